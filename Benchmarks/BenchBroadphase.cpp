@@ -0,0 +1,134 @@
+// Query cost of StaticBVH against a linear scan over the same world bounds as object count grows.
+// Objects are scattered at constant density, as in a level that grows outwards. Every query type
+// must return the same objects as the scan; exits non-zero on a mismatch.
+
+#include "BenchCommon.h"
+#include "StaticBVH.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Queries whose BVH results differ from the objects a linear scan accepts, compared as sorted ids
+template<typename Accept, typename Query>
+static unsigned int compareWithScan(unsigned int queries, unsigned int count, const Accept& accept, const Query& query)
+{
+	unsigned int wrong = 0;
+	std::vector<unsigned int> expected, got;
+	for (unsigned int q = 0; q < queries; q++)
+	{
+		expected.clear();
+		got.clear();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (accept(q, i)) expected.push_back(i);
+		}
+		query(q, [&](unsigned int id) { got.push_back(id); });
+		std::sort(got.begin(), got.end());
+		wrong += expected != got;
+	}
+	return wrong;
+}
+
+// Returns false when a BVH query disagrees with the scan
+static bool run(unsigned int count)
+{
+	BenchRandom rng;
+	float extent = 10.0f * sqrtf((float)count);
+	std::vector<WorldBounds> bounds(count);
+	std::vector<unsigned int> ids(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Vec3 c(rng.range(-extent, extent), rng.range(0.0f, 4.0f), rng.range(-extent, extent));
+		Vec3 h(rng.range(0.5f, 3.0f), rng.range(0.5f, 3.0f), rng.range(0.5f, 3.0f));
+		bounds[i] = { c - h, c + h };
+		ids[i] = i;
+	}
+
+	StaticBVH bvh;
+	double buildMs = benchBestOf(1, [&]() { bvh.build(bounds, ids); });
+
+	const unsigned int queries = 10000;
+	std::vector<Vec3> points(queries);
+	for (unsigned int q = 0; q < queries; q++)
+	{
+		points[q] = Vec3(rng.range(-extent, extent), rng.range(0.0f, 4.0f), rng.range(-extent, extent));
+	}
+	const float radius = 2.0f;
+	// The linear baseline is O(N) per query, so it only runs a sample at large sizes
+	const unsigned int linearQueries = count > 100000 ? 100 : (count > 10000 ? 1000 : queries);
+
+	uint64_t linearHits = 0, bvhHits = 0;
+	double linearPoint = benchBestOf(1, [&]() {
+		for (unsigned int q = 0; q < linearQueries; q++)
+			for (unsigned int i = 0; i < count; i++)
+				linearHits += bounds[i].contains(points[q]);
+	});
+	double bvhPoint = benchBestOf(3, [&]() {
+		bvhHits = 0;
+		for (unsigned int q = 0; q < linearQueries; q++)
+			bvh.queryPoint(points[q], [&](unsigned int) { bvhHits++; });
+	});
+	benchSink += linearHits + bvhHits;
+	unsigned int pointWrong = compareWithScan(linearQueries, count,
+		[&](unsigned int q, unsigned int i) { return bounds[i].contains(points[q]); },
+		[&](unsigned int q, const std::function<void(unsigned int)>& visit) { bvh.queryPoint(points[q], visit); });
+
+	linearHits = 0;
+	double linearSphere = benchBestOf(1, [&]() {
+		for (unsigned int q = 0; q < linearQueries; q++)
+			for (unsigned int i = 0; i < count; i++)
+				linearHits += StaticBVH::distanceSquared(bounds[i], points[q]) <= radius * radius;
+	});
+	double bvhSphere = benchBestOf(3, [&]() {
+		bvhHits = 0;
+		for (unsigned int q = 0; q < linearQueries; q++)
+			bvh.querySphere(points[q], radius, [&](unsigned int) { bvhHits++; });
+	});
+	benchSink += linearHits + bvhHits;
+	unsigned int sphereWrong = compareWithScan(linearQueries, count,
+		[&](unsigned int q, unsigned int i) { return StaticBVH::distanceSquared(bounds[i], points[q]) <= radius * radius; },
+		[&](unsigned int q, const std::function<void(unsigned int)>& visit) { bvh.querySphere(points[q], radius, visit); });
+
+	std::vector<WorldBounds> boxes(queries);
+	for (unsigned int q = 0; q < queries; q++)
+	{
+		boxes[q] = { points[q] - Vec3(radius, radius, radius), points[q] + Vec3(radius, radius, radius) };
+	}
+	linearHits = 0;
+	double linearBox = benchBestOf(1, [&]() {
+		for (unsigned int q = 0; q < linearQueries; q++)
+			for (unsigned int i = 0; i < count; i++)
+				linearHits += bounds[i].overlaps(boxes[q]);
+	});
+	double bvhBox = benchBestOf(3, [&]() {
+		bvhHits = 0;
+		for (unsigned int q = 0; q < queries; q++)
+			bvh.queryAABB(boxes[q], [&](unsigned int) { bvhHits++; });
+	});
+	benchSink += linearHits + bvhHits;
+	unsigned int boxWrong = compareWithScan(linearQueries, count,
+		[&](unsigned int q, unsigned int i) { return bounds[i].overlaps(boxes[q]); },
+		[&](unsigned int q, const std::function<void(unsigned int)>& visit) { bvh.queryAABB(boxes[q], visit); });
+
+	unsigned int wrong = pointWrong + sphereWrong + boxWrong;
+	printf("%8u objects | build %8.2f ms | per query: point linear %9.3f us, bvh %6.3f us | sphere linear %9.3f us, bvh %6.3f us | aabb linear %9.3f us, bvh %6.3f us | %s\n",
+		count, buildMs,
+		linearPoint * 1000.0 / linearQueries, bvhPoint * 1000.0 / linearQueries,
+		linearSphere * 1000.0 / linearQueries, bvhSphere * 1000.0 / linearQueries,
+		linearBox * 1000.0 / linearQueries, bvhBox * 1000.0 / queries,
+		wrong == 0 ? "ok" : "MISMATCH");
+	if (wrong != 0)
+	{
+		printf("MISMATCH: %u point, %u sphere, %u aabb queries of %u differ from the linear scan\n", pointWrong, sphereWrong, boxWrong, linearQueries);
+	}
+	return wrong == 0;
+}
+
+int main()
+{
+	bool ok = run(1000);
+	ok = run(10000) && ok;
+	ok = run(100000) && ok;
+	ok = run(1000000) && ok;
+	return ok ? 0 : 1;
+}
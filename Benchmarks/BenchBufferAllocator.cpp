@@ -0,0 +1,229 @@
+// OffsetAllocator, the TLSF allocator behind GPUBufferHeap: randomised allocate/free checked
+// against validate() and for overlaps, allocate/free throughput against a first-fit free list
+// (std::map, coalescing), fragmentation while streaming cells of meshes in and out of a 256 MB
+// heap, and the memory mesh buffers take sub-allocated versus as committed resources, which
+// D3D12 places at 64 KB granularity.
+
+#include "BenchCommon.h"
+#include "OffsetAllocator.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// Baseline: first fit over free ranges ordered by offset, merging neighbours on free
+class FirstFitAllocator
+{
+public:
+	explicit FirstFitAllocator(uint64_t capacity)
+	{
+		freeRanges[0] = capacity;
+	}
+
+	uint64_t allocate(uint64_t size)
+	{
+		size = (size + 15) & ~15ull;
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		{
+			if (it->second >= size)
+			{
+				uint64_t offset = it->first, rest = it->second - size;
+				freeRanges.erase(it);
+				if (rest > 0) freeRanges[offset + size] = rest;
+				return offset;
+			}
+		}
+		return ~0ull;
+	}
+
+	void free(uint64_t offset, uint64_t size)
+	{
+		size = (size + 15) & ~15ull;
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += size;
+				return;
+			}
+		}
+		freeRanges[offset] = size;
+	}
+
+private:
+	std::map<uint64_t, uint64_t> freeRanges;
+};
+
+// Mesh-like buffer sizes: index and vertex buffers of 24 to 65k vertices, skewed small
+static uint64_t meshBufferSize(BenchRandom& rng)
+{
+	uint64_t vertices = 24ull << (rng.next() % 12);
+	vertices += rng.next() % vertices;
+	return rng.next() % 2 ? vertices * 56 : vertices * 3 / 2 * 4;
+}
+
+static bool noOverlaps(std::vector<OffsetAllocator::Allocation> live, uint64_t capacity)
+{
+	std::sort(live.begin(), live.end(), [](const OffsetAllocator::Allocation& a, const OffsetAllocator::Allocation& b) { return a.offset < b.offset; });
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		if (live[i].offset + live[i].size > capacity) return false;
+		if (i > 0 && live[i - 1].offset + live[i - 1].size > live[i].offset) return false;
+	}
+	return true;
+}
+
+int main()
+{
+	BenchRandom rng;
+	bool ok = true;
+
+	// Randomised allocate/free with mixed alignments, checked as it goes
+	{
+		const uint64_t capacity = 64ull << 20;
+		OffsetAllocator allocator(capacity);
+		std::vector<OffsetAllocator::Allocation> live;
+		unsigned int failures = 0;
+		for (unsigned int step = 0; step < 200000 && ok; step++)
+		{
+			if (live.empty() || rng.next() % 100 < 55)
+			{
+				uint64_t alignment = 16ull << (rng.next() % 5);
+				OffsetAllocator::Allocation a = allocator.allocate(1 + rng.next() % 200000, alignment);
+				if (!a.valid())
+				{
+					failures++;
+					continue;
+				}
+				ok = ok && (a.offset & (alignment - 1)) == 0;
+				live.push_back(a);
+			}
+			else
+			{
+				size_t i = rng.next() % live.size();
+				allocator.free(live[i]);
+				live[i] = live.back();
+				live.pop_back();
+			}
+			if (step % 5000 == 0)
+			{
+				ok = ok && allocator.validate() && noOverlaps(live, capacity);
+			}
+		}
+		ok = ok && noOverlaps(live, capacity);
+		for (OffsetAllocator::Allocation& a : live) allocator.free(a);
+		ok = ok && allocator.validate() && allocator.freeBytes() == capacity && allocator.largestFreeBlock() == capacity;
+
+		// Exact fit of the whole range, then nothing left
+		OffsetAllocator::Allocation all = allocator.allocate(capacity);
+		ok = ok && all.valid() && !allocator.allocate(16).valid();
+		allocator.free(all);
+		printf("random allocate/free: 200000 steps, %u failed when full, %s\n", failures, ok ? "valid, no overlaps, merges back to one block" : "FAILED");
+	}
+
+	// Throughput: a steady working set of 2000 buffers with random replacement
+	{
+		const uint64_t capacity = 1ull << 32;
+		const unsigned int working = 2000, ops = 200000;
+		std::vector<uint64_t> sizes(ops);
+		std::vector<uint32_t> victims(ops);
+		for (unsigned int i = 0; i < ops; i++)
+		{
+			sizes[i] = meshBufferSize(rng);
+			victims[i] = rng.next() % working;
+		}
+
+		double tlsfMs = benchBestOf(3, [&]() {
+			OffsetAllocator allocator(capacity);
+			std::vector<OffsetAllocator::Allocation> live(working);
+			for (unsigned int i = 0; i < working; i++) live[i] = allocator.allocate(sizes[i]);
+			for (unsigned int i = working; i < ops; i++)
+			{
+				allocator.free(live[victims[i]]);
+				live[victims[i]] = allocator.allocate(sizes[i]);
+			}
+			benchSink += allocator.allocationCount();
+		});
+		double firstFitMs = benchBestOf(3, [&]() {
+			FirstFitAllocator allocator(capacity);
+			std::vector<std::pair<uint64_t, uint64_t>> live(working);
+			for (unsigned int i = 0; i < working; i++) live[i] = { allocator.allocate(sizes[i]), sizes[i] };
+			for (unsigned int i = working; i < ops; i++)
+			{
+				allocator.free(live[victims[i]].first, live[victims[i]].second);
+				live[victims[i]] = { allocator.allocate(sizes[i]), sizes[i] };
+			}
+			benchSink += live[0].first;
+		});
+		unsigned int pairs = ops - working;
+		printf("throughput, %u buffers live, %u free+allocate pairs: TLSF %.1f ns per pair, first fit %.1f ns per pair (x%.1f)\n",
+			working, pairs, tlsfMs * 1e6 / pairs, firstFitMs * 1e6 / pairs, firstFitMs / tlsfMs);
+	}
+
+	// Fragmentation while streaming: cells of 20-60 buffers load and unload around a 256 MB heap
+	{
+		const uint64_t capacity = 256ull << 20;
+		OffsetAllocator allocator(capacity);
+		std::vector<std::vector<OffsetAllocator::Allocation>> cells;
+		unsigned int rounds = 5000, failures = 0;
+		double fragmentationSum = 0.0, fragmentationMax = 0.0;
+		uint64_t peak = 0;
+		for (unsigned int round = 0; round < rounds; round++)
+		{
+			bool load = cells.empty() || (allocator.freeBytes() > capacity / 4 && rng.next() % 2);
+			if (load)
+			{
+				std::vector<OffsetAllocator::Allocation> cell;
+				unsigned int count = 20 + rng.next() % 41;
+				for (unsigned int i = 0; i < count; i++)
+				{
+					OffsetAllocator::Allocation a = allocator.allocate(meshBufferSize(rng));
+					if (a.valid()) cell.push_back(a);
+					else failures++;
+				}
+				cells.push_back(cell);
+			}
+			else
+			{
+				size_t c = rng.next() % cells.size();
+				for (OffsetAllocator::Allocation& a : cells[c]) allocator.free(a);
+				cells[c] = cells.back();
+				cells.pop_back();
+			}
+			peak = (std::max)(peak, capacity - allocator.freeBytes());
+			double f = allocator.fragmentation();
+			fragmentationSum += f;
+			fragmentationMax = (std::max)(fragmentationMax, f);
+		}
+		ok = ok && allocator.validate();
+		printf("streaming %u rounds: peak %.1f MB of %llu MB, fragmentation mean %.1f%% max %.1f%%, %u allocations failed\n", rounds,
+			peak / 1048576.0, (unsigned long long)(capacity >> 20), 100.0 * fragmentationSum / rounds, 100.0 * fragmentationMax, failures);
+	}
+
+	// Footprint: the scene's own small meshes plus a spread of level meshes
+	{
+		std::vector<uint64_t> buffers = {
+			24 * 56, 36 * 4,   // Cube
+			4 * 56, 6 * 4      // Plane
+		};
+		for (unsigned int i = 0; i < 400; i++) buffers.push_back(meshBufferSize(rng));
+		uint64_t committed = 0, subAllocated = 0, data = 0;
+		OffsetAllocator allocator(1ull << 32);
+		for (uint64_t size : buffers)
+		{
+			data += size;
+			committed += (size + 65535) & ~65535ull;
+			subAllocated += allocator.allocate(size).valid() ? (size + 15) & ~15ull : 0;
+		}
+		printf("%zu mesh buffers, %.2f MB of data: %.2f MB as committed resources, %.2f MB sub-allocated (Cube: 64 KB + 64 KB vs %llu B)\n",
+			buffers.size(), data / 1048576.0, committed / 1048576.0, subAllocated / 1048576.0,
+			(unsigned long long)(((24 * 56 + 15) & ~15) + ((36 * 4 + 15) & ~15)));
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// CharacterController step cost with many agents walking over a heightfield with thin walls,
+// plus a tunnelling check: a fast body fired at a zero-thickness wall must stop in front of it, and
+// a fall check: a body dropped fast onto the hills must land on them, as must every walking agent.
+// Exits non-zero when either fails.
+
+#include "BenchCommon.h"
+#include "CharacterController.h"
+#include <vector>
+
+struct World
+{
+	std::vector<Vec3> positions;
+	std::vector<unsigned int> indices;
+	MeshBVH bvh;
+
+	void quad(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+	{
+		unsigned int base = (unsigned int)positions.size();
+		positions.push_back(a);
+		positions.push_back(b);
+		positions.push_back(c);
+		positions.push_back(d);
+		unsigned int q[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+		indices.insert(indices.end(), q, q + 6);
+	}
+
+	bool sweep(const Vec3& c, const Vec3& d, float r, MeshBVH::SweepHit& hit) const
+	{
+		return bvh.sphereCast(c, d, r, hit);
+	}
+};
+
+static float terrainHeight(float x, float z)
+{
+	return 0.6f * sinf(x * 0.15f) * cosf(z * 0.11f);
+}
+
+static bool overHeightfield(const Vec3& p, unsigned int n)
+{
+	return p.x >= 0.0f && p.z >= 0.0f && p.x <= (float)n && p.z <= (float)n;
+}
+
+// True when a sphere centre over the heightfield has sunk through it
+static bool fellThrough(const Vec3& p, unsigned int n)
+{
+	return overHeightfield(p, n) && p.y < terrainHeight(p.x, p.z) - 0.1f;
+}
+
+// Gentle hills with a grid of thin vertical walls and low ledges to step onto
+static void buildWorld(World& w, unsigned int n)
+{
+	for (unsigned int z = 0; z < n; z++)
+	{
+		for (unsigned int x = 0; x < n; x++)
+		{
+			auto h = terrainHeight;
+			float fx = (float)x, fz = (float)z;
+			w.quad(Vec3(fx, h(fx, fz), fz), Vec3(fx, h(fx, fz + 1), fz + 1), Vec3(fx + 1, h(fx + 1, fz + 1), fz + 1), Vec3(fx + 1, h(fx + 1, fz), fz));
+		}
+	}
+	for (unsigned int i = 8; i < n; i += 16)
+	{
+		float f = (float)i;
+		w.quad(Vec3(f, -1, 2), Vec3(f, 3, 2), Vec3(f, 3, f), Vec3(f, -1, f));                 // wall along z
+		w.quad(Vec3(2, -1, f), Vec3(2, 3, f), Vec3(f * 0.5f, 3, f), Vec3(f * 0.5f, -1, f));   // wall along x
+		w.quad(Vec3(f + 2, 1.0f, f + 2), Vec3(f + 2, 1.0f, f + 5), Vec3(f + 5, 1.0f, f + 5), Vec3(f + 5, 1.0f, f + 2));   // ledge top
+	}
+	w.bvh.build(w.positions, w.indices);
+}
+
+struct Agent
+{
+	CharacterController controller;
+	Vec3 position;
+	Vec3 velocity;
+	bool walkedOff = false;   // left the heightfield at its edge, so may come back under it
+};
+
+// Returns the agents that ended up below the ground without walking off its edge
+static unsigned int run(const World& world, unsigned int count, unsigned int n)
+{
+	BenchRandom rng;
+	std::vector<Agent> agents(count);
+	for (Agent& a : agents)
+	{
+		a.position = Vec3(rng.range(4.0f, n - 4.0f), 3.0f, rng.range(4.0f, n - 4.0f));
+	}
+	const float dt = 1.0f / 60.0f;
+	const int frames = 240;
+	auto sweep = [&](const Vec3& c, const Vec3& d, float r, MeshBVH::SweepHit& hit) { return world.sweep(c, d, r, hit); };
+
+	double worst = 0.0, total = 0.0;
+	for (int f = 0; f < frames; f++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Agent& a = agents[i];
+			// Steer: wander horizontally at running speed, gravity, occasional jumps
+			if ((f + i) % 60 == 0)
+			{
+				float angle = rng.range(0.0f, 6.2831853f);
+				a.velocity.x = cosf(angle) * 6.0f;
+				a.velocity.z = sinf(angle) * 6.0f;
+				if (a.controller.onGround && (rng.next() & 3) == 0)
+				{
+					a.velocity.y = 5.0f;
+				}
+			}
+			a.velocity.y -= 9.8f * dt;
+			a.controller.move(a.position, a.velocity, dt, sweep);
+			a.walkedOff = a.walkedOff || !overHeightfield(a.position, n);
+		}
+		double ms = benchElapsedMs(start);
+		total += ms;
+		worst = ms > worst ? ms : worst;
+	}
+
+	unsigned int sweeps = 0, steps = 0, grounded = 0, walkedOff = 0, fell = 0;
+	for (const Agent& a : agents)
+	{
+		sweeps += a.controller.stats.sweeps;
+		steps += a.controller.stats.steps;
+		grounded += a.controller.onGround;
+		walkedOff += a.walkedOff;
+		fell += !a.walkedOff && fellThrough(a.position, n);
+	}
+	double perStep = total * 1000.0 / ((double)frames * count);
+	printf("%5u agents | %6.3f ms/frame avg, %6.3f worst (%.1f%% of 16.6 ms) | %6.2f us/agent-step | %.2f sweeps/step | %u step-ups | %u grounded | %u walked off | %u fell through\n",
+		count, total / frames, worst, 100.0 * (total / frames) / 16.6, perStep,
+		(double)sweeps / ((double)frames * count), steps, grounded, walkedOff, fell);
+	return fell;
+}
+
+int main()
+{
+	const unsigned int n = 128;
+	World world;
+	buildWorld(world, n);
+	printf("world: %u triangles\n", world.bvh.triangleCount());
+
+	auto sweep = [&](const Vec3& cc, const Vec3& d, float r, MeshBVH::SweepHit& hit) { return world.sweep(cc, d, r, hit); };
+	bool ok = true;
+
+	// Tunnelling: 300 m/s at a zero-thickness wall at x = 24, one 60 Hz step covers 5 m
+	{
+		CharacterController c;
+		Vec3 p(21.0f, 2.0f, 10.0f), v(300.0f, 0.0f, 0.0f);
+		for (int i = 0; i < 10; i++)
+		{
+			c.move(p, v, 1.0f / 60.0f, sweep);
+		}
+		ok = ok && p.x < 24.0f;
+		printf("tunnelling: body at x = %.3f after firing at wall x = 24 (%s)\n", p.x, p.x < 24.0f ? "stopped" : "TUNNELLED");
+	}
+
+	// Falling: 200 m/s straight down from 30 m, over 3 m per step, must come to rest on the hills
+	{
+		CharacterController c;
+		Vec3 p(40.5f, 30.0f, 50.5f), v(0.0f, -200.0f, 0.0f);
+		for (int i = 0; i < 30; i++)
+		{
+			v.y -= 9.8f / 60.0f;
+			c.move(p, v, 1.0f / 60.0f, sweep);
+		}
+		float ground = terrainHeight(p.x, p.z);
+		bool landed = c.onGround && !fellThrough(p, n) && p.y < ground + c.radius + 0.1f;
+		ok = ok && landed;
+		printf("falling: body at y = %.3f over ground at y = %.3f (%s)\n", p.y, ground, landed ? "landed" : "FELL THROUGH");
+	}
+
+	unsigned int fell = run(world, 100, n);
+	fell += run(world, 500, n);
+	fell += run(world, 1000, n);
+	return ok && fell == 0 ? 0 : 1;
+}
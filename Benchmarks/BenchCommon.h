@@ -0,0 +1,50 @@
+#pragma once
+// Shared helpers for the headless benchmarks (no window or GPU required)
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+inline double benchElapsedMs(BenchClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// Runs 'body' 'repeats' times and returns the best wall time in milliseconds
+template<typename F>
+double benchBestOf(int repeats, F body)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		body();
+		double ms = benchElapsedMs(start);
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
+
+// Small deterministic generator so runs are comparable
+struct BenchRandom
+{
+	uint32_t state = 0x12345678;
+
+	uint32_t next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// Uniform float in [lo, hi)
+	float range(float lo, float hi)
+	{
+		return lo + (hi - lo) * ((next() & 0xFFFFFF) / 16777216.0f);
+	}
+};
+
+// Keeps results observable so the optimiser cannot drop the measured loops
+static volatile uint64_t benchSink = 0;
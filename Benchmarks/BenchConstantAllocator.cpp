@@ -0,0 +1,240 @@
+// Constant buffer memory without a GPU: frames of draws, each taking a 256-byte entry stamped with
+// its frame and draw, with the GPU two frames behind as Core::beginFrame allows. A frame's entries
+// are checked when its fence completes. The old fixed ring (1024 entries per shader, wrapping
+// whatever the GPU is doing) against FrameLinearAllocator, which grows on demand and reuses a
+// frame's slabs only after its fence. Also checks mixed sizes and alignments, and allocation from
+// several threads at once, and reports peak usage per frame, slabs reserved and cost per allocation.
+
+#include "BenchCommon.h"
+#include "FrameLinearAllocator.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+static const unsigned int ENTRY_SIZE = 256;
+static const unsigned int FRAMES_IN_FLIGHT = 2;
+static const uint64_t SLAB_SIZE = 1024 * 1024;
+
+struct Stamp
+{
+	uint32_t frame;
+	uint32_t draw;
+};
+
+// Memory behind the slabs, as ConstantAllocator's mapped upload buffers
+struct SlabMemory
+{
+	std::vector<std::vector<unsigned char>> slabs = std::vector<std::vector<unsigned char>>(FrameLinearAllocator::MAX_SLABS);
+
+	void create(uint32_t slab, uint64_t size)
+	{
+		slabs[slab].assign(size, 0);
+	}
+
+	unsigned char* at(const FrameLinearAllocator::Allocation& a)
+	{
+		return slabs[a.slab].data() + a.offset;
+	}
+};
+
+// ConstantBufferClass before: a fixed ring that wraps
+struct FixedRing
+{
+	std::vector<unsigned char> buffer = std::vector<unsigned char>(ENTRY_SIZE * 1024);
+	std::atomic<unsigned int> offsetIndex{ 0 };
+
+	unsigned char* reserve()
+	{
+		unsigned int entry = offsetIndex.load(std::memory_order_relaxed);
+		while (!offsetIndex.compare_exchange_weak(entry, entry + 1 >= 1024 ? 0 : entry + 1, std::memory_order_relaxed))
+		{
+		}
+		return &buffer[entry * ENTRY_SIZE];
+	}
+};
+
+// Draws per frame: mostly a few hundred, with spikes past the ring's 1024
+static std::vector<unsigned int> frameDraws(BenchRandom& rng, unsigned int frames)
+{
+	std::vector<unsigned int> draws(frames);
+	for (unsigned int& d : draws)
+	{
+		d = rng.next() % 10 == 0 ? 2000 + rng.next() % 8000 : 200 + rng.next() % 600;
+	}
+	return draws;
+}
+
+// Runs the frames, checking each frame's stamps when the GPU would have finished reading them;
+// returns how many entries were overwritten first
+template<typename Reserve, typename Reclaim, typename Close>
+static unsigned int runFrames(const std::vector<unsigned int>& draws, const Reserve& reserve, const Reclaim& reclaim, const Close& close)
+{
+	std::vector<std::vector<unsigned char*>> inFlight(draws.size());
+	unsigned int corrupted = 0;
+	for (unsigned int f = 0; f < draws.size() + FRAMES_IN_FLIGHT; f++)
+	{
+		// beginFrame: wait for frame f - 2, the GPU has read its entries
+		if (f >= FRAMES_IN_FLIGHT)
+		{
+			unsigned int done = f - FRAMES_IN_FLIGHT;
+			for (unsigned int d = 0; d < inFlight[done].size(); d++)
+			{
+				Stamp s;
+				memcpy(&s, inFlight[done][d], sizeof(s));
+				corrupted += s.frame != done || s.draw != d;
+			}
+			inFlight[done].clear();
+			reclaim(done + 1);
+		}
+		if (f >= draws.size())
+		{
+			continue;
+		}
+		for (unsigned int d = 0; d < draws[f]; d++)
+		{
+			unsigned char* entry = reserve();
+			Stamp s = { f, d };
+			memcpy(entry, &s, sizeof(s));
+			inFlight[f].push_back(entry);
+		}
+		// finishFrame: signal fence value f + 1
+		close(f + 1);
+	}
+	return corrupted;
+}
+
+int main()
+{
+	BenchRandom rng;
+	bool ok = true;
+	const unsigned int frames = 300;
+	std::vector<unsigned int> draws = frameDraws(rng, frames);
+	unsigned long long totalDraws = 0;
+	unsigned int maxDraws = 0;
+	for (unsigned int d : draws)
+	{
+		totalDraws += d;
+		maxDraws = (std::max)(maxDraws, d);
+	}
+	printf("%u frames, %llu draws (up to %u per frame), %u-byte entries, GPU %u frames behind\n", frames, totalDraws, maxDraws,
+		ENTRY_SIZE, FRAMES_IN_FLIGHT);
+
+	// Fixed ring: wraps over entries still in flight
+	{
+		FixedRing ring;
+		unsigned int corrupted = runFrames(draws, [&]() { return ring.reserve(); }, [](uint64_t) {}, [](uint64_t) {});
+		printf("fixed 1024-entry ring:   %6u entries overwritten before the GPU read them, 0.25 MB\n", corrupted);
+	}
+
+	// Frame linear allocator: grows, reuses after the fence
+	{
+		FrameLinearAllocator allocator;
+		allocator.init(SLAB_SIZE);
+		SlabMemory memory;
+		auto create = [&](uint32_t slab, uint64_t size) { memory.create(slab, size); };
+		unsigned int corrupted = runFrames(draws,
+			[&]() { return memory.at(allocator.allocate(ENTRY_SIZE, 256, create)); },
+			[&](uint64_t completed) { allocator.reclaim(completed); },
+			[&](uint64_t fence) { allocator.close(fence); });
+		ok = ok && corrupted == 0 && allocator.stats.failed == 0;
+		printf("frame linear allocator:  %6u entries overwritten before the GPU read them, %.2f MB in %u slabs; peak %.1f KB per frame\n",
+			corrupted, allocator.reservedBytes() / 1048576.0, allocator.slabTotal(), allocator.stats.peakFrameBytes / 1024.0);
+	}
+
+	// Mixed sizes and alignments in one frame: aligned, inside their slab, no overlaps
+	{
+		FrameLinearAllocator allocator;
+		allocator.init(SLAB_SIZE);
+		SlabMemory memory;
+		struct Range
+		{
+			uint32_t slab;
+			uint64_t begin, end;
+		};
+		std::vector<Range> ranges;
+		bool aligned = true;
+		for (unsigned int i = 0; i < 20000; i++)
+		{
+			uint64_t size = 1 + rng.next() % (rng.next() % 50 == 0 ? 200000 : 4096);
+			uint64_t alignment = 16ull << (rng.next() % 9);
+			FrameLinearAllocator::Allocation a = allocator.allocate(size, alignment, [&](uint32_t slab, uint64_t bytes) { memory.create(slab, bytes); });
+			aligned = aligned && a.valid() && a.offset % alignment == 0 && a.offset + size <= allocator.slabBytes(a.slab);
+			ranges.push_back({ a.slab, a.offset, a.offset + size });
+		}
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.slab != b.slab ? a.slab < b.slab : a.begin < b.begin; });
+		bool disjoint = true;
+		for (size_t i = 1; i < ranges.size(); i++)
+		{
+			disjoint = disjoint && (ranges[i].slab != ranges[i - 1].slab || ranges[i].begin >= ranges[i - 1].end);
+		}
+		allocator.close(1);
+		ok = ok && aligned && disjoint;
+		printf("mixed sizes (1 B-200 KB) and alignments (16 B-4 KB): 20000 allocations, %s, %s; %.1f MB used in %u slabs\n",
+			aligned ? "aligned" : "MISALIGNED", disjoint ? "no overlaps" : "OVERLAPS", allocator.stats.frameBytes / 1048576.0, allocator.stats.frameSlabs);
+	}
+
+	// Several recording threads per frame, as Game::render's chunks
+	{
+		JobSystem jobs(4);
+		const unsigned int perFrame = 50000, threadFrames = 20;
+		FrameLinearAllocator allocator;
+		allocator.init(SLAB_SIZE);
+		SlabMemory memory;
+		std::vector<FrameLinearAllocator::Allocation> taken(perFrame);
+		bool disjoint = true;
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned int f = 0; f < threadFrames; f++)
+		{
+			if (f >= FRAMES_IN_FLIGHT) allocator.reclaim(f - FRAMES_IN_FLIGHT + 1);
+			jobs.parallelFor(perFrame, 256, [&](unsigned int begin, unsigned int end) {
+				for (unsigned int i = begin; i < end; i++)
+				{
+					taken[i] = allocator.allocate(ENTRY_SIZE, 256, [&](uint32_t slab, uint64_t size) { memory.create(slab, size); });
+					memcpy(memory.at(taken[i]), &i, sizeof(i));
+				}
+			});
+			allocator.close(f + 1);
+			std::sort(taken.begin(), taken.end(), [](const FrameLinearAllocator::Allocation& a, const FrameLinearAllocator::Allocation& b) {
+				return a.slab != b.slab ? a.slab < b.slab : a.offset < b.offset;
+			});
+			for (unsigned int i = 0; i < perFrame; i++)
+			{
+				disjoint = disjoint && taken[i].valid();
+				if (i > 0 && taken[i].slab == taken[i - 1].slab) disjoint = disjoint && taken[i].offset >= taken[i - 1].offset + ENTRY_SIZE;
+			}
+		}
+		double ms = benchElapsedMs(start);
+		ok = ok && disjoint;
+		printf("%u threads, %u frames of %u draws: %s, %u slabs (%.1f MB), %.1f ms including checks\n", jobs.threadCount(), threadFrames,
+			perFrame, disjoint ? "no overlaps" : "OVERLAPS", allocator.slabTotal(), allocator.reservedBytes() / 1048576.0, ms);
+	}
+
+	// Cost per allocation on one thread
+	{
+		const unsigned int count = 1000000;
+		FixedRing ring;
+		double ringMs = benchBestOf(5, [&]() {
+			for (unsigned int i = 0; i < count; i++) benchSink += ring.reserve()[0];
+		});
+		FrameLinearAllocator allocator;
+		allocator.init(SLAB_SIZE);
+		SlabMemory memory;
+		uint64_t fence = 0;
+		double linearMs = benchBestOf(5, [&]() {
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (i % 10000 == 0)
+				{
+					allocator.close(++fence);
+					allocator.reclaim(fence > FRAMES_IN_FLIGHT ? fence - FRAMES_IN_FLIGHT : 0);
+				}
+				benchSink += memory.at(allocator.allocate(ENTRY_SIZE, 256, [&](uint32_t slab, uint64_t size) { memory.create(slab, size); }))[0];
+			}
+		});
+		printf("per allocation: fixed ring %.1f ns, frame linear allocator %.1f ns (frames of 10000)\n", ringMs * 1e6 / count,
+			linearMs * 1e6 / count);
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Per-draw constant buffer writes without a GPU: StaticMesh's four variables written into a ring of
+// 256-byte entries for 100k draws. Before, each variable was found by a std::string (copied per
+// call) in a std::map, inserting on a miss; now reflection gives a flat layout, draws either write
+// through integer handles resolved at load or copy one struct that matches the cbuffer. Reports CPU
+// time per 100k draws and checks all three leave identical buffer contents.
+
+#include "BenchCommon.h"
+#include "maths.h"
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Variable
+{
+	unsigned int offset;
+	unsigned int size;
+};
+
+// VertexShader.hlsl's staticMeshBuffer as reflected: W 0, VP 64, time 128, cameraPos 132
+static const char* names[4] = { "W", "VP", "time", "cameraPos" };
+static const Variable reflected[4] = { { 0, 64 }, { 64, 64 }, { 128, 4 }, { 132, 12 } };
+
+// Mirrors StaticMesh::Constants
+struct Constants
+{
+	Matrix W;
+	Matrix VP;
+	float time;
+	Vec3 cameraPos;
+};
+
+// The ring both versions write into, as ConstantBufferClass
+struct Ring
+{
+	std::vector<unsigned char> buffer;
+	unsigned int cbSizeInBytes = 256;
+	unsigned int maxDrawCalls = 1024;
+	unsigned int offsetIndex = 0;
+
+	Ring()
+	{
+		buffer.assign(cbSizeInBytes * maxDrawCalls, 0);
+	}
+
+	unsigned int reserve()
+	{
+		unsigned int entry = offsetIndex;
+		offsetIndex = offsetIndex + 1 >= maxDrawCalls ? 0 : offsetIndex + 1;
+		return entry;
+	}
+};
+
+// ConstantBufferClass before: name by value, std::map operator[]
+struct MapConstantBuffer : Ring
+{
+	std::map<std::string, Variable> constantBufferData;
+
+	MapConstantBuffer()
+	{
+		for (int i = 0; i < 4; i++) constantBufferData.insert({ names[i], reflected[i] });
+	}
+
+	void update(unsigned int entry, std::string name, const void* data)
+	{
+		Variable v = constantBufferData[name];
+		memcpy(&buffer[entry * cbSizeInBytes + v.offset], data, v.size);
+	}
+};
+
+// ConstantBufferClass now: flat layout, handles and whole-struct writes
+struct LayoutConstantBuffer : Ring
+{
+	std::vector<std::string> variableNames;
+	std::vector<Variable> variables;
+
+	LayoutConstantBuffer()
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			variableNames.push_back(names[i]);
+			variables.push_back(reflected[i]);
+		}
+	}
+
+	int variable(const std::string& name) const
+	{
+		for (unsigned int i = 0; i < variableNames.size(); i++)
+		{
+			if (variableNames[i] == name) return (int)i;
+		}
+		return -1;
+	}
+
+	void update(unsigned int entry, int v, const void* data)
+	{
+		if (v < 0) return;
+		memcpy(&buffer[entry * cbSizeInBytes + variables[v].offset], data, variables[v].size);
+	}
+
+	template<typename T>
+	void write(unsigned int entry, const T& data)
+	{
+		memcpy(&buffer[entry * cbSizeInBytes], &data, sizeof(T));
+	}
+};
+
+struct Draw
+{
+	Matrix w;
+	float time;
+};
+
+int main()
+{
+	const unsigned int drawCount = 100000;
+	BenchRandom rng;
+	std::vector<Draw> draws(drawCount);
+	for (Draw& d : draws)
+	{
+		d.w.translation(Vec3(rng.range(-100.0f, 100.0f), rng.range(0.0f, 10.0f), rng.range(-100.0f, 100.0f)));
+		d.time = rng.range(0.0f, 60.0f);
+	}
+	Matrix vp;
+	vp.translation(Vec3(1.0f, 2.0f, 3.0f));
+	Vec3 camPos(4.0f, 5.0f, 6.0f);
+
+	bool layoutOk = offsetof(Constants, W) == reflected[0].offset && offsetof(Constants, VP) == reflected[1].offset &&
+		offsetof(Constants, time) == reflected[2].offset && offsetof(Constants, cameraPos) == reflected[3].offset &&
+		sizeof(Constants) == 144;
+
+	MapConstantBuffer byName;
+	double nameMs = benchBestOf(5, [&]() {
+		for (Draw& d : draws)
+		{
+			unsigned int entry = byName.reserve();
+			byName.update(entry, "W", &d.w);
+			byName.update(entry, "VP", &vp);
+			byName.update(entry, "time", &d.time);
+			byName.update(entry, "cameraPos", &camPos);
+		}
+		benchSink += byName.buffer[7];
+	});
+
+	LayoutConstantBuffer byHandle;
+	int handles[4];
+	for (int i = 0; i < 4; i++) handles[i] = byHandle.variable(names[i]);
+	double handleMs = benchBestOf(5, [&]() {
+		for (Draw& d : draws)
+		{
+			unsigned int entry = byHandle.reserve();
+			byHandle.update(entry, handles[0], &d.w);
+			byHandle.update(entry, handles[1], &vp);
+			byHandle.update(entry, handles[2], &d.time);
+			byHandle.update(entry, handles[3], &camPos);
+		}
+		benchSink += byHandle.buffer[7];
+	});
+
+	LayoutConstantBuffer byStruct;
+	double structMs = benchBestOf(5, [&]() {
+		for (Draw& d : draws)
+		{
+			Constants constants;
+			constants.W = d.w;
+			constants.VP = vp;
+			constants.time = d.time;
+			constants.cameraPos = camPos;
+			byStruct.write(byStruct.reserve(), constants);
+		}
+		benchSink += byStruct.buffer[7];
+	});
+
+	bool same = byName.offsetIndex == byHandle.offsetIndex && byName.offsetIndex == byStruct.offsetIndex &&
+		byName.buffer == byHandle.buffer && byName.buffer == byStruct.buffer;
+	printf("%u draws, 4 variables each (144-byte cbuffer)\n", drawCount);
+	printf("by name (std::string + std::map): %7.2f ms per 100k draws\n", nameMs * 100000.0 / drawCount);
+	printf("by handle:                        %7.2f ms per 100k draws (x%.1f)\n", handleMs * 100000.0 / drawCount, nameMs / handleMs);
+	printf("one struct copy:                  %7.2f ms per 100k draws (x%.1f)\n", structMs * 100000.0 / drawCount, nameMs / structMs);
+	printf("struct matches reflected layout: %s; buffers %s\n", layoutOk ? "yes" : "NO", same ? "identical" : "DIFFER");
+	return layoutOk && same ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// Frustum culling of 1M random world boxes: per-box scalar test against the batched SSE culler,
+// single-threaded and split over the job system. Checks both produce the same visible set.
+
+#include "BenchCommon.h"
+#include "Frustum.h"
+#include <vector>
+
+int main()
+{
+	// Same view-projection Camera::getViewProjection builds
+	Matrix p, v;
+	Matrix projection = p.perspectiveProjection(1024.0f / 768.0f, 60.0f, 0.1f, 1000.0f);
+	Matrix view = v.lookAtMatrix(Vec3(0, 2, -10), Vec3(0, 5, 0), Vec3(0, 1, 0));
+	Frustum frustum;
+	frustum.fromViewProjection(projection.multiply(view));
+
+	bool planesOk = frustum.intersectsAABB(Vec3(0, 3, 20), Vec3(0.1f, 0.1f, 0.1f))
+		&& !frustum.intersectsAABB(Vec3(0, 2, -30), Vec3(0.1f, 0.1f, 0.1f))
+		&& !frustum.intersectsAABB(Vec3(0, 2, 2000), Vec3(0.1f, 0.1f, 0.1f))
+		&& !frustum.intersectsAABB(Vec3(500, 2, 10), Vec3(0.1f, 0.1f, 0.1f));
+	printf("plane sanity: %s\n", planesOk ? "ok" : "FAILED");
+
+	JobSystem jobs;
+	unsigned int counts[] = { 1000, 100000, 1000000 };
+	for (unsigned int count : counts)
+	{
+		BenchRandom rng;
+		std::vector<Vec3> mins(count), maxs(count);
+		CullBounds bounds;
+		bounds.reserve(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Vec3 c(rng.range(-600, 600), rng.range(-100, 100), rng.range(-600, 600));
+			Vec3 e(rng.range(0.2f, 3), rng.range(0.2f, 3), rng.range(0.2f, 3));
+			mins[i] = c - e;
+			maxs[i] = c + e;
+			bounds.add(mins[i], maxs[i]);
+		}
+
+		std::vector<unsigned int> reference;
+		reference.reserve(count);
+		double scalarMs = benchBestOf(5, [&]() {
+			reference.clear();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				Vec3 centre = (mins[i] + maxs[i]) * 0.5f;
+				Vec3 extent = (maxs[i] - mins[i]) * 0.5f;
+				if (frustum.intersectsAABB(centre, extent))
+				{
+					reference.push_back(i);
+				}
+			}
+		});
+
+		FrustumCuller culler;
+		double batchedMs = benchBestOf(5, [&]() { culler.cull(bounds, frustum); });
+		bool same = culler.visible == reference;
+		double jobsMs = benchBestOf(5, [&]() { culler.cull(bounds, frustum, &jobs); });
+		same = same && culler.visible == reference;
+
+		printf("%8u boxes | %7u visible | scalar %8.3f ms | batched %8.3f ms (x%.1f) | batched x%u threads %8.3f ms | %s\n",
+			count, culler.stats.visible, scalarMs, batchedMs, scalarMs / batchedMs, jobs.threadCount(), jobsMs,
+			same ? "match" : "MISMATCH");
+		if (!same || !planesOk)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
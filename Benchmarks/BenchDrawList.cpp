@@ -0,0 +1,134 @@
+// Frame draw list: 100k submesh draws keyed (pass, PSO, material, mesh, depth) as the per-object
+// path in Game::render builds them. Measures the LSD radix sort against std::stable_sort, checks
+// both give the same order, and submits the draws unsorted and sorted through a RecordingBackend
+// with redundant-state elimination to count the binds each order saves.
+
+#include "BenchCommon.h"
+#include "CommandRecorder.h"
+#include "DrawList.h"
+#include <algorithm>
+#include <vector>
+
+// A prototype as StaticMesh holds it: its own PSO, one mesh and material per submesh
+struct Prototype
+{
+	int pso = 0;
+	std::vector<uint32_t> meshes;
+	std::vector<uint32_t> materials;
+};
+
+struct SubmeshDraw
+{
+	uint32_t prototype;
+	uint32_t submesh;
+};
+
+static int rootSignature;
+
+// Mirrors StaticMesh::drawSubmesh: both shader constant buffers advance per draw, then PSO and mesh
+static void submit(CommandRecorder& commands, const std::vector<Prototype>& prototypes, const SubmeshDraw& draw, uint64_t& ring)
+{
+	const Prototype& p = prototypes[draw.prototype];
+	commands.setRootConstantBuffer(0, ring += 256);
+	commands.setRootConstantBuffer(1, ring += 256);
+	commands.setPipelineState(&p.pso);
+	uint32_t mesh = p.meshes[draw.submesh];
+	VertexBufferView vb;
+	vb.address = 0x100000000ull + mesh * 0x10000ull;
+	vb.sizeInBytes = 0x8000;
+	vb.strideInBytes = 56;
+	IndexBufferView ib;
+	ib.address = vb.address + 0x8000;
+	ib.sizeInBytes = 0x8000;
+	ib.format = 42;
+	commands.setTopology(TOPOLOGY_TRIANGLE_LIST);
+	commands.setVertexBuffer(0, vb);
+	commands.setIndexBuffer(ib);
+	commands.drawIndexed(6000);
+}
+
+static CommandStats record(const std::vector<Prototype>& prototypes, const std::vector<SubmeshDraw>& draws, const DrawList& order)
+{
+	RecordingBackend commands;
+	commands.skipRedundant = true;
+	RenderViewport v;
+	v.width = 1024.0f;
+	v.height = 768.0f;
+	RenderScissor r;
+	r.right = 1024;
+	r.bottom = 768;
+	commands.setViewport(v);
+	commands.setScissor(r);
+	commands.setRootSignature(&rootSignature);
+	uint64_t ring = 0x10000;
+	for (const DrawList::Item& item : order.items)
+	{
+		submit(commands, prototypes, draws[item.payload], ring);
+	}
+	return commands.stats;
+}
+
+int main()
+{
+	const unsigned int prototypeCount = 200, materialCount = 64, drawCount = 100000;
+	BenchRandom rng;
+
+	std::vector<Prototype> prototypes(prototypeCount);
+	uint32_t nextMesh = 0;
+	for (Prototype& p : prototypes)
+	{
+		unsigned int submeshes = 1 + rng.next() % 3;
+		for (unsigned int s = 0; s < submeshes; s++)
+		{
+			p.meshes.push_back(nextMesh++);
+			p.materials.push_back(rng.next() % materialCount);
+		}
+	}
+
+	// Visible objects in scene order, every submesh a draw
+	std::vector<SubmeshDraw> draws;
+	DrawList unsorted;
+	while (draws.size() < drawCount)
+	{
+		uint32_t proto = rng.next() % prototypeCount;
+		uint32_t depth = DrawKey::depth(rng.range(0.0f, 1000.0f), 1000.0f);
+		for (uint32_t s = 0; s < prototypes[proto].meshes.size() && draws.size() < drawCount; s++)
+		{
+			uint64_t key = DrawKey::make(DrawKey::PASS_OPAQUE, proto, prototypes[proto].materials[s], prototypes[proto].meshes[s], depth);
+			unsorted.add(key, (uint32_t)draws.size());
+			draws.push_back({ proto, s });
+		}
+	}
+
+	// Sort cost, from the same unsorted list each time
+	DrawList sorted;
+	unsigned int passes = 0;
+	double radixMs = benchBestOf(10, [&]() {
+		sorted.items = unsorted.items;
+		passes = sorted.sort();
+	});
+	std::vector<DrawList::Item> reference;
+	double stdMs = benchBestOf(10, [&]() {
+		reference = unsorted.items;
+		std::stable_sort(reference.begin(), reference.end(), [](const DrawList::Item& a, const DrawList::Item& b) { return a.key < b.key; });
+	});
+	bool same = reference.size() == sorted.items.size();
+	for (size_t i = 0; same && i < reference.size(); i++)
+	{
+		same = reference[i].key == sorted.items[i].key && reference[i].payload == sorted.items[i].payload;
+	}
+	double scale = 100000.0 / drawCount;
+	printf("sort %u draws: radix %.3f ms (%u byte passes), std::stable_sort %.3f ms, per 100k draws: %.3f ms | %s\n",
+		drawCount, radixMs, passes, stdMs, radixMs * scale, same ? "same order" : "ORDER DIFFERS");
+
+	// Submission with redundant binds dropped, in scene order and in key order
+	CommandStats before = record(prototypes, draws, unsorted);
+	CommandStats after = record(prototypes, draws, sorted);
+	unsigned int requested = before.stateChanges + before.eliminated;
+	printf("unsorted: %u state commands requested, %u recorded, %u eliminated\n", requested, before.stateChanges, before.eliminated);
+	printf("sorted:   %u state commands requested, %u recorded, %u eliminated (%.0f%% of binds, %u more than unsorted)\n",
+		after.stateChanges + after.eliminated, after.stateChanges, after.eliminated,
+		100.0 * after.eliminated / (after.stateChanges + after.eliminated), after.eliminated - before.eliminated);
+	bool draws100 = before.draws == drawCount && after.draws == drawCount;
+	return same && draws100 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// Moving bodies: DynamicAABBTree (refit only what left its fat box, batched pair finding)
+// against rebuilding a StaticBVH every frame and querying every body for overlaps. Both find the
+// full set of touching pairs each frame. Exits non-zero when a body's tight box is not found inside
+// its fat box in the tree, or when the two pair sets differ.
+
+#include "BenchCommon.h"
+#include "DynamicAABBTree.h"
+#include "StaticBVH.h"
+#include <algorithm>
+#include <vector>
+
+struct Body
+{
+	Vec3 position;
+	Vec3 velocity;
+	Vec3 half;
+};
+
+static WorldBounds boundsOf(const Body& b)
+{
+	return { b.position - b.half, b.position + b.half };
+}
+
+static void step(std::vector<Body>& bodies, float dt, float extent)
+{
+	for (Body& b : bodies)
+	{
+		b.position += b.velocity * dt;
+		for (int a = 0; a < 3; a++)
+		{
+			if (b.position.v[a] < -extent || b.position.v[a] > extent)
+			{
+				b.velocity.v[a] = -b.velocity.v[a];
+			}
+		}
+	}
+}
+
+static std::vector<Body> makeBodies(unsigned int count, float extent)
+{
+	BenchRandom rng;
+	std::vector<Body> bodies(count);
+	for (Body& b : bodies)
+	{
+		b.position = Vec3(rng.range(-extent, extent), rng.range(-extent, extent), rng.range(-extent, extent));
+		b.velocity = Vec3(rng.range(-2.0f, 2.0f), rng.range(-2.0f, 2.0f), rng.range(-2.0f, 2.0f));
+		b.half = Vec3(rng.range(0.3f, 1.0f), rng.range(0.3f, 1.0f), rng.range(0.3f, 1.0f));
+	}
+	return bodies;
+}
+
+// Order-independent digest of a frame's pair set: the count and a sum of mixed pair hashes
+struct PairDigest
+{
+	uint64_t count = 0;
+	uint64_t sum = 0;
+
+	void add(unsigned int a, unsigned int b)
+	{
+		uint64_t h = ((uint64_t)(a < b ? a : b) << 32 | (b > a ? b : a)) * 0x9E3779B97F4A7C15ull;
+		count++;
+		sum += h ^ (h >> 29);
+	}
+
+	bool operator==(const PairDigest& other) const
+	{
+		return count == other.count && sum == other.sum;
+	}
+};
+
+// Both sides find every touching pair each frame. Returns the bodies the tree failed to find plus
+// the frames whose pair set differs from the baseline's.
+static uint64_t run(unsigned int count, int frames)
+{
+	const float dt = 1.0f / 60.0f;
+	float extent = 2.0f * cbrtf((float)count);
+
+	// Rebuild-every-frame baseline: query every body
+	std::vector<Body> bodies = makeBodies(count, extent);
+	StaticBVH bvh;
+	std::vector<WorldBounds> bounds(count);
+	std::vector<unsigned int> ids(count);
+	std::vector<PairDigest> rebuildPairs(frames);
+	std::vector<std::pair<unsigned int, unsigned int>> rebuildLast, treeLast;
+	BenchClock::time_point start = BenchClock::now();
+	for (int f = 0; f < frames; f++)
+	{
+		step(bodies, dt, extent);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			bounds[i] = boundsOf(bodies[i]);
+			ids[i] = i;
+		}
+		bvh.build(bounds, ids);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			bvh.queryAABB(bounds[i], [&](unsigned int j) {
+				if (j <= i) return;
+				rebuildPairs[f].add(i, j);
+				if (f == frames - 1) rebuildLast.push_back(std::make_pair(i, j));
+			});
+		}
+	}
+	double rebuildMs = benchElapsedMs(start) / frames;
+
+	// Incremental tree with the same motion: re-insert what left its fat box, then test every pair
+	// of overlapping fat boxes
+	bodies = makeBodies(count, extent);
+	DynamicAABBTree tree;
+	std::vector<int> proxies(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		proxies[i] = tree.createProxy(boundsOf(bodies[i]), i);
+	}
+	tree.updatePairs([](unsigned int, unsigned int) {});
+	std::vector<PairDigest> treePairs(frames);
+	uint64_t fatPairs = 0, missed = 0;
+	unsigned int reinsertsBefore = tree.stats.reinserts;
+	start = BenchClock::now();
+	for (int f = 0; f < frames; f++)
+	{
+		step(bodies, dt, extent);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			tree.moveProxy(proxies[i], boundsOf(bodies[i]), bodies[i].velocity * dt);
+		}
+		tree.updatePairs([](unsigned int, unsigned int) {});
+		tree.forEachOverlap([&](unsigned int a, unsigned int b) {
+			if (!boundsOf(bodies[a]).overlaps(boundsOf(bodies[b]))) return;
+			treePairs[f].add(a, b);
+			if (f == frames - 1) treeLast.push_back(std::make_pair((std::min)(a, b), (std::max)(a, b)));
+		});
+		fatPairs += tree.overlapCount();
+	}
+	double treeMs = benchElapsedMs(start) / frames;
+
+	// Correctness: every tight box must have a fat-box overlap in the tree
+	for (unsigned int i = 0; i < count && i < 2000; i++)
+	{
+		WorldBounds b = boundsOf(bodies[i]);
+		bool found = false;
+		tree.queryAABB(b, [&](int, unsigned int v) { found |= (v == i); });
+		missed += !found;
+	}
+	// and the same touching pairs as the baseline, every frame (the last one compared in full)
+	uint64_t wrongFrames = 0, pairs = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		wrongFrames += !(treePairs[f] == rebuildPairs[f]);
+		pairs += rebuildPairs[f].count;
+	}
+	std::sort(rebuildLast.begin(), rebuildLast.end());
+	std::sort(treeLast.begin(), treeLast.end());
+	wrongFrames += rebuildLast != treeLast;
+
+	printf("%6u bodies | %7.1f touching pairs/frame | rebuild+query %8.3f ms/frame | dynamic tree %7.3f ms/frame (%.1f fat pairs), %5.1f%% reinserted/frame, height %d | missed %llu, frames differing %llu\n",
+		count, (double)pairs / frames, rebuildMs, treeMs, (double)fatPairs / frames,
+		100.0 * (tree.stats.reinserts - reinsertsBefore) / ((double)count * frames), tree.height(),
+		(unsigned long long)missed, (unsigned long long)wrongFrames);
+	return missed + wrongFrames;
+}
+
+int main()
+{
+	uint64_t failures = run(1000, 120);
+	failures += run(10000, 60);
+	failures += run(50000, 20);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Compares the old array-of-GameObjects layout against EntityRegistry's dense component arrays
+// for the collision ("update") and draw-submission ("render") loops in Game.
+
+#include "BenchCommon.h"
+#include "EntityRegistry.h"
+#include <string>
+#include <vector>
+
+// Mirrors the removed GameObject: prototype pointer, world matrix, string type
+struct LegacyObject
+{
+	void* prototype;
+	Matrix world;
+	std::string type;
+};
+
+static const Vec3 localMin(-1.0f, 0.0f, -1.0f);
+static const Vec3 localMax(1.0f, 4.0f, 1.0f);
+static const float padding = 0.5f;
+
+static bool localHit(const Matrix& world, const Vec3& p)
+{
+	Vec3 l = world.invert().mulPoint(p);
+	return l.x >= localMin.x - padding && l.x <= localMax.x + padding &&
+		l.y >= localMin.y - padding && l.y <= localMax.y + padding &&
+		l.z >= localMin.z - padding && l.z <= localMax.z + padding;
+}
+
+static Matrix randomWorld(BenchRandom& rng, float extent)
+{
+	Matrix w;
+	w.translation(Vec3(rng.range(-extent, extent), 0.0f, rng.range(-extent, extent)));
+	return w;
+}
+
+static void run(unsigned int count)
+{
+	BenchRandom rng;
+	float extent = 10.0f * sqrtf((float)count);
+	Vec3 player(0.0f, 1.0f, 0.0f);
+
+	std::vector<LegacyObject> legacy(count);
+	EntityRegistry registry;
+	registry.reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Matrix w = randomWorld(rng, extent);
+		bool collectible = (i % 8) == 0;
+		legacy[i].prototype = nullptr;
+		legacy[i].world = w;
+		legacy[i].type = collectible ? "collectible" : "static";
+		registry.create(w, WorldBounds::fromLocal(localMin, localMax, w, padding), { i & 3 }, collectible ? TAG_COLLECTIBLE : (TAG_STATIC | TAG_SOLID));
+	}
+
+	int repeats = count >= 1000000 ? 3 : 10;
+
+	double legacyUpdate = benchBestOf(repeats, [&]() {
+		uint64_t hits = 0;
+		for (size_t i = 0; i < legacy.size(); i++)
+		{
+			if (localHit(legacy[i].world, player))
+			{
+				hits += (legacy[i].type == "collectible") ? 2 : 1;
+			}
+		}
+		benchSink += hits;
+	});
+
+	double registryUpdate = benchBestOf(repeats, [&]() {
+		uint64_t hits = 0;
+		for (unsigned int i = 0; i < registry.size(); i++)
+		{
+			if (registry.bounds[i].contains(player) && localHit(registry.world[i], player))
+			{
+				hits += (registry.tags[i] & TAG_COLLECTIBLE) ? 2 : 1;
+			}
+		}
+		benchSink += hits;
+	});
+
+	// Render: gather (prototype, world) pairs the way Game::render feeds draw calls
+	std::vector<const Matrix*> submitted(count);
+	double legacyRender = benchBestOf(repeats, [&]() {
+		for (size_t i = 0; i < legacy.size(); i++)
+		{
+			submitted[i] = &legacy[i].world;
+			benchSink += (uint64_t)(uintptr_t)legacy[i].prototype;
+		}
+	});
+
+	double registryRender = benchBestOf(repeats, [&]() {
+		for (unsigned int i = 0; i < registry.size(); i++)
+		{
+			submitted[i] = &registry.world[i];
+			benchSink += registry.render[i].prototype;
+		}
+	});
+
+	// O(1) removal of 10% of entities through their handles
+	std::vector<Entity> victims;
+	for (unsigned int i = 0; i < count; i += 10)
+	{
+		victims.push_back(registry.entities[i]);
+	}
+	BenchClock::time_point start = BenchClock::now();
+	for (Entity e : victims)
+	{
+		registry.destroy(e);
+	}
+	double removeMs = benchElapsedMs(start);
+
+	printf("%8u entities | update: legacy %9.3f ms, registry %9.3f ms | render: legacy %8.3f ms, registry %8.3f ms | remove %zu: %7.3f ms\n",
+		count, legacyUpdate, registryUpdate, legacyRender, registryRender, victims.size(), removeMs);
+}
+
+int main()
+{
+	printf("sizeof(LegacyObject) = %zu bytes, registry hot components = %zu bytes/entity\n",
+		sizeof(LegacyObject), sizeof(Matrix) + sizeof(WorldBounds) + sizeof(RenderHandle) + sizeof(unsigned char));
+	run(1000);
+	run(100000);
+	run(1000000);
+	return 0;
+}
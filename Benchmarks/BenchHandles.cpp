@@ -0,0 +1,188 @@
+// HandlePool without a GPU: a fake fence stands in for the graphics queue (signalled at the end
+// of each frame, completing two frames later like Core's double buffering). Checks stale-handle
+// rejection, that nothing is destroyed before its fence value completes and that a full pool
+// hands out null handles rather than wrapping the slot index, then reloads a
+// 300-mesh level every frame for a while to show the pool stays flat, and compares handle lookup
+// against a raw pointer.
+
+#include "BenchCommon.h"
+#include "HandlePool.h"
+#include <algorithm>
+#include <vector>
+
+// What a Mesh costs to hold: two buffers and their sizes
+struct FakeMesh
+{
+	uint64_t vertexBuffer = 0;
+	uint64_t indexBuffer = 0;
+	unsigned int indexCount = 0;
+};
+
+static unsigned int destroyed = 0;
+static uint64_t fenceCompleted = 0;
+static bool destroyedEarly = false;
+
+static void destroyFakeMesh(FakeMesh& mesh)
+{
+	destroyed++;
+	// indexCount carries the fence value it was released at
+	destroyedEarly = destroyedEarly || fenceCompleted < mesh.indexCount;
+	mesh.vertexBuffer = mesh.indexBuffer = 0;
+}
+
+// Signals one value per frame; the GPU finishes frame N when frame N + framesInFlight is submitted
+struct FakeFence
+{
+	uint64_t signalled = 0;
+	unsigned int framesInFlight = 2;
+
+	uint64_t next() const
+	{
+		return signalled + 1;
+	}
+
+	void endFrame()
+	{
+		signalled++;
+		fenceCompleted = signalled > framesInFlight ? signalled - framesInFlight : 0;
+	}
+};
+
+int main()
+{
+	bool ok = true;
+
+	// Lifetime rules
+	{
+		HandlePool<FakeMesh> pool(&destroyFakeMesh);
+		FakeFence fence;
+		FakeMesh m;
+		m.vertexBuffer = 1;
+		Handle<FakeMesh> a = pool.create(m);
+		ok = ok && pool.get(a) && pool.get(a)->vertexBuffer == 1 && !pool.get(Handle<FakeMesh>());
+
+		pool.get(a)->indexCount = (unsigned int)fence.next();
+		pool.release(a, fence.next());
+		ok = ok && !pool.get(a) && pool.pending() == 1;
+		pool.release(a, fence.next());   // double release is ignored
+		ok = ok && pool.pending() == 1;
+
+		pool.collect(fenceCompleted);
+		ok = ok && destroyed == 0;
+		fence.endFrame();
+		pool.collect(fenceCompleted);
+		ok = ok && destroyed == 0;       // submitted, not finished
+		fence.endFrame();
+		fence.endFrame();
+		pool.collect(fenceCompleted);
+		ok = ok && destroyed == 1 && pool.pending() == 0;
+
+		// The slot is reused with a new generation; the old handle stays dead
+		Handle<FakeMesh> b = pool.create(m);
+		ok = ok && b.index() == a.index() && b != a && !pool.get(a) && pool.get(b);
+		ok = ok && pool.capacity() == 1;
+	}
+	printf("handle lifetime: %s\n", ok && !destroyedEarly ? "ok" : "FAILED");
+
+	// Capacity: every slot the index bits can address, then null until one is collected
+	{
+		HandlePool<FakeMesh> pool;
+		FakeMesh m;
+		Handle<FakeMesh> first = pool.create(m), last;
+		for (uint32_t i = 1; i < Handle<FakeMesh>::MAX_SLOTS; i++)
+		{
+			last = pool.create(m);
+		}
+		Handle<FakeMesh> overflow = pool.create(m);
+		bool full = !last.isNull() && last.index() == Handle<FakeMesh>::MAX_SLOTS - 1 && overflow.isNull() &&
+			pool.capacity() == Handle<FakeMesh>::MAX_SLOTS && pool.get(first) && pool.get(last);
+		pool.release(first, 1);
+		pool.collect(1);
+		Handle<FakeMesh> reused = pool.create(m);
+		full = full && !reused.isNull() && reused.index() == first.index() && pool.capacity() == Handle<FakeMesh>::MAX_SLOTS;
+		printf("capacity: %u slots, then %s\n", pool.capacity(), full ? "null handles until a slot is collected" : "FAILED");
+		ok = ok && full;
+	}
+
+	// Reload every frame: release the whole level and create it again
+	{
+		destroyed = 0;
+		fenceCompleted = 0;
+		HandlePool<FakeMesh> pool(&destroyFakeMesh);
+		FakeFence fence;
+		const unsigned int meshCount = 300, reloads = 2000;
+		std::vector<Handle<FakeMesh>> level(meshCount);
+		unsigned int peakCapacity = 0;
+		BenchClock::time_point start = BenchClock::now();
+		for (unsigned int frame = 0; frame < reloads; frame++)
+		{
+			for (Handle<FakeMesh>& h : level)
+			{
+				if (!h.isNull())
+				{
+					pool.get(h)->indexCount = (unsigned int)fence.next();
+					pool.release(h, fence.next());
+				}
+				FakeMesh m;
+				m.vertexBuffer = frame + 1;
+				h = pool.create(m);
+			}
+			fence.endFrame();
+			pool.collect(fenceCompleted);
+			peakCapacity = (std::max)(peakCapacity, pool.capacity());
+		}
+		double ms = benchElapsedMs(start);
+		unsigned int released = meshCount * (reloads - 1);
+		bool flat = pool.capacity() <= meshCount * (fence.framesInFlight + 2);
+		bool complete = destroyed + pool.pending() == released && !destroyedEarly;
+		printf("%u reloads of %u meshes: %u slots (peak %u), %u destroyed, %u pending, %.3f us per create+release | %s\n",
+			reloads, meshCount, pool.capacity(), peakCapacity, destroyed, pool.pending(), ms * 1000.0 / released,
+			flat && complete ? "flat" : "GROWING OR EARLY");
+		ok = ok && flat && complete;
+	}
+
+	// Lookup: handle -> object against a raw pointer array
+	{
+		HandlePool<FakeMesh> pool;
+		const unsigned int count = 4096, lookups = 1 << 22;
+		std::vector<Handle<FakeMesh>> handles;
+		std::vector<FakeMesh*> pointers;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			FakeMesh m;
+			m.indexCount = i;
+			handles.push_back(pool.create(m));
+		}
+		for (unsigned int i = 0; i < count; i++)
+		{
+			pointers.push_back(new FakeMesh(*pool.get(handles[i])));
+		}
+		BenchRandom rng;
+		std::vector<unsigned int> order(lookups);
+		for (unsigned int& o : order)
+		{
+			o = rng.next() % count;
+		}
+		uint64_t sum = 0;
+		double handleMs = benchBestOf(5, [&]() {
+			for (unsigned int o : order)
+			{
+				sum += pool.get(handles[o])->indexCount;
+			}
+		});
+		double pointerMs = benchBestOf(5, [&]() {
+			for (unsigned int o : order)
+			{
+				sum += pointers[o]->indexCount;
+			}
+		});
+		benchSink += sum;
+		printf("lookup: handle %.2f ns, raw pointer %.2f ns\n", handleMs * 1e6 / lookups, pointerMs * 1e6 / lookups);
+		for (FakeMesh* p : pointers)
+		{
+			delete p;
+		}
+	}
+
+	return ok ? 0 : 1;
+}
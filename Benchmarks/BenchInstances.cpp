@@ -0,0 +1,183 @@
+// Memory of a 10k-tree level: the old per-placement prototype copies (what LevelLoader::load
+// returned, one full StaticMesh each) against one shared prototype in a ResourceCache with
+// entities holding its index and a transform. Heap use is counted by replacing operator new.
+// Also checks that refcounted release frees the prototype and returns the heap to baseline.
+
+#include "BenchCommon.h"
+#include "EntityRegistry.h"
+#include "MeshBVH.h"
+#include "ResourceCache.h"
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static size_t heapLive = 0;
+static const size_t HEADER = 16;
+
+void* operator new(size_t size)
+{
+	size_t* block = (size_t*)malloc(size + HEADER);
+	if (!block)
+	{
+		throw std::bad_alloc();
+	}
+	block[0] = size;
+	heapLive += size;
+	return (char*)block + HEADER;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p)
+	{
+		return;
+	}
+	size_t* block = (size_t*)((char*)p - HEADER);
+	heapLive -= block[0];
+	free(block);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+// Mirrors StaticMesh's members (D3D objects are stand-in pointers); copying it per placement is
+// what the old loader did, including a deep copy of the collision BVH
+struct PrototypeStandIn
+{
+	std::unordered_map<std::string, void*> psos;
+	std::vector<void*> meshes;
+	std::vector<unsigned int> materials;
+	void* vertexShader = nullptr;
+	void* pixelShader = nullptr;
+	std::vector<void*> vsConstantBuffers;
+	std::vector<void*> psConstantBuffers;
+	Matrix worldMatrix;
+	std::string type = "static";
+	Vec3 localMin, localMax;
+	float collisionPadding = 0.5f;
+	MeshBVH collisionBVH;
+};
+
+// Trunk and canopy as one latitude/longitude sphere squashed into a tree-ish shape
+static void buildTree(PrototypeStandIn& proto, unsigned int rings, unsigned int segments)
+{
+	std::vector<Vec3> positions;
+	std::vector<unsigned int> indices;
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		float v = (float)r / rings * 3.14159265f;
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float u = (float)s / segments * 6.2831853f;
+			float radius = 1.5f * sinf(v) + 0.2f;
+			positions.push_back(Vec3(radius * cosf(u), 4.0f - 4.0f * cosf(v), radius * sinf(u)));
+		}
+	}
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	proto.collisionBVH.build(positions, indices);
+	proto.localMin = Vec3(-1.7f, 0.0f, -1.7f);
+	proto.localMax = Vec3(1.7f, 8.0f, 1.7f);
+	proto.psos["Triangle"] = &proto;
+	for (int i = 0; i < 3; i++)
+	{
+		proto.meshes.push_back(&proto);
+		proto.materials.push_back(i);
+	}
+	proto.vsConstantBuffers.push_back(&proto);
+	proto.psConstantBuffers.push_back(&proto);
+}
+
+static Matrix placement(BenchRandom& rng)
+{
+	Matrix world;
+	world.m[3] = rng.range(-500, 500);
+	world.m[11] = rng.range(-500, 500);
+	return world;
+}
+
+int main()
+{
+	const unsigned int trees = 10000;
+	size_t baseline = heapLive;
+
+	// Before: every placement is a copy of the prototype
+	double copiesMs, copiesMB, copiesPerInstance;
+	{
+		PrototypeStandIn proto;
+		buildTree(proto, 25, 40);
+		size_t prototypeHeap = heapLive - baseline;
+		std::vector<PrototypeStandIn> instances;
+		BenchRandom rng;
+		BenchClock::time_point start = BenchClock::now();
+		instances.reserve(trees);
+		for (unsigned int i = 0; i < trees; i++)
+		{
+			instances.push_back(proto);
+			instances.back().worldMatrix = placement(rng);
+		}
+		copiesMs = benchElapsedMs(start);
+		size_t heap = heapLive - baseline;
+		copiesMB = heap / 1048576.0;
+		copiesPerInstance = (double)(heap - prototypeHeap) / trees;
+		printf("prototype: %u triangles, %zu bytes object + %zu bytes heap\n",
+			25 * 40 * 2, sizeof(PrototypeStandIn), prototypeHeap);
+	}
+	bool copiesFreed = heapLive == baseline;
+
+	// After: one cached prototype, entities hold an index and a transform
+	double sharedMs, sharedMB, sharedPerInstance;
+	bool released;
+	{
+		ResourceCache<PrototypeStandIn> prototypes;
+		PrototypeStandIn* proto = new PrototypeStandIn();
+		buildTree(*proto, 25, 40);
+		size_t modelHeap = heapLive - baseline;
+		unsigned int index = prototypes.add("tree.gem", proto);
+		size_t prototypeHeap = heapLive - baseline;
+
+		EntityRegistry entities;
+		BenchRandom rng;
+		BenchClock::time_point start = BenchClock::now();
+		entities.reserve(trees);
+		for (unsigned int i = 0; i < trees; i++)
+		{
+			Matrix world = placement(rng);
+			WorldBounds bounds = WorldBounds::fromLocal(prototypes[index]->localMin, prototypes[index]->localMax, world, 0.5f);
+			entities.create(world, bounds, RenderHandle{ index }, TAG_SOLID);
+		}
+		sharedMs = benchElapsedMs(start);
+		size_t heap = heapLive - baseline;
+		sharedMB = heap / 1048576.0;
+		sharedPerInstance = (double)(heap - prototypeHeap) / trees;
+
+		// Ten cells holding the model: it survives until the last lets go
+		for (int cell = 0; cell < 10; cell++)
+		{
+			prototypes.acquire(index);
+		}
+		bool survived = true;
+		for (int cell = 0; cell < 9; cell++)
+		{
+			survived = survived && !prototypes.release(index);
+		}
+		size_t beforeLast = heapLive;
+		released = survived && prototypes.release(index) && prototypes.size() == 0 && beforeLast - heapLive >= modelHeap;
+	}
+	released = released && heapLive == baseline;
+
+	printf("%u trees | copies: %8.0f bytes/instance, %7.2f MB heap, %7.3f ms | shared: %5.0f bytes/instance (%zu entity row), %5.2f MB heap, %6.3f ms\n",
+		trees, copiesPerInstance, copiesMB, copiesMs, sharedPerInstance, EntityRegistry::bytesPerEntity(), sharedMB, sharedMs);
+	printf("refcounted release: %s\n", released && copiesFreed ? "prototype freed on last release, heap back to baseline" : "LEAK");
+	return released && copiesFreed ? 0 : 1;
+}
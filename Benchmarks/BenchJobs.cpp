@@ -0,0 +1,139 @@
+// JobSystem: correctness of parallelFor, dependencies and nested spawning, then scaling of a
+// compute-bound loop from one thread to every hardware thread, and per-job overhead.
+
+#include "BenchCommon.h"
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+#include <thread>
+#include <vector>
+
+static bool checkCorrectness(JobSystem& jobs)
+{
+	bool ok = true;
+
+	// Every index visited exactly once
+	const unsigned int count = 1000003;
+	std::vector<unsigned int> visits(count, 0);
+	jobs.parallelFor(count, 1000, [&](unsigned int b, unsigned int e) {
+		for (unsigned int i = b; i < e; i++)
+		{
+			visits[i]++;
+		}
+	});
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ok = ok && visits[i] == 1;
+	}
+
+	// Continuations see every write of the batch they depend on
+	for (int round = 0; round < 200; round++)
+	{
+		std::vector<int> values(64, 0);
+		std::atomic<int> sum{ 0 };
+		JobCounter produce, consume;
+		for (int i = 0; i < 64; i++)
+		{
+			jobs.run([&values, i]() { values[i] = i + 1; }, &produce);
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			jobs.runAfter(produce, [&values, &sum]() {
+				int s = 0;
+				for (int v : values)
+				{
+					s += v;
+				}
+				sum.fetch_add(s);
+			}, &consume);
+		}
+		jobs.wait(produce);
+		jobs.wait(consume);
+		ok = ok && sum.load() == 4 * 64 * 65 / 2;
+
+		// Queued after the batch finished: runs straight away
+		JobCounter late;
+		jobs.runAfter(produce, [&sum]() { sum.fetch_add(1); }, &late);
+		jobs.wait(late);
+		ok = ok && sum.load() == 4 * 64 * 65 / 2 + 1;
+	}
+
+	// Jobs spawning jobs, more in total than one thread's ring holds
+	std::atomic<unsigned int> leaves{ 0 };
+	JobCounter tree;
+	for (int i = 0; i < 64; i++)
+	{
+		jobs.run([&jobs, &leaves, &tree]() {
+			for (int k = 0; k < 256; k++)
+			{
+				jobs.run([&leaves]() { leaves.fetch_add(1, std::memory_order_relaxed); }, &tree);
+			}
+		}, &tree);
+	}
+	jobs.wait(tree);
+	ok = ok && leaves.load() == 64 * 256;
+
+	return ok;
+}
+
+int main()
+{
+	unsigned int hardware = std::thread::hardware_concurrency();
+	hardware = hardware == 0 ? 1 : hardware;
+
+	// Exercise the stealing paths with several threads even on small machines
+	unsigned int checkThreads = hardware < 4 ? 4 : hardware;
+	{
+		JobSystem jobs(checkThreads);
+		bool ok = checkCorrectness(jobs);
+		printf("correctness (%u threads): %s, %llu jobs, %llu stolen\n", checkThreads, ok ? "ok" : "FAILED",
+			jobs.stats.executed.load(), jobs.stats.stolen.load());
+		if (!ok)
+		{
+			return 1;
+		}
+	}
+
+	// Compute-bound loop: compose a million transforms
+	const unsigned int count = 1 << 20;
+	std::vector<Vec3> pos(count), rot(count);
+	std::vector<Matrix> out(count);
+	BenchRandom rng;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		pos[i] = Vec3(rng.range(-50, 50), rng.range(-50, 50), rng.range(-50, 50));
+		rot[i] = Vec3(rng.range(-180, 180), rng.range(-180, 180), rng.range(-180, 180));
+	}
+	Vec3 one(1, 1, 1);
+	auto composeRange = [&](unsigned int b, unsigned int e) {
+		for (unsigned int i = b; i < e; i++)
+		{
+			out[i] = TransformHierarchy::compose(pos[i], rot[i], one);
+		}
+	};
+
+	double serialMs = benchBestOf(5, [&]() { composeRange(0, count); });
+	printf("\n%u hardware threads; compose %u matrices: serial loop %.3f ms\n", hardware, count, serialMs);
+
+	unsigned int maxThreads = hardware < 4 ? 4 : hardware;
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads);
+		double ms = benchBestOf(5, [&]() { jobs.parallelFor(count, 4096, composeRange); });
+		benchSink += (uint64_t)out[count / 2].m[3];
+
+		// Spawn cost: empty jobs submitted and drained from the attached thread
+		const unsigned int spawns = 100000;
+		double spawnMs = benchBestOf(3, [&]() {
+			JobCounter counter;
+			for (unsigned int i = 0; i < spawns; i++)
+			{
+				jobs.run([]() {}, &counter);
+			}
+			jobs.wait(counter);
+		});
+
+		printf("%3u threads%s | parallelFor %8.3f ms (x%.2f) | %6.1f M empty jobs/s\n", threads,
+			threads > hardware ? " (oversubscribed)" : "", ms, serialMs / ms, spawns / spawnMs / 1000.0);
+	}
+	return 0;
+}
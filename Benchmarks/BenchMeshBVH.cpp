@@ -0,0 +1,285 @@
+// MeshBVH build time and query throughput (rays, closest points, sphere overlaps) on the
+// shipped tree model and a large procedural terrain, checked against brute force.
+// Usage: BenchMeshBVH [model.gem]   (defaults to Pipeline/acacia_003.gem, skipped when not found from
+// the working directory; a named model that can't be loaded is a failure). Exits non-zero on any
+// mismatch, including instance queries under a rotated non-uniform scale.
+
+#include "BenchCommon.h"
+#include "MeshBVH.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct TriangleSoup
+{
+	std::vector<Vec3> positions;
+	std::vector<unsigned int> indices;
+};
+
+// False when the file is missing or not a valid model
+static bool loadModel(const char* filename, TriangleSoup& soup)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::vector<GEMLoader::GEMMesh> meshes;
+	GEMLoader::GEMModelLoader loader;
+	if (!loader.loadFromMemory(data, meshes))
+	{
+		return false;
+	}
+	for (const GEMLoader::GEMMesh& mesh : meshes)
+	{
+		unsigned int base = (unsigned int)soup.positions.size();
+		for (const GEMLoader::GEMStaticVertex& v : mesh.verticesStatic)
+		{
+			soup.positions.push_back(Vec3(v.position.x, v.position.y, v.position.z));
+		}
+		for (unsigned int index : mesh.indices)
+		{
+			soup.indices.push_back(base + index);
+		}
+	}
+	return true;
+}
+
+// Rolling heightfield, 2 * n * n triangles
+static TriangleSoup makeTerrain(unsigned int n)
+{
+	TriangleSoup soup;
+	for (unsigned int z = 0; z <= n; z++)
+	{
+		for (unsigned int x = 0; x <= n; x++)
+		{
+			float fx = (float)x, fz = (float)z;
+			soup.positions.push_back(Vec3(fx, 3.0f * sinf(fx * 0.07f) * cosf(fz * 0.05f), fz));
+		}
+	}
+	for (unsigned int z = 0; z < n; z++)
+	{
+		for (unsigned int x = 0; x < n; x++)
+		{
+			unsigned int i = z * (n + 1) + x;
+			unsigned int quad[6] = { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 };
+			soup.indices.insert(soup.indices.end(), quad, quad + 6);
+		}
+	}
+	return soup;
+}
+
+static float bruteRay(const TriangleSoup& s, const Vec3& o, const Vec3& d)
+{
+	MeshBVH::RayHit hit;
+	for (size_t i = 0; i < s.indices.size(); i += 3)
+	{
+		Vec3 a = s.positions[s.indices[i]], b = s.positions[s.indices[i + 1]], c = s.positions[s.indices[i + 2]];
+		Vec3 e1 = b - a, e2 = c - a, p = d.Cross(e2);
+		float det = e1.Dot(p);
+		if (fabsf(det) < 1e-12f) continue;
+		float inv = 1.0f / det;
+		Vec3 t = o - a;
+		float u = t.Dot(p) * inv;
+		if (u < 0.0f || u > 1.0f) continue;
+		Vec3 q = t.Cross(e1);
+		float v = d.Dot(q) * inv;
+		if (v < 0.0f || u + v > 1.0f) continue;
+		float tt = e2.Dot(q) * inv;
+		if (tt >= 0.0f && tt < hit.t) hit.t = tt;
+	}
+	return hit.t;
+}
+
+static float bruteClosest(const TriangleSoup& s, const Vec3& p)
+{
+	float best = FLT_MAX;
+	for (size_t i = 0; i < s.indices.size(); i += 3)
+	{
+		Vec3 q = MeshBVH::closestOnTriangle(s.positions[s.indices[i]], s.positions[s.indices[i + 1]], s.positions[s.indices[i + 2]], p);
+		float d = (q - p).lengthSquared();
+		best = d < best ? d : best;
+	}
+	return best;
+}
+
+// Returns the queries that disagreed with brute force
+static unsigned int run(const char* name, const TriangleSoup& soup)
+{
+	unsigned int triangles = (unsigned int)(soup.indices.size() / 3);
+	if (triangles == 0)
+	{
+		printf("%s: no triangles\n", name);
+		return 0;
+	}
+	MeshBVH bvh;
+	double buildMs = benchBestOf(3, [&]() { bvh.build(soup.positions, soup.indices); });
+
+	Vec3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vec3& p : soup.positions)
+	{
+		lo = Vec3::Min(lo, p);
+		hi = Vec3::Max(hi, p);
+	}
+	Vec3 centre = (lo + hi) * 0.5f;
+	float size = (hi - lo).length();
+
+	// Rays from a sphere around the model aimed at random points inside its box
+	BenchRandom rng;
+	const unsigned int rays = 200000;
+	std::vector<Vec3> origins(rays), dirs(rays);
+	for (unsigned int i = 0; i < rays; i++)
+	{
+		Vec3 from = Vec3(rng.range(-1, 1), rng.range(-1, 1), rng.range(-1, 1)).normalize() * size + centre;
+		Vec3 to(rng.range(lo.x, hi.x), rng.range(lo.y, hi.y), rng.range(lo.z, hi.z));
+		origins[i] = from;
+		dirs[i] = (to - from).normalize();
+	}
+	uint64_t hits = 0;
+	double rayMs = benchBestOf(3, [&]() {
+		hits = 0;
+		for (unsigned int i = 0; i < rays; i++)
+		{
+			MeshBVH::RayHit hit;
+			hits += bvh.raycast(origins[i], dirs[i], FLT_MAX, hit);
+		}
+	});
+
+	const unsigned int points = 200000;
+	std::vector<Vec3> probes(points);
+	for (unsigned int i = 0; i < points; i++)
+	{
+		probes[i] = Vec3(rng.range(lo.x, hi.x), rng.range(lo.y, hi.y), rng.range(lo.z, hi.z));
+	}
+	float radius = size * 0.01f;
+	double closestMs = benchBestOf(3, [&]() {
+		for (unsigned int i = 0; i < points; i++)
+		{
+			MeshBVH::PointHit hit;
+			benchSink += bvh.closestPoint(probes[i], size * 0.05f, hit);
+		}
+	});
+	uint64_t overlaps = 0;
+	double sphereMs = benchBestOf(3, [&]() {
+		overlaps = 0;
+		for (unsigned int i = 0; i < points; i++)
+		{
+			overlaps += bvh.overlapsSphere(probes[i], radius);
+		}
+	});
+
+	// Verify a sample against brute force
+	unsigned int mismatches = 0;
+	BenchClock::time_point start = BenchClock::now();
+	const unsigned int checks = triangles > 100000 ? 20 : 200;
+	for (unsigned int i = 0; i < checks; i++)
+	{
+		MeshBVH::RayHit hit;
+		float expected = bruteRay(soup, origins[i], dirs[i]);
+		float got = bvh.raycast(origins[i], dirs[i], FLT_MAX, hit) ? hit.t : FLT_MAX;
+		mismatches += fabsf(expected - got) > 1e-3f * (expected < FLT_MAX ? expected : 1.0f);
+		MeshBVH::PointHit ph;
+		float expectedD = bruteClosest(soup, probes[i]);
+		float gotD = bvh.closestPoint(probes[i], FLT_MAX / 4, ph) ? ph.distanceSquared : FLT_MAX;
+		mismatches += fabsf(expectedD - gotD) > 1e-3f * (expectedD + 1e-3f);
+	}
+	double bruteMs = benchElapsedMs(start) / (2.0 * checks);
+
+	printf("%-10s %8u tris | build %8.2f ms, %6zu nodes | rays %6.2f M/s (%4.1f%% hit) | closest %6.2f M/s | sphere %6.2f M/s | brute force %8.3f ms/query | mismatches %u\n",
+		name, triangles, buildMs, bvh.nodes.size(),
+		rays / (rayMs * 1000.0), 100.0 * hits / rays,
+		points / (closestMs * 1000.0), points / (sphereMs * 1000.0),
+		bruteMs, mismatches);
+	benchSink += overlaps;
+	return mismatches;
+}
+
+// Instance queries under a rotated non-uniform scale, against brute force over the transformed
+// triangles (and, for sweeps, a BVH built over them). The conservative paths may report extra
+// contacts but must never miss one or report it later.
+static unsigned int runInstance(const TriangleSoup& soup)
+{
+	Matrix rotA; rotA.setIdentity(); rotA.rotAroundZ(0.6f);
+	Matrix rotB; rotB.setIdentity(); rotB.rotAroundX(0.9f);
+	Matrix rotC; rotC.setIdentity(); rotC.rotAroundY(0.7f);
+	Matrix scl; scl.setIdentity(); scl.scaling(Vec3(3.0f, 0.5f, 1.5f));
+	Matrix world = rotA.multiply(rotB).multiply(scl).multiply(rotC);
+	world.translation(Vec3(5, -2, 7));
+	Matrix invWorld = world.invert();
+
+	TriangleSoup worldSoup = soup;
+	for (Vec3& p : worldSoup.positions)
+	{
+		p = world.mulPoint(p);
+	}
+	MeshBVH bvh, worldBvh;
+	bvh.build(soup.positions, soup.indices);
+	worldBvh.build(worldSoup.positions, worldSoup.indices);
+
+	Vec3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const Vec3& p : worldSoup.positions)
+	{
+		lo = Vec3::Min(lo, p);
+		hi = Vec3::Max(hi, p);
+	}
+	float size = (hi - lo).length();
+	float radius = size * 0.02f, maxDistance = size * 0.05f;
+	float stretch = MeshBVH::maxAxisScale(world) * MeshBVH::maxAxisScale(invWorld);
+
+	BenchRandom rng;
+	const unsigned int queries = 2000;
+	unsigned int overlapMissed = 0, closestMissed = 0, sweepMissed = 0, contacts = 0, hits = 0;
+	for (unsigned int i = 0; i < queries; i++)
+	{
+		Vec3 p(rng.range(lo.x, hi.x), rng.range(lo.y, hi.y), rng.range(lo.z, hi.z));
+		float nearest = sqrtf(bruteClosest(worldSoup, p));
+
+		bool overlaps = bvh.overlapsSphereInstance(invWorld, p, radius);
+		contacts += nearest < radius;
+		overlapMissed += nearest < radius * 0.999f && !overlaps;
+
+		MeshBVH::PointHit closest;
+		bool found = bvh.closestPointInstance(world, invWorld, p, maxDistance, closest);
+		closestMissed += nearest * stretch < maxDistance * 0.999f && !found;
+		closestMissed += found && sqrtf(closest.distanceSquared) < nearest * 0.999f - 1e-4f;
+
+		Vec3 delta = Vec3(rng.range(-1, 1), rng.range(-1, 1), rng.range(-1, 1)) * (size * 0.1f);
+		MeshBVH::SweepHit exact, instance;
+		// Sweeps ignore contacts already touching at the start, so only those starting clear count
+		if (nearest > radius && worldBvh.sphereCast(p, delta, radius, exact))
+		{
+			hits++;
+			sweepMissed += !bvh.sphereCastInstance(world, invWorld, p, delta, radius, instance) || instance.t > exact.t + 1e-3f;
+		}
+	}
+	unsigned int mismatches = overlapMissed + closestMissed + sweepMissed;
+	printf("instance   %8u tris | rotated scale (3, 0.5, 1.5), bound %.3f | %u queries: %u contacts, %u sweep hits | missed: overlap %u, closest %u, sweep %u\n",
+		(unsigned int)(soup.indices.size() / 3), MeshBVH::maxAxisScale(invWorld), queries, contacts, hits, overlapMissed, closestMissed, sweepMissed);
+	return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+	const char* model = argc > 1 ? argv[1] : "Pipeline/acacia_003.gem";
+	unsigned int mismatches = 0;
+	TriangleSoup soup;
+	if (loadModel(model, soup))
+	{
+		mismatches += run("model", soup);
+	}
+	else if (argc > 1)
+	{
+		printf("model: %s is missing or not a GE Model File\n", model);
+		mismatches++;
+	}
+	else
+	{
+		printf("model: %s not found, skipped\n", model);
+	}
+	mismatches += run("terrain", makeTerrain(128));
+	mismatches += run("terrain", makeTerrain(512));
+	mismatches += runInstance(makeTerrain(64));
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+// Parallel recording of a sorted draw list: 100k submesh draws keyed as in BenchDrawList, cut into
+// contiguous chunks by ChunkedRecording and recorded into a RecordingBackend per chunk on 1, 2, 4...
+// threads, as Game::render records its per-object path into one command list per chunk. Each draw
+// mirrors StaticMesh::drawSubmesh: constant buffer entries reserved from shared rings, the world
+// matrix written into its entry, then PSO and mesh binds. Reports recording time per thread count
+// and the re-binds chunk boundaries cost, and checks that replaying the chunks in order (the
+// ordered submit) draws the same meshes with the same PSOs and constants as one recorder would.
+
+#include "BenchCommon.h"
+#include "CommandRecorder.h"
+#include "DrawList.h"
+#include "ParallelRecording.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Mirrors ConstantBufferClass::reserve/update over a ring of 256-byte entries
+struct StandInRing
+{
+	std::vector<unsigned char> buffer;
+	uint64_t gpuAddress = 0;
+	unsigned int cbSizeInBytes = 256;
+	unsigned int maxDrawCalls = 0;
+	std::atomic<unsigned int> offsetIndex{ 0 };
+
+	void init(uint64_t address, unsigned int entries)
+	{
+		gpuAddress = address;
+		maxDrawCalls = entries;
+		buffer.assign((size_t)cbSizeInBytes * entries, 0);
+		offsetIndex = 0;
+	}
+
+	unsigned int reserve()
+	{
+		unsigned int entry = offsetIndex.load(std::memory_order_relaxed);
+		while (!offsetIndex.compare_exchange_weak(entry, entry + 1 >= maxDrawCalls ? 0 : entry + 1, std::memory_order_relaxed))
+		{
+		}
+		return entry;
+	}
+
+	const unsigned char* contents(uint64_t address) const
+	{
+		return &buffer[address - gpuAddress];
+	}
+};
+
+struct Prototype
+{
+	int pso = 0;
+	std::vector<uint32_t> meshes;
+	std::vector<uint32_t> materials;
+};
+
+struct SubmeshDraw
+{
+	uint32_t prototype;
+	uint32_t submesh;
+	float world[16];
+};
+
+struct Scene
+{
+	std::vector<Prototype> prototypes;
+	std::vector<SubmeshDraw> draws;
+	DrawList order;
+	StandInRing vs, ps;
+};
+
+static int rootSignature;
+
+// Mirrors Core::beginRenderPass, which starts every chunk
+static void beginRenderPass(CommandRecorder& commands)
+{
+	RenderViewport v;
+	v.width = 1024.0f;
+	v.height = 768.0f;
+	RenderScissor r;
+	r.right = 1024;
+	r.bottom = 768;
+	commands.setViewport(v);
+	commands.setScissor(r);
+	commands.setRootSignature(&rootSignature);
+}
+
+// Mirrors StaticMesh::drawSubmesh with Shader::applyDraw
+static void submit(CommandRecorder& commands, Scene& scene, const SubmeshDraw& draw)
+{
+	const Prototype& p = scene.prototypes[draw.prototype];
+	unsigned int entry = scene.vs.reserve();
+	memcpy(&scene.vs.buffer[(size_t)entry * scene.vs.cbSizeInBytes], draw.world, sizeof(draw.world));
+	commands.setRootConstantBuffer(0, scene.vs.gpuAddress + (uint64_t)entry * scene.vs.cbSizeInBytes);
+	commands.setRootConstantBuffer(1, scene.ps.gpuAddress + (uint64_t)scene.ps.reserve() * scene.ps.cbSizeInBytes);
+	commands.setPipelineState(&p.pso);
+	uint32_t mesh = p.meshes[draw.submesh];
+	VertexBufferView vb;
+	vb.address = 0x100000000ull + mesh * 0x10000ull;
+	vb.sizeInBytes = 0x8000;
+	vb.strideInBytes = 56;
+	IndexBufferView ib;
+	ib.address = vb.address + 0x8000;
+	ib.sizeInBytes = 0x8000;
+	ib.format = 42;
+	commands.setTopology(TOPOLOGY_TRIANGLE_LIST);
+	commands.setVertexBuffer(0, vb);
+	commands.setIndexBuffer(ib);
+	commands.drawIndexed(6000);
+}
+
+static void recordRange(CommandRecorder& commands, Scene& scene, unsigned int begin, unsigned int end)
+{
+	beginRenderPass(commands);
+	for (unsigned int n = begin; n < end; n++)
+	{
+		submit(commands, scene, scene.draws[scene.order.items[n].payload]);
+	}
+}
+
+// What reaches the GPU per draw: the bound PSO and mesh, and the world matrix its constants hold
+class DrawTrace : public CommandRecorder
+{
+public:
+	struct Draw
+	{
+		const void* pso;
+		uint64_t vertexBuffer;
+		uint64_t indexBuffer;
+		unsigned int indexCount;
+		float world[16];
+	};
+
+	const StandInRing* ring = nullptr;
+	std::vector<Draw> draws;
+
+protected:
+	void recordViewport(const RenderViewport&) override {}
+	void recordScissor(const RenderScissor&) override {}
+	void recordRootSignature(const void*) override {}
+	void recordTopology(PrimitiveTopology) override {}
+
+	void recordPipelineState(const void* pipelineState) override
+	{
+		current.pso = pipelineState;
+	}
+
+	void recordRootConstantBuffer(unsigned int slot, uint64_t address) override
+	{
+		if (slot == 0)
+		{
+			constants = address;
+		}
+	}
+
+	void recordVertexBuffer(unsigned int, const VertexBufferView& view) override
+	{
+		current.vertexBuffer = view.address;
+	}
+
+	void recordIndexBuffer(const IndexBufferView& view) override
+	{
+		current.indexBuffer = view.address;
+	}
+
+	void recordDrawIndexed(unsigned int indexCount, unsigned int, unsigned int, int, unsigned int) override
+	{
+		current.indexCount = indexCount;
+		memcpy(current.world, ring->contents(constants), sizeof(current.world));
+		draws.push_back(current);
+	}
+
+	void recordDraw(unsigned int, unsigned int, unsigned int, unsigned int) override {}
+
+private:
+	Draw current = {};
+	uint64_t constants = 0;
+};
+
+static bool sameDraws(const std::vector<DrawTrace::Draw>& a, const std::vector<DrawTrace::Draw>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].pso != b[i].pso || a[i].vertexBuffer != b[i].vertexBuffer || a[i].indexBuffer != b[i].indexBuffer ||
+			a[i].indexCount != b[i].indexCount || memcmp(a[i].world, b[i].world, sizeof(a[i].world)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const unsigned int prototypeCount = 200, materialCount = 64, drawCount = 100000, minChunk = 256;
+	BenchRandom rng;
+
+	Scene scene;
+	scene.prototypes.resize(prototypeCount);
+	uint32_t nextMesh = 0;
+	for (Prototype& p : scene.prototypes)
+	{
+		unsigned int submeshes = 1 + rng.next() % 3;
+		for (unsigned int s = 0; s < submeshes; s++)
+		{
+			p.meshes.push_back(nextMesh++);
+			p.materials.push_back(rng.next() % materialCount);
+		}
+	}
+	while (scene.draws.size() < drawCount)
+	{
+		uint32_t proto = rng.next() % prototypeCount;
+		uint32_t depth = DrawKey::depth(rng.range(0.0f, 1000.0f), 1000.0f);
+		SubmeshDraw d;
+		d.prototype = proto;
+		for (int k = 0; k < 16; k++)
+		{
+			d.world[k] = rng.range(-100.0f, 100.0f);
+		}
+		for (uint32_t s = 0; s < scene.prototypes[proto].meshes.size() && scene.draws.size() < drawCount; s++)
+		{
+			const Prototype& p = scene.prototypes[proto];
+			scene.order.add(DrawKey::make(DrawKey::PASS_OPAQUE, proto, p.materials[s], p.meshes[s], depth), (uint32_t)scene.draws.size());
+			d.submesh = s;
+			scene.draws.push_back(d);
+		}
+	}
+	scene.order.sort();
+
+	// Rings hold the whole frame, so every draw's constants are still there when traced
+	scene.vs.init(0x10000000ull, drawCount);
+	scene.ps.init(0x20000000ull, drawCount);
+
+	// One recorder, as before: the reference stream and time
+	RecordingBackend single;
+	single.skipRedundant = true;
+	double singleMs = benchBestOf(5, [&]() {
+		single.clear();
+		single.stats.reset();
+		recordRange(single, scene, 0, drawCount);
+	});
+	DrawTrace reference;
+	reference.ring = &scene.vs;
+	single.replay(reference);
+	printf("%u sorted draws, one recorder: %.3f ms, %u state commands, %u redundant eliminated\n", drawCount, singleMs,
+		single.stats.stateChanges, single.stats.eliminated);
+
+	unsigned int hardware = std::thread::hardware_concurrency();
+	unsigned int maxThreads = hardware < 8 ? 8 : hardware;
+	bool allSame = true;
+	std::vector<RecordingBackend> backends(maxThreads);
+	for (RecordingBackend& b : backends)
+	{
+		b.skipRedundant = true;
+	}
+	ChunkedRecording recording;
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads);
+		recording.split(drawCount, threads, minChunk);
+		double ms = benchBestOf(5, [&]() {
+			recording.record(&jobs, [&](unsigned int chunk, unsigned int begin, unsigned int end) {
+				RecordingBackend& commands = backends[chunk];
+				commands.clear();
+				commands.stats.reset();
+				recordRange(commands, scene, begin, end);
+			});
+		});
+
+		// Ordered submit: chunks replayed in list order
+		DrawTrace trace;
+		trace.ring = &scene.vs;
+		CommandStats total;
+		for (unsigned int k = 0; k < recording.chunks.size(); k++)
+		{
+			backends[k].replay(trace);
+			total.add(backends[k].stats);
+		}
+		bool same = sameDraws(reference.draws, trace.draws);
+		allSame = allSame && same;
+		printf("%2u threads%s | %2u chunks | record %8.3f ms (x%.2f) | %u state commands (+%u at chunk starts) | %s\n",
+			threads, threads > hardware ? " (oversubscribed)" : "", (unsigned int)recording.chunks.size(), ms, singleMs / ms,
+			total.stateChanges, total.stateChanges - single.stats.stateChanges, same ? "same draws in order" : "DRAWS DIFFER");
+	}
+
+	// Short lists stay on fewer chunks
+	recording.split(1000, 8, minChunk);
+	printf("1000 draws over up to 8 threads: %u chunks of >= %u draws\n", (unsigned int)recording.chunks.size(), minChunk);
+	printf("%u hardware threads\n", hardware);
+	return allSame ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+// Serial vs pipelined frame loop, modelled on Game::run without a GPU. Simulation is a 60 Hz
+// fixed-step TransformHierarchy update; "recording" multiplies every world matrix by the view-
+// projection into a constant-buffer array; present blocks until the next 120 Hz vblank. The
+// pipelined loop ticks on its own thread and hands snapshots over through a TripleBuffer.
+// Reports average frame time and input-to-present latency (input sample to the present of the
+// first frame drawn from a tick that used it).
+
+#include "BenchCommon.h"
+#include "TransformHierarchy.h"
+#include "FixedTimestep.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static double nowSeconds()
+{
+	return std::chrono::duration<double>(BenchClock::now().time_since_epoch()).count();
+}
+
+struct Snapshot
+{
+	std::vector<Matrix> world;
+	double inputSampledAt = 0.0;
+};
+
+struct Input
+{
+	double sampledAt = 0.0;
+};
+
+struct Scene
+{
+	TransformHierarchy transforms;
+	unsigned int roots = 0;
+	std::vector<Matrix> constants;   // what recording writes
+
+	Scene(unsigned int simNodes)
+	{
+		roots = simNodes / 4;
+		for (unsigned int r = 0; r < roots; r++)
+		{
+			transforms.add(TransformHierarchy::NO_PARENT, Vec3((float)r, 0, 0), Vec3(0, 0, 0), Vec3(1, 1, 1));
+		}
+		for (unsigned int c = 0; c < roots * 3; c++)
+		{
+			transforms.add(c % roots, Vec3(0, 1, 0), Vec3(0, 0, 0), Vec3(1, 1, 1));
+		}
+		transforms.update();
+	}
+
+	void tick(float dt)
+	{
+		for (unsigned int r = 0; r < roots; r++)
+		{
+			transforms.rotate(r, Vec3(0, 90.0f * dt, 0));
+		}
+		transforms.update();
+	}
+
+	void capture(Snapshot& s, double inputSampledAt)
+	{
+		s.world = transforms.world;
+		s.inputSampledAt = inputSampledAt;
+	}
+
+	void record(const Snapshot& s, unsigned int passes)
+	{
+		Matrix vp;
+		vp.m[0] = 1.2f; vp.m[5] = 1.6f; vp.m[10] = 1.001f; vp.m[11] = -0.1f; vp.m[14] = 1.0f; vp.m[15] = 0.0f;
+		constants.resize(s.world.size());
+		for (unsigned int p = 0; p < passes; p++)
+		{
+			for (size_t i = 0; i < s.world.size(); i++)
+			{
+				constants[i] = vp.multiply(s.world[i]);
+			}
+		}
+		benchSink += (uint64_t)constants[constants.size() / 2].m[3];
+	}
+};
+
+// Blocks until the next display refresh, like a vsynced Present
+static void present(double refresh)
+{
+	double now = nowSeconds();
+	double next = (floor(now / refresh) + 1.0) * refresh;
+	while (nowSeconds() < next)
+	{
+		double left = next - nowSeconds();
+		if (left > 0.002)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+struct Result
+{
+	double frameMs = 0.0;
+	double latencyMs = 0.0;
+};
+
+static Result runSerial(Scene& scene, unsigned int recordPasses, double seconds, double refresh)
+{
+	FixedTimestep stepper(60.0f);
+	Snapshot snapshot;
+	Result result;
+	unsigned int frames = 0;
+	double start = nowSeconds(), last = start;
+	scene.capture(snapshot, start);
+	while (nowSeconds() - start < seconds)
+	{
+		double now = nowSeconds();
+		Input input;
+		input.sampledAt = now;
+		int ticks = stepper.advance((float)(now - last));
+		last = now;
+		for (int t = 0; t < ticks; t++)
+		{
+			scene.tick(stepper.dt());
+		}
+		if (ticks > 0)
+		{
+			scene.capture(snapshot, input.sampledAt);
+		}
+		scene.record(snapshot, recordPasses);
+		present(refresh);
+		result.latencyMs += (nowSeconds() - snapshot.inputSampledAt) * 1000.0;
+		frames++;
+	}
+	result.frameMs = (nowSeconds() - start) * 1000.0 / frames;
+	result.latencyMs /= frames;
+	return result;
+}
+
+static Result runPipelined(Scene& scene, unsigned int recordPasses, double seconds, double refresh)
+{
+	TripleBuffer<Input> inputs;
+	TripleBuffer<Snapshot> snapshots;
+	std::atomic<bool> running{ true };
+
+	std::thread sim([&]() {
+		FixedTimestep stepper(60.0f);
+		Input input;
+		double last = nowSeconds();
+		while (running)
+		{
+			double now = nowSeconds();
+			int ticks = stepper.advance((float)(now - last));
+			last = now;
+			if (ticks == 0)
+			{
+				float remaining = (1.0f - stepper.alpha()) * stepper.dt();
+				if (remaining > 0.002f)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+				continue;
+			}
+			if (inputs.acquire())
+			{
+				input = inputs.readBuffer();
+			}
+			for (int t = 0; t < ticks; t++)
+			{
+				scene.tick(stepper.dt());
+			}
+			scene.capture(snapshots.writeBuffer(), input.sampledAt);
+			snapshots.publish();
+		}
+	});
+
+	Result result;
+	unsigned int frames = 0;
+	double start = nowSeconds();
+	while (nowSeconds() - start < seconds)
+	{
+		inputs.writeBuffer().sampledAt = nowSeconds();
+		inputs.publish();
+		snapshots.acquire();
+		const Snapshot& snapshot = snapshots.readBuffer();
+		if (snapshot.world.empty())
+		{
+			std::this_thread::yield();   // nothing simulated yet
+			continue;
+		}
+		scene.record(snapshot, recordPasses);
+		present(refresh);
+		result.latencyMs += (nowSeconds() - snapshot.inputSampledAt) * 1000.0;
+		frames++;
+	}
+	result.frameMs = (nowSeconds() - start) * 1000.0 / frames;
+	result.latencyMs /= frames;
+	running = false;
+	sim.join();
+	return result;
+}
+
+int main()
+{
+	const double refresh = 1.0 / 120.0;
+	const double seconds = 2.0;
+	printf("%u hardware threads, 60 Hz ticks, 120 Hz present\n", std::thread::hardware_concurrency());
+
+	unsigned int nodeCounts[] = { 4000, 40000, 80000 };
+	for (unsigned int nodes : nodeCounts)
+	{
+		Scene scene(nodes);
+		double tickMs = benchBestOf(5, [&]() { scene.tick(1.0f / 60.0f); });
+		Snapshot probe;
+		scene.capture(probe, 0.0);
+		double recordMs = benchBestOf(5, [&]() { scene.record(probe, 2); });
+
+		Result serial = runSerial(scene, 2, seconds, refresh);
+		Result piped = runPipelined(scene, 2, seconds, refresh);
+		printf("%6u nodes (tick %.2f ms, record %.2f ms) | serial %6.2f ms/frame, %6.2f ms latency | pipelined %6.2f ms/frame, %6.2f ms latency\n",
+			nodes, tickMs, recordMs, serial.frameMs, serial.latencyMs, piped.frameMs, piped.latencyMs);
+	}
+	return 0;
+}
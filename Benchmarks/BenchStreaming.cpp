@@ -0,0 +1,237 @@
+// World-cell streaming without a GPU. A 100k-placement level over 2 km is split into cells and a
+// camera flies across it while CellStreamer picks cells; models are refcounted like
+// LevelLoader::acquirePrototype so resident memory is what live cells use. Reports update
+// cost, loads/unloads, peak resident memory against the budget, and checks that pacing back
+// and forth over a cell boundary doesn't thrash. The budget is soft: resident memory may pass it
+// only while the load ring alone needs more, and then no further than the ring; exits non-zero
+// otherwise. Then StreamingReader reads a set of temp files through the VirtualFileSystem to
+// measure background I/O throughput.
+
+#include "BenchCommon.h"
+#include "WorldStreaming.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+static const unsigned int MODEL_COUNT = 64;
+
+static size_t modelBytes(unsigned int model)
+{
+	return (size_t)(64 + (model % 8) * 96) << 10;   // 64 KB to 736 KB
+}
+
+// Instant loads: cells become resident on the update they're requested, so this measures the
+// streaming policy rather than I/O
+struct StreamingWorld
+{
+	WorldCellGrid grid;
+	CellStreamer streamer;
+	std::vector<unsigned int> modelRefs;
+	std::vector<unsigned int> load, unload;
+	size_t resident = 0;
+	size_t peak = 0;
+	unsigned int unloads = 0;
+
+	StreamingWorld(unsigned int placements, float extent, size_t budget)
+	{
+		BenchRandom rng;
+		std::vector<Vec3> positions(placements);
+		std::vector<std::string> models(placements);
+		for (unsigned int i = 0; i < placements; i++)
+		{
+			positions[i] = Vec3(rng.range(-extent, extent), 0.0f, rng.range(-extent, extent));
+			// Regional model sets, so moving around changes what is resident
+			int region = (int)floorf((positions[i].x + extent) / 256.0f) * 7 + (int)floorf((positions[i].z + extent) / 256.0f);
+			models[i] = "model" + std::to_string((region * 5 + rng.next() % 24) % MODEL_COUNT) + ".gem";
+		}
+		grid.build(positions, models);
+		streamer.memoryBudget = budget;
+		streamer.maxLoadsInFlight = 64;
+		modelRefs.assign(MODEL_COUNT, 0);
+	}
+
+	static unsigned int modelOf(const std::string& file)
+	{
+		return (unsigned int)atoi(file.c_str() + 5);
+	}
+
+	void step(const Vec3& centre)
+	{
+		streamer.update(grid, centre, resident, load, unload);
+		for (unsigned int c : unload)
+		{
+			for (const std::string& file : grid.cells[c].models)
+			{
+				unsigned int m = modelOf(file);
+				if (--modelRefs[m] == 0)
+				{
+					resident -= modelBytes(m);
+				}
+			}
+			unloads++;
+		}
+		for (unsigned int c : load)
+		{
+			for (const std::string& file : grid.cells[c].models)
+			{
+				unsigned int m = modelOf(file);
+				if (modelRefs[m]++ == 0)
+				{
+					resident += modelBytes(m);
+				}
+			}
+			streamer.markResident(grid, c, [](const std::string& file) { return modelBytes(modelOf(file)); });
+		}
+		peak = (std::max)(peak, resident);
+	}
+
+	// Memory of the distinct models used by cells in the load ring around 'centre': the least the
+	// soft budget lets the streamer hold there
+	size_t ringBytes(const Vec3& centre) const
+	{
+		std::vector<bool> used(MODEL_COUNT, false);
+		size_t bytes = 0;
+		int reach = (int)ceilf(streamer.loadRadius / grid.cellSize);
+		int cx = grid.coord(centre.x), cz = grid.coord(centre.z);
+		for (int z = cz - reach; z <= cz + reach; z++)
+		{
+			for (int x = cx - reach; x <= cx + reach; x++)
+			{
+				int c = grid.find(x, z);
+				if (c < 0 || grid.distanceTo(grid.cells[c], centre) > streamer.loadRadius)
+				{
+					continue;
+				}
+				for (const std::string& file : grid.cells[c].models)
+				{
+					unsigned int m = modelOf(file);
+					if (!used[m])
+					{
+						used[m] = true;
+						bytes += modelBytes(m);
+					}
+				}
+			}
+		}
+		return bytes;
+	}
+};
+
+int main()
+{
+	const float extent = 1024.0f;
+
+	// Fly diagonally across the level at 20 m/s, 60 updates per second
+	std::vector<Vec3> path;
+	for (float t = 0.0f; t < 1.0f; t += 20.0f / 60.0f / (2.0f * extent))
+	{
+		path.push_back(Vec3(-extent + t * 2.0f * extent, 1.8f, -extent + t * 2.0f * extent));
+	}
+	std::vector<size_t> ring(path.size());
+	size_t ringPeak = 0;
+	{
+		StreamingWorld world(100000, extent, 0);
+		for (size_t f = 0; f < path.size(); f++)
+		{
+			ring[f] = world.ringBytes(path[f]);
+			ringPeak = (std::max)(ringPeak, ring[f]);
+		}
+	}
+	printf("load ring needs up to %.1f MB along the path\n", ringPeak / 1048576.0);
+
+	// Each frame, resident memory may only pass a budget the load ring alone doesn't fit in, and
+	// then only up to the ring
+	bool withinBudget = true;
+	size_t budgets[] = { (size_t)64 << 20, ringPeak + ((size_t)1 << 20), (size_t)12 << 20, (size_t)6 << 20 };
+	for (size_t budget : budgets)
+	{
+		StreamingWorld world(100000, extent, budget);
+		double ms = 0.0;
+		unsigned int overFrames = 0;
+		for (size_t f = 0; f < path.size(); f++)
+		{
+			BenchClock::time_point start = BenchClock::now();
+			world.step(path[f]);
+			ms += benchElapsedMs(start);
+			overFrames += world.resident > (std::max)(budget, ring[f]);
+		}
+		unsigned int frames = (unsigned int)path.size();
+		bool within = overFrames == 0;
+		withinBudget = withinBudget && within;
+		printf("budget %5.1f MB | %5u cells | %5u frames, %.4f ms/update | %5u loads, %5u unloads (%u over budget) | peak %.1f MB resident, %u frames over (%s)\n",
+			budget / 1048576.0, (unsigned int)world.grid.cells.size(), frames, ms / frames, world.streamer.stats.loadsStarted,
+			world.unloads, world.streamer.stats.budgetUnloads, world.peak / 1048576.0, overFrames, within ? "ok" : "OVER");
+	}
+
+	// Hysteresis: settle beside a cell boundary, then pace 10 m either side of it
+	StreamingWorld pacing(100000, extent, (size_t)256 << 20);
+	Vec3 boundary(pacing.grid.cellSize * 3.0f, 1.8f, 5.0f);
+	pacing.step(boundary);
+	unsigned int settledUnloads = pacing.unloads, settledLoads = pacing.streamer.stats.loadsStarted;
+	for (int frame = 0; frame < 600; frame++)
+	{
+		float offset = 10.0f * sinf(frame * 0.05f);
+		pacing.step(Vec3(boundary.x + offset, boundary.y, boundary.z));
+	}
+	unsigned int thrash = pacing.unloads - settledUnloads;
+	printf("pacing over a boundary: %u loads, %u unloads after settling (%s)\n",
+		pacing.streamer.stats.loadsStarted - settledLoads, thrash, thrash == 0 ? "no thrash" : "THRASHING");
+
+	// Background reads through the VFS (loose files here; a mounted pack reads the same way)
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "bench_streaming";
+	std::filesystem::create_directories(dir);
+	const unsigned int fileCount = 48;
+	const size_t fileSize = (size_t)1 << 20;
+	std::vector<std::string> files;
+	std::string payload(fileSize, '\0');
+	for (size_t i = 0; i < fileSize; i++)
+	{
+		payload[i] = (char)(i * 31);
+	}
+	for (unsigned int i = 0; i < fileCount; i++)
+	{
+		files.push_back((dir / ("cell" + std::to_string(i) + ".bin")).string());
+		std::ofstream(files.back(), std::ios::binary).write(payload.data(), payload.size());
+	}
+
+	struct Checksum
+	{
+		uint64_t sum = 0;
+	};
+	StreamingReader<Checksum> reader([](const std::string& bytes, Checksum& out) {
+		for (char c : bytes)
+		{
+			out.sum += (unsigned char)c;
+		}
+	});
+	std::vector<StreamingReader<Checksum>::Completed> completed;
+	BenchClock::time_point start = BenchClock::now();
+	for (const std::string& file : files)
+	{
+		reader.request(file);
+	}
+	double pollMs = 0.0;
+	unsigned int polls = 0;
+	while (completed.size() < fileCount)
+	{
+		BenchClock::time_point pollStart = BenchClock::now();
+		reader.poll(completed);
+		pollMs += benchElapsedMs(pollStart);
+		polls++;
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	double seconds = benchElapsedMs(start) / 1000.0;
+	bool ok = true;
+	for (const StreamingReader<Checksum>::Completed& c : completed)
+	{
+		ok = ok && c.result && c.result->sum == completed[0].result->sum;
+	}
+	printf("reader: %u files, %.1f MB in %.3f s = %.1f MB/s | main thread %.4f ms per poll | %s\n",
+		fileCount, reader.bytesRead / 1048576.0, seconds, reader.bytesRead / 1048576.0 / seconds,
+		pollMs / polls, ok ? "checksums match" : "CHECKSUM MISMATCH");
+	std::filesystem::remove_all(dir);
+
+	return (withinBudget && thrash == 0 && ok) ? 0 : 1;
+}
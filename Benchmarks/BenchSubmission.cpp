@@ -0,0 +1,439 @@
+// Draw submission without a GPU: the command sequences Game::render produces recorded into a
+// RecordingBackend. Each frame is recorded per object (StaticMesh::draw per instance, Cube::draw
+// per particle, as before instancing) and instanced (InstancedRenderer: one draw per prototype per
+// submesh; ParticleSystem: one draw for all particles). Reports the CPU cost of a frame's
+// submission, its draw calls and state changes, and how particle cost scales to 100k; checks the
+// instance ranges and that replaying a recorded stream reproduces it exactly.
+
+#include "BenchCommon.h"
+#include "CommandRecorder.h"
+#include "maths.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Mirrors ConstantBufferClass: named variables written into a ring of 256-byte entries
+struct StandInConstantBuffer
+{
+	struct Variable
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+	std::map<std::string, Variable> constantBufferData;
+	std::vector<unsigned char> buffer;
+	uint64_t gpuAddress = 0;
+	unsigned int cbSizeInBytes = 256;
+	unsigned int maxDrawCalls = 1024;
+	unsigned int offsetIndex = 0;
+
+	void init(uint64_t address)
+	{
+		gpuAddress = address;
+		buffer.resize(cbSizeInBytes * maxDrawCalls);
+		constantBufferData["W"] = { 0, 64 };
+		constantBufferData["VP"] = { 64, 64 };
+		constantBufferData["time"] = { 128, 4 };
+		constantBufferData["cameraPos"] = { 144, 12 };
+	}
+
+	void update(std::string name, void* data)
+	{
+		Variable v = constantBufferData[name];
+		memcpy(&buffer[offsetIndex * cbSizeInBytes + v.offset], data, v.size);
+	}
+
+	uint64_t getGPUAddress() const
+	{
+		return gpuAddress + offsetIndex * cbSizeInBytes;
+	}
+
+	void next()
+	{
+		offsetIndex = offsetIndex + 1 >= maxDrawCalls ? 0 : offsetIndex + 1;
+	}
+};
+
+// Mirrors Shader::apply and Mesh::draw
+struct StandInShader
+{
+	StandInConstantBuffer vs, ps;
+
+	void apply(CommandRecorder& commands)
+	{
+		commands.setRootConstantBuffer(0, vs.getGPUAddress());
+		vs.next();
+		commands.setRootConstantBuffer(1, ps.getGPUAddress());
+		ps.next();
+	}
+};
+
+struct StandInMesh
+{
+	VertexBufferView vb;
+	IndexBufferView ib;
+	unsigned int indexCount = 0;
+
+	void draw(CommandRecorder& commands, unsigned int instanceCount = 1, unsigned int startInstance = 0)
+	{
+		commands.setTopology(TOPOLOGY_TRIANGLE_LIST);
+		commands.setVertexBuffer(0, vb);
+		commands.setIndexBuffer(ib);
+		commands.drawIndexed(indexCount, instanceCount, 0, 0, startInstance);
+	}
+};
+
+static uint64_t nextAddress = 0x10000;
+
+static StandInMesh makeMesh(unsigned int vertices, unsigned int indices)
+{
+	StandInMesh mesh;
+	mesh.vb.address = nextAddress;
+	mesh.vb.sizeInBytes = vertices * 56;
+	mesh.vb.strideInBytes = 56;
+	nextAddress += mesh.vb.sizeInBytes;
+	mesh.ib.address = nextAddress;
+	mesh.ib.sizeInBytes = indices * 4;
+	mesh.ib.format = 42;   // DXGI_FORMAT_R32_UINT
+	nextAddress += mesh.ib.sizeInBytes;
+	mesh.indexCount = indices;
+	return mesh;
+}
+
+// Core::beginRenderPass
+static int rootSignature;
+static void beginRenderPass(CommandRecorder& commands)
+{
+	RenderViewport v;
+	v.width = 1024.0f;
+	v.height = 768.0f;
+	RenderScissor r;
+	r.right = 1024;
+	r.bottom = 768;
+	commands.setViewport(v);
+	commands.setScissor(r);
+	commands.setRootSignature(&rootSignature);
+}
+
+// StaticMesh::draw: one shader and PSO per prototype, every submesh re-applies them
+struct StandInPrototype
+{
+	StandInShader shader;
+	int pso = 0;
+	std::vector<StandInMesh> meshes;
+
+	void draw(CommandRecorder& commands, Matrix& w, Matrix& vp, float time, const Vec3& camPos)
+	{
+		beginRenderPass(commands);
+		for (StandInMesh& mesh : meshes)
+		{
+			shader.vs.update("W", &w);
+			shader.vs.update("VP", &vp);
+			shader.vs.update("time", (void*)&time);
+			shader.vs.update("cameraPos", (void*)&camPos);
+			shader.apply(commands);
+			commands.setPipelineState(&pso);
+			mesh.draw(commands);
+		}
+	}
+};
+
+// InstancedRenderer: count per prototype, lay out ranges, write matrices, draw each batch
+struct StandInInstanced
+{
+	struct Batch
+	{
+		unsigned int first = 0;
+		unsigned int count = 0;
+		unsigned int written = 0;
+	};
+	std::vector<Batch> batches;
+	std::vector<Matrix> instanceBuffer;
+	unsigned int instances = 0;
+	StandInShader shader;
+	int pso = 0;
+	uint64_t instanceAddress = 0;
+
+	void begin(unsigned int prototypeSlots)
+	{
+		batches.assign(prototypeSlots, Batch());
+		instances = 0;
+	}
+
+	void count(unsigned int prototype)
+	{
+		batches[prototype].count++;
+	}
+
+	void layout()
+	{
+		unsigned int first = 0;
+		for (Batch& b : batches)
+		{
+			b.first = first;
+			first += b.count;
+		}
+		instances = first;
+		if (instanceBuffer.size() < instances)
+		{
+			instanceBuffer.resize(instances);
+		}
+	}
+
+	void add(unsigned int prototype, const Matrix& world)
+	{
+		Batch& b = batches[prototype];
+		instanceBuffer[b.first + b.written++] = world;
+	}
+
+	void draw(CommandRecorder& commands, std::vector<StandInPrototype>& prototypes, Matrix& vp, float time, const Vec3& camPos)
+	{
+		beginRenderPass(commands);
+		shader.vs.update("VP", &vp);
+		shader.vs.update("time", (void*)&time);
+		shader.vs.update("cameraPos", (void*)&camPos);
+		shader.apply(commands);
+		commands.setPipelineState(&pso);
+		VertexBufferView view;
+		view.address = instanceAddress;
+		view.sizeInBytes = instances * 64;
+		view.strideInBytes = 64;
+		commands.setVertexBuffer(1, view);
+		for (unsigned int p = 0; p < batches.size(); p++)
+		{
+			if (batches[p].count == 0)
+			{
+				continue;
+			}
+			for (StandInMesh& mesh : prototypes[p].meshes)
+			{
+				mesh.draw(commands, batches[p].count, batches[p].first);
+			}
+		}
+	}
+};
+
+struct BenchParticle
+{
+	Vec3 pos;
+	Vec3 prevPos;
+	float life;
+};
+
+struct ParticleInstance
+{
+	Vec3 position;
+	float scale;
+	float life;
+};
+
+// ParticleSystem::draw: one linear pass into the instance stream, one instanced cube draw
+struct StandInParticles
+{
+	std::vector<ParticleInstance> instanceBuffer;
+	StandInShader shader;
+	int pso = 0;
+	uint64_t instanceAddress = 0;
+	StandInMesh cube;
+
+	void draw(CommandRecorder& commands, const std::vector<BenchParticle>& list, Matrix& vp, float time, const Vec3& camPos, float alpha)
+	{
+		unsigned int count = (unsigned int)list.size();
+		if (instanceBuffer.size() < count)
+		{
+			instanceBuffer.resize(count);
+		}
+		ParticleInstance* out = instanceBuffer.data();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const BenchParticle& p = list[i];
+			ParticleInstance instance;
+			instance.position = lerp(p.prevPos, p.pos, alpha);
+			instance.scale = 0.05f;
+			instance.life = p.life;
+			out[i] = instance;
+		}
+		beginRenderPass(commands);
+		shader.vs.update("VP", &vp);
+		shader.vs.update("time", (void*)&time);
+		shader.vs.update("cameraPos", (void*)&camPos);
+		shader.apply(commands);
+		commands.setPipelineState(&pso);
+		VertexBufferView view;
+		view.address = instanceAddress;
+		view.sizeInBytes = count * sizeof(ParticleInstance);
+		view.strideInBytes = sizeof(ParticleInstance);
+		commands.setVertexBuffer(1, view);
+		cube.draw(commands, count, 0);
+	}
+};
+
+// The old ParticleSystem::draw: a matrix and a Cube::draw per particle
+static void drawParticlesPerCube(CommandRecorder& commands, StandInPrototype& cube, const std::vector<BenchParticle>& list, Matrix& vp, float time, const Vec3& camPos, float alpha)
+{
+	for (const BenchParticle& p : list)
+	{
+		Matrix w;
+		w.translation(lerp(p.prevPos, p.pos, alpha));
+		w.scaling(Vec3(0.05f, 0.05f, 0.05f));
+		cube.draw(commands, w, vp, time, camPos);
+	}
+}
+
+static std::vector<BenchParticle> makeParticles(BenchRandom& rng, unsigned int count)
+{
+	std::vector<BenchParticle> particles(count);
+	for (BenchParticle& p : particles)
+	{
+		p.pos = Vec3(rng.range(-20, 20), rng.range(-20, 20), rng.range(-20, 20));
+		p.prevPos = p.pos + Vec3(0.0f, -0.01f, 0.0f);
+		p.life = rng.range(0, 1);
+	}
+	return particles;
+}
+
+int main()
+{
+	const unsigned int prototypeCount = 8, visibleDraws = 2000, particleCount = 1000, frames = 20;
+
+	std::vector<StandInPrototype> prototypes(prototypeCount + 1);   // the last one is the particle cube
+	for (unsigned int p = 0; p < prototypes.size(); p++)
+	{
+		StandInPrototype& proto = prototypes[p];
+		proto.shader.vs.init(nextAddress);
+		nextAddress += 1 << 18;
+		proto.shader.ps.init(nextAddress);
+		nextAddress += 1 << 18;
+		unsigned int submeshes = p < prototypeCount ? 1 + p % 3 : 1;
+		for (unsigned int m = 0; m < submeshes; m++)
+		{
+			proto.meshes.push_back(p < prototypeCount ? makeMesh(2000, 6000) : makeMesh(24, 36));
+		}
+	}
+	StandInPrototype& cube = prototypes[prototypeCount];
+
+	BenchRandom rng;
+	std::vector<unsigned int> visible(visibleDraws);
+	std::vector<Matrix> worlds(visibleDraws);
+	for (unsigned int i = 0; i < visibleDraws; i++)
+	{
+		visible[i] = rng.next() % prototypeCount;
+		worlds[i].translation(Vec3(rng.range(-500, 500), 0.0f, rng.range(-500, 500)));
+	}
+	std::vector<BenchParticle> particles = makeParticles(rng, particleCount);
+
+	Matrix vp;
+	Vec3 eye(0.0f, 5.0f, 0.0f);
+	float time = 1.0f;
+	StandInInstanced instanced;
+	instanced.shader.vs.init(nextAddress);
+	nextAddress += 1 << 18;
+	instanced.shader.ps.init(nextAddress);
+	nextAddress += 1 << 18;
+	instanced.instanceAddress = nextAddress;
+	nextAddress += 1 << 24;
+	StandInParticles instancedParticles;
+	instancedParticles.shader.vs.init(nextAddress);
+	nextAddress += 1 << 18;
+	instancedParticles.shader.ps.init(nextAddress);
+	nextAddress += 1 << 18;
+	instancedParticles.instanceAddress = nextAddress;
+	nextAddress += 1 << 24;
+	instancedParticles.cube = cube.meshes[0];
+	float alpha = 0.5f;
+
+	// Records one frame either way
+	RecordingBackend recorder;
+	auto recordFrame = [&](bool instancing) {
+		if (instancing)
+		{
+			instanced.begin(prototypeCount);
+			for (unsigned int i = 0; i < visibleDraws; i++)
+			{
+				instanced.count(visible[i]);
+			}
+			instanced.layout();
+			for (unsigned int i = 0; i < visibleDraws; i++)
+			{
+				instanced.add(visible[i], worlds[i]);
+			}
+			instanced.draw(recorder, prototypes, vp, time, eye);
+			instancedParticles.draw(recorder, particles, vp, time, eye, alpha);
+		}
+		else
+		{
+			for (unsigned int i = 0; i < visibleDraws; i++)
+			{
+				prototypes[visible[i]].draw(recorder, worlds[i], vp, time, eye);
+			}
+			drawParticlesPerCube(recorder, cube, particles, vp, time, eye, alpha);
+		}
+	};
+
+	bool ok = true;
+	for (int instancing = 0; instancing < 2; instancing++)
+	{
+		double best = 1e30;
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			recorder.clear();
+			recorder.stats.reset();
+			BenchClock::time_point start = BenchClock::now();
+			recordFrame(instancing != 0);
+			double ms = benchElapsedMs(start);
+			best = ms < best ? ms : best;
+		}
+		CommandStats frame = recorder.stats;
+		printf("%-12s %u instances + %u particles -> %5u draws, %6u state changes (%5u redundant, %2.0f%%), %.1f KB recorded, %.3f ms CPU (best of %u)\n",
+			instancing ? "instanced:" : "per object:", visibleDraws, particleCount, frame.draws, frame.stateChanges, frame.redundantChanges,
+			100.0 * frame.redundantChanges / frame.stateChanges, recorder.bytes() / 1024.0, best, frames);
+
+		// Replaying the stream into a second recorder must reproduce it byte for byte
+		RecordingBackend copy;
+		recorder.replay(copy);
+		bool same = copy.buffer == recorder.buffer && copy.commands == recorder.commands &&
+			copy.stats.draws == frame.draws && copy.stats.stateChanges == frame.stateChanges &&
+			copy.stats.redundantChanges == frame.redundantChanges;
+		double replayMs = benchBestOf(5, [&]() {
+			copy.clear();
+			recorder.replay(copy);
+		});
+		printf("%-12s replay %.3f ms, %s\n", "", replayMs, same ? "identical" : "MISMATCH");
+		ok = ok && same;
+	}
+
+	// Every batch holds exactly its prototype's worlds, in visible order
+	bool ranges = true;
+	std::vector<unsigned int> seen(prototypeCount, 0);
+	for (unsigned int i = 0; i < visibleDraws; i++)
+	{
+		const StandInInstanced::Batch& b = instanced.batches[visible[i]];
+		const Matrix& slot = instanced.instanceBuffer[b.first + seen[visible[i]]++];
+		ranges = ranges && memcmp(slot.m, worlds[i].m, sizeof(slot.m)) == 0;
+	}
+	for (unsigned int p = 0; p < prototypeCount; p++)
+	{
+		ranges = ranges && seen[p] == instanced.batches[p].count && instanced.batches[p].written == seen[p];
+	}
+	printf("instance ranges: %s\n", ranges ? "ok" : "WRONG");
+
+	// Particles alone: the old per-cube path at the game's 100 against one instanced draw
+	std::vector<BenchParticle> hundred = makeParticles(rng, 100);
+	double perCubeMs = benchBestOf(frames, [&]() {
+		recorder.clear();
+		drawParticlesPerCube(recorder, cube, hundred, vp, time, eye, alpha);
+	});
+	printf("particles per cube:  %6u -> %.4f ms CPU (%.1f ns each)\n", 100, perCubeMs, perCubeMs * 1e6 / 100);
+	for (unsigned int count : { 100u, 10000u, 100000u })
+	{
+		std::vector<BenchParticle> list = makeParticles(rng, count);
+		recorder.stats.reset();
+		double ms = benchBestOf(frames, [&]() {
+			recorder.clear();
+			instancedParticles.draw(recorder, list, vp, time, eye, alpha);
+		});
+		printf("particles instanced: %6u -> %.4f ms CPU (%.1f ns each), %u draws per frame\n",
+			count, ms, ms * 1e6 / count, recorder.stats.draws / frames);
+	}
+	return ok && ranges ? 0 : 1;
+}
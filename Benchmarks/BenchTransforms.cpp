@@ -0,0 +1,166 @@
+// TransformHierarchy update cost: full recompute against the old per-object composition
+// (five 4x4 multiplies), sparse dirty subtrees, and the level-parallel path. Every path is checked
+// against a serial recompute of the whole hierarchy with the old composition; exits non-zero on a
+// mismatch.
+
+#include "BenchCommon.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// The composition LevelLoader used before: T * (Rz * Ry * Rx) * S as full 4x4 multiplies
+static Matrix composeReference(const Vec3& pos, const Vec3& rot, const Vec3& scale)
+{
+	Matrix sMat; sMat.setIdentity(); sMat.scaling(scale);
+	Matrix rotX; rotX.setIdentity(); rotX.rotAroundX(rot.x * PI_F / 180.0f);
+	Matrix rotY; rotY.setIdentity(); rotY.rotAroundY(rot.y * PI_F / 180.0f);
+	Matrix rotZ; rotZ.setIdentity(); rotZ.rotAroundZ(rot.z * PI_F / 180.0f);
+	Matrix rMat = rotZ.multiply(rotY.multiply(rotX));
+	Matrix tMat; tMat.setIdentity(); tMat.translation(pos);
+	return tMat.multiply(rMat.multiply(sMat));
+}
+
+// Largest difference between two matrices, relative to the size of each entry
+static float matrixError(const Matrix& a, const Matrix& b)
+{
+	float worst = 0.0f;
+	for (int k = 0; k < 16; k++)
+	{
+		float d = fabsf(a.m[k] - b.m[k]) / (1.0f + fabsf(b.m[k]));
+		worst = d > worst ? d : worst;
+	}
+	return worst;
+}
+
+// Worst error of h.world against every node recomputed from its local TRS, parents first
+static float hierarchyError(const TransformHierarchy& h)
+{
+	std::vector<Matrix> expected(h.size());
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < h.size(); i++)
+	{
+		Matrix local = composeReference(h.position[i], h.rotation[i], h.scale[i]);
+		int p = h.parent[i];
+		expected[i] = p == TransformHierarchy::NO_PARENT ? local : expected[p].multiply(local);
+		float e = matrixError(h.world[i], expected[i]);
+		worst = e > worst ? e : worst;
+	}
+	return worst;
+}
+
+static const float TOLERANCE = 1e-4f;
+
+// Roots with 'fanout' children per node down to 'levels' levels, added level by level
+static void buildScene(TransformHierarchy& h, unsigned int roots, unsigned int fanout, unsigned int levels)
+{
+	BenchRandom rng;
+	h.clear();
+	unsigned int levelBegin = 0;
+	for (unsigned int r = 0; r < roots; r++)
+	{
+		h.add(TransformHierarchy::NO_PARENT, Vec3(rng.range(-100, 100), 0, rng.range(-100, 100)), Vec3(0, rng.range(0, 360), 0), Vec3(1, 1, 1));
+	}
+	for (unsigned int level = 1; level < levels; level++)
+	{
+		unsigned int levelEnd = h.size();
+		for (unsigned int p = levelBegin; p < levelEnd; p++)
+		{
+			for (unsigned int c = 0; c < fanout; c++)
+			{
+				h.add((int)p, Vec3(rng.range(-2, 2), rng.range(0, 2), rng.range(-2, 2)),
+					Vec3(rng.range(0, 30), rng.range(0, 360), 0), Vec3(0.8f, 0.8f, 0.8f));
+			}
+		}
+		levelBegin = levelEnd;
+	}
+	h.update();
+}
+
+// Returns false when an update path disagrees with the full recompute
+static bool run(unsigned int roots, JobSystem& jobs)
+{
+	TransformHierarchy h;
+	buildScene(h, roots, 4, 4);
+	unsigned int count = h.size();
+
+	// Old path: every object composed from scratch every frame, no parents
+	std::vector<Matrix> legacy(count);
+	double legacyMs = benchBestOf(5, [&]() {
+		for (unsigned int i = 0; i < count; i++)
+		{
+			legacy[i] = composeReference(h.position[i], h.rotation[i], h.scale[i]);
+		}
+	});
+
+	auto markRoots = [&](unsigned int every) {
+		for (unsigned int r = 0; r < roots; r += every)
+		{
+			h.rotate(r, Vec3(0, 1, 0));
+		}
+	};
+
+	// Every root has 1 + 4 + 16 + 64 nodes under it, itself included
+	unsigned int perRoot = count / roots;
+	unsigned int sparseRoots = (roots + 99) / 100;
+
+	double fullMs = benchBestOf(5, [&]() { markRoots(1); h.update(); });
+	unsigned int fullCount = h.stats.recomputed;
+	float fullError = hierarchyError(h);
+	double sparseMs = benchBestOf(5, [&]() { markRoots(100); h.update(); });
+	unsigned int sparseCount = h.stats.recomputed;
+	float sparseError = hierarchyError(h);
+	double idleMs = benchBestOf(5, [&]() { h.update(); });
+	unsigned int idleCount = h.stats.recomputed;
+	double parallelMs = benchBestOf(5, [&]() { markRoots(1); h.update(&jobs); });
+	float parallelError = hierarchyError(h);
+	double parallelSparseMs = benchBestOf(5, [&]() { markRoots(100); h.update(&jobs); });
+	unsigned int parallelSparseCount = h.stats.recomputed;
+	float parallelSparseError = hierarchyError(h);
+
+	// A child edited along with its root must not be counted twice
+	h.rotate(roots, Vec3(1, 0, 0));
+	markRoots(1);
+	h.update(&jobs);
+	unsigned int overlapCount = h.stats.recomputed;
+	float overlapError = hierarchyError(h);
+
+	float worst = (std::max)((std::max)(fullError, sparseError), (std::max)((std::max)(parallelError, parallelSparseError), overlapError));
+	bool ok = worst <= TOLERANCE && fullCount == count && sparseCount == sparseRoots * perRoot && idleCount == 0 &&
+		parallelSparseCount == sparseRoots * perRoot && overlapCount == count;
+
+	printf("%8u nodes (%u levels) | legacy compose %8.3f ms | full %8.3f ms (%u) | 1%% dirty %7.3f ms (%u) | idle %6.3f ms | x%u threads: full %8.3f ms, 1%% dirty %7.3f ms | error %.2g %s\n",
+		count, h.stats.levels, legacyMs, fullMs, fullCount, sparseMs, sparseCount, idleMs, jobs.threadCount(), parallelMs, parallelSparseMs,
+		worst, ok ? "ok" : "MISMATCH");
+	return ok;
+}
+
+int main()
+{
+	// compose() must match the matrix product it replaces
+	BenchRandom rng;
+	float worst = 0.0f;
+	for (int i = 0; i < 10000; i++)
+	{
+		Vec3 p(rng.range(-50, 50), rng.range(-50, 50), rng.range(-50, 50));
+		Vec3 r(rng.range(-360, 360), rng.range(-360, 360), rng.range(-360, 360));
+		Vec3 s(rng.range(0.1f, 3), rng.range(0.1f, 3), rng.range(0.1f, 3));
+		Matrix a = TransformHierarchy::compose(p, r, s);
+		Matrix b = composeReference(p, r, s);
+		for (int k = 0; k < 16; k++)
+		{
+			float d = fabsf(a.m[k] - b.m[k]);
+			worst = d > worst ? d : worst;
+		}
+	}
+	bool ok = worst <= TOLERANCE;
+	printf("compose vs reference: max abs difference %g %s\n", worst, ok ? "ok" : "MISMATCH");
+
+	// At least four workers, so the level split is exercised on small machines too
+	JobSystem jobs((std::max)(4u, std::thread::hardware_concurrency()));
+	ok = run(100, jobs) && ok;
+	ok = run(1000, jobs) && ok;
+	ok = run(10000, jobs) && ok;
+	ok = run(50000, jobs) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+// Level-load uploads without a GPU: every mesh's index and vertex buffer copied through a simulated
+// copy queue, a thread that runs submissions in order, pays a fixed cost per submission and
+// memcpys each copy. The old Core::uploadResource path allocates an upload buffer per call,
+// submits it alone and flushes; UploadBatcher's path stages into one StagingRing, submits a batch
+// per quarter ring and only waits when the ring is full. Reports load time, submissions and
+// flushes/stalls, and checks every destination holds its data.
+
+#include "BenchCommon.h"
+#include "StagingRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed cost of a submission on the simulated queue: command list launch plus fence signal
+static const double SUBMIT_COST_MS = 0.03;
+
+struct Copy
+{
+	const unsigned char* source;
+	unsigned char* destination;
+	size_t size;
+};
+
+// In-order queue with a fence, as ID3D12CommandQueue + ID3D12Fence
+class SimulatedCopyQueue
+{
+public:
+	SimulatedCopyQueue()
+	{
+		worker = std::thread([this]() { run(); });
+	}
+
+	~SimulatedCopyQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		worker.join();
+	}
+
+	// Returns the fence value that signals when these copies are done
+	uint64_t execute(std::vector<Copy>&& copies)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back({ std::move(copies), ++submitted });
+		wake.notify_all();
+		return submitted;
+	}
+
+	uint64_t completedValue() const
+	{
+		return completed.load(std::memory_order_acquire);
+	}
+
+	void wait(uint64_t value)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() { return completed.load() >= value; });
+	}
+
+private:
+	struct Submission
+	{
+		std::vector<Copy> copies;
+		uint64_t fence;
+	};
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	std::deque<Submission> pending;
+	uint64_t submitted = 0;
+	std::atomic<uint64_t> completed{ 0 };
+	bool stopping = false;
+
+	void run()
+	{
+		for (;;)
+		{
+			Submission s;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || !pending.empty(); });
+				if (pending.empty())
+				{
+					return;
+				}
+				s = std::move(pending.front());
+				pending.pop_front();
+			}
+			BenchClock::time_point start = BenchClock::now();
+			while (benchElapsedMs(start) < SUBMIT_COST_MS)
+			{
+			}
+			for (const Copy& c : s.copies)
+			{
+				memcpy(c.destination, c.source, c.size);
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				completed.store(s.fence, std::memory_order_release);
+			}
+			done.notify_all();
+		}
+	}
+};
+
+struct Upload
+{
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> destination;   // the default-heap buffer
+};
+
+struct LoadStats
+{
+	double ms = 0.0;
+	unsigned int submissions = 0;
+	unsigned int waits = 0;
+};
+
+// Core::uploadResource before: a buffer, a submission and a full flush per upload
+static LoadStats loadPerUpload(std::vector<Upload>& uploads)
+{
+	LoadStats stats;
+	BenchClock::time_point start = BenchClock::now();
+	SimulatedCopyQueue queue;
+	for (Upload& u : uploads)
+	{
+		std::vector<unsigned char> staging(u.data.size());
+		memcpy(staging.data(), u.data.data(), u.data.size());
+		uint64_t fence = queue.execute({ { staging.data(), u.destination.data(), u.data.size() } });
+		stats.submissions++;
+		queue.wait(fence);
+		stats.waits++;
+	}
+	stats.ms = benchElapsedMs(start);
+	return stats;
+}
+
+// UploadBatcher: staged into the ring, batched, waiting only for ring space
+static LoadStats loadBatched(std::vector<Upload>& uploads, size_t ringBytes)
+{
+	// Created and mapped once at Core::init, so outside the load
+	std::vector<unsigned char> memory(ringBytes);
+	LoadStats stats;
+	BenchClock::time_point start = BenchClock::now();
+	SimulatedCopyQueue queue;
+	StagingRing ring;
+	ring.init(ringBytes);
+	std::vector<Copy> batch;
+	auto submit = [&]() {
+		if (batch.empty())
+		{
+			return;
+		}
+		ring.close(queue.execute(std::move(batch)));
+		batch.clear();
+		stats.submissions++;
+	};
+	for (Upload& u : uploads)
+	{
+		ring.reclaim(queue.completedValue());
+		size_t offset = ring.allocate(u.data.size(), 16);
+		while (offset == StagingRing::FAILED)
+		{
+			submit();
+			queue.wait(ring.oldestPending());
+			stats.waits++;
+			ring.reclaim(queue.completedValue());
+			offset = ring.allocate(u.data.size(), 16);
+		}
+		memcpy(&memory[offset], u.data.data(), u.data.size());
+		batch.push_back({ &memory[offset], u.destination.data(), u.data.size() });
+		if (ring.bytesOpen() >= ring.size() / 4)
+		{
+			submit();
+		}
+	}
+	submit();
+	queue.wait(stats.submissions);
+	stats.ms = benchElapsedMs(start);
+	return stats;
+}
+
+static bool verify(std::vector<Upload>& uploads)
+{
+	bool ok = true;
+	for (Upload& u : uploads)
+	{
+		ok = ok && memcmp(u.data.data(), u.destination.data(), u.data.size()) == 0;
+		memset(u.destination.data(), 0, u.destination.size());
+	}
+	return ok;
+}
+
+int main()
+{
+	// A level's worth of meshes: an index and a vertex buffer each, 2 KB to 1 MB
+	const unsigned int meshCount = 400;
+	BenchRandom rng;
+	std::vector<Upload> uploads;
+	size_t total = 0;
+	for (unsigned int m = 0; m < meshCount; m++)
+	{
+		size_t vertices = 64 + rng.next() % 16000;
+		size_t sizes[2] = { vertices * 3 / 2 * 4, vertices * 56 };
+		for (size_t size : sizes)
+		{
+			Upload u;
+			u.data.resize(size);
+			for (size_t i = 0; i < size; i += 64)
+			{
+				u.data[i] = (unsigned char)rng.next();
+			}
+			u.destination.assign(size, 0);
+			total += size;
+			uploads.push_back(std::move(u));
+		}
+	}
+	printf("%u meshes, %u uploads, %.1f MB; simulated copy queue at %.2f ms per submission\n", meshCount,
+		(unsigned int)uploads.size(), total / 1048576.0, SUBMIT_COST_MS);
+
+	LoadStats before = loadPerUpload(uploads);
+	bool beforeOk = verify(uploads);
+	printf("per upload:      %8.2f ms | %4u submissions | %4u queue flushes | %s\n", before.ms, before.submissions, before.waits,
+		beforeOk ? "data ok" : "DATA MISMATCH");
+
+	bool allOk = beforeOk;
+	for (size_t ringMb : { 64, 16, 4 })
+	{
+		LoadStats after = loadBatched(uploads, ringMb * 1048576);
+		bool ok = verify(uploads);
+		allOk = allOk && ok;
+		printf("%2zu MB ring:      %8.2f ms | %4u submissions | %4u ring stalls   | %s (x%.1f)\n", ringMb, after.ms, after.submissions,
+			after.waits, ok ? "data ok" : "DATA MISMATCH", before.ms / after.ms);
+	}
+	return allOk ? 0 : 1;
+}
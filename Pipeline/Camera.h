@@ -1,5 +1,6 @@
 #pragma once
 #include "maths.h"
+#include "Frustum.h"
 #include "window.h" // For input handling
 #include <cmath>
 
@@ -82,6 +83,14 @@ public:
     {
         return projectionMatrix.multiply(viewMatrix);
     }
+
+    // World-space planes of the current view, for culling
+    Frustum getFrustum()
+    {
+        Frustum f;
+        f.fromViewProjection(getViewProjection());
+        return f;
+    }
     
     void setAspectRatio(float ratio) {
         aspectRatio = ratio;
@@ -0,0 +1,164 @@
+#pragma once
+#include "MeshBVH.h"
+#include <cmath>
+
+// Swept-sphere character controller. Movement is resolved with collide-and-slide: sweep the
+// sphere along the remaining displacement, stop just short of the first contact, and slide the
+// rest along the contact plane (or the crease between two planes), for at most maxIterations
+// sweeps. Small ledges are climbed by a step-up pass and a downward probe keeps the body on
+// walkable ground.
+//
+// The world is supplied as a sweep callback, bool sweep(centre, delta, radius, MeshBVH::SweepHit&),
+// which must return the earliest contact before hit.t (in [0, 1] of delta).
+class CharacterController
+{
+public:
+	float radius = 0.5f;
+	float stepHeight = 0.35f;
+	float skin = 0.01f;              // gap kept from surfaces so the next sweep doesn't start inside
+	float maxSlopeCos = 0.64f;       // cos(50 degrees): steeper surfaces are walls
+	float groundProbe = 0.05f;       // how far below the feet ground is searched for
+	int maxIterations = 4;
+
+	// Result of the last move
+	bool onGround = false;
+	Vec3 groundNormal = Vec3(0, 1, 0);
+
+	struct Stats
+	{
+		unsigned int sweeps = 0;
+		unsigned int steps = 0;      // successful step-ups
+	} stats;
+
+	// Moves 'position' by 'velocity * dt' and clips 'velocity' against whatever was hit
+	template<typename Sweep>
+	void move(Vec3& position, Vec3& velocity, float dt, Sweep sweep)
+	{
+		Vec3 delta = velocity * dt;
+		bool wasOnGround = onGround;
+		Vec3 start = position;
+
+		Vec3 blockedNormal;
+		bool blocked = slide(position, delta, velocity, sweep, &blockedNormal);
+
+		// Step up: a wall stopped horizontal motion while standing, so retry the horizontal part
+		// from 'stepHeight' higher and drop back down onto walkable ground
+		Vec3 horizontal(delta.x, 0.0f, delta.z);
+		if (blocked && wasOnGround && horizontal.lengthSquared() > 1e-8f)
+		{
+			Vec3 raised = start;
+			Vec3 scratch;
+			Vec3 up(0.0f, stepHeight, 0.0f);
+			sweepTo(raised, up, sweep, scratch);
+			slide(raised, horizontal, scratch, sweep, nullptr);
+			MeshBVH::SweepHit down;
+			Vec3 drop(0.0f, -(stepHeight + groundProbe), 0.0f);
+			stats.sweeps++;
+			if (sweep(raised, drop, radius, down) && down.normal.y >= maxSlopeCos)
+			{
+				Vec3 landed = raised + drop * down.t + down.normal * skin;
+				Vec3 stepProgress = landed - start;
+				Vec3 slideProgress = position - start;
+				if (Vec3(stepProgress.x, 0, stepProgress.z).lengthSquared() > Vec3(slideProgress.x, 0, slideProgress.z).lengthSquared() + 1e-6f)
+				{
+					position = landed;
+					velocity = Vec3(velocity.x, 0.0f, velocity.z);
+					stats.steps++;
+				}
+			}
+		}
+
+		// Ground detection
+		onGround = false;
+		if (velocity.y <= 0.0f)
+		{
+			MeshBVH::SweepHit down;
+			Vec3 probe(0.0f, -groundProbe, 0.0f);
+			stats.sweeps++;
+			if (sweep(position, probe, radius, down) && down.normal.y >= maxSlopeCos)
+			{
+				onGround = true;
+				groundNormal = down.normal;
+				position = position + probe * down.t + down.normal * skin;   // stick to slopes
+				if (velocity.y < 0.0f)
+				{
+					velocity.y = 0.0f;
+				}
+			}
+		}
+	}
+
+private:
+	// Sweep the whole displacement once; stops short of contact. Returns true on contact.
+	template<typename Sweep>
+	bool sweepTo(Vec3& position, const Vec3& delta, Sweep sweep, Vec3& normal)
+	{
+		MeshBVH::SweepHit hit;
+		stats.sweeps++;
+		if (!sweep(position, delta, radius, hit))
+		{
+			position += delta;
+			return false;
+		}
+		position = position + delta * hit.t + hit.normal * skin;
+		normal = hit.normal;
+		return true;
+	}
+
+	// Collide-and-slide. 'wallNormal' (optional) receives the first non-walkable normal hit.
+	template<typename Sweep>
+	bool slide(Vec3& position, Vec3 remaining, Vec3& velocity, Sweep sweep, Vec3* wallNormal)
+	{
+		bool hitWall = false;
+		Vec3 firstNormal;
+		for (int i = 0; i < maxIterations && remaining.lengthSquared() > 1e-10f; i++)
+		{
+			MeshBVH::SweepHit hit;
+			stats.sweeps++;
+			if (!sweep(position, remaining, radius, hit))
+			{
+				position += remaining;
+				return hitWall;
+			}
+			position = position + remaining * hit.t + hit.normal * skin;
+			remaining = remaining * (1.0f - hit.t);
+
+			if (hit.normal.y < maxSlopeCos)
+			{
+				hitWall = true;
+				if (wallNormal)
+				{
+					*wallNormal = hit.normal;
+				}
+			}
+
+			// Slide along the plane; on a second plane follow the crease between the two
+			if (i == 0)
+			{
+				remaining -= hit.normal * remaining.Dot(hit.normal);
+				firstNormal = hit.normal;
+			}
+			else
+			{
+				Vec3 crease = firstNormal.Cross(hit.normal);
+				float len = crease.length();
+				if (len < 1e-4f)
+				{
+					remaining -= hit.normal * remaining.Dot(hit.normal);
+				}
+				else
+				{
+					crease = crease / len;
+					remaining = crease * remaining.Dot(crease);
+				}
+				firstNormal = hit.normal;
+			}
+			float into = velocity.Dot(hit.normal);
+			if (into < 0.0f)
+			{
+				velocity -= hit.normal * into;
+			}
+		}
+		return hitWall;
+	}
+};
@@ -0,0 +1,395 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Backend-neutral draw submission. Draw code records through a CommandRecorder; Core implements it
+// over the frame's D3D12 command list, and RecordingBackend serialises the commands into a buffer
+// so submission can run (and be measured) without a GPU.
+
+// Same layouts as the D3D12 structures they stand for
+struct RenderViewport
+{
+	float x = 0.0f, y = 0.0f, width = 0.0f, height = 0.0f, minDepth = 0.0f, maxDepth = 1.0f;
+};
+
+struct RenderScissor
+{
+	int32_t left = 0, top = 0, right = 0, bottom = 0;
+};
+
+struct VertexBufferView
+{
+	uint64_t address = 0;
+	uint32_t sizeInBytes = 0;
+	uint32_t strideInBytes = 0;
+};
+
+struct IndexBufferView
+{
+	uint64_t address = 0;
+	uint32_t sizeInBytes = 0;
+	uint32_t format = 0;   // DXGI_FORMAT
+};
+
+// Values match D3D_PRIMITIVE_TOPOLOGY
+enum PrimitiveTopology : uint32_t
+{
+	TOPOLOGY_TRIANGLE_LIST = 4,
+	TOPOLOGY_TRIANGLE_STRIP = 5
+};
+
+// What a frame submitted. A state change is any state-setting command recorded; it is redundant
+// when it sets what was already bound, which the GPU front end still has to process. With
+// skipRedundant set such commands are dropped instead and counted as eliminated.
+struct CommandStats
+{
+	unsigned int draws = 0;
+	unsigned int instances = 0;
+	unsigned int stateChanges = 0;
+	unsigned int redundantChanges = 0;
+	unsigned int eliminated = 0;
+
+	void reset()
+	{
+		*this = CommandStats();
+	}
+
+	void add(const CommandStats& other)
+	{
+		draws += other.draws;
+		instances += other.instances;
+		stateChanges += other.stateChanges;
+		redundantChanges += other.redundantChanges;
+		eliminated += other.eliminated;
+	}
+};
+
+class CommandRecorder
+{
+public:
+	static constexpr unsigned int ROOT_SLOTS = 8;
+	static constexpr unsigned int VERTEX_SLOTS = 4;
+
+	CommandStats stats;
+
+	// Drop state commands that would set what is already bound
+	bool skipRedundant = false;
+
+	virtual ~CommandRecorder()
+	{
+	}
+
+	void setViewport(const RenderViewport& viewport)
+	{
+		if (skip(bound.hasViewport && memcmp(&bound.viewport, &viewport, sizeof(viewport)) == 0)) return;
+		bound.viewport = viewport;
+		bound.hasViewport = true;
+		recordViewport(viewport);
+	}
+
+	void setScissor(const RenderScissor& scissor)
+	{
+		if (skip(bound.hasScissor && memcmp(&bound.scissor, &scissor, sizeof(scissor)) == 0)) return;
+		bound.scissor = scissor;
+		bound.hasScissor = true;
+		recordScissor(scissor);
+	}
+
+	// Backend objects (root signature, pipeline state) are opaque here. A new root signature
+	// invalidates the root arguments bound under the old one.
+	void setRootSignature(const void* rootSignature)
+	{
+		if (skip(bound.rootSignature == rootSignature)) return;
+		if (bound.rootSignature != rootSignature) memset(bound.rootConstants, 0, sizeof(bound.rootConstants));
+		bound.rootSignature = rootSignature;
+		recordRootSignature(rootSignature);
+	}
+
+	void setPipelineState(const void* pipelineState)
+	{
+		if (skip(bound.pipelineState == pipelineState)) return;
+		bound.pipelineState = pipelineState;
+		recordPipelineState(pipelineState);
+	}
+
+	void setRootConstantBuffer(unsigned int slot, uint64_t address)
+	{
+		if (skip(slot < ROOT_SLOTS && bound.rootConstants[slot] == address)) return;
+		if (slot < ROOT_SLOTS) bound.rootConstants[slot] = address;
+		recordRootConstantBuffer(slot, address);
+	}
+
+	void setTopology(PrimitiveTopology topology)
+	{
+		if (skip(bound.topology == topology)) return;
+		bound.topology = topology;
+		recordTopology(topology);
+	}
+
+	void setVertexBuffer(unsigned int slot, const VertexBufferView& view)
+	{
+		if (skip(slot < VERTEX_SLOTS && memcmp(&bound.vertexBuffers[slot], &view, sizeof(view)) == 0)) return;
+		if (slot < VERTEX_SLOTS) bound.vertexBuffers[slot] = view;
+		recordVertexBuffer(slot, view);
+	}
+
+	void setIndexBuffer(const IndexBufferView& view)
+	{
+		if (skip(memcmp(&bound.indexBuffer, &view, sizeof(view)) == 0)) return;
+		bound.indexBuffer = view;
+		recordIndexBuffer(view);
+	}
+
+	void drawIndexed(unsigned int indexCount, unsigned int instanceCount = 1, unsigned int startIndex = 0, int baseVertex = 0, unsigned int startInstance = 0)
+	{
+		stats.draws++;
+		stats.instances += instanceCount;
+		recordDrawIndexed(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	void draw(unsigned int vertexCount, unsigned int instanceCount = 1, unsigned int startVertex = 0, unsigned int startInstance = 0)
+	{
+		stats.draws++;
+		stats.instances += instanceCount;
+		recordDraw(vertexCount, instanceCount, startVertex, startInstance);
+	}
+
+	// A new command list starts with nothing bound; stats carry on
+	void resetState()
+	{
+		bound = Bound();
+	}
+
+protected:
+	virtual void recordViewport(const RenderViewport& viewport) = 0;
+	virtual void recordScissor(const RenderScissor& scissor) = 0;
+	virtual void recordRootSignature(const void* rootSignature) = 0;
+	virtual void recordPipelineState(const void* pipelineState) = 0;
+	virtual void recordRootConstantBuffer(unsigned int slot, uint64_t address) = 0;
+	virtual void recordTopology(PrimitiveTopology topology) = 0;
+	virtual void recordVertexBuffer(unsigned int slot, const VertexBufferView& view) = 0;
+	virtual void recordIndexBuffer(const IndexBufferView& view) = 0;
+	virtual void recordDrawIndexed(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+	virtual void recordDraw(unsigned int vertexCount, unsigned int instanceCount, unsigned int startVertex, unsigned int startInstance) = 0;
+
+private:
+	struct Bound
+	{
+		RenderViewport viewport;
+		RenderScissor scissor;
+		bool hasViewport = false;
+		bool hasScissor = false;
+		const void* rootSignature = nullptr;
+		const void* pipelineState = nullptr;
+		uint64_t rootConstants[ROOT_SLOTS] = {};
+		uint32_t topology = 0;
+		VertexBufferView vertexBuffers[VERTEX_SLOTS];
+		IndexBufferView indexBuffer;
+	} bound;
+
+	// True when the command should be dropped
+	bool skip(bool redundant)
+	{
+		if (redundant && skipRedundant)
+		{
+			stats.eliminated++;
+			return true;
+		}
+		stats.stateChanges++;
+		if (redundant) stats.redundantChanges++;
+		return false;
+	}
+};
+
+// Null backend: each command becomes an opcode byte and its arguments in one growing buffer. The
+// buffer keeps its capacity across clear(), so steady-state recording does not allocate, and
+// replay() feeds the stream to another recorder in order.
+class RecordingBackend : public CommandRecorder
+{
+public:
+	enum Opcode : uint8_t
+	{
+		OP_VIEWPORT,
+		OP_SCISSOR,
+		OP_ROOT_SIGNATURE,
+		OP_PIPELINE_STATE,
+		OP_ROOT_CONSTANT_BUFFER,
+		OP_TOPOLOGY,
+		OP_VERTEX_BUFFER,
+		OP_INDEX_BUFFER,
+		OP_DRAW_INDEXED,
+		OP_DRAW
+	};
+
+	std::vector<uint8_t> buffer;
+	unsigned int commands = 0;
+
+	// Drops the recorded commands and the bound state, keeping stats
+	void clear()
+	{
+		buffer.clear();
+		commands = 0;
+		resetState();
+	}
+
+	size_t bytes() const
+	{
+		return buffer.size();
+	}
+
+	void replay(CommandRecorder& target) const
+	{
+		size_t at = 0;
+		while (at < buffer.size())
+		{
+			uint8_t op = buffer[at++];
+			switch (op)
+			{
+			case OP_VIEWPORT:
+				target.setViewport(read<RenderViewport>(at));
+				break;
+			case OP_SCISSOR:
+				target.setScissor(read<RenderScissor>(at));
+				break;
+			case OP_ROOT_SIGNATURE:
+				target.setRootSignature((const void*)(uintptr_t)read<uint64_t>(at));
+				break;
+			case OP_PIPELINE_STATE:
+				target.setPipelineState((const void*)(uintptr_t)read<uint64_t>(at));
+				break;
+			case OP_ROOT_CONSTANT_BUFFER:
+			{
+				RootConstantBuffer c = read<RootConstantBuffer>(at);
+				target.setRootConstantBuffer(c.slot, c.address);
+				break;
+			}
+			case OP_TOPOLOGY:
+				target.setTopology((PrimitiveTopology)read<uint32_t>(at));
+				break;
+			case OP_VERTEX_BUFFER:
+			{
+				VertexBuffer v = read<VertexBuffer>(at);
+				target.setVertexBuffer(v.slot, v.view);
+				break;
+			}
+			case OP_INDEX_BUFFER:
+				target.setIndexBuffer(read<IndexBufferView>(at));
+				break;
+			case OP_DRAW_INDEXED:
+			{
+				DrawIndexed d = read<DrawIndexed>(at);
+				target.drawIndexed(d.indexCount, d.instanceCount, d.startIndex, d.baseVertex, d.startInstance);
+				break;
+			}
+			case OP_DRAW:
+			{
+				Draw d = read<Draw>(at);
+				target.draw(d.vertexCount, d.instanceCount, d.startVertex, d.startInstance);
+				break;
+			}
+			default:
+				return;   // corrupt stream
+			}
+		}
+	}
+
+protected:
+	void recordViewport(const RenderViewport& viewport) override
+	{
+		write(OP_VIEWPORT, viewport);
+	}
+
+	void recordScissor(const RenderScissor& scissor) override
+	{
+		write(OP_SCISSOR, scissor);
+	}
+
+	void recordRootSignature(const void* rootSignature) override
+	{
+		write(OP_ROOT_SIGNATURE, (uint64_t)(uintptr_t)rootSignature);
+	}
+
+	void recordPipelineState(const void* pipelineState) override
+	{
+		write(OP_PIPELINE_STATE, (uint64_t)(uintptr_t)pipelineState);
+	}
+
+	void recordRootConstantBuffer(unsigned int slot, uint64_t address) override
+	{
+		write(OP_ROOT_CONSTANT_BUFFER, RootConstantBuffer{ address, slot, 0 });
+	}
+
+	void recordTopology(PrimitiveTopology topology) override
+	{
+		write(OP_TOPOLOGY, (uint32_t)topology);
+	}
+
+	void recordVertexBuffer(unsigned int slot, const VertexBufferView& view) override
+	{
+		write(OP_VERTEX_BUFFER, VertexBuffer{ view, slot, 0 });
+	}
+
+	void recordIndexBuffer(const IndexBufferView& view) override
+	{
+		write(OP_INDEX_BUFFER, view);
+	}
+
+	void recordDrawIndexed(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override
+	{
+		write(OP_DRAW_INDEXED, DrawIndexed{ indexCount, instanceCount, startIndex, baseVertex, startInstance });
+	}
+
+	void recordDraw(unsigned int vertexCount, unsigned int instanceCount, unsigned int startVertex, unsigned int startInstance) override
+	{
+		write(OP_DRAW, Draw{ vertexCount, instanceCount, startVertex, startInstance });
+	}
+
+private:
+	// Explicit padding, so equal commands serialise to equal bytes
+	struct RootConstantBuffer
+	{
+		uint64_t address;
+		uint32_t slot;
+		uint32_t unused;
+	};
+
+	struct VertexBuffer
+	{
+		VertexBufferView view;
+		uint32_t slot;
+		uint32_t unused;
+	};
+
+	struct DrawIndexed
+	{
+		uint32_t indexCount, instanceCount, startIndex;
+		int32_t baseVertex;
+		uint32_t startInstance;
+	};
+
+	struct Draw
+	{
+		uint32_t vertexCount, instanceCount, startVertex, startInstance;
+	};
+
+	// Arguments are packed unaligned after the opcode, so they go through memcpy both ways
+	template<typename T>
+	void write(uint8_t op, const T& args)
+	{
+		size_t at = buffer.size();
+		buffer.resize(at + 1 + sizeof(T));
+		buffer[at] = op;
+		memcpy(&buffer[at + 1], &args, sizeof(T));
+		commands++;
+	}
+
+	template<typename T>
+	T read(size_t& at) const
+	{
+		T args;
+		memcpy(&args, &buffer[at], sizeof(T));
+		at += sizeof(T);
+		return args;
+	}
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "core.h"
+#include <mutex>
 
 struct ConstantBufferVariable
 {
@@ -9,76 +10,112 @@ struct ConstantBufferVariable
 
 class ConstantBufferClass
 {
-	ID3D12Resource* constantBuffer;
-
-	//CPU - mapped pointer
-	unsigned char* buffer;
-	
 	// size of a single CB entry (aligned to 256)
-	unsigned int cbSizeInBytes;
-
-	// capacity (# of instances / draw calls)
-	unsigned int maxDrawCalls;
+	unsigned int cbSizeInBytes = 0;
 
-	// current index in ring buffer
-	unsigned int offsetIndex;
+	// Values written by name, copied into each entry commit() takes
+	std::vector<unsigned char> staged;
 
-	// number of instances actually requested (alias for clarity)
-	unsigned int numInstances = 0;
+	// The entry current() hands out until the staged values change or the frame closes
+	std::mutex currentMutex;
+	ConstantAllocation currentEntry = {};
+	uint64_t currentFrame = UINT64_MAX;
+	bool dirty = true;
 
 public:
 
 	std::string name;
-	std::map<std::string, ConstantBufferVariable> constantBufferData;
 
-	// initialises the constant buffer
-	void init(Core* core, unsigned int sizeInBytes, unsigned int _maxDrawCalls = 1024)
+	// Reflected layout, variables in declaration order. Per-draw code resolves a name to its index
+	// once (variable()), or writes a C++ struct that matches the layout in one copy.
+	std::vector<std::string> variableNames;
+	std::vector<ConstantBufferVariable> variables;
+	unsigned int layoutSize = 0;   // reflected cbuffer size, padding included
+
+	void addVariable(const std::string& variableName, unsigned int offset, unsigned int size)
+	{
+		variableNames.push_back(variableName);
+		variables.push_back({ offset, size });
+	}
+
+	// Handle of a variable, or -1 if the shader has none by that name
+	int variable(const std::string& variableName) const
+	{
+		for (unsigned int i = 0; i < variableNames.size(); i++)
+		{
+			if (variableNames[i] == variableName) return (int)i;
+		}
+		return -1;
+	}
+
+	// Whether 'variableName' sits at 'offset' with 'size' bytes, i.e. a struct member lines up with it
+	bool matches(const std::string& variableName, unsigned int offset, unsigned int size) const
+	{
+		int v = variable(variableName);
+		return v >= 0 && variables[v].offset == offset && variables[v].size == size;
+	}
+
+	// Entries come from Core::constants, shared by every shader, so only the layout is kept here
+	void init(unsigned int sizeInBytes)
 	{
 		cbSizeInBytes = (sizeInBytes + 255) & ~255;
-		maxDrawCalls = _maxDrawCalls;
-		unsigned int cbSizeInBytesAligned = cbSizeInBytes * maxDrawCalls;
-		numInstances = _maxDrawCalls;
-		offsetIndex = 0;
-		HRESULT hr;
-		D3D12_HEAP_PROPERTIES heapprops = {};
-		heapprops.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapprops.CreationNodeMask = 1;
-		heapprops.VisibleNodeMask = 1;
-		D3D12_RESOURCE_DESC cbDesc = {};
-		cbDesc.Width = cbSizeInBytesAligned;
-		cbDesc.Height = 1;
-		cbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		cbDesc.DepthOrArraySize = 1;
-		cbDesc.MipLevels = 1;
-		cbDesc.SampleDesc.Count = 1;
-		cbDesc.SampleDesc.Quality = 0;
-		cbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		core->device->CreateCommittedResource(&heapprops, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL,
-			IID_PPV_ARGS(&constantBuffer));
-		constantBuffer->Map(0, NULL, (void**)&buffer);
+		staged.assign(cbSizeInBytes, 0);
 	}
 
-	// Update via a memcpy
-	void update(std::string name, void* data)
+	// Stages a value via a memcpy; unknown names are ignored
+	void update(const std::string& variableName, const void* data)
 	{
-		ConstantBufferVariable cbVariable = constantBufferData[name];
-		unsigned int offset = offsetIndex * cbSizeInBytes;
-		memcpy(&buffer[offset + cbVariable.offset], data, cbVariable.size);
+		int v = variable(variableName);
+		if (v < 0) return;
+		memcpy(&staged[variables[v].offset], data, variables[v].size);
+		dirty = true;
 	}
 
+	// A fresh entry for one draw, for the caller to fill; safe on any thread
+	ConstantAllocation reserve(Core* core)
+	{
+		return core->constants.allocate(cbSizeInBytes);
+	}
 
-	// GPU address of contents
-	D3D12_GPU_VIRTUAL_ADDRESS getGPUAddress() const
+	// A fresh entry holding the staged values
+	ConstantAllocation commit(Core* core)
 	{
-		return (constantBuffer->GetGPUVirtualAddress() + (offsetIndex * cbSizeInBytes));
+		ConstantAllocation entry = reserve(core);
+		memcpy(entry.data, staged.data(), cbSizeInBytes);
+		return entry;
 	}
 
-	void next()
+	// An entry holding the staged values, shared by every draw until update() changes them or the
+	// frame closes, so repeated binds hit the same address. Read-only; safe on any thread.
+	ConstantAllocation current(Core* core)
 	{
-		offsetIndex++;
-		if (offsetIndex >= maxDrawCalls)
+		std::lock_guard<std::mutex> lock(currentMutex);
+		if (dirty || currentFrame != core->constants.frame())
 		{
-			offsetIndex = 0;
+			currentEntry = commit(core);
+			currentFrame = core->constants.frame();
+			dirty = false;
 		}
+		return currentEntry;
+	}
+
+	// Writes one variable of a reserved entry by handle
+	void update(const ConstantAllocation& entry, int handle, const void* data)
+	{
+		if (handle < 0) return;
+		memcpy(entry.data + variables[handle].offset, data, variables[handle].size);
+	}
+
+	// Writes a reserved entry whole from a struct laid out as the cbuffer (check with matches())
+	template<typename T>
+	void write(const ConstantAllocation& entry, const T& data)
+	{
+		memcpy(entry.data, &data, sizeof(T) < cbSizeInBytes ? sizeof(T) : cbSizeInBytes);
+	}
+
+	void release()
+	{
+		staged.clear();
+		dirty = true;
 	}
 };
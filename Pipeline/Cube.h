@@ -28,8 +28,8 @@ public:
 		return v;
 	}
 
-	// Implement plane, 2 triangles
-	void init(Core* core)
+	// Cube geometry only, for callers with their own shader (instanced particles)
+	void initMesh(Core* core)
 	{
 		std::vector<STATIC_VERTEX> vertices;
 		Vec3 p0 = Vec3(-1.0f, -1.0f, -1.0f);
@@ -78,6 +78,12 @@ public:
 		indices.push_back(20); indices.push_back(21); indices.push_back(22);
 		indices.push_back(20); indices.push_back(22); indices.push_back(23);
 		mesh.init(core, vertices, indices);
+	}
+
+	// Mesh, shader and PSO for per-object draws
+	void init(Core* core)
+	{
+		initMesh(core);
 
 		// Load the shaders
 		shader.LoadShaders("VertexShader.hlsl", "PixelShader.hlsl");
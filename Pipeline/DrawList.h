@@ -0,0 +1,151 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 64-bit draw sort key, most significant field first, so sorting by key groups draws by pass, then
+// pipeline state, material and mesh, and orders each group front to back:
+//   pass 4 | pso 12 | material 16 | mesh 16 | depth 16
+// so at most 16 passes, 4096 PSOs and 65536 materials and meshes. Fields are only sorted on, never
+// decoded to draw, so an index past its limit still draws correctly but aliases another's group
+// and breaks up batching; make() asserts on that in debug builds.
+struct DrawKey
+{
+	enum Pass : uint64_t
+	{
+		PASS_OPAQUE = 0,
+		PASS_PARTICLES = 1
+	};
+
+	static const uint32_t MAX_PASSES = 1u << 4;
+	static const uint32_t MAX_PSOS = 1u << 12;
+	static const uint32_t MAX_MATERIALS = 1u << 16;
+	static const uint32_t MAX_MESHES = 1u << 16;
+
+	static uint64_t make(uint64_t pass, uint32_t pso, uint32_t material, uint32_t mesh, uint32_t depth)
+	{
+		assert(pass < MAX_PASSES && pso < MAX_PSOS && material < MAX_MATERIALS && mesh < MAX_MESHES && depth <= 0xFFFF);
+		return (pass & 0xF) << 60 |
+			(uint64_t)(pso & 0xFFF) << 48 |
+			(uint64_t)(material & 0xFFFF) << 32 |
+			(uint64_t)(mesh & 0xFFFF) << 16 |
+			(depth & 0xFFFF);
+	}
+
+	// View distance in [0, range) quantised to the 16-bit depth field; farther clamps to the last step
+	static uint32_t depth(float distance, float range)
+	{
+		float t = distance / range;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		return (uint32_t)(t * 65535.0f);
+	}
+
+	static uint32_t pass(uint64_t key)
+	{
+		return (uint32_t)(key >> 60);
+	}
+
+	static uint32_t pso(uint64_t key)
+	{
+		return (uint32_t)(key >> 48) & 0xFFF;
+	}
+
+	static uint32_t material(uint64_t key)
+	{
+		return (uint32_t)(key >> 32) & 0xFFFF;
+	}
+
+	static uint32_t mesh(uint64_t key)
+	{
+		return (uint32_t)(key >> 16) & 0xFFFF;
+	}
+};
+
+// A frame's draws as (key, payload) pairs. sort() is an LSD radix sort over the key's bytes: one
+// pass builds all eight histograms, and bytes every key shares are skipped, so typical frames
+// (few passes and PSOs) scatter five or six times rather than eight. Stable, so equal keys keep
+// submission order. Storage is reused across frames.
+class DrawList
+{
+public:
+	struct Item
+	{
+		uint64_t key;
+		uint32_t payload;   // caller's index into its own draw data
+	};
+
+	std::vector<Item> items;
+
+	void clear()
+	{
+		items.clear();
+	}
+
+	void add(uint64_t key, uint32_t payload)
+	{
+		items.push_back({ key, payload });
+	}
+
+	size_t size() const
+	{
+		return items.size();
+	}
+
+	// Returns how many byte passes were scattered
+	unsigned int sort()
+	{
+		size_t n = items.size();
+		if (n < 2)
+		{
+			return 0;
+		}
+		scratch.resize(n);
+
+		uint32_t counts[8][256];
+		memset(counts, 0, sizeof(counts));
+		for (const Item& item : items)
+		{
+			uint64_t key = item.key;
+			for (int b = 0; b < 8; b++)
+			{
+				counts[b][(key >> (b * 8)) & 0xFF]++;
+			}
+		}
+
+		Item* from = items.data();
+		Item* to = scratch.data();
+		unsigned int passes = 0;
+		for (int b = 0; b < 8; b++)
+		{
+			uint32_t* count = counts[b];
+			if (count[(from[0].key >> (b * 8)) & 0xFF] == n)
+			{
+				continue;   // every key has this byte
+			}
+			uint32_t offset[256];
+			uint32_t sum = 0;
+			for (int d = 0; d < 256; d++)
+			{
+				offset[d] = sum;
+				sum += count[d];
+			}
+			for (size_t i = 0; i < n; i++)
+			{
+				to[offset[(from[i].key >> (b * 8)) & 0xFF]++] = from[i];
+			}
+			Item* t = from;
+			from = to;
+			to = t;
+			passes++;
+		}
+		if (from != items.data())
+		{
+			items.swap(scratch);
+		}
+		return passes;
+	}
+
+private:
+	std::vector<Item> scratch;
+};
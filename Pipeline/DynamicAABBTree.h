@@ -0,0 +1,478 @@
+#pragma once
+#include "EntityRegistry.h"
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+// Incremental AABB tree for objects that move every frame. Leaves store "fat" boxes grown by a
+// margin (and stretched along the last displacement), so small moves don't touch the tree at
+// all; a leaf is only removed and re-inserted once its real box leaves the fat one. Insertion
+// picks the sibling by surface area cost and rotations keep the tree height balanced.
+class DynamicAABBTree
+{
+public:
+	static constexpr int NULL_NODE = -1;
+
+	struct Node
+	{
+		WorldBounds fat;
+		int parent = NULL_NODE;   // next free node while on the free list
+		int left = NULL_NODE;
+		int right = NULL_NODE;
+		int height = 0;           // 0 for leaves, -1 while free
+		unsigned int value = 0;   // user payload for leaves
+		bool moved = false;
+
+		bool isLeaf() const { return left == NULL_NODE; }
+	};
+
+	// Growth applied to every leaf box
+	float margin = 0.25f;
+	// Fraction of the last displacement the fat box is stretched by, to predict motion
+	float displacementScale = 2.0f;
+
+	// Running totals, for tuning the margin
+	struct Stats
+	{
+		unsigned int reinserts = 0;
+		unsigned int rotations = 0;
+	} stats;
+
+	DynamicAABBTree()
+	{
+		allocateMore(16);
+	}
+
+	// Returns a proxy id, stable until destroyProxy
+	int createProxy(const WorldBounds& box, unsigned int value)
+	{
+		int proxy = allocateNode();
+		nodes[proxy].fat = fatten(box, Vec3(0, 0, 0));
+		nodes[proxy].value = value;
+		nodes[proxy].height = 0;
+		nodes[proxy].moved = true;
+		insertLeaf(proxy);
+		moveBuffer.push_back(proxy);
+		proxyCount++;
+		return proxy;
+	}
+
+	void destroyProxy(int proxy)
+	{
+		removeLeaf(proxy);
+		freeNode(proxy);
+		proxyCount--;
+	}
+
+	// Returns true if the proxy was re-inserted (its box left the fat box)
+	bool moveProxy(int proxy, const WorldBounds& box, const Vec3& displacement)
+	{
+		const WorldBounds& fat = nodes[proxy].fat;
+		if (fat.min.x <= box.min.x && fat.min.y <= box.min.y && fat.min.z <= box.min.z &&
+			fat.max.x >= box.max.x && fat.max.y >= box.max.y && fat.max.z >= box.max.z)
+		{
+			return false;
+		}
+		removeLeaf(proxy);
+		nodes[proxy].fat = fatten(box, displacement);
+		insertLeaf(proxy);
+		if (!nodes[proxy].moved)
+		{
+			nodes[proxy].moved = true;
+			moveBuffer.push_back(proxy);
+		}
+		stats.reinserts++;
+		return true;
+	}
+
+	unsigned int getValue(int proxy) const
+	{
+		return nodes[proxy].value;
+	}
+
+	const WorldBounds& getFatBounds(int proxy) const
+	{
+		return nodes[proxy].fat;
+	}
+
+	unsigned int size() const
+	{
+		return proxyCount;
+	}
+
+	int height() const
+	{
+		return root == NULL_NODE ? 0 : nodes[root].height;
+	}
+
+	// Leaves whose fat box overlaps 'box'; visitor receives (proxy, value)
+	template<typename Visitor>
+	void queryAABB(const WorldBounds& box, Visitor visit)
+	{
+		if (root == NULL_NODE)
+		{
+			return;
+		}
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			int index = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[index];
+			if (!node.fat.overlaps(box))
+			{
+				continue;
+			}
+			if (node.isLeaf())
+			{
+				visit(index, node.value);
+			}
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.right);
+			}
+		}
+	}
+
+	template<typename Visitor>
+	void queryPoint(const Vec3& p, Visitor visit)
+	{
+		WorldBounds box = { p, p };
+		queryAABB(box, visit);
+	}
+
+	// Batched pair finding: only proxies re-inserted since the last call are queried, and each
+	// overlapping pair of fat boxes is reported once as (valueA, valueB). A pair whose fat boxes
+	// still overlap from before is not reported again, even when its bodies start touching;
+	// forEachOverlap visits those as well.
+	template<typename Visitor>
+	void updatePairs(Visitor visit)
+	{
+		pairs.clear();
+		for (int proxy : moveBuffer)
+		{
+			if (nodes[proxy].height < 0)
+			{
+				continue;   // destroyed after moving
+			}
+			queryAABB(nodes[proxy].fat, [&](int other, unsigned int) {
+				// A pair of two moved proxies is found from both sides; keep one
+				if (other == proxy || (nodes[other].moved && other < proxy))
+				{
+					return;
+				}
+				pairs.push_back(std::make_pair((std::min)(proxy, other), (std::max)(proxy, other)));
+			});
+		}
+		for (int proxy : moveBuffer)
+		{
+			if (nodes[proxy].height >= 0)
+			{
+				nodes[proxy].moved = false;
+			}
+		}
+		moveBuffer.clear();
+
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+		for (const std::pair<int, int>& p : pairs)
+		{
+			visit(nodes[p.first].value, nodes[p.second].value);
+		}
+
+		// Fat boxes only change on re-insertion, so the pairs overlapping now are the ones kept from
+		// before that still overlap plus the new ones
+		size_t kept = 0;
+		for (const std::pair<int, int>& p : overlaps)
+		{
+			const Node& a = nodes[p.first];
+			const Node& b = nodes[p.second];
+			if (a.height == 0 && b.height == 0 && a.fat.overlaps(b.fat))
+			{
+				overlaps[kept++] = p;
+			}
+		}
+		overlaps.resize(kept);
+		merged.clear();
+		std::set_union(overlaps.begin(), overlaps.end(), pairs.begin(), pairs.end(), std::back_inserter(merged));
+		overlaps.swap(merged);
+	}
+
+	// Every pair whose fat boxes overlapped at the last updatePairs, as (valueA, valueB), each once.
+	// Narrow-phase tests over these see every contact, whether or not either proxy moved.
+	template<typename Visitor>
+	void forEachOverlap(Visitor visit) const
+	{
+		for (const std::pair<int, int>& p : overlaps)
+		{
+			visit(nodes[p.first].value, nodes[p.second].value);
+		}
+	}
+
+	unsigned int overlapCount() const
+	{
+		return (unsigned int)overlaps.size();
+	}
+
+	// Drop everything, keeping the node storage
+	void clear()
+	{
+		nodes.clear();
+		freeList = NULL_NODE;
+		root = NULL_NODE;
+		proxyCount = 0;
+		moveBuffer.clear();
+		overlaps.clear();
+		allocateMore(16);
+	}
+
+private:
+	std::vector<Node> nodes;
+	int root = NULL_NODE;
+	int freeList = NULL_NODE;
+	unsigned int proxyCount = 0;
+	std::vector<int> moveBuffer;
+	std::vector<int> stack;
+	std::vector<std::pair<int, int>> pairs;
+	std::vector<std::pair<int, int>> overlaps;   // by proxy, sorted
+	std::vector<std::pair<int, int>> merged;
+
+	WorldBounds fatten(const WorldBounds& box, const Vec3& displacement) const
+	{
+		WorldBounds fat;
+		fat.min = box.min - Vec3(margin, margin, margin);
+		fat.max = box.max + Vec3(margin, margin, margin);
+		Vec3 d = displacement * displacementScale;
+		for (int a = 0; a < 3; a++)
+		{
+			if (d.v[a] < 0.0f) fat.min.v[a] += d.v[a];
+			else fat.max.v[a] += d.v[a];
+		}
+		return fat;
+	}
+
+	static WorldBounds combine(const WorldBounds& a, const WorldBounds& b)
+	{
+		WorldBounds c;
+		c.min = Vec3::Min(a.min, b.min);
+		c.max = Vec3::Max(a.max, b.max);
+		return c;
+	}
+
+	static float area(const WorldBounds& b)
+	{
+		Vec3 e = b.extent();
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	void allocateMore(int count)
+	{
+		int start = (int)nodes.size();
+		nodes.resize(start + count);
+		for (int i = start; i < start + count; i++)
+		{
+			nodes[i].parent = (i + 1 < start + count) ? i + 1 : freeList;
+			nodes[i].height = -1;
+		}
+		freeList = start;
+	}
+
+	int allocateNode()
+	{
+		if (freeList == NULL_NODE)
+		{
+			allocateMore((int)nodes.size());
+		}
+		int index = freeList;
+		freeList = nodes[index].parent;
+		nodes[index] = Node();
+		return index;
+	}
+
+	void freeNode(int index)
+	{
+		nodes[index].parent = freeList;
+		nodes[index].height = -1;
+		nodes[index].moved = false;
+		freeList = index;
+	}
+
+	void insertLeaf(int leaf)
+	{
+		if (root == NULL_NODE)
+		{
+			root = leaf;
+			nodes[root].parent = NULL_NODE;
+			return;
+		}
+
+		// Descend towards the sibling with the lowest surface area increase
+		WorldBounds leafBox = nodes[leaf].fat;
+		int index = root;
+		while (!nodes[index].isLeaf())
+		{
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+			float a = area(nodes[index].fat);
+			float combinedArea = area(combine(nodes[index].fat, leafBox));
+			float cost = 2.0f * combinedArea;               // new parent here
+			float inheritance = 2.0f * (combinedArea - a);  // growth pushed onto descendants
+
+			float costLeft = area(combine(leafBox, nodes[left].fat)) + inheritance;
+			if (!nodes[left].isLeaf())
+			{
+				costLeft -= area(nodes[left].fat);
+			}
+			float costRight = area(combine(leafBox, nodes[right].fat)) + inheritance;
+			if (!nodes[right].isLeaf())
+			{
+				costRight -= area(nodes[right].fat);
+			}
+			if (cost < costLeft && cost < costRight)
+			{
+				break;
+			}
+			index = costLeft < costRight ? left : right;
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].fat = combine(leafBox, nodes[sibling].fat);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].left = sibling;
+		nodes[newParent].right = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+		if (oldParent == NULL_NODE)
+		{
+			root = newParent;
+		}
+		else if (nodes[oldParent].left == sibling)
+		{
+			nodes[oldParent].left = newParent;
+		}
+		else
+		{
+			nodes[oldParent].right = newParent;
+		}
+
+		refit(nodes[leaf].parent);
+	}
+
+	void removeLeaf(int leaf)
+	{
+		if (leaf == root)
+		{
+			root = NULL_NODE;
+			return;
+		}
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+		if (grandParent == NULL_NODE)
+		{
+			root = sibling;
+			nodes[sibling].parent = NULL_NODE;
+			freeNode(parent);
+			return;
+		}
+		if (nodes[grandParent].left == parent)
+		{
+			nodes[grandParent].left = sibling;
+		}
+		else
+		{
+			nodes[grandParent].right = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	}
+
+	// Walk to the root, rebalancing and recomputing boxes and heights
+	void refit(int index)
+	{
+		while (index != NULL_NODE)
+		{
+			index = balance(index);
+			int left = nodes[index].left;
+			int right = nodes[index].right;
+			nodes[index].height = 1 + (std::max)(nodes[left].height, nodes[right].height);
+			nodes[index].fat = combine(nodes[left].fat, nodes[right].fat);
+			index = nodes[index].parent;
+		}
+	}
+
+	// Rotates the taller grandchild up if 'a' is out of balance; returns the subtree root
+	int balance(int a)
+	{
+		Node& A = nodes[a];
+		if (A.isLeaf() || A.height < 2)
+		{
+			return a;
+		}
+		int b = A.left;
+		int c = A.right;
+		int diff = nodes[c].height - nodes[b].height;
+		if (diff > 1)
+		{
+			return rotate(a, c, b, true);
+		}
+		if (diff < -1)
+		{
+			return rotate(a, b, c, false);
+		}
+		return a;
+	}
+
+	// Promote 'up' (a child of 'a') above 'a'; 'other' is a's remaining child
+	int rotate(int a, int up, int other, bool upIsRight)
+	{
+		stats.rotations++;
+		int f = nodes[up].left;
+		int g = nodes[up].right;
+
+		// 'up' takes a's place under a's parent
+		nodes[up].left = a;
+		nodes[up].parent = nodes[a].parent;
+		nodes[a].parent = up;
+		int parent = nodes[up].parent;
+		if (parent == NULL_NODE)
+		{
+			root = up;
+		}
+		else if (nodes[parent].left == a)
+		{
+			nodes[parent].left = up;
+		}
+		else
+		{
+			nodes[parent].right = up;
+		}
+
+		// The taller of up's children stays with 'up', the shorter moves under 'a'
+		int keep = nodes[f].height > nodes[g].height ? f : g;
+		int give = keep == f ? g : f;
+		nodes[up].right = keep;
+		if (upIsRight)
+		{
+			nodes[a].right = give;
+		}
+		else
+		{
+			nodes[a].left = give;
+		}
+		nodes[give].parent = a;
+
+		nodes[a].fat = combine(nodes[other].fat, nodes[give].fat);
+		nodes[a].height = 1 + (std::max)(nodes[other].height, nodes[give].height);
+		nodes[up].fat = combine(nodes[a].fat, nodes[keep].fat);
+		nodes[up].height = 1 + (std::max)(nodes[a].height, nodes[keep].height);
+		return up;
+	}
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "core.h"
+#include <algorithm>
+
+// Vertex data the CPU rewrites every frame (instance streams). One persistently mapped upload
+// buffer per back buffer: beginFrame has waited for the frame that last used it, so it can be
+// rewritten, or replaced when too small, without a flush.
+class DynamicVertexBuffer
+{
+public:
+	// After beginFrame: room for 'count' elements of 'stride' bytes in this frame's buffer. Write
+	// it sequentially and never read it back; upload memory is write-combined.
+	unsigned char* map(Core* core, unsigned int count, unsigned int _stride)
+	{
+		frame = core->frameIndex();
+		stride = _stride;
+		buffers[frame].reserve(core, (size_t)count * stride);
+		return buffers[frame].mapped;
+	}
+
+	// The first 'count' elements written this frame
+	VertexBufferView view(unsigned int count) const
+	{
+		VertexBufferView v;
+		v.address = buffers[frame].resource->GetGPUVirtualAddress();
+		v.sizeInBytes = count * stride;
+		v.strideInBytes = stride;
+		return v;
+	}
+
+	// Shutdown, after flushGraphicsQueue()
+	void release()
+	{
+		buffers[0].release();
+		buffers[1].release();
+	}
+
+private:
+	struct Buffer
+	{
+		ID3D12Resource* resource = nullptr;
+		unsigned char* mapped = nullptr;
+		size_t capacity = 0;
+
+		void reserve(Core* core, size_t bytes)
+		{
+			if (bytes <= capacity)
+			{
+				return;
+			}
+			release();
+			capacity = (std::max)(bytes, (size_t)65536);
+			while (capacity < bytes) capacity *= 2;
+
+			D3D12_HEAP_PROPERTIES heapprops = {};
+			heapprops.Type = D3D12_HEAP_TYPE_UPLOAD;
+			heapprops.CreationNodeMask = 1;
+			heapprops.VisibleNodeMask = 1;
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Width = capacity;
+			desc.Height = 1;
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = 1;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			core->device->CreateCommittedResource(&heapprops, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL,
+				IID_PPV_ARGS(&resource));
+			resource->Map(0, NULL, (void**)&mapped);
+		}
+
+		void release()
+		{
+			if (resource)
+			{
+				resource->Unmap(0, NULL);
+				resource->Release();
+			}
+			resource = nullptr;
+			mapped = nullptr;
+			capacity = 0;
+		}
+	};
+
+	Buffer buffers[2];
+	unsigned int frame = 0;
+	unsigned int stride = 0;
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include "maths.h"
+#include <vector>
+#include <string>
+
+// Generational entity handle: low bits index a slot, high bits count how often the slot was
+// reused, so a handle to a destroyed entity never aliases whatever replaced it.
+struct Entity
+{
+	static constexpr unsigned int INDEX_BITS = 22;
+	static constexpr unsigned int INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr unsigned int GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+	unsigned int id = 0xFFFFFFFF;
+
+	Entity() {}
+	Entity(unsigned int slot, unsigned int generation) : id((generation << INDEX_BITS) | slot) {}
+
+	unsigned int slot() const { return id & INDEX_MASK; }
+	unsigned int generation() const { return id >> INDEX_BITS; }
+	bool isNull() const { return id == 0xFFFFFFFF; }
+	bool operator==(const Entity& other) const { return id == other.id; }
+	bool operator!=(const Entity& other) const { return id != other.id; }
+};
+
+// Gameplay tags as a bitmask so systems test a byte instead of comparing strings
+enum EntityTag : unsigned char
+{
+	TAG_NONE = 0,
+	TAG_STATIC = 1 << 0,
+	TAG_COLLECTIBLE = 1 << 1,
+	TAG_SOLID = 1 << 2,  // blocks the player
+	TAG_MOVED = 1 << 3   // world changed in the last simulation tick; render interpolates it
+};
+
+inline unsigned char tagsFromType(const std::string& type)
+{
+	if (type == "collectible")
+	{
+		return TAG_COLLECTIBLE;
+	}
+	return TAG_STATIC | TAG_SOLID;
+}
+
+// World-space axis-aligned box
+struct WorldBounds
+{
+	Vec3 min;
+	Vec3 max;
+
+	bool contains(const Vec3& p) const
+	{
+		return p.x >= min.x && p.x <= max.x &&
+			p.y >= min.y && p.y <= max.y &&
+			p.z >= min.z && p.z <= max.z;
+	}
+
+	bool overlaps(const WorldBounds& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	Vec3 centre() const { return (min + max) * 0.5f; }
+	Vec3 extent() const { return max - min; }
+
+	// Conservative world box around a local box (grown by 'padding' in local space) under 'world'
+	static WorldBounds fromLocal(const Vec3& localMin, const Vec3& localMax, const Matrix& world, float padding = 0.0f)
+	{
+		Vec3 lo = localMin - Vec3(padding, padding, padding);
+		Vec3 hi = localMax + Vec3(padding, padding, padding);
+		WorldBounds b;
+		b.min = Vec3(1e30f, 1e30f, 1e30f);
+		b.max = Vec3(-1e30f, -1e30f, -1e30f);
+		for (int i = 0; i < 8; i++)
+		{
+			Vec3 corner((i & 1) ? hi.x : lo.x, (i & 2) ? hi.y : lo.y, (i & 4) ? hi.z : lo.z);
+			Vec3 p = world.mulPoint(corner);
+			b.min = Vec3::Min(b.min, p);
+			b.max = Vec3::Max(b.max, p);
+		}
+		return b;
+	}
+};
+
+// Which shared prototype (model) an entity draws with
+struct RenderHandle
+{
+	unsigned int prototype;
+};
+
+// Dense, structure-of-arrays entity storage. Component arrays are indexed by a dense index in
+// [0, size()); systems loop over just the arrays they need. Removal swaps the last entity into
+// the hole, and the slot table keeps handles valid across the move.
+class EntityRegistry
+{
+public:
+	// Hot components
+	std::vector<Matrix> world;
+	std::vector<Matrix> previousWorld;   // world at the start of the last simulation tick
+	std::vector<WorldBounds> bounds;
+	std::vector<RenderHandle> render;
+	std::vector<unsigned char> tags;
+
+	// Cold components (never touched by per-frame systems)
+	std::vector<std::string> names;   // level placement id
+
+	// Dense index -> owning handle
+	std::vector<Entity> entities;
+
+	unsigned int size() const
+	{
+		return (unsigned int)entities.size();
+	}
+
+	// Component and slot storage per entity (the name's characters are extra when they don't fit
+	// the string's inline buffer)
+	static constexpr size_t bytesPerEntity()
+	{
+		return 2 * sizeof(Matrix) + sizeof(WorldBounds) + sizeof(RenderHandle) + sizeof(unsigned char)
+			+ sizeof(std::string) + sizeof(Entity) + sizeof(Slot);
+	}
+
+	void reserve(unsigned int count)
+	{
+		world.reserve(count);
+		previousWorld.reserve(count);
+		bounds.reserve(count);
+		render.reserve(count);
+		tags.reserve(count);
+		names.reserve(count);
+		entities.reserve(count);
+		slots.reserve(count);
+	}
+
+	Entity create(const Matrix& w, const WorldBounds& b, RenderHandle r, unsigned char t, const std::string& name = "")
+	{
+		unsigned int slot;
+		if (freeHead != NO_SLOT)
+		{
+			slot = freeHead;
+			freeHead = slots[slot].dense;
+		}
+		else
+		{
+			slot = (unsigned int)slots.size();
+			slots.push_back({ 0, 0 });
+		}
+		Entity e(slot, slots[slot].generation);
+		slots[slot].dense = size();
+
+		world.push_back(w);
+		previousWorld.push_back(w);
+		bounds.push_back(b);
+		render.push_back(r);
+		tags.push_back(t);
+		names.push_back(name);
+		entities.push_back(e);
+		return e;
+	}
+
+	bool alive(Entity e) const
+	{
+		return !e.isNull() && e.slot() < slots.size() && slots[e.slot()].generation == e.generation() &&
+			slots[e.slot()].dense < entities.size() && entities[slots[e.slot()].dense] == e;
+	}
+
+	// Dense index of a live entity
+	unsigned int indexOf(Entity e) const
+	{
+		return slots[e.slot()].dense;
+	}
+
+	// O(1): move the last entity into the hole and recycle the slot with a bumped generation
+	void destroy(Entity e)
+	{
+		if (!alive(e))
+		{
+			return;
+		}
+		unsigned int hole = indexOf(e);
+		unsigned int last = size() - 1;
+		if (hole != last)
+		{
+			world[hole] = world[last];
+			previousWorld[hole] = previousWorld[last];
+			bounds[hole] = bounds[last];
+			render[hole] = render[last];
+			tags[hole] = tags[last];
+			names[hole] = std::move(names[last]);
+			entities[hole] = entities[last];
+			slots[entities[hole].slot()].dense = hole;
+		}
+		world.pop_back();
+		previousWorld.pop_back();
+		bounds.pop_back();
+		render.pop_back();
+		tags.pop_back();
+		names.pop_back();
+		entities.pop_back();
+
+		Slot& slot = slots[e.slot()];
+		slot.generation = (slot.generation + 1) & Entity::GENERATION_MASK;
+		slot.dense = freeHead;
+		freeHead = e.slot();
+	}
+
+	void clear()
+	{
+		while (size() > 0)
+		{
+			destroy(entities.back());
+		}
+	}
+
+	// Count entities carrying every bit in 'mask'
+	unsigned int countTagged(unsigned char mask) const
+	{
+		unsigned int count = 0;
+		for (unsigned char t : tags)
+		{
+			count += ((t & mask) == mask);
+		}
+		return count;
+	}
+
+private:
+	static constexpr unsigned int NO_SLOT = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		unsigned int dense;       // dense index while alive, next free slot while dead
+		unsigned int generation;
+	};
+	std::vector<Slot> slots;
+	unsigned int freeHead = NO_SLOT;
+};
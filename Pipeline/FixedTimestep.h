@@ -0,0 +1,78 @@
+#pragma once
+
+// Fixed-step accumulator: frame time is banked and paid out in whole simulation ticks, so
+// gameplay runs at the same rate regardless of the display. The leftover fraction of a tick is
+// the interpolation factor for rendering between the last two simulated states.
+class FixedTimestep
+{
+public:
+	// Ticks after which the remaining backlog is dropped (the game slows down instead of
+	// spiralling when a frame takes longer than maxSubsteps ticks to simulate)
+	int maxSubsteps = 5;
+
+	// Longest frame time accepted, so a debugger pause or window drag isn't simulated
+	float maxFrameTime = 0.25f;
+
+	// Running totals
+	unsigned long long ticks = 0;
+	unsigned long long droppedTicks = 0;
+
+	FixedTimestep(float ticksPerSecond = 60.0f)
+	{
+		setTickRate(ticksPerSecond);
+	}
+
+	void setTickRate(float ticksPerSecond)
+	{
+		step = 1.0f / ticksPerSecond;
+	}
+
+	float tickRate() const
+	{
+		return 1.0f / step;
+	}
+
+	// Seconds of simulation per tick
+	float dt() const
+	{
+		return step;
+	}
+
+	// Bank a frame's elapsed time; returns how many ticks to simulate now
+	int advance(float frameTime)
+	{
+		if (frameTime > maxFrameTime)
+		{
+			frameTime = maxFrameTime;
+		}
+		if (frameTime < 0.0f)
+		{
+			frameTime = 0.0f;
+		}
+		accumulator += frameTime;
+		int count = (int)(accumulator / step);
+		if (count > maxSubsteps)
+		{
+			droppedTicks += count - maxSubsteps;
+			count = maxSubsteps;
+			accumulator = 0.0f;
+		}
+		else
+		{
+			accumulator -= count * step;
+		}
+		ticks += count;
+		return count;
+	}
+
+	// Blend factor in [0, 1) between the previous and the current simulation state
+	float alpha() const
+	{
+		float a = accumulator / step;
+		return a < 1.0f ? a : 1.0f;
+	}
+
+private:
+	float step = 1.0f / 60.0f;
+	float accumulator = 0.0f;
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Per-frame bump allocation over slabs of memory the caller creates. Allocations take the next
+// bytes of the current slab (one compare-and-swap, so recording threads can share it) and move to
+// another slab when it is full, creating one if none is free. close() ends a frame: its slabs wait
+// on the fence value that covers the frame, and reclaim() frees them once the GPU has passed it.
+// Nothing here touches the memory itself, so the same allocator drives D3D12 upload buffers and
+// the headless benchmark.
+class FrameLinearAllocator
+{
+public:
+	static constexpr uint32_t MAX_SLABS = 1024;
+	static constexpr uint32_t NO_SLAB = 0xFFFFFFFF;
+
+	struct Allocation
+	{
+		uint32_t slab = NO_SLAB;
+		uint32_t offset = 0;
+
+		bool valid() const
+		{
+			return slab != NO_SLAB;
+		}
+	};
+
+	struct Stats
+	{
+		unsigned long long frameBytes = 0;       // used by the last closed frame, alignment included
+		unsigned long long peakFrameBytes = 0;   // most any frame has used since resetPeak()
+		unsigned int frameSlabs = 0;             // slabs the last closed frame took
+		unsigned int failed = 0;                 // allocations refused with MAX_SLABS in use
+	} stats;
+
+	// 'slabSize' is the usual slab; larger requests get a slab of their own
+	void init(uint64_t _slabSize)
+	{
+		slabSize = _slabSize;
+		slabCount = 0;
+		cursor.store(pack(NO_SLAB, 0));
+		frameSlabs.clear();
+		freeSlabs.clear();
+		inFlight.clear();
+		stats = Stats();
+	}
+
+	// 'alignment' is a power of two, at most that of the slab memory itself. createSlab(slab, size)
+	// is called, under a lock, when a new slab is needed, before any allocation from it is handed
+	// out. Safe on any thread.
+	template<typename CreateSlab>
+	Allocation allocate(uint64_t size, uint64_t alignment, const CreateSlab& createSlab)
+	{
+		if (size + alignment - 1 > slabSize)
+		{
+			// A slab of its own, leaving the current one to the allocations that fit it
+			std::lock_guard<std::mutex> lock(mutex);
+			Allocation a;
+			a.slab = takeSlab(size, createSlab);
+			if (a.slab == NO_SLAB)
+			{
+				stats.failed++;
+				return a;
+			}
+			slabs[a.slab].used = (uint32_t)size;
+			return a;
+		}
+
+		uint64_t current = cursor.load(std::memory_order_acquire);
+		for (;;)
+		{
+			uint32_t slab = (uint32_t)(current >> 32);
+			uint64_t offset = (uint32_t)current;
+			if (slab != NO_SLAB)
+			{
+				uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+				if (aligned + size <= slabs[slab].size)
+				{
+					if (cursor.compare_exchange_weak(current, pack(slab, aligned + size), std::memory_order_acq_rel, std::memory_order_acquire))
+					{
+						Allocation a;
+						a.slab = slab;
+						a.offset = (uint32_t)aligned;
+						return a;
+					}
+					continue;
+				}
+			}
+
+			// The slab is full (or the frame has none yet): move on to another, unless a thread
+			// that got here first already has
+			std::lock_guard<std::mutex> lock(mutex);
+			if (cursor.load(std::memory_order_acquire) == current)
+			{
+				uint32_t next = takeSlab(size + alignment - 1, createSlab);
+				if (next == NO_SLAB)
+				{
+					stats.failed++;
+					return Allocation();
+				}
+				if (cursor.compare_exchange_strong(current, pack(next, 0), std::memory_order_acq_rel))
+				{
+					if (slab != NO_SLAB) slabs[slab].used = offset;
+				}
+				else
+				{
+					// An allocation still fit the old slab in the meantime; keep the new one for later
+					frameSlabs.pop_back();
+					freeSlabs.push_back(next);
+				}
+			}
+			current = cursor.load(std::memory_order_acquire);
+		}
+	}
+
+	// Ends the frame on the main thread, with no allocations in progress: its slabs are reused once
+	// 'fenceValue' completes
+	void close(uint64_t fenceValue)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		uint64_t current = cursor.load(std::memory_order_acquire);
+		uint32_t slab = (uint32_t)(current >> 32);
+		if (slab != NO_SLAB) slabs[slab].used = (uint32_t)current;
+
+		unsigned long long bytes = 0;
+		for (uint32_t s : frameSlabs)
+		{
+			bytes += slabs[s].used;
+			inFlight.push_back({ s, fenceValue });
+		}
+		stats.frameBytes = bytes;
+		stats.frameSlabs = (unsigned int)frameSlabs.size();
+		stats.peakFrameBytes = (std::max)(stats.peakFrameBytes, bytes);
+		frameSlabs.clear();
+		cursor.store(pack(NO_SLAB, 0), std::memory_order_release);
+	}
+
+	// Frees the slabs of every frame whose fence value is at most 'completedValue'
+	void reclaim(uint64_t completedValue)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t kept = 0;
+		for (size_t i = 0; i < inFlight.size(); i++)
+		{
+			if (inFlight[i].fence <= completedValue) freeSlabs.push_back(inFlight[i].slab);
+			else inFlight[kept++] = inFlight[i];
+		}
+		inFlight.resize(kept);
+	}
+
+	void resetPeak()
+	{
+		stats.peakFrameBytes = 0;
+	}
+
+	uint32_t slabTotal() const
+	{
+		return slabCount;
+	}
+
+	uint64_t slabBytes(uint32_t slab) const
+	{
+		return slabs[slab].size;
+	}
+
+	// Memory held by every slab, in use or free
+	unsigned long long reservedBytes() const
+	{
+		unsigned long long bytes = 0;
+		for (uint32_t s = 0; s < slabCount; s++) bytes += slabs[s].size;
+		return bytes;
+	}
+
+private:
+	struct Slab
+	{
+		uint64_t size = 0;
+		uint32_t used = 0;   // bytes taken when the frame moved past it
+	};
+
+	struct Retired
+	{
+		uint32_t slab;
+		uint64_t fence;
+	};
+
+	uint64_t slabSize = 0;
+
+	// Fixed so that threads reading a slab never race with one being added
+	Slab slabs[MAX_SLABS];
+	uint32_t slabCount = 0;
+
+	// Slab in the high half, offset in the low half, so both change in one step
+	std::atomic<uint64_t> cursor{ pack(NO_SLAB, 0) };
+
+	std::mutex mutex;
+	std::vector<uint32_t> frameSlabs;   // taken by the open frame
+	std::vector<uint32_t> freeSlabs;
+	std::vector<Retired> inFlight;
+
+	static uint64_t pack(uint32_t slab, uint64_t offset)
+	{
+		return ((uint64_t)slab << 32) | offset;
+	}
+
+	// A free slab of at least 'size' bytes, else a new one; under the lock
+	template<typename CreateSlab>
+	uint32_t takeSlab(uint64_t size, const CreateSlab& createSlab)
+	{
+		for (size_t i = 0; i < freeSlabs.size(); i++)
+		{
+			uint32_t s = freeSlabs[i];
+			if (slabs[s].size >= size)
+			{
+				freeSlabs[i] = freeSlabs.back();
+				freeSlabs.pop_back();
+				slabs[s].used = 0;
+				frameSlabs.push_back(s);
+				return s;
+			}
+		}
+		if (slabCount == MAX_SLABS)
+		{
+			return NO_SLAB;
+		}
+		uint32_t s = slabCount;
+		slabs[s].size = (std::max)(slabSize, (size + 255) & ~(uint64_t)255);
+		slabs[s].used = 0;
+		createSlab(s, slabs[s].size);
+		slabCount++;
+		frameSlabs.push_back(s);
+		return s;
+	}
+};
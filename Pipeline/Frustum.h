@@ -0,0 +1,228 @@
+#pragma once
+#include "maths.h"
+#include "JobSystem.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+// Six view-frustum planes, pointing inwards (a point is inside when a*x + b*y + c*z + d >= 0)
+struct Frustum
+{
+	enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+	float planes[PLANE_COUNT][4];
+
+	// Gribb/Hartmann extraction from a view-projection that maps column vectors to D3D clip
+	// space (0 <= z <= w), as built by Camera::getViewProjection
+	void fromViewProjection(const Matrix& vp)
+	{
+		const float* r0 = &vp.m[0];
+		const float* r1 = &vp.m[4];
+		const float* r2 = &vp.m[8];
+		const float* r3 = &vp.m[12];
+		for (int k = 0; k < 4; k++)
+		{
+			planes[LEFT][k] = r3[k] + r0[k];
+			planes[RIGHT][k] = r3[k] - r0[k];
+			planes[BOTTOM][k] = r3[k] + r1[k];
+			planes[TOP][k] = r3[k] - r1[k];
+			planes[NEAR_PLANE][k] = r2[k];
+			planes[FAR_PLANE][k] = r3[k] - r2[k];
+		}
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+			float inv = length > 0.0f ? 1.0f / length : 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				planes[p][k] *= inv;
+			}
+		}
+	}
+
+	// Conservative box test: false only when the box is wholly outside one plane
+	bool intersectsAABB(const Vec3& centre, const Vec3& extent) const
+	{
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			const float* n = planes[p];
+			float d = n[0] * centre.x + n[1] * centre.y + n[2] * centre.z + n[3];
+			float r = fabsf(n[0]) * extent.x + fabsf(n[1]) * extent.y + fabsf(n[2]) * extent.z;
+			if (d + r < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// World AABBs as structure-of-arrays centres and extents, padded to a whole batch so the culler
+// never needs a scalar tail. Filled by whoever owns the objects, read by FrustumCuller.
+struct CullBounds
+{
+	static constexpr unsigned int BATCH = 8;
+
+	std::vector<float> cx, cy, cz;
+	std::vector<float> ex, ey, ez;
+	unsigned int count = 0;
+
+	void clear()
+	{
+		count = 0;
+		cx.clear(); cy.clear(); cz.clear();
+		ex.clear(); ey.clear(); ez.clear();
+	}
+
+	void reserve(unsigned int n)
+	{
+		n = (n + BATCH - 1) / BATCH * BATCH;
+		cx.reserve(n); cy.reserve(n); cz.reserve(n);
+		ex.reserve(n); ey.reserve(n); ez.reserve(n);
+	}
+
+	void add(const Vec3& min, const Vec3& max)
+	{
+		if (count % BATCH == 0)
+		{
+			// Open a new batch; unused slots stay zero and are masked out by the culler
+			size_t size = cx.size() + BATCH;
+			cx.resize(size, 0.0f); cy.resize(size, 0.0f); cz.resize(size, 0.0f);
+			ex.resize(size, 0.0f); ey.resize(size, 0.0f); ez.resize(size, 0.0f);
+		}
+		cx[count] = (min.x + max.x) * 0.5f; ex[count] = (max.x - min.x) * 0.5f;
+		cy[count] = (min.y + max.y) * 0.5f; ey[count] = (max.y - min.y) * 0.5f;
+		cz[count] = (min.z + max.z) * 0.5f; ez[count] = (max.z - min.z) * 0.5f;
+		count++;
+	}
+};
+
+// Batched frustum culling: each step tests eight boxes against all six planes (two SSE lanes of
+// four) and appends the indices of the survivors to 'visible'
+class FrustumCuller
+{
+public:
+	std::vector<unsigned int> visible;
+
+	struct Stats
+	{
+		unsigned int total = 0;
+		unsigned int visible = 0;
+		double cullMs = 0.0;
+	} stats;
+
+	// Batches (of eight boxes) per job when a job system is given
+	unsigned int batchesPerJob = 2048;
+
+	void cull(const CullBounds& bounds, const Frustum& frustum, JobSystem* jobs = nullptr)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		unsigned int batches = (bounds.count + CullBounds::BATCH - 1) / CullBounds::BATCH;
+		visible.resize(batches * CullBounds::BATCH);
+
+		if (!jobs || jobs->threadCount() <= 1 || batches < batchesPerJob * 2)
+		{
+			visible.resize(cullBatches(bounds, frustum, 0, batches, visible.data()));
+		}
+		else
+		{
+			// Each chunk compacts into its own slice of 'visible'; the slices are then packed
+			unsigned int chunks = (batches + batchesPerJob - 1) / batchesPerJob;
+			chunkCounts.resize(chunks);
+			jobs->parallelFor(chunks, 1, [&](unsigned int b, unsigned int e) {
+				for (unsigned int c = b; c < e; c++)
+				{
+					unsigned int first = c * batchesPerJob;
+					unsigned int last = (std::min)(first + batchesPerJob, batches);
+					chunkCounts[c] = cullBatches(bounds, frustum, first, last, visible.data() + first * CullBounds::BATCH);
+				}
+			});
+			unsigned int packed = chunkCounts[0];
+			for (unsigned int c = 1; c < chunks; c++)
+			{
+				const unsigned int* src = visible.data() + c * batchesPerJob * CullBounds::BATCH;
+				std::copy(src, src + chunkCounts[c], visible.data() + packed);
+				packed += chunkCounts[c];
+			}
+			visible.resize(packed);
+		}
+
+		stats.total = bounds.count;
+		stats.visible = (unsigned int)visible.size();
+		stats.cullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+private:
+	std::vector<unsigned int> chunkCounts;
+
+	// Culls batches [first, last) into 'out'; returns how many indices were written
+	static unsigned int cullBatches(const CullBounds& bounds, const Frustum& frustum, unsigned int first, unsigned int last, unsigned int* out)
+	{
+		unsigned int written = 0;
+		for (unsigned int batch = first; batch < last; batch++)
+		{
+			unsigned int base = batch * CullBounds::BATCH;
+			unsigned int outside = outsideMask(bounds, frustum, base);
+
+			// Padding past the last box never counts as visible
+			unsigned int valid = bounds.count - base;
+			if (valid < CullBounds::BATCH)
+			{
+				outside |= 0xFFu << valid;
+			}
+
+			// Branch-free compaction: always write, advance only for survivors
+			unsigned int inside = ~outside & 0xFFu;
+			for (unsigned int k = 0; k < CullBounds::BATCH; k++)
+			{
+				out[written] = base + k;
+				written += (inside >> k) & 1u;
+			}
+		}
+		return written;
+	}
+
+	// Bit k set when box base+k is outside some plane
+	static unsigned int outsideMask(const CullBounds& bounds, const Frustum& frustum, unsigned int base)
+	{
+#ifdef FRUSTUM_SSE
+		__m128 cx0 = _mm_loadu_ps(&bounds.cx[base]), cx1 = _mm_loadu_ps(&bounds.cx[base + 4]);
+		__m128 cy0 = _mm_loadu_ps(&bounds.cy[base]), cy1 = _mm_loadu_ps(&bounds.cy[base + 4]);
+		__m128 cz0 = _mm_loadu_ps(&bounds.cz[base]), cz1 = _mm_loadu_ps(&bounds.cz[base + 4]);
+		__m128 ex0 = _mm_loadu_ps(&bounds.ex[base]), ex1 = _mm_loadu_ps(&bounds.ex[base + 4]);
+		__m128 ey0 = _mm_loadu_ps(&bounds.ey[base]), ey1 = _mm_loadu_ps(&bounds.ey[base + 4]);
+		__m128 ez0 = _mm_loadu_ps(&bounds.ez[base]), ez1 = _mm_loadu_ps(&bounds.ez[base + 4]);
+		__m128 out0 = _mm_setzero_ps(), out1 = _mm_setzero_ps();
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			const float* n = frustum.planes[p];
+			__m128 nx = _mm_set1_ps(n[0]), ny = _mm_set1_ps(n[1]), nz = _mm_set1_ps(n[2]), nw = _mm_set1_ps(n[3]);
+			__m128 ax = _mm_set1_ps(fabsf(n[0])), ay = _mm_set1_ps(fabsf(n[1])), az = _mm_set1_ps(fabsf(n[2]));
+			// d + r < 0: signed centre distance plus the box's projected radius
+			__m128 s0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx0), _mm_mul_ps(ny, cy0)), _mm_add_ps(_mm_mul_ps(nz, cz0), nw));
+			__m128 s1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx1), _mm_mul_ps(ny, cy1)), _mm_add_ps(_mm_mul_ps(nz, cz1), nw));
+			s0 = _mm_add_ps(s0, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ex0), _mm_mul_ps(ay, ey0)), _mm_mul_ps(az, ez0)));
+			s1 = _mm_add_ps(s1, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ex1), _mm_mul_ps(ay, ey1)), _mm_mul_ps(az, ez1)));
+			out0 = _mm_or_ps(out0, _mm_cmplt_ps(s0, _mm_setzero_ps()));
+			out1 = _mm_or_ps(out1, _mm_cmplt_ps(s1, _mm_setzero_ps()));
+		}
+		return (unsigned int)(_mm_movemask_ps(out0) | (_mm_movemask_ps(out1) << 4));
+#else
+		unsigned int mask = 0;
+		for (unsigned int k = 0; k < CullBounds::BATCH; k++)
+		{
+			unsigned int i = base + k;
+			Vec3 centre(bounds.cx[i], bounds.cy[i], bounds.cz[i]);
+			Vec3 extent(bounds.ex[i], bounds.ey[i], bounds.ez[i]);
+			mask |= (unsigned int)!frustum.intersectsAABB(centre, extent) << k;
+		}
+		return mask;
+#endif
+	}
+};
@@ -30,6 +30,7 @@ SOFTWARE.
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <cstring>
 
 #pragma warning( disable : 26495)
 
@@ -269,7 +270,7 @@ namespace GEMLoader
 	{
 	private:
 		// Reads a GEMProperty (name-value) from the file
-		GEMProperty loadProperty(std::ifstream& file)
+		GEMProperty loadProperty(std::istream& file)
 		{
 			GEMProperty prop;
 			prop.name = loadString(file);
@@ -277,14 +278,14 @@ namespace GEMLoader
 			return prop;
 		}
 
-		// Loads a single mesh from the file (either static or animated)
-		void loadMesh(std::ifstream& file, GEMMesh& mesh, int isAnimated)
+		// Loads a single mesh from the file (either static or animated); stops where the stream ends
+		void loadMesh(std::istream& file, GEMMesh& mesh, int isAnimated)
 		{
 			unsigned int n = 0;
 
 			// Load the material properties for this mesh
 			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
-			for (unsigned int i = 0; i < n; i++)
+			for (unsigned int i = 0; i < n && file; i++)
 			{
 				mesh.material.properties.push_back(loadProperty(file));
 			}
@@ -293,7 +294,7 @@ namespace GEMLoader
 			if (isAnimated == 0)
 			{
 				file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
-				for (unsigned int i = 0; i < n; i++)
+				for (unsigned int i = 0; i < n && file; i++)
 				{
 					GEMStaticVertex v;
 					file.read(reinterpret_cast<char*>(&v), sizeof(GEMStaticVertex));
@@ -301,7 +302,7 @@ namespace GEMLoader
 				}
 
 				file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
-				for (unsigned int i = 0; i < n; i++)
+				for (unsigned int i = 0; i < n && file; i++)
 				{
 					unsigned int index = 0;
 					file.read(reinterpret_cast<char*>(&index), sizeof(unsigned int));
@@ -312,7 +313,7 @@ namespace GEMLoader
 			else
 			{
 				file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
-				for (unsigned int i = 0; i < n; i++)
+				for (unsigned int i = 0; i < n && file; i++)
 				{
 					GEMAnimatedVertex v;
 					file.read(reinterpret_cast<char*>(&v), sizeof(GEMAnimatedVertex));
@@ -320,7 +321,7 @@ namespace GEMLoader
 				}
 
 				file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
-				for (unsigned int i = 0; i < n; i++)
+				for (unsigned int i = 0; i < n && file; i++)
 				{
 					unsigned int index = 0;
 					file.read(reinterpret_cast<char*>(&index), sizeof(unsigned int));
@@ -331,7 +332,7 @@ namespace GEMLoader
 
 		// Reads a string from the file, which starts with an int length,
 		// followed by that many characters
-		std::string loadString(std::ifstream& file)
+		std::string loadString(std::istream& file)
 		{
 			int l = 0;
 			file.read(reinterpret_cast<char*>(&l), sizeof(int));
@@ -345,7 +346,7 @@ namespace GEMLoader
 		}
 
 		// Reads a GEMVec3 structure from the file
-		GEMVec3 loadVec3(std::ifstream& file)
+		GEMVec3 loadVec3(std::istream& file)
 		{
 			GEMVec3 v;
 			file.read(reinterpret_cast<char*>(&v), sizeof(GEMVec3));
@@ -353,7 +354,7 @@ namespace GEMLoader
 		}
 
 		// Reads a GEMMatrix structure (16 floats) from the file
-		GEMMatrix loadMatrix(std::ifstream& file)
+		GEMMatrix loadMatrix(std::istream& file)
 		{
 			GEMMatrix mat;
 			file.read(reinterpret_cast<char*>(&mat.m), sizeof(float) * 16);
@@ -361,7 +362,7 @@ namespace GEMLoader
 		}
 
 		// Reads a GEMQuaternion structure (4 floats) from the file
-		GEMQuaternion loadQuaternion(std::ifstream& file)
+		GEMQuaternion loadQuaternion(std::istream& file)
 		{
 			GEMQuaternion q;
 			file.read(reinterpret_cast<char*>(&q.q), sizeof(float) * 4);
@@ -369,7 +370,7 @@ namespace GEMLoader
 		}
 
 		// Loads data for a single animation frame, including position, rotation, and scale for each bone
-		void loadFrame(GEMAnimationSequence& aseq, std::ifstream& file, int bonesN)
+		void loadFrame(GEMAnimationSequence& aseq, std::istream& file, int bonesN)
 		{
 			GEMAnimationFrame frame;
 
@@ -398,7 +399,7 @@ namespace GEMLoader
 		}
 
 		// Loads multiple frames for an animation sequence
-		void loadFrames(GEMAnimationSequence& aseq, std::ifstream& file, int bonesN, int frames)
+		void loadFrames(GEMAnimationSequence& aseq, std::istream& file, int bonesN, int frames)
 		{
 			for (int i = 0; i < frames; i++)
 			{
@@ -455,6 +456,41 @@ namespace GEMLoader
 			file.close();
 		}
 
+		// Load static meshes from a model file already read into memory (e.g. from a pack file).
+		// False when the data is not a model or ends early; callers may run on a worker thread, so
+		// this reports rather than exiting.
+		bool loadFromMemory(const std::string& data, std::vector<GEMMesh>& meshes)
+		{
+			std::istringstream file(data, ::std::ios::binary);
+			unsigned int n = 0;
+			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
+
+			// Check file signature
+			if (!file || n != 4058972161)
+			{
+				std::cout << "Buffer is not a GE Model File" << std::endl;
+				return false;
+			}
+
+			unsigned int isAnimated = 0;
+			file.read(reinterpret_cast<char*>(&isAnimated), sizeof(unsigned int));
+			file.read(reinterpret_cast<char*>(&n), sizeof(unsigned int));
+
+			// Load each mesh
+			for (unsigned int i = 0; i < n && file; i++)
+			{
+				GEMMesh mesh;
+				loadMesh(file, mesh, isAnimated);
+				meshes.push_back(mesh);
+			}
+			if (!file)
+			{
+				std::cout << "GE Model File is truncated" << std::endl;
+				return false;
+			}
+			return true;
+		}
+
 		// Load a model file that may contain meshes plus animation data (bones, frames)
 		// Populates both 'meshes' and the 'animation' structure
 		void load(std::string filename, std::vector<GEMMesh>& meshes, GEMAnimation& animation)
@@ -573,6 +609,19 @@ namespace GEMLoader
 			vDict = v;
 		}
 
+		// Move constructors used by the parser so nested arrays/dictionaries are not deep copied
+		GEMJson(std::vector<GEMJson>&& v)
+		{
+			type = GEM_JSON_ARRAY;
+			vArr = std::move(v);
+		}
+
+		GEMJson(std::map<std::string, GEMJson>&& v)
+		{
+			type = GEM_JSON_DICT;
+			vDict = std::move(v);
+		}
+
 		// Converts this JSON value to a string representation
 		std::string asStr() const
 		{
@@ -765,7 +814,7 @@ namespace GEMLoader
 				}
 				skipWhitespace();
 			}
-			return GEMJson(elements);
+			return GEMJson(std::move(elements));
 		}
 
 		// Parses a JSON object/dictionary: { "key": value, ... }
@@ -786,8 +835,7 @@ namespace GEMLoader
 				skipWhitespace();
 				get();
 				skipWhitespace();
-				GEMJson value = parseValue();
-				obj[key] = value;
+				obj[key] = parseValue();
 				skipWhitespace();
 				char c = get();
 				if (c == '}')
@@ -796,7 +844,7 @@ namespace GEMLoader
 				}
 				skipWhitespace();
 			}
-			return GEMJson(obj);
+			return GEMJson(std::move(obj));
 		}
 	};
 
@@ -0,0 +1,138 @@
+#pragma once
+#include "core.h"
+#include "OffsetAllocator.h"
+#include <algorithm>
+
+// Where a buffer lives in GPUBufferHeap: the block's resource, and the allocator entry that holds
+// its offset and size
+struct GPUBufferRange
+{
+	ID3D12Resource* resource = nullptr;
+	unsigned int block = 0;
+	OffsetAllocator::Allocation allocation;
+
+	D3D12_GPU_VIRTUAL_ADDRESS address() const
+	{
+		return resource->GetGPUVirtualAddress() + allocation.offset;
+	}
+};
+
+// Vertex and index data of every mesh in a few large default-heap buffers, each carved up by an
+// OffsetAllocator, rather than a committed resource per buffer (placed at 64 KB granularity, so a
+// cube's 1.5 KB took 128 KB). Blocks are created in COMMON: ranges upload on the copy queue and
+// are read on the graphics queue through implicit promotion. A range may only be freed once the
+// GPU is done with it, which GPUResources' deferred mesh destruction ensures.
+class GPUBufferHeap
+{
+public:
+	static constexpr uint64_t BLOCK_SIZE = 32ull * 1024 * 1024;
+
+	struct Stats
+	{
+		unsigned int ranges = 0;
+		unsigned long long bytes = 0;            // requested by live ranges
+		unsigned long long committedBytes = 0;   // the same buffers as committed resources
+	} stats;
+
+	static GPUBufferHeap& instance()
+	{
+		static GPUBufferHeap heap;
+		return heap;
+	}
+
+	GPUBufferRange allocate(Core* core, uint64_t size, uint64_t alignment = OffsetAllocator::GRANULE)
+	{
+		GPUBufferRange range;
+		for (unsigned int b = 0; b < blocks.size() && !range.resource; b++)
+		{
+			range.allocation = blocks[b].allocator.allocate(size, alignment);
+			if (range.allocation.valid())
+			{
+				range.resource = blocks[b].resource;
+				range.block = b;
+			}
+		}
+		if (!range.resource)
+		{
+			// No block has room: add one, larger than usual for a buffer that would not fit
+			uint64_t blockSize = (std::max)(BLOCK_SIZE, (size + alignment + 65535) & ~65535ull);
+			Block block;
+			block.resource = createBuffer(core, blockSize);
+			block.allocator.reset(blockSize);
+			blocks.push_back(std::move(block));
+			range.block = (unsigned int)blocks.size() - 1;
+			range.resource = blocks.back().resource;
+			range.allocation = blocks.back().allocator.allocate(size, alignment);
+		}
+		stats.ranges++;
+		stats.bytes += size;
+		stats.committedBytes += (size + 65535) & ~65535ull;
+		return range;
+	}
+
+	void free(GPUBufferRange& range)
+	{
+		if (!range.resource)
+		{
+			return;
+		}
+		stats.ranges--;
+		stats.bytes -= range.allocation.size;
+		stats.committedBytes -= (range.allocation.size + 65535) & ~65535ull;
+		blocks[range.block].allocator.free(range.allocation);
+		range = GPUBufferRange();
+	}
+
+	unsigned int blockCount() const
+	{
+		return (unsigned int)blocks.size();
+	}
+
+	// GPU memory held by the blocks, used or not
+	unsigned long long reservedBytes() const
+	{
+		unsigned long long bytes = 0;
+		for (const Block& block : blocks) bytes += block.allocator.capacity();
+		return bytes;
+	}
+
+	// Shutdown, after every mesh is destroyed
+	void release()
+	{
+		for (Block& block : blocks)
+		{
+			block.resource->Release();
+		}
+		blocks.clear();
+		stats = Stats();
+	}
+
+private:
+	struct Block
+	{
+		ID3D12Resource* resource = nullptr;
+		OffsetAllocator allocator;
+	};
+
+	std::vector<Block> blocks;
+
+	static ID3D12Resource* createBuffer(Core* core, uint64_t size)
+	{
+		D3D12_HEAP_PROPERTIES heapprops = {};
+		heapprops.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapprops.CreationNodeMask = 1;
+		heapprops.VisibleNodeMask = 1;
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Width = size;
+		desc.Height = 1;
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ID3D12Resource* resource = nullptr;
+		core->device->CreateCommittedResource(&heapprops, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, NULL, IID_PPV_ARGS(&resource));
+		return resource;
+	}
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include "core.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "HandlePool.h"
+
+typedef Handle<Mesh> MeshHandle;
+typedef Handle<Shader> ShaderHandle;
+typedef Handle<ID3D12PipelineState*> PSOHandle;
+
+// Typed pools for GPU objects. Releasing invalidates the handle at once; the object itself is
+// destroyed by collect() once the graphics queue has passed the fence value that was next to be
+// signalled at release, so frames still in flight can keep drawing with it.
+class GPUResources
+{
+public:
+	HandlePool<Mesh> meshes{ &destroyMesh };
+	HandlePool<Shader> shaders{ &destroyShader };
+	HandlePool<ID3D12PipelineState*> psos{ &destroyPSO };
+
+	static GPUResources& instance()
+	{
+		static GPUResources resources;
+		return resources;
+	}
+
+	// Source of fence values; without one releases retire on the next collect()
+	void attach(Core* _core)
+	{
+		core = _core;
+	}
+
+	void release(MeshHandle h)
+	{
+		meshes.release(h, retireValue());
+	}
+
+	void release(ShaderHandle h)
+	{
+		shaders.release(h, retireValue());
+	}
+
+	void release(PSOHandle h)
+	{
+		psos.release(h, retireValue());
+	}
+
+	// Once per frame, after submission
+	void collect()
+	{
+		UINT64 completed = core ? core->completedGraphicsFenceValue() : ~0ull;
+		meshes.collect(completed);
+		shaders.collect(completed);
+		psos.collect(completed);
+	}
+
+	// Shutdown, after flushGraphicsQueue()
+	void destroyAll()
+	{
+		meshes.destroyAll();
+		shaders.destroyAll();
+		psos.destroyAll();
+	}
+
+private:
+	Core* core = nullptr;
+
+	UINT64 retireValue() const
+	{
+		return core ? core->nextGraphicsFenceValue() : 0;
+	}
+
+	static void destroyMesh(Mesh& mesh)
+	{
+		mesh.release();
+	}
+
+	static void destroyShader(Shader& shader)
+	{
+		shader.release();
+	}
+
+	static void destroyPSO(ID3D12PipelineState*& pso)
+	{
+		if (pso) pso->Release();
+		pso = nullptr;
+	}
+};
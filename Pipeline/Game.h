@@ -1,14 +1,34 @@
 #pragma once
 #include "Camera.h"
+#include "CharacterController.h"
 #include "LevelLoader.h"
-#include "GameObject.h"
+#include "EntityRegistry.h"
+#include "FixedTimestep.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "ParallelRecording.h"
 #include "ParticleSystem.h"
+#include "StaticBVH.h"
+#include "TransformHierarchy.h"
+#include "TripleBuffer.h"
 #include "StaticMesh.h"
+#include "VirtualFileSystem.h"
+#include "WorldStreaming.h"
+#include "DynamicAABBTree.h"
 #include "core.h"
 #include "maths.h"
 #include "window.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 
@@ -18,70 +38,888 @@ public:
   Core core;
   Camera cam;
   GamesEngineeringBase::Timer tim;
+
+  // Worker pool for per-frame data-parallel work; the main thread helps while it waits
+  JobSystem jobs;
+
   ParticleSystem particles;
 
-  // Scene Objects
-  std::vector<GameObject> objects;
+  // Static meshes draw one instanced batch per prototype (F10 switches to a draw per instance)
+  InstancedRenderer instanced;
+  bool instancing = true;
+
+  // Per-object path: one entry per visible submesh, sorted by key before submission
+  struct SubmeshDraw {
+    unsigned int prototype;
+    unsigned int submesh;
+    unsigned int world; // index into objectWorlds
+  };
+  DrawList drawList;
+  std::vector<SubmeshDraw> submeshDraws;
+  std::vector<Matrix> objectWorlds;
+  ChunkedRecording recording;
+  double sortMsTotal = 0.0;
+
+  // Scene Objects (dense component arrays; prototypes are shared via levelLoader.prototypes)
+  EntityRegistry entities;
+
+  // Broadphase over static entity world bounds, rebuilt when the level changes
+  StaticBVH broadphase;
+  std::vector<Entity> collisionCandidates;
+  std::vector<Entity> sweepCandidates;
+
+  // Collectibles float free in zero gravity, so they live in an incremental tree instead
+  struct FloatingBody {
+    Entity entity;
+    int proxy;
+    unsigned int node;
+    Vec3 velocity;
+  };
+  DynamicAABBTree floatingTree;
+  std::vector<FloatingBody> floating;
+  // Entity id pairs of floating bodies touching as of the last update, sorted; a pair bounces
+  // only on the update it first touches
+  std::vector<std::pair<unsigned int, unsigned int>> touchingFloating, touchingScratch;
+
+  // Placement transforms; entity world matrices are written from here when they change
+  TransformHierarchy transforms;
+  std::vector<std::string> transformIds;  // node -> placement id
+  std::vector<Entity> transformEntities;  // node -> entity (null once collected)
+  struct Spinner {
+    unsigned int node;
+    Vec3 degreesPerSecond;
+  };
+  std::vector<Spinner> spinners;
+
+  // Level (kept alive so hot reload can reuse loaded prototypes)
+  LevelLoader levelLoader;
+  std::string levelFile = "level.json";
+  std::unordered_map<std::string, Entity> placementEntities; // placement id -> live entity
+  std::unordered_set<std::string> collectedIds; // not respawned by a reload
+  std::filesystem::file_time_type levelWriteTime;
+  float levelPollTimer = 0.0f;
+
+  // Level streaming: placements are filed into cells by their root's position, and only cells
+  // near the player have entities and models resident. Model files are read and decoded on the
+  // reader thread; GPU buffers are created and entities spawned on the main thread.
+  std::vector<LevelPlacement> levelPlacements; // world space, from the last parse
+  std::vector<unsigned int> placementNodes;    // placement -> transform node
+  WorldCellGrid cellGrid;
+  CellStreamer streamer;
+  StreamingReader<StaticMesh::Decoded> modelReader{&StaticMesh::decode};
+  std::vector<StreamingReader<StaticMesh::Decoded>::Completed> completedReads;
+  std::unordered_map<std::string, std::unique_ptr<StaticMesh::Decoded>> decodedModels; // read, not yet created
+  std::unordered_set<std::string> modelsInFlight;
+  std::vector<unsigned int> loadingCells;
+  std::vector<unsigned int> cellLoads, cellUnloads, readyCells, residentUnloads;
+  Vec3 streamingCentre = Vec3(0, 0, 0); // camera position of the last rendered frame
+  double streamingReportTime = 0.0;
+  unsigned long long streamedBytesReported = 0;
 
   // Collectible tracking
   int totalCollectibles = 0;
   int collected = 0;
+  // Set by the tick that collects the last core; the main thread shows the dialog, since a tick
+  // may run on the simulation thread and a modal box there would stall it behind stale frames
+  std::atomic<bool> levelComplete{false};
+
+  // Simulation runs in fixed ticks; render interpolates between the last two tick states
+  FixedTimestep stepper = FixedTimestep(60.0f);
+  Vec3 previousCamPosition = Vec3(0, 0, 0);
+  std::vector<Entity> movedEntities; // TAG_MOVED entities from the last tick
+
+  // Keyboard state sampled once per displayed frame. Ticks read 'input' rather than win.keys,
+  // so the simulation can run on a thread of its own.
+  struct InputState {
+    bool keys[256] = {};
+    double sampledAt = 0.0; // frameClock() seconds
+  };
+  InputState input;          // seen by the current tick
+  InputState previousInput;  // seen by the previous tick, for edge-triggered keys
+  bool frameKeys[256] = {};  // main thread: keys at the previous frame
+  TripleBuffer<InputState> inputHandoff;
+
+  // What render needs from the latest tick, copied out so drawing never reads live simulation state
+  struct DrawItem {
+    unsigned int prototype;
+    bool moved; // interpolate from 'previous'
+    Matrix previous;
+    Matrix current;
+  };
+  struct FrameSnapshot {
+    Camera camera;
+    Vec3 previousCamPosition;
+    float time = 0.0f;
+    float dt = 1.0f / 60.0f;
+    std::vector<DrawItem> draws;
+    CullBounds bounds; // per draw, covering both interpolation ends
+    std::vector<Particle> particles;
+    double tickTime = 0.0;       // display time the latest tick's state belongs to
+    double inputSampledAt = 0.0; // when the input that tick used was sampled
+  };
+  TripleBuffer<FrameSnapshot> snapshots;
+  FrustumCuller culler; // render side
+
+  // Pipelined mode (F8 toggles): a simulation thread ticks and publishes snapshots while the main
+  // thread pumps messages and records the newest one, so tick and draw costs overlap
+  bool pipelined = true;
+  std::thread simThread;
+  std::atomic<bool> simRunning{false};
+  // Parking the thread between tick batches, for main-thread work that rebuilds simulation state;
+  // cheaper than joining and starting a new thread, which streamed cell changes do often
+  std::mutex simMutex;
+  std::condition_variable simWake;
+  std::atomic<bool> simPauseRequested{false};
+  bool simParked = false; // guarded by simMutex, as is simExited
+  bool simExited = false;
+
+  // Frame time and input-to-present latency, averaged until the next F7 report
+  double frameMsTotal = 0.0;
+  double latencyMsTotal = 0.0;
+  unsigned int framesMeasured = 0;
+
+  // CPU cost of recording draws (beginFrame's fence wait and present excluded) and what was
+  // recorded, summed over the same frames
+  double submitMsTotal = 0.0;
+  CommandStats submitted;
 
   // Game State
   int score = 0;
   float time = 0.0f;
-  bool isRunning = true;
+  std::atomic<bool> isRunning{true};
+
+  // Asset loading (shaders, level, models) time from startup, in seconds
+  float loadTime = 0.0f;
 
   // Anti-Gravity State
   float gravityScale = 1.0f; // 1.0 = Normal, 0.5 = Low, 0.0 = Zero
   Vec3 playerVelocity = Vec3(0, 0, 0);
   bool onGround = false;
 
+  // Player body: a sphere resting on the ground plane (y = 0) at the old eye height of 0.5
+  CharacterController controller;
+  float groundHeight = 0.0f;
+
   void initialize() {
+    GamesEngineeringBase::Timer loadTimer;
+
+    // Shipped builds read assets from the pack; without one we fall back to loose files
+    VirtualFileSystem &vfs = VirtualFileSystem::instance();
+    vfs.mount("data.pak");
+
     win.initialize("Anti-Gravity Game", 1024, 768);
     if (!win.hwnd) { isRunning = false; return; }
     core.init(win.hwnd, 1024, 768);
     if (!core.device) { isRunning = false; return; }
+    GPUResources::instance().attach(&core);
 
     // Initialize Camera
     cam.init(Vec3(0.0f, 2.0f, -10.0f), (float)win.width / (float)win.height);
 
     // Initialize Particles
     particles.init(&core, 100);
+    instanced.init(&core);
 
     // Load Level
-    LevelLoader loader;
-    std::vector<StaticMesh> loadedMeshes;
-    loader.load("level.json", &core, loadedMeshes);
+    std::vector<LevelPlacement> placements;
+    levelLoader.parse(levelFile, placements);
+    buildTransforms(placements);
+    levelPlacements = placements;
+    buildCells();
 
-    // convert loaded meshes into game objects (use prototype pointers)
-    for (auto &m : loadedMeshes) {
-      GameObject obj;
-      // store prototype in heap to maintain lifetime (simple approach)
-      StaticMesh* proto = new StaticMesh(m);
-      obj.prototype = proto;
-      obj.world = m.worldMatrix;
-      obj.type = m.type;
-      objects.push_back(obj);
-    }
+    // Block on the cells around the start position; the rest stream in while playing
+    streamingCentre = cam.position;
+    streamingReportTime = frameClock();
+    updateStreaming(streamingCentre, true);
+    bindTransforms();
+    levelWriteTime = levelFileWriteTime();
 
     // count collectibles
-    totalCollectibles = 0;
-    for (auto &o : objects) if (o.type == "collectible") totalCollectibles++;
+    countCollectibles();
+    rebuildBroadphase();
+
+    loadTime = loadTimer.dt();
+    char report[256];
+    snprintf(report, sizeof(report), "Load: %.3f s (%s), %u pack reads, %u loose reads, %llu bytes\n",
+             loadTime, vfs.hasPacks() ? "pack" : "loose files", vfs.stats.packReads,
+             vfs.stats.looseReads, vfs.stats.bytesRead);
+    OutputDebugStringA(report);
+    const UploadBatcher::Stats &uploads = core.uploads.stats;
+    snprintf(report, sizeof(report), "Uploads: %u (%.2f MB) in %u copy batches, %u ring stalls, %u queue flushes\n",
+             uploads.uploads, uploads.bytes / 1048576.0, uploads.batches, uploads.stalls, core.queueFlushes);
+    OutputDebugStringA(report);
+    const GPUBufferHeap &buffers = GPUBufferHeap::instance();
+    snprintf(report, sizeof(report), "Mesh buffers: %u ranges, %.2f MB in %u blocks of %.0f MB (%.2f MB as committed resources)\n",
+             buffers.stats.ranges, buffers.stats.bytes / 1048576.0, buffers.blockCount(),
+             GPUBufferHeap::BLOCK_SIZE / 1048576.0, buffers.stats.committedBytes / 1048576.0);
+    OutputDebugStringA(report);
+    snprintf(report, sizeof(report), "Instances: %u entities at %zu bytes each, sharing %u prototypes (%.2f MB)\n",
+             entities.size(), EntityRegistry::bytesPerEntity(), levelLoader.prototypes.size(),
+             levelLoader.residentBytes() / 1048576.0);
+    OutputDebugStringA(report);
   }
 
-  void update(float dt) {
+  // World bounds include the prototype's collision padding so the box reject in update is exact
+  WorldBounds placementBounds(unsigned int prototype, const Matrix &world) {
+    StaticMesh *proto = levelLoader.prototypes[prototype];
+    return WorldBounds::fromLocal(proto->localAABB.min, proto->localAABB.max, world, proto->collisionPadding);
+  }
+
+  // convert a placement into an entity that references the shared prototype
+  void spawnPlacement(const LevelPlacement &p, const Matrix &world) {
+    RenderHandle render = { levelLoader.getPrototypeIndex(&core, p.file) };
+    Entity e = entities.create(world, placementBounds(render.prototype, world), render, tagsFromType(p.type), p.id);
+    placementEntities[p.id] = e;
+  }
+
+  // Over the whole level, not just the resident cells
+  void countCollectibles() {
+    int remaining = 0;
+    for (const LevelPlacement &p : levelPlacements) {
+      if ((tagsFromType(p.type) & TAG_COLLECTIBLE) && !collectedIds.count(p.id)) remaining++;
+    }
+    totalCollectibles = collected + remaining;
+  }
+
+  // Resolve placement parents into a hierarchy (parents before children, grouped by depth) and
+  // replace each placement's local matrix with its world matrix. Missing or cyclic parents
+  // make the placement a root.
+  void buildTransforms(std::vector<LevelPlacement> &placements) {
+    size_t count = placements.size();
+    std::unordered_map<std::string, size_t> byId;
+    for (size_t i = 0; i < count; i++) byId[placements[i].id] = i;
+
+    std::vector<int> parentOf(count, -1);
+    for (size_t i = 0; i < count; i++) {
+      if (placements[i].parent.empty()) continue;
+      auto it = byId.find(placements[i].parent);
+      if (it != byId.end() && it->second != i) parentOf[i] = (int)it->second;
+    }
+    std::vector<unsigned int> depth(count, 0);
+    for (size_t i = 0; i < count; i++) {
+      unsigned int d = 0;
+      for (int j = parentOf[i]; j >= 0 && d <= count; j = parentOf[j]) d++;
+      if (d > count) { parentOf[i] = -1; d = 0; } // cycle
+      depth[i] = d;
+    }
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return depth[a] < depth[b]; });
+
+    transforms.clear();
+    transforms.reserve((unsigned int)count);
+    transformIds.clear();
+    spinners.clear();
+    placementNodes.assign(count, 0);
+    std::vector<int> nodeOf(count, -1);
+    for (size_t i : order) {
+      const LevelPlacement &p = placements[i];
+      int parentNode = parentOf[i] >= 0 ? nodeOf[parentOf[i]] : TransformHierarchy::NO_PARENT;
+      nodeOf[i] = (int)transforms.add(parentNode, p.pos, p.rot, p.scale);
+      transformIds.push_back(p.id);
+      if (p.spin.lengthSquared() > 0.0f) spinners.push_back({ (unsigned int)nodeOf[i], p.spin });
+    }
+    transforms.update();
+    for (size_t i = 0; i < count; i++) {
+      placements[i].world = transforms.world[nodeOf[i]];
+      placementNodes[i] = (unsigned int)nodeOf[i];
+    }
+  }
+
+  // File placements into cells by the position of their hierarchy root, so attached objects
+  // stream with their parent. Cells resident before a rebuild (hot reload) stay resident at the
+  // same coordinates; loads in progress start over.
+  void buildCells() {
+    std::vector<std::pair<int, int>> wasResident;
+    for (const WorldCell &c : cellGrid.cells) {
+      if (c.state == WorldCell::RESIDENT) wasResident.push_back({ c.x, c.z });
+    }
+    std::vector<Vec3> anchors(levelPlacements.size());
+    std::vector<std::string> models(levelPlacements.size());
+    for (size_t i = 0; i < levelPlacements.size(); i++) {
+      int n = (int)placementNodes[i];
+      while (transforms.parent[n] != TransformHierarchy::NO_PARENT) n = transforms.parent[n];
+      const Matrix &w = transforms.world[n];
+      anchors[i] = Vec3(w.m[3], w.m[7], w.m[11]);
+      models[i] = levelPlacements[i].file;
+    }
+    cellGrid.build(anchors, models);
+    for (const std::pair<int, int> &xz : wasResident) {
+      int c = cellGrid.find(xz.first, xz.second);
+      if (c >= 0) cellGrid.cells[c].state = WorldCell::RESIDENT;
+    }
+    streamer.sync(cellGrid);
+    loadingCells.clear();
+  }
+
+  // Prototype references held by resident cells (one per model per cell)
+  std::vector<unsigned int> heldPrototypes() {
+    std::vector<unsigned int> held;
+    for (const WorldCell &c : cellGrid.cells) {
+      if (c.state != WorldCell::RESIDENT) continue;
+      for (const std::string &file : c.models) {
+        int index = levelLoader.findPrototype(file);
+        if (index >= 0) held.push_back((unsigned int)index);
+      }
+    }
+    return held;
+  }
+
+  // Frames still in flight may draw these; GPUResources defers destroying their GPU objects
+  void releasePrototypes(const std::vector<unsigned int> &held) {
+    for (unsigned int index : held) levelLoader.releasePrototype(index);
+  }
+
+  // Spawns a cell's placements at their current hierarchy transforms
+  void spawnCell(const WorldCell &cell) {
+    for (unsigned int i : cell.placements) {
+      const LevelPlacement &p = levelPlacements[i];
+      if (!collectedIds.count(p.id)) spawnPlacement(p, transforms.world[placementNodes[i]]);
+    }
+  }
+
+  void despawnCell(const WorldCell &cell) {
+    for (unsigned int i : cell.placements) {
+      auto it = placementEntities.find(levelPlacements[i].id);
+      if (it == placementEntities.end()) continue;
+      destroyEntity(it->second);
+      placementEntities.erase(it);
+    }
+  }
+
+  // Main thread, once per frame: collect finished model reads, let the streamer pick cells
+  // around 'centre', request the models new cells need, then bring in cells whose models have
+  // all arrived and drop the ones left behind. 'wait' blocks until nothing is loading.
+  void updateStreaming(const Vec3 &centre, bool wait = false) {
+    do {
+      completedReads.clear();
+      modelReader.poll(completedReads);
+      for (auto &read : completedReads) {
+        modelsInFlight.erase(read.file);
+        decodedModels[read.file] = std::move(read.result);
+      }
+
+      streamer.update(cellGrid, centre, levelLoader.residentBytes(), cellLoads, cellUnloads);
+
+      // Unloads of cells still loading only cancel the load
+      residentUnloads.clear();
+      for (unsigned int c : cellUnloads) {
+        if (std::find(loadingCells.begin(), loadingCells.end(), c) == loadingCells.end()) residentUnloads.push_back(c);
+      }
+
+      for (unsigned int c : cellLoads) {
+        for (const std::string &file : cellGrid.cells[c].models) {
+          if (levelLoader.findPrototype(file) >= 0 || decodedModels.count(file) || modelsInFlight.count(file)) continue;
+          modelReader.request(file);
+          modelsInFlight.insert(file);
+        }
+        loadingCells.push_back(c);
+      }
+
+      readyCells.clear();
+      for (size_t k = 0; k < loadingCells.size();) {
+        const WorldCell &cell = cellGrid.cells[loadingCells[k]];
+        bool loading = cell.state == WorldCell::LOADING;
+        bool ready = loading;
+        for (const std::string &file : cell.models) ready = ready && !modelsInFlight.count(file);
+        if (ready) readyCells.push_back(loadingCells[k]);
+        if (ready || !loading) {
+          loadingCells[k] = loadingCells.back();
+          loadingCells.pop_back();
+        } else {
+          k++;
+        }
+      }
+
+      if (!readyCells.empty() || !residentUnloads.empty()) applyCells();
+      if (wait && !loadingCells.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (wait && (!loadingCells.empty() || !cellLoads.empty()));
+
+    // Whatever is left was read for loads that were cancelled
+    if (loadingCells.empty()) decodedModels.clear();
+  }
+
+  // Create models and spawn entities for ready cells, remove unloaded ones. Rebuilds every
+  // simulation structure, so the simulation thread is parked around it.
+  void applyCells() {
+    bool resume = pauseSimulation();
+    for (unsigned int c : readyCells) {
+      WorldCell &cell = cellGrid.cells[c];
+      for (const std::string &file : cell.models) {
+        auto it = decodedModels.find(file);
+        levelLoader.acquirePrototype(&core, file, it != decodedModels.end() ? it->second.get() : nullptr);
+      }
+      streamer.markResident(cellGrid, c, [&](const std::string &file) {
+        int index = levelLoader.findPrototype(file);
+        return index >= 0 ? levelLoader.prototypes[(unsigned int)index]->residentBytes() : (size_t)0;
+      });
+      spawnCell(cell);
+    }
+
+    std::vector<unsigned int> released;
+    for (unsigned int c : residentUnloads) {
+      despawnCell(cellGrid.cells[c]);
+      for (const std::string &file : cellGrid.cells[c].models) {
+        int index = levelLoader.findPrototype(file);
+        if (index >= 0) released.push_back((unsigned int)index);
+      }
+    }
+
+    bindTransforms();
+    countCollectibles();
+    rebuildBroadphase();
+    publishSnapshot();
+    releasePrototypes(released);
+    if (resume) resumeSimulation();
+  }
+
+  // Point every hierarchy node at the entity spawned for its placement
+  void bindTransforms() {
+    transformEntities.assign(transforms.size(), Entity());
+    for (unsigned int n = 0; n < transforms.size(); n++) {
+      auto it = placementEntities.find(transformIds[n]);
+      if (it != placementEntities.end()) transformEntities[n] = it->second;
+    }
+  }
+
+  // Static entities only move through the hierarchy, so a full SAH build on load/reload plus a
+  // refit when a parent animates is enough. Destroyed entities stay in the BVH until the next
+  // rebuild; queries skip them via alive().
+  void rebuildBroadphase() {
+    std::vector<WorldBounds> bounds;
+    std::vector<unsigned int> ids;
+    bounds.reserve(entities.size());
+    ids.reserve(entities.size());
+    floatingTree.clear();
+    floating.clear();
+    touchingFloating.clear();
+    for (unsigned int n = 0; n < transforms.size(); n++) {
+      Entity e = transformEntities[n];
+      if (!entities.alive(e)) continue;
+      unsigned int i = entities.indexOf(e);
+      if (entities.tags[i] & TAG_COLLECTIBLE) {
+        // Seed a slow drift from the node index so reloads are repeatable
+        float phase = (float)n * 2.399963f;
+        Vec3 drift(cosf(phase), 0.35f * sinf(phase * 1.7f), sinf(phase));
+        floating.push_back({ e, floatingTree.createProxy(entities.bounds[i], e.id), n, drift * 0.6f });
+        continue;
+      }
+      bounds.push_back(entities.bounds[i]);
+      ids.push_back(e.id);
+    }
+    broadphase.build(bounds, ids);
+  }
+
+  // Animate spinners and (in zero gravity) drift floating bodies, propagate the changes down
+  // the hierarchy, then refit the broadphases for what moved and bounce bodies that start touching
+  void updateTransforms(float dt) {
+    for (const Spinner &s : spinners) transforms.rotate(s.node, s.degreesPerSecond * dt);
+    bool drifting = gravityScale == 0.0f;
+    if (drifting) {
+      for (const FloatingBody &body : floating) transforms.translate(body.node, body.velocity * dt);
+    }
+    transforms.update(&jobs);
+
+    bool staticMoved = false;
+    for (unsigned int n : transforms.changed) {
+      Entity e = transformEntities[n];
+      if (!entities.alive(e)) continue;
+      unsigned int i = entities.indexOf(e);
+      entities.world[i] = transforms.world[n];
+      entities.bounds[i] = placementBounds(entities.render[i].prototype, entities.world[i]);
+      if (!(entities.tags[i] & TAG_MOVED)) {
+        entities.tags[i] |= TAG_MOVED;
+        movedEntities.push_back(e);
+      }
+      if (!(entities.tags[i] & TAG_COLLECTIBLE)) staticMoved = true;
+    }
+    if (staticMoved) {
+      broadphase.refit([&](unsigned int id, const WorldBounds &old) {
+        Entity e;
+        e.id = id;
+        return entities.alive(e) ? entities.bounds[entities.indexOf(e)] : old;
+      });
+    }
+    if (transforms.changed.empty()) return;
+
+    for (const FloatingBody &body : floating) {
+      Vec3 displacement = drifting ? body.velocity * dt : Vec3(0, 0, 0);
+      floatingTree.moveProxy(body.proxy, entities.bounds[entities.indexOf(body.entity)], displacement);
+    }
+    // updatePairs only reports pairs new to the tree, which misses bodies that start touching
+    // inside their fat boxes; every pair of overlapping fat boxes is tested instead
+    floatingTree.updatePairs([](unsigned int, unsigned int) {});
+    touchingScratch.clear();
+    floatingTree.forEachOverlap([&](unsigned int a, unsigned int b) {
+      Entity ea, eb;
+      ea.id = a;
+      eb.id = b;
+      if (!entities.alive(ea) || !entities.alive(eb)) return;
+      if (!entities.bounds[entities.indexOf(ea)].overlaps(entities.bounds[entities.indexOf(eb)])) return;
+      touchingScratch.push_back(std::make_pair((std::min)(a, b), (std::max)(a, b)));
+    });
+    std::sort(touchingScratch.begin(), touchingScratch.end());
+    for (const std::pair<unsigned int, unsigned int> &pair : touchingScratch) {
+      if (std::binary_search(touchingFloating.begin(), touchingFloating.end(), pair)) continue; // already bounced
+      Entity ea, eb;
+      ea.id = pair.first;
+      eb.id = pair.second;
+      FloatingBody *fa = findFloating(ea);
+      FloatingBody *fb = findFloating(eb);
+      if (fa && fb) std::swap(fa->velocity, fb->velocity); // equal-mass elastic bounce
+    }
+    touchingFloating.swap(touchingScratch);
+  }
+
+  // Earliest contact of a sphere moving by 'delta' against the ground plane and the triangles of
+  // solid entities near the sweep (for the character controller)
+  bool sweepWorld(const Vec3 &centre, const Vec3 &delta, float radius, MeshBVH::SweepHit &hit) {
+    bool found = false;
+    float height = centre.y - radius - groundHeight;
+    if (delta.y < 0.0f && -delta.y * hit.t > height) {
+      float t = height > 0.0f ? height / -delta.y : 0.0f;
+      hit.t = t;
+      hit.normal = Vec3(0, 1, 0);
+      hit.point = Vec3(centre.x + delta.x * t, groundHeight, centre.z + delta.z * t);
+      found = true;
+    }
+
+    Vec3 end = centre + delta;
+    Vec3 r(radius, radius, radius);
+    WorldBounds swept = { Vec3::Min(centre, end) - r, Vec3::Max(centre, end) + r };
+    sweepCandidates.clear();
+    broadphase.queryAABB(swept, [&](unsigned int id) {
+      Entity e;
+      e.id = id;
+      sweepCandidates.push_back(e);
+    });
+    for (Entity e : sweepCandidates) {
+      if (!entities.alive(e)) continue;
+      unsigned int i = entities.indexOf(e);
+      if (!(entities.tags[i] & TAG_SOLID)) continue;
+      const MeshBVH &bvh = levelLoader.prototypes[entities.render[i].prototype]->collisionBVH;
+      found |= bvh.sphereCastInstance(entities.world[i], entities.world[i].invert(), centre, delta, radius, hit);
+    }
+    return found;
+  }
+
+  FloatingBody *findFloating(Entity e) {
+    for (FloatingBody &body : floating) {
+      if (body.entity == e) return &body;
+    }
+    return nullptr;
+  }
+
+  // Destroys an entity, dropping its floating proxy if it has one
+  void destroyEntity(Entity e) {
+    FloatingBody *body = findFloating(e);
+    if (body) {
+      floatingTree.destroyProxy(body->proxy);
+      *body = floating.back();
+      floating.pop_back();
+    }
+    entities.destroy(e);
+  }
+
+  std::filesystem::file_time_type levelFileWriteTime() {
+    std::error_code ec;
+    std::filesystem::file_time_type t = std::filesystem::last_write_time(levelFile, ec);
+    return ec ? std::filesystem::file_time_type() : t;
+  }
+
+  // Re-parse the level and apply only what changed, matching placements to live objects by id.
+  // Prototypes come from the loader's cache, so edits never reload models or recompile shaders.
+  void reloadLevel() {
+    GamesEngineeringBase::Timer reloadTimer;
+    std::vector<LevelPlacement> placements;
+    if (!levelLoader.parse(levelFile, placements, true)) return;
+    buildTransforms(placements);
+    levelPlacements = placements;
+
+    // Re-file into cells; resident cells take references on their (possibly new) models before
+    // the old references are dropped, so unchanged models are never reloaded
+    std::vector<unsigned int> held = heldPrototypes();
+    buildCells();
+    std::vector<unsigned char> resident(placements.size(), 0);
+    for (const WorldCell &c : cellGrid.cells) {
+      if (c.state != WorldCell::RESIDENT) continue;
+      for (const std::string &file : c.models) levelLoader.acquirePrototype(&core, file);
+      for (unsigned int i : c.placements) resident[i] = 1;
+    }
+
+    std::unordered_set<std::string> present;
+    present.reserve(placements.size());
+    int added = 0, moved = 0, changed = 0, removed = 0;
+    for (size_t k = 0; k < placements.size(); k++) {
+      const LevelPlacement &p = placements[k];
+      if (!resident[k] || collectedIds.count(p.id)) continue;
+      present.insert(p.id);
+      auto it = placementEntities.find(p.id);
+      if (it == placementEntities.end() || !entities.alive(it->second)) {
+        spawnPlacement(p, p.world);
+        added++;
+        continue;
+      }
+      unsigned int i = entities.indexOf(it->second);
+      unsigned int prototype = levelLoader.getPrototypeIndex(&core, p.file);
+      unsigned char tags = tagsFromType(p.type);
+      bool worldChanged = memcmp(entities.world[i].m, p.world.m, sizeof(p.world.m)) != 0;
+      bool prototypeChanged = entities.render[i].prototype != prototype;
+      if (prototypeChanged || (entities.tags[i] & ~TAG_MOVED) != tags) {
+        // Model swap or gameplay type change: point at the other (cached) prototype
+        entities.render[i].prototype = prototype;
+        entities.tags[i] = tags;
+        changed++;
+      }
+      if (worldChanged) {
+        entities.world[i] = p.world;
+        moved++;
+      }
+      if (worldChanged || prototypeChanged) {
+        entities.bounds[i] = placementBounds(prototype, p.world);
+      }
+    }
+
+    // Remove placements that disappeared from the file
+    for (auto it = placementEntities.begin(); it != placementEntities.end();) {
+      if (present.count(it->first)) { ++it; continue; }
+      destroyEntity(it->second);
+      it = placementEntities.erase(it);
+      removed++;
+    }
+
+    bindTransforms();
+    countCollectibles();
+    rebuildBroadphase();
+    releasePrototypes(held);
+
+    char report[256];
+    snprintf(report, sizeof(report), "Level reload: %.3f ms (%d added, %d moved, %d changed, %d removed)\n",
+             reloadTimer.dt() * 1000.0f, added, moved, changed, removed);
+    OutputDebugStringA(report);
+  }
+
+  static double frameClock() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Once per displayed frame on the main thread, which owns the window's message queue. The
+  // sample goes straight to 'input' in the serial loop, or is handed to the simulation thread.
+  void pollInput() {
     win.processMessages();
     if (win.keys[VK_ESCAPE] == 1) {
       isRunning = false;
     }
+    InputState &sample = pipelined ? inputHandoff.writeBuffer() : input;
+    memcpy(sample.keys, win.keys, sizeof(sample.keys));
+    sample.sampledAt = frameClock();
+    if (pipelined) inputHandoff.publish();
+  }
+
+  // Hot reload: poll level.json twice a second, or force with F5. Reloading uploads to the GPU
+  // and rebuilds every simulation structure, so the simulation thread is parked around it.
+  void pollReload(float frameTime) {
+    levelPollTimer += frameTime;
+    bool forced = win.keys[VK_F5] && !frameKeys[VK_F5];
+    if (levelPollTimer <= 0.5f && !forced) return;
+    levelPollTimer = 0.0f;
+    std::filesystem::file_time_type writeTime = levelFileWriteTime();
+    if (writeTime == levelWriteTime && !forced) return;
+    levelWriteTime = writeTime;
+    bool resume = pauseSimulation();
+    reloadLevel();
+    publishSnapshot();
+    if (resume) resumeSimulation();
+  }
+
+  // Main-thread keys: F7 reports frame pacing, culling, draw submission and constant memory, F8
+  // switches between the pipelined and serial loops, F9 reports level streaming, F10 toggles
+  // instanced static meshes (F6 belongs to the simulation's transform report)
+  void handleFrameKeys() {
+    if (win.keys[VK_F7] && !frameKeys[VK_F7] && framesMeasured > 0) {
+      char report[256];
+      snprintf(report, sizeof(report), "%s loop: %.3f ms per frame, %.3f ms input to present (%u frames); culling: %u/%u visible, %.3f ms\n",
+               pipelined ? "Pipelined" : "Serial", frameMsTotal / framesMeasured,
+               latencyMsTotal / framesMeasured, framesMeasured, culler.stats.visible, culler.stats.total,
+               culler.stats.cullMs);
+      OutputDebugStringA(report);
+      snprintf(report, sizeof(report), "Submission: %.3f ms CPU (%.3f ms sorting), %u draws, %u state changes, %u redundant binds eliminated per frame\n",
+               submitMsTotal / framesMeasured, sortMsTotal / framesMeasured, submitted.draws / framesMeasured,
+               submitted.stateChanges / framesMeasured, submitted.eliminated / framesMeasured);
+      OutputDebugStringA(report);
+      const FrameLinearAllocator::Stats &constants = core.constants.stats();
+      snprintf(report, sizeof(report), "Constants: %.1f KB last frame in %u slabs, %.1f KB peak per frame, %u slabs (%.1f MB) reserved\n",
+               constants.frameBytes / 1024.0, constants.frameSlabs, constants.peakFrameBytes / 1024.0,
+               core.constants.slabCount(), core.constants.reservedBytes() / 1048576.0);
+      OutputDebugStringA(report);
+      core.constants.resetPeak();
+      frameMsTotal = latencyMsTotal = submitMsTotal = sortMsTotal = 0.0;
+      submitted.reset();
+      framesMeasured = 0;
+    }
+    if (win.keys[VK_F10] && !frameKeys[VK_F10]) {
+      instancing = !instancing;
+      frameMsTotal = latencyMsTotal = submitMsTotal = sortMsTotal = 0.0;
+      submitted.reset();
+      framesMeasured = 0;
+    }
+    if (win.keys[VK_F8] && !frameKeys[VK_F8]) {
+      stopSimulation();
+      pipelined = !pipelined;
+      if (pipelined) startSimulation();
+      frameMsTotal = latencyMsTotal = submitMsTotal = sortMsTotal = 0.0;
+      submitted.reset();
+      framesMeasured = 0;
+    }
+    if (win.keys[VK_F9] && !frameKeys[VK_F9]) {
+      double now = frameClock();
+      unsigned long long bytes = modelReader.bytesRead;
+      double readRate = (double)(bytes - streamedBytesReported) / (now - streamingReportTime);
+      char report[320];
+      snprintf(report, sizeof(report), "Streaming: %u/%u cells resident, %u loading, %.2f MB resident (budget %.0f MB), %u loads, %u unloads (%u over budget), %u deferred, %.2f MB/s read\n",
+               streamer.residentCount(cellGrid), (unsigned int)cellGrid.cells.size(), (unsigned int)loadingCells.size(),
+               levelLoader.residentBytes() / 1048576.0, streamer.memoryBudget / 1048576.0, streamer.stats.loadsStarted,
+               streamer.stats.unloads, streamer.stats.budgetUnloads, streamer.stats.deferredLoads, readRate / 1048576.0);
+      OutputDebugStringA(report);
+      streamingReportTime = now;
+      streamedBytesReported = bytes;
+    }
+    memcpy(frameKeys, win.keys, sizeof(frameKeys));
+  }
+
+  // Copy what render needs from the latest tick into the next snapshot and hand it over
+  void publishSnapshot() {
+    FrameSnapshot &frame = snapshots.writeBuffer();
+    frame.camera = cam;
+    frame.previousCamPosition = previousCamPosition;
+    frame.time = time;
+    frame.dt = stepper.dt();
+    frame.draws.resize(entities.size());
+    frame.bounds.clear();
+    frame.bounds.reserve(entities.size());
+    for (unsigned int i = 0; i < entities.size(); i++) {
+      DrawItem &d = frame.draws[i];
+      d.prototype = entities.render[i].prototype;
+      d.moved = (entities.tags[i] & TAG_MOVED) != 0;
+      d.current = entities.world[i];
+      WorldBounds b = entities.bounds[i];
+      if (d.moved) {
+        // Stretch over the previous position so interpolated frames aren't culled early
+        d.previous = entities.previousWorld[i];
+        Vec3 shift(d.previous.m[3] - d.current.m[3], d.previous.m[7] - d.current.m[7], d.previous.m[11] - d.current.m[11]);
+        b.min = Vec3::Min(b.min, b.min + shift);
+        b.max = Vec3::Max(b.max, b.max + shift);
+      }
+      frame.bounds.add(b.min, b.max);
+    }
+    frame.particles = particles.particles; // reuses the snapshot's capacity
+    frame.tickTime = frameClock() - stepper.alpha() * stepper.dt();
+    frame.inputSampledAt = input.sampledAt;
+    snapshots.publish();
+  }
+
+  // Simulation thread: tick on wall-clock time and publish a snapshot after each batch of ticks
+  void simulationLoop() {
+    jobs.attachCurrentThread();
+    double last = frameClock();
+    while (simRunning && isRunning) {
+      if (simPauseRequested) {
+        std::unique_lock<std::mutex> lock(simMutex);
+        simParked = true;
+        simWake.notify_all();
+        simWake.wait(lock, [this]() { return !simPauseRequested || !simRunning; });
+        simParked = false;
+        last = frameClock(); // no catching up on the time spent parked
+        continue;
+      }
+      double now = frameClock();
+      int ticks = stepper.advance((float)(now - last));
+      last = now;
+      if (ticks == 0) {
+        // Sleep until the next tick is due; yield when it's too close for the OS sleep granularity
+        float remaining = (1.0f - stepper.alpha()) * stepper.dt();
+        if (remaining > 0.002f) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        else std::this_thread::yield();
+        continue;
+      }
+      if (inputHandoff.acquire()) input = inputHandoff.readBuffer();
+      for (int t = 0; t < ticks && isRunning; t++) {
+        update(stepper.dt());
+      }
+      publishSnapshot();
+    }
+    jobs.detachCurrentThread();
+    std::lock_guard<std::mutex> lock(simMutex);
+    simExited = true;
+    simWake.notify_all();
+  }
+
+  void startSimulation() {
+    if (simRunning) return;
+    simRunning = true;
+    simPauseRequested = false;
+    simExited = false;
+    simThread = std::thread([this]() { simulationLoop(); });
+  }
+
+  void stopSimulation() {
+    if (!simRunning) return;
+    {
+      std::lock_guard<std::mutex> lock(simMutex);
+      simRunning = false;
+    }
+    simWake.notify_all();
+    simThread.join();
+  }
+
+  // Parks the simulation thread once its current batch of ticks is published; false when it
+  // isn't running or is already parked, so nested callers leave resuming to the outermost
+  bool pauseSimulation() {
+    if (!simRunning || simPauseRequested) return false;
+    std::unique_lock<std::mutex> lock(simMutex);
+    simPauseRequested = true;
+    simWake.wait(lock, [this]() { return simParked || simExited; });
+    return true;
+  }
+
+  void resumeSimulation() {
+    {
+      std::lock_guard<std::mutex> lock(simMutex);
+      simPauseRequested = false;
+    }
+    simWake.notify_all();
+  }
+
+  // Snapshot the state render interpolates from, before a tick changes it
+  void beginTick() {
+    previousCamPosition = cam.position;
+    for (Entity e : movedEntities) {
+      if (!entities.alive(e)) continue;
+      unsigned int i = entities.indexOf(e);
+      entities.previousWorld[i] = entities.world[i];
+      entities.tags[i] &= ~TAG_MOVED;
+    }
+    movedEntities.clear();
+  }
+
+  // One fixed simulation tick
+  void update(float dt) {
+    beginTick();
+
+    // F6: print transform hierarchy cost for the last frame
+    if (input.keys[VK_F6] && !previousInput.keys[VK_F6]) {
+      char report[256];
+      snprintf(report, sizeof(report), "Transforms: %u nodes, %u world matrices recomputed, %.3f ms\n",
+               transforms.size(), transforms.stats.recomputed, transforms.stats.updateMs);
+      OutputDebugStringA(report);
+    }
 
     // Gravity Control
-    if (win.keys['1'])
+    if (input.keys['1'])
       gravityScale = 1.0f; // Normal
-    if (win.keys['2'])
+    if (input.keys['2'])
       gravityScale = 0.2f; // Low
-    if (win.keys['3'])
+    if (input.keys['3'])
       gravityScale = 0.0f; // Zero
 
     time += dt;
@@ -95,42 +933,37 @@ public:
     playerVelocity.y += gravity * dt;
 
     // Friction / Damping
-    playerVelocity.x *= 0.95f;
-    playerVelocity.z *= 0.95f;
+    // (tuned as per-frame factors at 60 Hz; scaled so any tick rate feels the same)
+    float ticks60 = dt * 60.0f;
+    float friction = powf(0.95f, ticks60);
+    playerVelocity.x *= friction;
+    playerVelocity.z *= friction;
     if (gravityScale == 0.0f)
-      playerVelocity.y *= 0.98f; // Air resistance in zero G
+      playerVelocity.y *= powf(0.98f, ticks60); // Air resistance in zero G
 
     // Input Force (Simplified)
     float moveSpeed = 20.0f * dt;
-    if (win.keys['W'])
+    if (input.keys['W'])
       playerVelocity.z += moveSpeed;
-    if (win.keys['S'])
+    if (input.keys['S'])
       playerVelocity.z -= moveSpeed;
-    if (win.keys['A'])
+    if (input.keys['A'])
       playerVelocity.x += moveSpeed;
-    if (win.keys['D'])
+    if (input.keys['D'])
       playerVelocity.x -= moveSpeed;
 
     // Jump / Up-Thrust
-    if (win.keys[VK_SPACE]) {
+    if (input.keys[VK_SPACE]) {
       if (onGround || gravityScale < 0.5f) {
         playerVelocity.y += 10.0f * dt; // Thrust
       }
     }
 
-    // Apply Velocity
-    cam.position.x += playerVelocity.x * dt;
-    cam.position.y += playerVelocity.y * dt;
-    cam.position.z += playerVelocity.z * dt;
-
-    // Ground Floor (Hardcoded for now)
-    if (cam.position.y < 0.5f) {
-      cam.position.y = 0.5f;
-      playerVelocity.y = 0;
-      onGround = true;
-    } else {
-      onGround = false;
-    }
+    // Apply Velocity: swept collide-and-slide against solid meshes and the ground plane, so
+    // fast movement can't tunnel through thin geometry
+    controller.move(cam.position, playerVelocity, dt,
+                    [&](const Vec3 &c, const Vec3 &d, float r, MeshBVH::SweepHit &hit) { return sweepWorld(c, d, r, hit); });
+    onGround = controller.onGround;
 
     // Camera Look Logic (Target update)
     // Since we don't have mouse delta easily, use Arrow Keys to rotate view?
@@ -144,73 +977,162 @@ public:
     cam.update(dt);
 
     // Update Particles
-    particles.update(dt);
-
-    // --- Collision & Collection ---
-    for (int i = 0; i < objects.size(); i++) {
-      GameObject &obj = objects[i];
-      if (!obj.prototype) continue;
-      if (obj.prototype->checkCollision(cam.position)) {
-        // Collision!
-        // Check type
-        // Note: We need 'type' member in StaticMesh.h (Added!)
-
-        // Assuming we can access 'type' (public)
-        // Need to use string compare
-        // Wait, I declared 'type' in StaticMesh.h in previous step?
-        // Yes, 'std::string type = "static";'
-
-        // If Collectible
-        if (obj.type == "collectible") {
-          // Collect!
-          score++;
-          Vec3 pickupPos = obj.world.mulPoint(Vec3(0,0,0));
-          particles.spawnAt(pickupPos, 24);
-          // Remove object and free prototype
-          delete obj.prototype;
-          objects[i] = objects.back();
-          objects.pop_back();
-          i--; // adjust index
-
-          // Check win
-          collected++;
-          if (collected >= totalCollectibles) {
-              MessageBoxA(NULL, "All Energy Cores collected! Portal activated. You win!", "Level Complete", MB_OK | MB_ICONINFORMATION);
-              isRunning = false;
-          }
-        } else {
-          // Hit Wall/Static
-          // Push back slightly (Simple response)
-          cam.position -= playerVelocity * dt * 2.0f; // Revert move
-          playerVelocity = Vec3(0, 0, 0);
-        }
-      }
+    particles.update(dt, &jobs);
+    updateTransforms(dt);
+
+    // --- Collection ---
+    // Solids are handled by the controller; only floating pickups near the player pay for
+    // the inverse transform in the local-space test
+    collisionCandidates.clear();
+    floatingTree.queryPoint(cam.position, [&](int, unsigned int id) {
+      Entity e;
+      e.id = id;
+      collisionCandidates.push_back(e);
+    });
+    for (Entity e : collisionCandidates) {
+      if (!entities.alive(e)) continue;
+      unsigned int i = entities.indexOf(e);
+      if (!(entities.tags[i] & TAG_COLLECTIBLE)) continue;
+      StaticMesh *proto = levelLoader.prototypes[entities.render[i].prototype];
+      if (!proto->checkCollision(entities.world[i], cam.position, false)) continue;
+
+      // Collect!
+      score++;
+      Vec3 pickupPos = entities.world[i].mulPoint(Vec3(0,0,0));
+      particles.spawnAt(pickupPos, 24);
+      // Remove entity and its floating proxy
+      collectedIds.insert(entities.names[i]);
+      placementEntities.erase(entities.names[i]);
+      destroyEntity(e);
+
+      // Check win
+      collected++;
+      if (collected >= totalCollectibles) levelComplete = true;
     }
+    previousInput = input;
   }
 
-  void render() {
+  // Draw a snapshot, interpolated to the display time between its previous and latest tick
+  void render(const FrameSnapshot &frame) {
+    float alpha = (float)((frameClock() - frame.tickTime) / frame.dt);
+    alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+
     core.beginFrame();
+    CommandRecorder &commands = core.commands();
+    commands.stats.reset();
+    double submitStart = frameClock();
 
-    Matrix vp = cam.getViewProjection();
+    Camera view = frame.camera;
+    view.position = lerp(frame.previousCamPosition, frame.camera.position, alpha);
+    view.updateMatrices();
+    Matrix vp = view.getViewProjection();
+    Vec3 eye = view.position;
+    streamingCentre = eye;
 
-    // Draw GameObjects
-    for (auto &obj : objects) {
-      if (obj.prototype) obj.draw(&core, vp, time, cam.position);
+    // Only what intersects the view is submitted
+    culler.cull(frame.bounds, view.getFrustum(), &jobs);
+    const ResourceCache<StaticMesh> &prototypes = levelLoader.prototypes;
+    if (instancing) {
+      instanced.begin(prototypes.capacity());
+      for (unsigned int i : culler.visible) instanced.count(frame.draws[i].prototype);
+      instanced.layout(&core);
+      for (unsigned int i : culler.visible) {
+        const DrawItem &d = frame.draws[i];
+        instanced.add(d.prototype, d.moved ? lerpMatrix(d.previous, d.current, alpha) : d.current);
+      }
+      instanced.draw(&core, prototypes, vp, frame.time, eye);
+    } else {
+      // Keyed by PSO, material, mesh and distance, so after sorting the recorder drops most binds
+      drawList.clear();
+      submeshDraws.clear();
+      objectWorlds.clear();
+      for (unsigned int i : culler.visible) {
+        const DrawItem &d = frame.draws[i];
+        const StaticMesh *prototype = prototypes[d.prototype];
+        unsigned int world = (unsigned int)objectWorlds.size();
+        objectWorlds.push_back(d.moved ? lerpMatrix(d.previous, d.current, alpha) : d.current);
+        const Matrix &w = objectWorlds.back();
+        uint32_t depth = DrawKey::depth((Vec3(w.m[3], w.m[7], w.m[11]) - eye).length(), view.farPlane);
+        for (unsigned int s = 0; s < prototype->meshes.size(); s++) {
+          drawList.add(prototype->drawKey(s, depth), (uint32_t)submeshDraws.size());
+          submeshDraws.push_back({d.prototype, s, world});
+        }
+      }
+      double sortStart = frameClock();
+      drawList.sort();
+      sortMsTotal += (frameClock() - sortStart) * 1000.0;
+      // Contiguous chunks of the sorted list record on the workers, a command list each, and are
+      // submitted in list order ahead of the particles
+      recording.split((unsigned int)drawList.size(), (std::min)(jobs.threadCount(), Core::MAX_RECORDING_CHUNKS), 256);
+      core.prepareChunks((unsigned int)recording.chunks.size());
+      recording.record(&jobs, [&](unsigned int chunk, unsigned int begin, unsigned int end) {
+        core.beginChunk(chunk);
+        for (unsigned int n = begin; n < end; n++) {
+          const SubmeshDraw &s = submeshDraws[drawList.items[n].payload];
+          prototypes[s.prototype]->drawSubmesh(&core, s.submesh, objectWorlds[s.world], vp, frame.time, eye);
+        }
+        core.endChunk();
+      });
+      core.executeChunks((unsigned int)recording.chunks.size());
+      for (unsigned int k = 0; k < recording.chunks.size(); k++) submitted.add(core.chunkRecorders[k].stats);
     }
 
     // Draw Particles
-    particles.draw(&core, vp, time, cam.position);
+    particles.draw(&core, frame.particles, vp, frame.time, eye, alpha);
+
+    submitMsTotal += (frameClock() - submitStart) * 1000.0;
+    submitted.add(commands.stats);
 
     core.finishFrame();
+    GPUResources::instance().collect();
+    latencyMsTotal += (frameClock() - frame.inputSampledAt) * 1000.0;
+  }
+
+  // Element-wise blend; fine for the small rotation between two ticks
+  static Matrix lerpMatrix(const Matrix &a, const Matrix &b, float t) {
+    Matrix m;
+    for (int k = 0; k < 16; k++) m.m[k] = a.m[k] + (b.m[k] - a.m[k]) * t;
+    return m;
   }
 
   void run() {
     initialize();
+    previousCamPosition = cam.position;
+    input.sampledAt = frameClock();
+    publishSnapshot();
+    if (pipelined) startSimulation();
     while (isRunning) {
-      float dt = tim.dt();
-      update(dt);
-      render();
+      float frameTime = tim.dt();
+      pollInput();
+      pollReload(frameTime);
+      updateStreaming(streamingCentre);
+      handleFrameKeys();
+      if (!pipelined) {
+        int ticks = stepper.advance(frameTime);
+        for (int t = 0; t < ticks && isRunning; t++) {
+          update(stepper.dt());
+        }
+        if (ticks > 0) publishSnapshot();
+      }
+      snapshots.acquire();
+      render(snapshots.readBuffer());
+      frameMsTotal += frameTime * 1000.0;
+      framesMeasured++;
+      if (levelComplete) {
+        bool resume = pauseSimulation();
+        MessageBoxA(win.hwnd, "All Energy Cores collected! Portal activated. You win!", "Level Complete", MB_OK | MB_ICONINFORMATION);
+        isRunning = false;
+        if (resume) resumeSimulation();
+      }
     }
+    stopSimulation();
     core.flushGraphicsQueue();
+    instanced.release();
+    particles.release();
+    levelLoader.prototypes.clear();
+    GPUResources::instance().destroyAll();
+    GPUBufferHeap::instance().release();
+    core.uploads.release();
+    core.constants.release();
   }
 };
@@ -0,0 +1,221 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+// 32-bit generational handle into a HandlePool<T>: the low INDEX_BITS pick a slot, the rest
+// count how often the slot was released, so a stale handle never reaches a reused slot.
+// Generations start at 1, so a zero handle is always null.
+template<typename T>
+struct Handle
+{
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+	static constexpr uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+
+	uint32_t bits = 0;
+
+	uint32_t index() const
+	{
+		return bits & INDEX_MASK;
+	}
+
+	uint32_t generation() const
+	{
+		return bits >> INDEX_BITS;
+	}
+
+	bool isNull() const
+	{
+		return bits == 0;
+	}
+
+	bool operator==(const Handle& other) const
+	{
+		return bits == other.bits;
+	}
+
+	bool operator!=(const Handle& other) const
+	{
+		return bits != other.bits;
+	}
+};
+
+// Slot pool of T addressed by Handle<T> with O(1) lookup. release() invalidates the handle at once
+// but keeps the object until collect() is given a completed fence value at or past the one it was
+// released with; only then is it destroyed and its slot reused. Fence values must not decrease
+// between releases, which holds for a single GPU queue's timeline.
+template<typename T>
+class HandlePool
+{
+public:
+	typedef void (*DestroyFn)(T& object);
+
+	explicit HandlePool(DestroyFn destroyFn = nullptr) : destroy(destroyFn)
+	{
+	}
+
+	HandlePool(const HandlePool&) = delete;
+	HandlePool& operator=(const HandlePool&) = delete;
+
+	~HandlePool()
+	{
+		destroyAll();
+	}
+
+	// A null handle once all Handle<T>::MAX_SLOTS slots are live or pending; 'object' is then not
+	// taken, so the caller still owns whatever it holds
+	Handle<T> create(const T& object)
+	{
+		uint32_t index;
+		if (freeHead != NO_SLOT)
+		{
+			index = freeHead;
+			freeHead = slots[index].nextFree;
+		}
+		else
+		{
+			if (slots.size() >= Handle<T>::MAX_SLOTS)
+			{
+				return Handle<T>();
+			}
+			index = (uint32_t)slots.size();
+			slots.push_back(Slot());
+		}
+		Slot& slot = slots[index];
+		slot.object = object;
+		slot.live = true;
+		live++;
+		Handle<T> h;
+		h.bits = (slot.generation << Handle<T>::INDEX_BITS) | index;
+		return h;
+	}
+
+	// Null for null, stale or released handles. Pointers are invalidated by create().
+	T* get(Handle<T> h)
+	{
+		return alive(h) ? &slots[h.index()].object : nullptr;
+	}
+
+	const T* get(Handle<T> h) const
+	{
+		return alive(h) ? &slots[h.index()].object : nullptr;
+	}
+
+	bool alive(Handle<T> h) const
+	{
+		if (h.isNull() || h.index() >= slots.size())
+		{
+			return false;
+		}
+		const Slot& slot = slots[h.index()];
+		return slot.live && slot.generation == h.generation();
+	}
+
+	// The GPU may still use the object until 'retireValue' completes; stale handles are ignored
+	void release(Handle<T> h, uint64_t retireValue)
+	{
+		if (!alive(h))
+		{
+			return;
+		}
+		Slot& slot = slots[h.index()];
+		slot.live = false;
+		slot.generation = nextGeneration(slot.generation);
+		live--;
+		retired.push_back({ h.index(), retireValue });
+	}
+
+	// Destroys released objects whose fence value has completed; returns how many
+	unsigned int collect(uint64_t completedValue)
+	{
+		unsigned int count = 0;
+		while (!retired.empty() && retired.front().value <= completedValue)
+		{
+			destroySlot(retired.front().index);
+			retired.pop_front();
+			count++;
+		}
+		return count;
+	}
+
+	// Destroys everything, live or retired; only once the GPU is idle
+	void destroyAll()
+	{
+		for (uint32_t i = 0; i < slots.size(); i++)
+		{
+			if (slots[i].live)
+			{
+				slots[i].live = false;
+				slots[i].generation = nextGeneration(slots[i].generation);
+				live--;
+				destroySlot(i);
+			}
+		}
+		while (!retired.empty())
+		{
+			destroySlot(retired.front().index);
+			retired.pop_front();
+		}
+	}
+
+	// Objects reachable through a handle
+	unsigned int size() const
+	{
+		return live;
+	}
+
+	// Released objects waiting for the GPU
+	unsigned int pending() const
+	{
+		return (unsigned int)retired.size();
+	}
+
+	// Slots ever allocated; stays flat when releases are collected before new creates
+	unsigned int capacity() const
+	{
+		return (unsigned int)slots.size();
+	}
+
+private:
+	static constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		T object = T();
+		uint32_t generation = 1;
+		uint32_t nextFree = NO_SLOT;
+		bool live = false;
+	};
+
+	struct Retired
+	{
+		uint32_t index;
+		uint64_t value;
+	};
+
+	std::vector<Slot> slots;
+	std::deque<Retired> retired;
+	uint32_t freeHead = NO_SLOT;
+	unsigned int live = 0;
+	DestroyFn destroy;
+
+	static uint32_t nextGeneration(uint32_t generation)
+	{
+		generation = (generation + 1) & Handle<T>::GENERATION_MASK;
+		return generation ? generation : 1;
+	}
+
+	void destroySlot(uint32_t index)
+	{
+		Slot& slot = slots[index];
+		if (destroy)
+		{
+			destroy(slot.object);
+		}
+		slot.object = T();
+		slot.nextFree = freeHead;
+		freeHead = index;
+	}
+};
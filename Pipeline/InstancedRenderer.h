@@ -0,0 +1,117 @@
+#pragma once
+#include "core.h"
+#include "DynamicVertexBuffer.h"
+#include "Static_Vertex.h"
+#include "Shader.h"
+#include "PipeLineState.h"
+#include "GPUResources.h"
+#include "ResourceCache.h"
+#include "StaticMesh.h"
+#include <vector>
+
+// Draws static meshes with one instanced draw per prototype per submesh. Visible instances are
+// counted per prototype, given contiguous ranges, and their world matrices written into this
+// frame's instance stream; that stays bound in vertex slot 1 and each batch selects its range
+// with startInstance.
+class InstancedRenderer
+{
+public:
+	struct Batch
+	{
+		unsigned int first = 0;
+		unsigned int count = 0;
+		unsigned int written = 0;
+	};
+
+	std::vector<Batch> batches;   // indexed by prototype slot
+	unsigned int instances = 0;
+
+	// One shader and PSO serve every prototype: the per-instance data is all in the vertex stream
+	void init(Core* core)
+	{
+		Shader program;
+		program.LoadShaders("VertexShaderInstanced.hlsl", "PixelShader.hlsl");
+		program.ReflectShaders(core, program.pixelShader, false);
+		program.ReflectShaders(core, program.vertexShader, true);
+		psos.createPSO(core, "Instanced", program.vertexShader, program.pixelShader, VertexLayoutCache::getInstancedLayout());
+		shader = GPUResources::instance().shaders.create(program);
+	}
+
+	// 'prototypeSlots' is the prototype cache's capacity
+	void begin(unsigned int prototypeSlots)
+	{
+		batches.assign(prototypeSlots, Batch());
+		instances = 0;
+	}
+
+	void count(unsigned int prototype)
+	{
+		batches[prototype].count++;
+	}
+
+	// After counting and beginFrame: lays out the ranges and makes room in this frame's buffer
+	void layout(Core* core)
+	{
+		unsigned int first = 0;
+		for (Batch& b : batches)
+		{
+			b.first = first;
+			first += b.count;
+		}
+		instances = first;
+		mapped = instanceBuffer.map(core, instances, INSTANCE_STRIDE);
+	}
+
+	void add(unsigned int prototype, const Matrix& world)
+	{
+		Batch& b = batches[prototype];
+		memcpy(mapped + (size_t)(b.first + b.written++) * INSTANCE_STRIDE, world.m, INSTANCE_STRIDE);
+	}
+
+	void draw(Core* core, const ResourceCache<StaticMesh>& prototypes, Matrix& vp, float time, const Vec3& camPos)
+	{
+		Shader* program = GPUResources::instance().shaders.get(shader);
+		if (instances == 0 || !program)
+		{
+			return;
+		}
+
+		// Shared by every batch, so written and bound once
+		core->beginRenderPass();
+		if (program->vsConstantBuffers.size() > 0)
+		{
+			program->vsConstantBuffers[0]->update("VP", &vp);
+			program->vsConstantBuffers[0]->update("time", (void*)&time);
+			program->vsConstantBuffers[0]->update("cameraPos", (void*)&camPos);
+		}
+		program->apply(core);
+		psos.bind(core, "Instanced");
+		core->commands().setVertexBuffer(1, instanceBuffer.view(instances));
+
+		for (unsigned int p = 0; p < batches.size(); p++)
+		{
+			StaticMesh* prototype = prototypes[p];
+			if (batches[p].count > 0 && prototype)
+			{
+				prototype->drawInstances(core, batches[p].first, batches[p].count);
+			}
+		}
+	}
+
+	// Shutdown, after flushGraphicsQueue()
+	void release()
+	{
+		instanceBuffer.release();
+		GPUResources::instance().release(shader);
+		shader = ShaderHandle();
+		psos.release();
+	}
+
+private:
+	static constexpr unsigned int INSTANCE_STRIDE = sizeof(float) * 16;
+
+	DynamicVertexBuffer instanceBuffer;
+	unsigned char* mapped = nullptr;
+	PSOManager psos;
+	ShaderHandle shader;
+};
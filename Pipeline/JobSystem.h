@@ -0,0 +1,544 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <chrono>
+
+class JobSystem;
+
+// Tracks a batch of jobs. Jobs started with a counter increment it and decrement it when they
+// finish; wait() returns once it reaches zero. Jobs queued with runAfter() are held on the
+// counter and submitted by whichever thread finishes the batch, so start the whole batch before
+// queueing continuations on it. A counter may be reused once done.
+class JobCounter
+{
+public:
+	// Also waits out a finishing thread that is still releasing continuations, so a done counter
+	// can safely go out of scope
+	bool done() const
+	{
+		return pending.load(std::memory_order_acquire) == 0 && finishing.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+	std::atomic<int> pending{ 0 };
+	std::atomic<int> finishing{ 0 };
+	std::atomic<struct Job*> continuations{ nullptr };
+};
+
+// A unit of work: a small callable stored inline, so submitting never touches the heap
+struct Job
+{
+	static constexpr size_t STORAGE = 64;
+
+	void (*invoke)(Job*) = nullptr;
+	JobCounter* counter = nullptr;
+	Job* next = nullptr;                  // continuation list link
+	std::atomic<bool> free{ true };       // pool slot can be reused (set once the job starts)
+	bool heap = false;                    // overflow job, deleted once started
+	alignas(std::max_align_t) unsigned char storage[STORAGE];
+};
+
+// Work-stealing scheduler. Every worker thread (and each attached external thread, such as the
+// main thread) owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom without
+// locks, while idle threads steal from the top of others' deques with a single CAS. Waiting on
+// a counter runs other jobs instead of blocking, so waits never deadlock the pool.
+class JobSystem
+{
+public:
+	static constexpr unsigned int QUEUE_CAPACITY = 4096;    // jobs in flight per thread
+	static constexpr unsigned int MAX_EXTERNAL_THREADS = 4;
+
+	// Running totals, for tuning grain sizes
+	struct Stats
+	{
+		std::atomic<unsigned long long> executed{ 0 };
+		std::atomic<unsigned long long> stolen{ 0 };
+		std::atomic<unsigned long long> overflow{ 0 };   // jobs that didn't fit a thread's ring
+	} stats;
+
+	// 'threads' counts the constructing thread, which is attached automatically, so 1 means no
+	// background workers (0 = one per hardware thread)
+	explicit JobSystem(unsigned int threads = 0)
+	{
+		if (threads == 0)
+		{
+			threads = std::thread::hardware_concurrency();
+		}
+		unsigned int workerCount = threads > 1 ? threads - 1 : 0;
+		unsigned int slots = workerCount + MAX_EXTERNAL_THREADS;
+		queues = std::vector<Queue>(slots);
+		pools = std::vector<Pool>(slots);
+		attachCurrentThread();
+
+		running.store(true);
+		workers.reserve(workerCount);
+		for (unsigned int i = 0; i < workerCount; i++)
+		{
+			unsigned int slot = MAX_EXTERNAL_THREADS + i;
+			workers.emplace_back([this, slot]() { workerLoop(slot); });
+		}
+	}
+
+	// Queued jobs that have not started are dropped; wait on their counters first
+	~JobSystem()
+	{
+		running.store(false);
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			sleepCondition.notify_all();
+		}
+		for (std::thread& t : workers)
+		{
+			t.join();
+		}
+		if (currentOwner() == this)
+		{
+			tlsSlot() = NO_SLOT;
+			tlsOwner() = nullptr;
+		}
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Threads that submit or wait must be attached (workers and the constructing thread are).
+	// Returns false if every external slot is taken; such threads run submitted jobs inline.
+	bool attachCurrentThread()
+	{
+		if (currentOwner() == this)
+		{
+			return true;
+		}
+		unsigned int used = externalSlots.load();
+		for (;;)
+		{
+			unsigned int slot = 0;
+			while (slot < MAX_EXTERNAL_THREADS && (used & (1u << slot)))
+			{
+				slot++;
+			}
+			if (slot == MAX_EXTERNAL_THREADS)
+			{
+				return false;
+			}
+			if (externalSlots.compare_exchange_weak(used, used | (1u << slot)))
+			{
+				tlsSlot() = slot;
+				tlsOwner() = this;
+				return true;
+			}
+		}
+	}
+
+	// Give the slot back before an attached thread exits. Jobs it left queued stay stealable
+	// and are picked up by the next thread to take the slot.
+	void detachCurrentThread()
+	{
+		unsigned int slot = currentSlot();
+		if (slot == NO_SLOT || slot >= MAX_EXTERNAL_THREADS)
+		{
+			return;
+		}
+		tlsSlot() = NO_SLOT;
+		tlsOwner() = nullptr;
+		externalSlots.fetch_and(~(1u << slot));
+	}
+
+	unsigned int threadCount() const
+	{
+		return (unsigned int)workers.size() + 1;
+	}
+
+	// Queue 'f' (a callable no larger than Job::STORAGE)
+	template<typename F>
+	void run(F&& f, JobCounter* counter = nullptr)
+	{
+		Job* job = makeJob(std::forward<F>(f), counter);
+		if (!job)
+		{
+			return;   // ran inline
+		}
+		submit(job);
+	}
+
+	// Queue 'f' to start once every job counted by 'dependency' has finished
+	template<typename F>
+	void runAfter(JobCounter& dependency, F&& f, JobCounter* counter = nullptr)
+	{
+		if (dependency.done())
+		{
+			run(std::forward<F>(f), counter);
+			return;
+		}
+		Job* job = makeJob(std::forward<F>(f), counter);
+		if (!job)
+		{
+			return;
+		}
+		Job* head = dependency.continuations.load(std::memory_order_relaxed);
+		do
+		{
+			job->next = head;
+		} while (!dependency.continuations.compare_exchange_weak(head, job, std::memory_order_acq_rel));
+
+		// The batch may have finished before the push; whoever takes the list submits it
+		if (dependency.pending.load(std::memory_order_acquire) == 0)
+		{
+			releaseContinuations(dependency);
+		}
+	}
+
+	// Split [0, count) into ranges of at most 'grain' items and call f(begin, end) for each.
+	// Ranges are split in halves on demand, so thieves take big pieces and owners keep locality.
+	template<typename F>
+	void parallelFor(unsigned int count, unsigned int grain, const F& f, JobCounter* counter)
+	{
+		if (grain == 0)
+		{
+			grain = 1;
+		}
+		splitRange(0, count, grain, &f, counter);
+	}
+
+	// Blocking convenience: run the loop and help until it completes
+	template<typename F>
+	void parallelFor(unsigned int count, unsigned int grain, const F& f)
+	{
+		JobCounter counter;
+		parallelFor(count, grain, f, &counter);
+		wait(counter);
+	}
+
+	// Run jobs until 'counter' reaches zero
+	void wait(const JobCounter& counter)
+	{
+		unsigned int slot = currentSlot();
+		unsigned int idle = 0;
+		while (!counter.done())
+		{
+			if (slot != NO_SLOT && runOne(slot))
+			{
+				idle = 0;
+				continue;
+			}
+			if (++idle > 64)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	static constexpr unsigned int NO_SLOT = 0xFFFFFFFF;
+
+	// Chase-Lev deque over a fixed ring (Le et al., "Correct and Efficient Work-Stealing for
+	// Weak Memory Models")
+	struct Queue
+	{
+		std::atomic<long long> top{ 0 };
+		char padTop[64];
+		std::atomic<long long> bottom{ 0 };
+		char padBottom[64];
+		std::atomic<Job*> ring[QUEUE_CAPACITY];
+
+		Queue()
+		{
+			for (unsigned int i = 0; i < QUEUE_CAPACITY; i++)
+			{
+				ring[i].store(nullptr, std::memory_order_relaxed);
+			}
+		}
+		Queue(const Queue&) : Queue() {}
+
+		// Owner only; false when full
+		bool push(Job* job)
+		{
+			long long b = bottom.load(std::memory_order_relaxed);
+			long long t = top.load(std::memory_order_acquire);
+			if (b - t >= (long long)QUEUE_CAPACITY)
+			{
+				return false;
+			}
+			ring[b & (QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);   // publishes the job to thieves
+			return true;
+		}
+
+		// Owner only
+		Job* pop()
+		{
+			long long b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long t = top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			Job* job = ring[b & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// Last item: race any thief for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		// Any thread
+		Job* steal()
+		{
+			long long t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+			{
+				return nullptr;
+			}
+			Job* job = ring[t & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return job;
+		}
+	};
+
+	// Per-thread ring of job slots; a slot is reused once its previous job has started
+	struct Pool
+	{
+		std::vector<Job> jobs;
+		unsigned int next = 0;
+
+		Pool() : jobs(QUEUE_CAPACITY) {}
+		Pool(const Pool&) : jobs(QUEUE_CAPACITY) {}
+	};
+
+	std::vector<Queue> queues;
+	std::vector<Pool> pools;
+	std::vector<std::thread> workers;
+	std::atomic<unsigned int> externalSlots{ 0 };   // bit per attached external thread
+	std::atomic<bool> running{ false };
+
+	// Idle workers sleep here; submitters only touch the mutex when someone is asleep
+	std::atomic<int> sleepers{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+
+	static unsigned int& tlsSlot()
+	{
+		thread_local unsigned int slot = NO_SLOT;
+		return slot;
+	}
+
+	static JobSystem*& tlsOwner()
+	{
+		thread_local JobSystem* owner = nullptr;
+		return owner;
+	}
+
+	static JobSystem* currentOwner()
+	{
+		return tlsOwner();
+	}
+
+	unsigned int currentSlot() const
+	{
+		return tlsOwner() == this ? tlsSlot() : NO_SLOT;
+	}
+
+	template<typename F>
+	Job* makeJob(F&& f, JobCounter* counter)
+	{
+		typedef typename std::decay<F>::type Callable;
+		static_assert(sizeof(Callable) <= Job::STORAGE, "job callable too large; capture by reference or pointer");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "job callable over-aligned");
+
+		unsigned int slot = currentSlot();
+		if (counter)
+		{
+			counter->pending.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (slot == NO_SLOT)
+		{
+			// Unattached thread: no queue to push to, so do the work now
+			Callable c(std::forward<F>(f));
+			c();
+			finish(counter);
+			return nullptr;
+		}
+
+		// Slots free up as soon as their job starts, so the ring only wraps onto a busy slot when
+		// this thread has QUEUE_CAPACITY jobs waiting (mostly continuations); spill to the heap
+		// rather than block, since the blocking job may depend on the caller
+		Pool& pool = pools[slot];
+		Job* job = &pool.jobs[pool.next];
+		if (job->free.load(std::memory_order_acquire))
+		{
+			pool.next = (pool.next + 1) & (QUEUE_CAPACITY - 1);
+			job->free.store(false, std::memory_order_relaxed);
+		}
+		else
+		{
+			job = new Job();
+			job->heap = true;
+			stats.overflow.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// The callable is moved onto the running thread's stack before it is called, which
+		// releases the slot while the job is still executing
+		new (job->storage) Callable(std::forward<F>(f));
+		job->invoke = [](Job* j) {
+			Callable* stored = reinterpret_cast<Callable*>(j->storage);
+			Callable c(std::move(*stored));
+			stored->~Callable();
+			release(j);
+			c();
+		};
+		job->counter = counter;
+		job->next = nullptr;
+		return job;
+	}
+
+	void submit(Job* job)
+	{
+		unsigned int slot = currentSlot();
+		if (slot == NO_SLOT || !queues[slot].push(job))
+		{
+			execute(job);   // queue full (or foreign thread): run it here
+			return;
+		}
+		if (sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			sleepCondition.notify_one();
+		}
+	}
+
+	void execute(Job* job)
+	{
+		JobCounter* counter = job->counter;
+		job->invoke(job);
+		stats.executed.fetch_add(1, std::memory_order_relaxed);
+		finish(counter);
+	}
+
+	static void release(Job* job)
+	{
+		if (job->heap)
+		{
+			delete job;
+		}
+		else
+		{
+			job->free.store(true, std::memory_order_release);
+		}
+	}
+
+	void finish(JobCounter* counter)
+	{
+		if (!counter)
+		{
+			return;
+		}
+		// 'finishing' keeps done() false until this thread stops touching the counter
+		counter->finishing.fetch_add(1, std::memory_order_acq_rel);
+		if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			releaseContinuations(*counter);
+		}
+		counter->finishing.fetch_sub(1, std::memory_order_release);
+	}
+
+	// Exchange hands the list to exactly one thread, so each continuation is submitted once
+	void releaseContinuations(JobCounter& counter)
+	{
+		if (counter.continuations.load(std::memory_order_relaxed) == nullptr)
+		{
+			return;
+		}
+		Job* list = counter.continuations.exchange(nullptr, std::memory_order_acq_rel);
+		while (list)
+		{
+			Job* next = list->next;
+			submit(list);
+			list = next;
+		}
+	}
+
+	// Pop our own work first, then try to steal; returns false if nothing ran
+	bool runOne(unsigned int slot)
+	{
+		Job* job = queues[slot].pop();
+		if (!job)
+		{
+			unsigned int count = (unsigned int)queues.size();
+			for (unsigned int i = 1; i < count && !job; i++)
+			{
+				job = queues[(slot + i) % count].steal();
+			}
+			if (!job)
+			{
+				return false;
+			}
+			stats.stolen.fetch_add(1, std::memory_order_relaxed);
+		}
+		execute(job);
+		return true;
+	}
+
+	void workerLoop(unsigned int slot)
+	{
+		tlsSlot() = slot;
+		tlsOwner() = this;
+		unsigned int idle = 0;
+		while (running.load(std::memory_order_relaxed))
+		{
+			if (runOne(slot))
+			{
+				idle = 0;
+				continue;
+			}
+			if (++idle < 256)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			// Sleep briefly; the timeout bounds the cost of a wakeup that raced with going to sleep
+			sleepers.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepCondition.wait_for(lock, std::chrono::milliseconds(1));
+			}
+			sleepers.fetch_sub(1);
+			idle = 0;
+		}
+	}
+
+	template<typename F>
+	void splitRange(unsigned int begin, unsigned int end, unsigned int grain, const F* f, JobCounter* counter)
+	{
+		run([this, begin, end, grain, f, counter]() {
+			unsigned int b = begin, e = end;
+			while (e - b > grain)
+			{
+				unsigned int mid = b + (e - b) / 2;
+				splitRange(mid, e, grain, f, counter);   // hand the upper half to the queue
+				e = mid;
+			}
+			(*f)(b, e);
+		}, counter);
+	}
+};
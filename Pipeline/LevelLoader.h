@@ -1,8 +1,11 @@
 #pragma once
 #include "GEMLoader.h"
 #include "StaticMesh.h"
+#include "ResourceCache.h"
 #include "core.h"
 #include "maths.h"
+#include "VirtualFileSystem.h"
+#include "TransformHierarchy.h"
 #include <vector>
 #include <string>
 #include <map>
@@ -10,99 +13,163 @@
 #include <sstream>
 #include <cmath>
 
-// Simple GameObject structure if we want to separate Data from Renderer, 
-// but for now we might just enhance StaticMesh or use it as is.
-// Actually, StaticMesh in this project seems to hold the VertexBuffer too. 
-// So cloning it for every object is wasteful if they share the same model.
-// But to keep it simple and safe given the constraints:
-// We will load a StaticMesh for each unique model file, and re-use it?
-// Or just load everything as separate objects for now (easiest to implement, though memory inefficient).
-// Let's stick to "One StaticMesh per object in level" for simplicity unless it crashes.
-// BETTER APPROACH: A ResourceManager that holds loaded Meshes, and GameObjects that reference them.
-// But let's start with a simple loader.
+// One object placement as written in level.json
+struct LevelPlacement
+{
+    std::string id;      // stable across edits; used to diff against live objects on reload
+    std::string file;
+    std::string type = "static";
+    std::string parent;  // id of the placement this one is attached to, empty for roots
+
+    // Local transform (relative to the parent when there is one)
+    Vec3 pos = Vec3(0, 0, 0);
+    Vec3 rot = Vec3(0, 0, 0);   // Euler degrees
+    Vec3 scale = Vec3(1, 1, 1);
+    Vec3 spin = Vec3(0, 0, 0);  // degrees per second, for animated parents
+    Matrix world;               // local matrix from parse; the game resolves parents into it
+};
 
 class LevelLoader
 {
 public:
-    void load(std::string filename, Core* core, std::vector<StaticMesh>& outMeshes)
+    // One shared prototype per model file, addressed by a small index (RenderHandle::prototype).
+    // Prototypes stay loaded for the lifetime of the loader so reloads never re-read models,
+    // unless they are held through acquirePrototype: those are freed when the last holder
+    // releases them (level streaming), and their index is reused.
+    ResourceCache<StaticMesh> prototypes;
+
+    unsigned int getPrototypeIndex(Core* core, const std::string& modelFile)
     {
-        // read file
-        std::ifstream file(filename);
-        if (!file.is_open()) return;
+        int found = prototypes.find(modelFile);
+        if (found >= 0) return (unsigned int)found;
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string jsonString = buffer.str();
+        StaticMesh* proto = new StaticMesh();
+        if (!proto->loadMeshes(core, modelFile)) reportBadModel(modelFile);
+        return prototypes.add(modelFile, proto);
+    }
+
+    // -1 when the model isn't loaded
+    int findPrototype(const std::string& modelFile) const
+    {
+        return prototypes.find(modelFile);
+    }
+
+    // Takes a reference, loading the model if needed. 'decoded' (read and parsed off-thread)
+    // replaces the file read when the model isn't loaded yet; a model that failed to decode is
+    // logged and kept as an empty prototype rather than read again here.
+    unsigned int acquirePrototype(Core* core, const std::string& modelFile, StaticMesh::Decoded* decoded = nullptr)
+    {
+        int index = prototypes.find(modelFile);
+        if (index < 0 && decoded) {
+            StaticMesh* proto = new StaticMesh();
+            if (decoded->ok) proto->create(core, *decoded);
+            else reportBadModel(modelFile);
+            index = (int)prototypes.add(modelFile, proto);
+        }
+        if (index < 0) index = (int)getPrototypeIndex(core, modelFile);
+        prototypes.acquire((unsigned int)index);
+        return (unsigned int)index;
+    }
+
+    // Drops a reference; the last one frees the prototype (its GPU objects once in-flight frames finish)
+    void releasePrototype(unsigned int index)
+    {
+        prototypes.release(index);
+    }
+
+    // Mesh buffers and collision data of every loaded prototype
+    size_t residentBytes() const
+    {
+        size_t bytes = 0;
+        prototypes.forEach([&](const StaticMesh& proto) { bytes += proto.residentBytes(); });
+        return bytes;
+    }
+
+    // Parse placements only (no GPU work). 'loose' bypasses mounted packs for hot reload.
+    bool parse(const std::string& filename, std::vector<LevelPlacement>& outPlacements, bool loose = false)
+    {
+        // read file (pack or loose)
+        std::string jsonString;
+        VirtualFileSystem& vfs = VirtualFileSystem::instance();
+        if (!(loose ? vfs.readLooseFile(filename, jsonString) : vfs.readFile(filename, jsonString))) return false;
 
         // parse JSON
         GEMLoader::GEMJsonParser parser;
         GEMLoader::GEMJson json = parser.parse(jsonString);
 
-        // simple cache for prototypes keyed by filename
-        std::map<std::string, StaticMesh> prototypeCache;
-
-        if (json.vDict.find("objects") != json.vDict.end()) {
-            std::vector<GEMLoader::GEMJson> objects = json.vDict["objects"].vArr;
-            for (auto& obj : objects) {
-                std::string modelFile = obj.vDict["file"].vStr;
-
-                // get or load prototype
-                if (prototypeCache.find(modelFile) == prototypeCache.end()) {
-                    StaticMesh proto;
-                    proto.loadMeshes(core, modelFile);
-                    prototypeCache[modelFile] = proto;
-                }
-
-                // clone prototype metadata into instance (shallow copy is fine for meshes vector pointers)
-                StaticMesh instance = prototypeCache[modelFile];
-
-                // Transform: position, rotation (degrees), scale
-                Vec3 pos(0,0,0);
-                if (obj.vDict.find("pos") != obj.vDict.end()) {
-                    auto p = obj.vDict["pos"].vArr;
-                    if(p.size() >= 3) pos = Vec3(p[0].vFloat, p[1].vFloat, p[2].vFloat);
-                }
-
-                Vec3 rot(0,0,0); // Euler degrees
-                if (obj.vDict.find("rot") != obj.vDict.end()) {
-                    auto r = obj.vDict["rot"].vArr;
-                    if (r.size() >= 3) rot = Vec3(r[0].vFloat, r[1].vFloat, r[2].vFloat);
-                } else if (obj.vDict.find("rotation") != obj.vDict.end()) {
-                    auto r = obj.vDict["rotation"].vArr;
-                    if (r.size() >= 3) rot = Vec3(r[0].vFloat, r[1].vFloat, r[2].vFloat);
-                }
-
-                Vec3 scale(1,1,1);
-                if (obj.vDict.find("scale") != obj.vDict.end()) {
-                    auto s = obj.vDict["scale"].vArr;
-                    if(s.size() >= 3) scale = Vec3(s[0].vFloat, s[1].vFloat, s[2].vFloat);
-                }
-
-                if (obj.vDict.find("type") != obj.vDict.end()) {
-                    instance.type = obj.vDict["type"].vStr;
-                }
-
-                // Build scale, rotation (Z Y X), translation matrices and compose as World = T * R * S
-                Matrix sMat; sMat.setIdentity(); sMat.scaling(scale);
-
-                // rotation degrees -> radians
-                float rx = rot.x * PI_F / 180.0f;
-                float ry = rot.y * PI_F / 180.0f;
-                float rz = rot.z * PI_F / 180.0f;
-
-                Matrix rotX; rotX.setIdentity(); rotX.rotAroundX(rx);
-                Matrix rotY; rotY.setIdentity(); rotY.rotAroundY(ry);
-                Matrix rotZ; rotZ.setIdentity(); rotZ.rotAroundZ(rz);
-
-                // R = Rz * Ry * Rx
-                Matrix rMat = rotZ.multiply(rotY.multiply(rotX));
-
-                Matrix tMat; tMat.setIdentity(); tMat.translation(pos);
-
-                instance.worldMatrix = tMat.multiply(rMat.multiply(sMat));
-
-                outMeshes.push_back(instance);
-            }
+        auto objectsIt = json.vDict.find("objects");
+        if (objectsIt == json.vDict.end()) return false;
+
+        const std::vector<GEMLoader::GEMJson>& objects = objectsIt->second.vArr;
+        outPlacements.reserve(objects.size());
+        for (size_t i = 0; i < objects.size(); i++) {
+            const std::map<std::string, GEMLoader::GEMJson>& obj = objects[i].vDict;
+            LevelPlacement placement;
+
+            auto fileIt = obj.find("file");
+            if (fileIt != obj.end()) placement.file = fileIt->second.vStr;
+
+            // Objects without an explicit id fall back to their index, which is only stable
+            // as long as nothing is inserted before them
+            auto idIt = obj.find("id");
+            placement.id = (idIt != obj.end()) ? idIt->second.asStr() : "#" + std::to_string(i);
+
+            auto typeIt = obj.find("type");
+            if (typeIt != obj.end()) placement.type = typeIt->second.vStr;
+
+            auto parentIt = obj.find("parent");
+            if (parentIt != obj.end()) placement.parent = parentIt->second.asStr();
+
+            // Transform: position, rotation (degrees), scale
+            placement.pos = readVec3(obj, "pos", Vec3(0, 0, 0));
+            placement.rot = readVec3(obj, obj.find("rot") != obj.end() ? "rot" : "rotation", Vec3(0, 0, 0)); // Euler degrees
+            placement.scale = readVec3(obj, "scale", Vec3(1, 1, 1));
+            placement.spin = readVec3(obj, "spin", Vec3(0, 0, 0));
+            placement.world = composeWorld(placement.pos, placement.rot, placement.scale);
+
+            outPlacements.push_back(placement);
         }
+        return true;
+    }
+
+    // A placement as an instance of a shared prototype: an index plus a transform
+    struct Instance
+    {
+        unsigned int prototype;
+        Matrix world;
+    };
+
+    // Parse and resolve prototypes in one go, for callers that don't need the placement data
+    void load(const std::string& filename, Core* core, std::vector<Instance>& outInstances)
+    {
+        std::vector<LevelPlacement> placements;
+        if (!parse(filename, placements)) return;
+
+        outInstances.reserve(outInstances.size() + placements.size());
+        for (auto& placement : placements) {
+            outInstances.push_back({ getPrototypeIndex(core, placement.file), placement.world });
+        }
+    }
+
+    // World = T * R * S with R = Rz * Ry * Rx
+    static Matrix composeWorld(const Vec3& pos, const Vec3& rot, const Vec3& scale)
+    {
+        return TransformHierarchy::compose(pos, rot, scale);
+    }
+
+private:
+    static Vec3 readVec3(const std::map<std::string, GEMLoader::GEMJson>& obj, const char* key, const Vec3& fallback)
+    {
+        auto it = obj.find(key);
+        if (it == obj.end() || it->second.vArr.size() < 3) return fallback;
+        const std::vector<GEMLoader::GEMJson>& v = it->second.vArr;
+        return Vec3(v[0].vFloat, v[1].vFloat, v[2].vFloat);
+    }
+
+    // The placements still spawn and collide as nothing; the level keeps running
+    static void reportBadModel(const std::string& modelFile)
+    {
+        std::string message = modelFile + " is missing or not a valid GE Model File; drawing nothing for it\n";
+        OutputDebugStringA(message.c_str());
     }
 };
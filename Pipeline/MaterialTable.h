@@ -0,0 +1,253 @@
+#pragma once
+#include "GEMLoader.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+
+// Interns strings (property names, texture paths) into small integer IDs.
+// ID 0 is reserved for "none" so a zeroed record means "unset".
+class StringInterner
+{
+public:
+	static constexpr unsigned int NONE = 0;
+
+	StringInterner()
+	{
+		strings.push_back("");
+	}
+
+	unsigned int intern(const std::string& str)
+	{
+		if (str.empty())
+		{
+			return NONE;
+		}
+		auto it = ids.find(str);
+		if (it != ids.end())
+		{
+			return it->second;
+		}
+		unsigned int id = (unsigned int)strings.size();
+		strings.push_back(str);
+		ids.insert({ str, id });
+		return id;
+	}
+
+	// Returns NONE if the string has never been interned
+	unsigned int find(const std::string& str) const
+	{
+		auto it = ids.find(str);
+		return (it != ids.end()) ? it->second : NONE;
+	}
+
+	const std::string& lookup(unsigned int id) const
+	{
+		return strings[id < strings.size() ? id : NONE];
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)strings.size();
+	}
+
+private:
+	std::vector<std::string> strings;
+	std::unordered_map<std::string, unsigned int> ids;
+};
+
+// Texture slots in a packed material, matching the property names written by the GEM exporter
+enum MaterialTextureSlot
+{
+	MATERIAL_TEXTURE_ALBEDO = 0,
+	MATERIAL_TEXTURE_NORMAL_HEIGHT,
+	MATERIAL_TEXTURE_RMAX,
+	MATERIAL_TEXTURE_COUNT
+};
+
+enum MaterialScalarSlot
+{
+	MATERIAL_SCALAR_ROUGHNESS = 0,
+	MATERIAL_SCALAR_METALLIC,
+	MATERIAL_SCALAR_ALPHA_CUTOFF,
+	MATERIAL_SCALAR_COUNT
+};
+
+enum MaterialFlags
+{
+	MATERIAL_FLAG_NONE = 0,
+	MATERIAL_FLAG_ALPHA_TEST = 1 << 0,
+	MATERIAL_FLAG_TWO_SIDED = 1 << 1,
+	MATERIAL_FLAG_NORMAL_MAP = 1 << 2
+};
+
+// Typed, fixed-size material record. Compared bytewise for deduplication, so it
+// holds no pointers or padding that could differ between identical materials.
+struct PackedMaterial
+{
+	unsigned int textures[MATERIAL_TEXTURE_COUNT]; // interned texture paths, 0 = none
+	float scalars[MATERIAL_SCALAR_COUNT];
+	unsigned int flags;
+
+	PackedMaterial()
+	{
+		memset(this, 0, sizeof(PackedMaterial));
+		scalars[MATERIAL_SCALAR_ROUGHNESS] = 1.0f;
+		scalars[MATERIAL_SCALAR_ALPHA_CUTOFF] = 0.5f;
+	}
+
+	bool operator==(const PackedMaterial& other) const
+	{
+		return memcmp(this, &other, sizeof(PackedMaterial)) == 0;
+	}
+};
+
+// Compiles GEMMaterial property lists into deduplicated PackedMaterials once at import.
+// Draws then refer to a material by its small integer ID instead of re-scanning strings.
+class MaterialTable
+{
+public:
+	typedef unsigned short MaterialID;
+
+	enum PropertyKind
+	{
+		PROPERTY_TEXTURE,
+		PROPERTY_SCALAR,
+		PROPERTY_FLAG
+	};
+
+	struct PropertyBinding
+	{
+		PropertyKind kind;
+		unsigned int slot; // texture/scalar slot, or flag bit
+	};
+
+	StringInterner names;     // property names
+	StringInterner textures;  // texture paths
+	std::vector<PackedMaterial> materials;
+
+	unsigned int compiledCount = 0;   // materials passed to compile()
+	unsigned int unknownProperties = 0;
+
+	MaterialTable()
+	{
+		registerProperty("albedo", PROPERTY_TEXTURE, MATERIAL_TEXTURE_ALBEDO);
+		registerProperty("diffuse", PROPERTY_TEXTURE, MATERIAL_TEXTURE_ALBEDO);
+		registerProperty("nh", PROPERTY_TEXTURE, MATERIAL_TEXTURE_NORMAL_HEIGHT);
+		registerProperty("normals", PROPERTY_TEXTURE, MATERIAL_TEXTURE_NORMAL_HEIGHT);
+		registerProperty("rmax", PROPERTY_TEXTURE, MATERIAL_TEXTURE_RMAX);
+		registerProperty("roughness", PROPERTY_SCALAR, MATERIAL_SCALAR_ROUGHNESS);
+		registerProperty("metallic", PROPERTY_SCALAR, MATERIAL_SCALAR_METALLIC);
+		registerProperty("alphaCutoff", PROPERTY_SCALAR, MATERIAL_SCALAR_ALPHA_CUTOFF);
+		registerProperty("alphaTest", PROPERTY_FLAG, MATERIAL_FLAG_ALPHA_TEST);
+		registerProperty("twoSided", PROPERTY_FLAG, MATERIAL_FLAG_TWO_SIDED);
+
+		// ID 0 is the default material, used by meshes that carry no properties
+		materials.push_back(PackedMaterial());
+		lookup.insert({ hashMaterial(materials[0]), 0 });
+	}
+
+	// Shared table so identical materials dedupe across every loaded model file
+	static MaterialTable& instance()
+	{
+		static MaterialTable table;
+		return table;
+	}
+
+	void registerProperty(const std::string& name, PropertyKind kind, unsigned int slot)
+	{
+		unsigned int id = names.intern(name);
+		if (id >= bindings.size())
+		{
+			bindings.resize(id + 1, { PROPERTY_TEXTURE, INVALID_SLOT });
+		}
+		bindings[id] = { kind, slot };
+	}
+
+	// Parse every property exactly once and return the ID of the matching packed record
+	MaterialID compile(const GEMLoader::GEMMaterial& material)
+	{
+		PackedMaterial packed;
+		for (const GEMLoader::GEMProperty& prop : material.properties)
+		{
+			unsigned int id = names.find(prop.name);
+			if (id == StringInterner::NONE || id >= bindings.size() || bindings[id].slot == INVALID_SLOT)
+			{
+				unknownProperties++;
+				continue;
+			}
+			const PropertyBinding& binding = bindings[id];
+			GEMLoader::GEMProperty value;
+			switch (binding.kind)
+			{
+			case PROPERTY_TEXTURE:
+				packed.textures[binding.slot] = textures.intern(prop.value);
+				break;
+			case PROPERTY_SCALAR:
+				value.value = prop.value;
+				packed.scalars[binding.slot] = value.getValue(packed.scalars[binding.slot]);
+				break;
+			case PROPERTY_FLAG:
+				value.value = prop.value;
+				if (value.getValue(0) != 0 || prop.value == "true")
+				{
+					packed.flags |= binding.slot;
+				}
+				break;
+			}
+		}
+		if (packed.textures[MATERIAL_TEXTURE_NORMAL_HEIGHT] != StringInterner::NONE)
+		{
+			packed.flags |= MATERIAL_FLAG_NORMAL_MAP;
+		}
+		compiledCount++;
+		return add(packed);
+	}
+
+	// Insert a packed record, returning the existing ID if an identical one is present
+	MaterialID add(const PackedMaterial& packed)
+	{
+		size_t hash = hashMaterial(packed);
+		auto range = lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (materials[it->second] == packed)
+			{
+				return it->second;
+			}
+		}
+		MaterialID id = (MaterialID)materials.size();
+		materials.push_back(packed);
+		lookup.insert({ hash, id });
+		return id;
+	}
+
+	const PackedMaterial& get(MaterialID id) const
+	{
+		return materials[id];
+	}
+
+	unsigned int uniqueCount() const
+	{
+		return (unsigned int)materials.size();
+	}
+
+private:
+	static constexpr unsigned int INVALID_SLOT = 0xFFFFFFFF;
+
+	std::vector<PropertyBinding> bindings; // indexed by interned property name
+	std::unordered_multimap<size_t, MaterialID> lookup;
+
+	// FNV-1a over the raw record bytes
+	static size_t hashMaterial(const PackedMaterial& packed)
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&packed);
+		unsigned long long hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(PackedMaterial); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return (size_t)hash;
+	}
+};
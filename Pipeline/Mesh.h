@@ -1,69 +1,41 @@
 #pragma once
 #include "core.h"
 #include "Static_Vertex.h"
+#include "GPUBufferHeap.h"
 
 class Mesh
 {
 public:
-	// Vertex Buffer
-	ID3D12Resource* vertexBuffer;      // vertex buffer member variable
+	// Vertex and index data, sub-allocated from the shared buffer heap
+	GPUBufferRange vertexRange;
+	GPUBufferRange indexRange;
 	D3D12_VERTEX_BUFFER_VIEW vbView;   // view member variable
 	D3D12_INPUT_ELEMENT_DESC inputLayout[2];     // Vec3 and colour, so 2
 	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;     // overall description of layout, array of invididual elements
 
 	// Index Buffer
-	ID3D12Resource* indexBuffer;
 	D3D12_INDEX_BUFFER_VIEW ibView;
 	unsigned int numMeshIndices;
 
 	void init(Core* core, void* vertices, int vertexSizeInBytes, int numVertices, unsigned int* indices, int numIndices)   // number of bytes per vertex and number of vertices
 	{
-		D3D12_HEAP_PROPERTIES heapprops = {};
-		heapprops.Type = D3D12_HEAP_TYPE_DEFAULT;
-		heapprops.CreationNodeMask = 1;                  // only one GPU
-		heapprops.VisibleNodeMask = 1;
+		GPUBufferHeap& heap = GPUBufferHeap::instance();
 
-		// Create vertex buffer on the heap
-		D3D12_RESOURCE_DESC vbDesc = {};
-		vbDesc.Width = numVertices * vertexSizeInBytes;
-		vbDesc.Height = 1;
-		vbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		vbDesc.DepthOrArraySize = 1;
-		vbDesc.MipLevels = 1;
-		vbDesc.SampleDesc.Count = 1;
-		vbDesc.SampleDesc.Quality = 0;
-		vbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		// Index buffer range, filled through the copy queue
+		indexRange = heap.allocate(core, numIndices * sizeof(unsigned int));
+		core->uploadBuffer(indexRange.resource, indexRange.allocation.offset, indices, numIndices * sizeof(unsigned int));
 
-		// Create index buffer on the heap
-		D3D12_RESOURCE_DESC ibDesc;
-		memset(&ibDesc, 0, sizeof(D3D12_RESOURCE_DESC));
-		ibDesc.Width = numIndices * sizeof(unsigned int);
-		ibDesc.Height = 1;
-		ibDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		ibDesc.DepthOrArraySize = 1;
-		ibDesc.MipLevels = 1;
-		ibDesc.SampleDesc.Count = 1;
-		ibDesc.SampleDesc.Quality = 0;
-		ibDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		HRESULT hr;
-		hr = core->device->CreateCommittedResource(&heapprops, D3D12_HEAP_FLAG_NONE, &ibDesc,
-			D3D12_RESOURCE_STATE_COMMON, NULL, IID_PPV_ARGS(&indexBuffer));
-		core->uploadResource(indexBuffer, indices, numIndices * sizeof(unsigned int),
-			D3D12_RESOURCE_STATE_INDEX_BUFFER);
-
-		// Allocatre memory
-		core->device->CreateCommittedResource(&heapprops, D3D12_HEAP_FLAG_NONE, &vbDesc, D3D12_RESOURCE_STATE_COMMON, NULL, IID_PPV_ARGS(&vertexBuffer));
-
-		// Copy vertices using our helper function
-		core->uploadResource(vertexBuffer, vertices, numVertices * vertexSizeInBytes, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		// Vertex buffer range
+		vertexRange = heap.allocate(core, numVertices * vertexSizeInBytes);
+		core->uploadBuffer(vertexRange.resource, vertexRange.allocation.offset, vertices, numVertices * vertexSizeInBytes);
 
 		// Fill in vertex buffer view in helper function
-		vbView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+		vbView.BufferLocation = vertexRange.address();
 		vbView.StrideInBytes = vertexSizeInBytes;                         // how big each vertex is
 		vbView.SizeInBytes = numVertices * vertexSizeInBytes;
 
 		// Fill in index buiffer view in helper function
-		ibView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+		ibView.BufferLocation = indexRange.address();
 		ibView.Format = DXGI_FORMAT_R32_UINT;
 		ibView.SizeInBytes = numIndices * sizeof(unsigned int);
 		numMeshIndices = numIndices;
@@ -78,14 +50,36 @@ public:
 	// WHAT TO DRAW
 	// Add commands for drawing
 	// Specify type of geometry, where the geometry is (the view), issue command to draw
-	void draw(Core* core)
+	void draw(Core* core, unsigned int instanceCount = 1, unsigned int startInstance = 0)
+	{
+		CommandRecorder& commands = core->commands();
+		VertexBufferView vb;
+		vb.address = vbView.BufferLocation;
+		vb.sizeInBytes = vbView.SizeInBytes;
+		vb.strideInBytes = vbView.StrideInBytes;
+		IndexBufferView ib;
+		ib.address = ibView.BufferLocation;
+		ib.sizeInBytes = ibView.SizeInBytes;
+		ib.format = ibView.Format;
+		commands.setTopology(TOPOLOGY_TRIANGLE_LIST);
+		commands.setVertexBuffer(0, vb);
+		commands.setIndexBuffer(ib);
+		commands.drawIndexed(numMeshIndices, instanceCount, 0, 0, startInstance);
+	}
+
+
+	// GPU memory held by the vertex and index buffers
+	size_t gpuBytes() const
 	{
-		core->getCommandList()->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		core->getCommandList()->IASetVertexBuffers(0, 1, &vbView);
-		core->getCommandList()->IASetIndexBuffer(&ibView);
-		core->getCommandList()->DrawIndexedInstanced(numMeshIndices, 1, 0, 0, 0);
+		return (size_t)vbView.SizeInBytes + ibView.SizeInBytes;
 	}
 
+	// Returns the ranges to the heap; the GPU must be done with them
+	void release()
+	{
+		GPUBufferHeap::instance().free(vertexRange);
+		GPUBufferHeap::instance().free(indexRange);
+	}
 
 	// Overload function
 	void init(Core* core, std::vector<STATIC_VERTEX> vertices, std::vector<unsigned int> indices)
@@ -0,0 +1,946 @@
+#pragma once
+#include "GEMLoader.h"
+#include "maths.h"
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define MESHBVH_SSE 1
+#endif
+
+// Triangle BVH for one model, built once in model space and shared by every instance that draws
+// the model. A binned-SAH binary tree is collapsed into 4-wide nodes stored as SoA boxes, so one
+// SSE slab or distance test covers all four children. Queries take either model-space inputs or
+// an instance transform.
+class MeshBVH
+{
+public:
+	struct RayHit
+	{
+		float t = FLT_MAX;          // along the (unnormalised) ray direction
+		unsigned int triangle = 0;  // index into the source index buffer / 3
+		float u = 0.0f, v = 0.0f;   // barycentrics of vertex 1 and 2
+	};
+
+	// First contact of a moving sphere
+	struct SweepHit
+	{
+		float t = 1.0f;             // fraction of the displacement travelled before contact
+		Vec3 normal;                // from the contact point towards the sphere centre
+		Vec3 point;                 // contact point on the surface
+		unsigned int triangle = 0;
+	};
+
+	struct PointHit
+	{
+		Vec3 point;
+		float distanceSquared = FLT_MAX;
+		unsigned int triangle = 0;
+	};
+
+	// Four child boxes side by side; a child is a node index (>= 0), a leaf (~(first << 4 | count))
+	// or EMPTY
+	struct Node4
+	{
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		int child[4];
+	};
+
+	std::vector<Node4> nodes;
+
+	unsigned int triangleCount() const
+	{
+		return (unsigned int)triIndex.size();
+	}
+
+	bool empty() const
+	{
+		return triIndex.empty();
+	}
+
+	// Heap memory held by the tree, for streaming budgets
+	size_t memoryBytes() const
+	{
+		return nodes.capacity() * sizeof(Node4) + tris.capacity() * sizeof(Tri) + triIndex.capacity() * sizeof(unsigned int);
+	}
+
+	void build(const std::vector<Vec3>& positions, const std::vector<unsigned int>& indices)
+	{
+		unsigned int count = (unsigned int)(indices.size() / 3);
+		nodes.clear();
+		tris.clear();
+		triIndex.clear();
+		if (count == 0)
+		{
+			return;
+		}
+
+		// Triangle boxes and centroids for the binary build
+		std::vector<BuildTri> build(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const Vec3& a = positions[indices[i * 3 + 0]];
+			const Vec3& b = positions[indices[i * 3 + 1]];
+			const Vec3& c = positions[indices[i * 3 + 2]];
+			build[i].min = Vec3::Min(a, Vec3::Min(b, c));
+			build[i].max = Vec3::Max(a, Vec3::Max(b, c));
+			build[i].centre = (build[i].min + build[i].max) * 0.5f;
+			build[i].index = i;
+		}
+		std::vector<BinaryNode> binary;
+		binary.reserve(2 * count);
+		binary.push_back(BinaryNode());
+		binary[0].first = 0;
+		binary[0].count = count;
+		subdivide(binary, build, 0);
+
+		// Triangles in leaf order, as v0 plus two edges for the ray test
+		tris.resize(count);
+		triIndex.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int t = build[i].index;
+			const Vec3& a = positions[indices[t * 3 + 0]];
+			tris[i].v0 = a;
+			tris[i].e1 = positions[indices[t * 3 + 1]] - a;
+			tris[i].e2 = positions[indices[t * 3 + 2]] - a;
+			triIndex[i] = t;
+		}
+
+		nodes.reserve(binary.size() / 2 + 1);
+		collapse(binary, 0);
+	}
+
+	// Convenience for GEM models: all static submeshes merged into one tree
+	void build(const std::vector<GEMLoader::GEMMesh>& meshes)
+	{
+		std::vector<Vec3> positions;
+		std::vector<unsigned int> indices;
+		for (const GEMLoader::GEMMesh& mesh : meshes)
+		{
+			unsigned int base = (unsigned int)positions.size();
+			for (const GEMLoader::GEMStaticVertex& v : mesh.verticesStatic)
+			{
+				positions.push_back(Vec3(v.position.x, v.position.y, v.position.z));
+			}
+			for (unsigned int index : mesh.indices)
+			{
+				indices.push_back(base + index);
+			}
+		}
+		build(positions, indices);
+	}
+
+	// Closest hit along origin + t * dir for t in [0, maxT]
+	bool raycast(const Vec3& origin, const Vec3& dir, float maxT, RayHit& hit) const
+	{
+		if (nodes.empty())
+		{
+			return false;
+		}
+		hit.t = maxT;
+		bool found = false;
+		Vec3 inv(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+		StackEntry stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = { 0, 0.0f };
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			if (entry.tNear > hit.t)
+			{
+				continue;   // a closer hit was found since this was pushed
+			}
+			const Node4& node = nodes[entry.node];
+			float tNear[4];
+			int mask = rayBoxes(node, origin, inv, hit.t, tNear) & occupied(node);
+
+			// Push hit children far-to-near so the nearest is popped first
+			int order[4];
+			int hits = sortChildren(mask, tNear, order);
+			for (int k = 0; k < hits; k++)
+			{
+				int c = order[k];
+				int child = node.child[c];
+				if (child >= 0)
+				{
+					if (top < STACK_SIZE)
+					{
+						stack[top++] = { child, tNear[c] };
+					}
+					continue;
+				}
+				unsigned int first = leafFirst(child);
+				unsigned int end = first + leafCount(child);
+				for (unsigned int i = first; i < end; i++)
+				{
+					found |= rayTriangle(tris[i], origin, dir, i, hit);
+				}
+			}
+		}
+		if (found)
+		{
+			hit.triangle = triIndex[hit.triangle];
+		}
+		return found;
+	}
+
+	// Closest point on the mesh to 'p' within 'maxDistance'
+	bool closestPoint(const Vec3& p, float maxDistance, PointHit& hit) const
+	{
+		if (nodes.empty())
+		{
+			return false;
+		}
+		hit.distanceSquared = maxDistance * maxDistance;
+		bool found = false;
+		StackEntry stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = { 0, 0.0f };
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			if (entry.tNear > hit.distanceSquared)
+			{
+				continue;
+			}
+			const Node4& node = nodes[entry.node];
+			float d2[4];
+			int mask = pointBoxes(node, p, hit.distanceSquared, d2) & occupied(node);
+
+			// Visit the nearest box first so the search radius shrinks early
+			int order[4];
+			int hits = sortChildren(mask, d2, order);
+			for (int k = 0; k < hits; k++)
+			{
+				int c = order[k];
+				int child = node.child[c];
+				if (child >= 0)
+				{
+					if (top < STACK_SIZE)
+					{
+						stack[top++] = { child, d2[c] };
+					}
+					continue;
+				}
+				unsigned int first = leafFirst(child);
+				unsigned int end = first + leafCount(child);
+				for (unsigned int i = first; i < end; i++)
+				{
+					Vec3 q = closestOnTriangle(tris[i], p);
+					float d = (q - p).lengthSquared();
+					if (d <= hit.distanceSquared)
+					{
+						hit.distanceSquared = d;
+						hit.point = q;
+						hit.triangle = triIndex[i];
+						found = true;
+					}
+				}
+			}
+		}
+		return found;
+	}
+
+	// Does any triangle come within 'radius' of 'centre'? Stops at the first one found.
+	bool overlapsSphere(const Vec3& centre, float radius) const
+	{
+		if (nodes.empty())
+		{
+			return false;
+		}
+		float r2 = radius * radius;
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node4& node = nodes[stack[--top]];
+			float d2[4];
+			int mask = pointBoxes(node, centre, r2, d2) & occupied(node);
+			for (int c = 0; c < 4; c++)
+			{
+				if (!(mask & (1 << c)))
+				{
+					continue;
+				}
+				int child = node.child[c];
+				if (child >= 0)
+				{
+					if (top < STACK_SIZE)
+					{
+						stack[top++] = child;
+					}
+					continue;
+				}
+				unsigned int first = leafFirst(child);
+				unsigned int end = first + leafCount(child);
+				for (unsigned int i = first; i < end; i++)
+				{
+					if ((closestOnTriangle(tris[i], centre) - centre).lengthSquared() <= r2)
+					{
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	// Earliest contact of a sphere moving from 'centre' by 'delta'. Boxes are grown by the radius
+	// and tested like a ray; triangles are tested against face, edges and vertices. A sphere that
+	// starts overlapping a triangle only collides if it is moving further into it.
+	bool sphereCast(const Vec3& centre, const Vec3& delta, float radius, SweepHit& hit) const
+	{
+		if (nodes.empty())
+		{
+			return false;
+		}
+		hit.t = 1.0f;
+		bool found = false;
+		Vec3 inv(1.0f / delta.x, 1.0f / delta.y, 1.0f / delta.z);
+		StackEntry stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = { 0, 0.0f };
+		while (top > 0)
+		{
+			StackEntry entry = stack[--top];
+			if (entry.tNear > hit.t)
+			{
+				continue;
+			}
+			const Node4& node = nodes[entry.node];
+			float tNear[4];
+			int mask = rayBoxes(node, centre, inv, hit.t, tNear, radius) & occupied(node);
+			int order[4];
+			int hits = sortChildren(mask, tNear, order);
+			for (int k = 0; k < hits; k++)
+			{
+				int c = order[k];
+				int child = node.child[c];
+				if (child >= 0)
+				{
+					if (top < STACK_SIZE)
+					{
+						stack[top++] = { child, tNear[c] };
+					}
+					continue;
+				}
+				unsigned int first = leafFirst(child);
+				unsigned int end = first + leafCount(child);
+				for (unsigned int i = first; i < end; i++)
+				{
+					if (sweepTriangle(tris[i], centre, delta, radius, hit))
+					{
+						hit.triangle = triIndex[i];
+						found = true;
+					}
+				}
+			}
+		}
+		return found;
+	}
+
+	// Instance queries: the query is moved into model space with the inverse instance transform.
+	// Ray t is unchanged by an affine transform, so hits compare directly between instances.
+	bool raycastInstance(const Matrix& invWorld, const Vec3& origin, const Vec3& dir, float maxT, RayHit& hit) const
+	{
+		Vec3 localOrigin = invWorld.mulPoint(origin);
+		Vec3 localDir = invWorld.mulVec(dir);
+		return raycast(localOrigin, localDir, maxT, hit);
+	}
+
+	// Sweep in world units. Exact for uniformly scaled instances; under non-uniform scale the
+	// sphere is grown to the largest axis. The hit normal and point come back in world space.
+	bool sphereCastInstance(const Matrix& world, const Matrix& invWorld, const Vec3& centre, const Vec3& delta, float radius, SweepHit& hit) const
+	{
+		SweepHit local;
+		local.t = hit.t;
+		if (!sphereCast(invWorld.mulPoint(centre), invWorld.mulVec(delta), radius * maxAxisScale(invWorld), local) || local.t >= hit.t)
+		{
+			return false;
+		}
+		// Normals transform by the inverse transpose
+		const float* m = invWorld.m;
+		Vec3 n = local.normal;
+		hit.normal = Vec3(m[0] * n.x + m[4] * n.y + m[8] * n.z,
+			m[1] * n.x + m[5] * n.y + m[9] * n.z,
+			m[2] * n.x + m[6] * n.y + m[10] * n.z).normalize();
+		hit.point = world.mulPoint(local.point);
+		hit.t = local.t;
+		hit.triangle = local.triangle;
+		return true;
+	}
+
+	// 'radius' is in world units; under non-uniform scale the sphere is tested conservatively
+	bool overlapsSphereInstance(const Matrix& invWorld, const Vec3& centre, float radius) const
+	{
+		return overlapsSphere(invWorld.mulPoint(centre), radius * maxAxisScale(invWorld));
+	}
+
+	// Returns the closest point in world space. Under non-uniform scale it is the closest in model
+	// space, so it may not be the nearest in world space; it is always found when some surface point
+	// lies within maxDistance / (maxAxisScale(world) * maxAxisScale(invWorld)).
+	bool closestPointInstance(const Matrix& world, const Matrix& invWorld, const Vec3& p, float maxDistance, PointHit& hit) const
+	{
+		if (!closestPoint(invWorld.mulPoint(p), maxDistance * maxAxisScale(invWorld), hit))
+		{
+			return false;
+		}
+		hit.point = world.mulPoint(hit.point);
+		hit.distanceSquared = (hit.point - p).lengthSquared();
+		return hit.distanceSquared <= maxDistance * maxDistance;
+	}
+
+	// Largest factor by which the 3x3 part of 'm' stretches any vector: its largest singular value,
+	// the square root of the largest eigenvalue of A^T A (closed form for symmetric 3x3). Row or
+	// column norms fall short of it once a non-uniform scale is rotated.
+	static float maxAxisScale(const Matrix& m)
+	{
+		double a[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				a[r][c] = m.m[r * 4 + c];
+			}
+		}
+		double b[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				b[r][c] = a[0][r] * a[0][c] + a[1][r] * a[1][c] + a[2][r] * a[2][c];
+			}
+		}
+		double off = b[0][1] * b[0][1] + b[0][2] * b[0][2] + b[1][2] * b[1][2];
+		double q = (b[0][0] + b[1][1] + b[2][2]) / 3.0;
+		double d0 = b[0][0] - q, d1 = b[1][1] - q, d2 = b[2][2] - q;
+		double p = sqrt((d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * off) / 6.0);
+		double largest = q;
+		if (p > 1e-12 * (q > 1.0 ? q : 1.0))
+		{
+			// Eigenvalues of B are q + 2p cos(phi + 2k pi / 3), phi from det((B - qI) / p) / 2
+			double det = d0 * (d1 * d2 - b[1][2] * b[1][2]) - b[0][1] * (b[0][1] * d2 - b[1][2] * b[0][2]) + b[0][2] * (b[0][1] * b[1][2] - d1 * b[0][2]);
+			double r = det / (2.0 * p * p * p);
+			r = r < -1.0 ? -1.0 : (r > 1.0 ? 1.0 : r);
+			largest = q + 2.0 * p * cos(acos(r) / 3.0);
+		}
+		// A hair over, so rounding never makes the bound too small
+		return (float)(sqrt(largest > 0.0 ? largest : 0.0) * (1.0 + 1e-5));
+	}
+
+	// Closest point on triangle (v0, v0 + e1, v0 + e2) to p, by Voronoi region
+	static Vec3 closestOnTriangle(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& p)
+	{
+		Vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = ab.Dot(ap), d2 = ac.Dot(ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) return a;
+		Vec3 bp = p - b;
+		float d3 = ab.Dot(bp), d4 = ac.Dot(bp);
+		if (d3 >= 0.0f && d4 <= d3) return b;
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+		Vec3 cp = p - c;
+		float d5 = ab.Dot(cp), d6 = ac.Dot(cp);
+		if (d6 >= 0.0f && d5 <= d6) return c;
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		float denom = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+private:
+	static constexpr int EMPTY = INT32_MIN;
+	static constexpr int STACK_SIZE = 256;
+	static constexpr unsigned int LEAF_SIZE = 4;
+	static constexpr int BINS = 16;
+
+	// Leaf children are stored as ~(first << 4 | count)
+	static int makeLeaf(unsigned int first, unsigned int count) { return ~(int)((first << 4) | count); }
+	static unsigned int leafFirst(int child) { return (unsigned int)(~child) >> 4; }
+	static unsigned int leafCount(int child) { return (unsigned int)(~child) & 15; }
+
+	// Children in 'mask' ordered by descending key, so pushing them in order pops the nearest first
+	static int sortChildren(int mask, const float key[4], int order[4])
+	{
+		int hits = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			if (!(mask & (1 << c)))
+			{
+				continue;
+			}
+			int k = hits++;
+			while (k > 0 && key[order[k - 1]] < key[c])
+			{
+				order[k] = order[k - 1];
+				k--;
+			}
+			order[k] = c;
+		}
+		return hits;
+	}
+
+	// Empty slots have inverted boxes, but a slab test can still pass them once (FLT_MAX - o) * inv
+	// overflows, so they are masked out explicitly
+	static int occupied(const Node4& node)
+	{
+		return (node.child[0] != EMPTY) | ((node.child[1] != EMPTY) << 1) | ((node.child[2] != EMPTY) << 2) | ((node.child[3] != EMPTY) << 3);
+	}
+
+	struct Tri
+	{
+		Vec3 v0, e1, e2;
+	};
+
+	struct BuildTri
+	{
+		Vec3 min, max, centre;
+		unsigned int index;
+	};
+
+	struct BinaryNode
+	{
+		Vec3 min, max;
+		unsigned int first;   // triangle range for leaves, left child for interior nodes
+		unsigned int count;   // 0 for interior nodes
+	};
+
+	struct StackEntry
+	{
+		int node;
+		float tNear;   // entry distance (ray) or squared distance (point) of the node's box
+	};
+
+	std::vector<Tri> tris;
+	std::vector<unsigned int> triIndex;   // leaf order -> source triangle
+
+	static Vec3 closestOnTriangle(const Tri& t, const Vec3& p)
+	{
+		return closestOnTriangle(t.v0, t.v0 + t.e1, t.v0 + t.e2, p);
+	}
+
+	static float halfArea(const Vec3& min, const Vec3& max)
+	{
+		Vec3 e = max - min;
+		if (e.x < 0.0f) return 0.0f;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	static int binOf(float v, float lo, float scale)
+	{
+		int b = (int)((v - lo) * scale);
+		return b < 0 ? 0 : (b >= BINS ? BINS - 1 : b);
+	}
+
+	void subdivide(std::vector<BinaryNode>& binary, std::vector<BuildTri>& build, unsigned int nodeIndex)
+	{
+		unsigned int first = binary[nodeIndex].first;
+		unsigned int count = binary[nodeIndex].count;
+		Vec3 nodeMin(FLT_MAX, FLT_MAX, FLT_MAX), nodeMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		Vec3 centreMin = nodeMin, centreMax = nodeMax;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			nodeMin = Vec3::Min(nodeMin, build[i].min);
+			nodeMax = Vec3::Max(nodeMax, build[i].max);
+			centreMin = Vec3::Min(centreMin, build[i].centre);
+			centreMax = Vec3::Max(centreMax, build[i].centre);
+		}
+		binary[nodeIndex].min = nodeMin;
+		binary[nodeIndex].max = nodeMax;
+		if (count <= LEAF_SIZE)
+		{
+			return;
+		}
+
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = halfArea(nodeMin, nodeMax) * (float)count;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float lo = centreMin.v[axis], hi = centreMax.v[axis];
+			if (hi <= lo)
+			{
+				continue;
+			}
+			Vec3 binMin[BINS], binMax[BINS];
+			unsigned int binCount[BINS] = {};
+			for (int b = 0; b < BINS; b++)
+			{
+				binMin[b] = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+				binMax[b] = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			}
+			float scale = (float)BINS / (hi - lo);
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				int b = binOf(build[i].centre.v[axis], lo, scale);
+				binCount[b]++;
+				binMin[b] = Vec3::Min(binMin[b], build[i].min);
+				binMax[b] = Vec3::Max(binMax[b], build[i].max);
+			}
+			float rightArea[BINS];
+			unsigned int rightCount[BINS];
+			Vec3 accMin(FLT_MAX, FLT_MAX, FLT_MAX), accMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			unsigned int n = 0;
+			for (int b = BINS - 1; b > 0; b--)
+			{
+				accMin = Vec3::Min(accMin, binMin[b]);
+				accMax = Vec3::Max(accMax, binMax[b]);
+				n += binCount[b];
+				rightArea[b] = halfArea(accMin, accMax);
+				rightCount[b] = n;
+			}
+			accMin = Vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+			accMax = Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			n = 0;
+			for (int b = 0; b < BINS - 1; b++)
+			{
+				accMin = Vec3::Min(accMin, binMin[b]);
+				accMax = Vec3::Max(accMax, binMax[b]);
+				n += binCount[b];
+				float cost = halfArea(accMin, accMax) * (float)n + rightArea[b + 1] * (float)rightCount[b + 1];
+				if (n > 0 && rightCount[b + 1] > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		unsigned int mid;
+		if (bestAxis >= 0)
+		{
+			float lo = centreMin.v[bestAxis];
+			float scale = (float)BINS / (centreMax.v[bestAxis] - lo);
+			unsigned int i = first, j = first + count;
+			while (i < j)
+			{
+				if (binOf(build[i].centre.v[bestAxis], lo, scale) < bestSplit) i++;
+				else std::swap(build[i], build[--j]);
+			}
+			mid = i;
+		}
+		else if (count > 15)
+		{
+			// Leaves hold at most 15 triangles; split big unsplittable ranges in half
+			mid = first + count / 2;
+		}
+		else
+		{
+			return;
+		}
+
+		unsigned int left = (unsigned int)binary.size();
+		binary.push_back(BinaryNode());
+		binary.push_back(BinaryNode());
+		binary[left].first = first;
+		binary[left].count = mid - first;
+		binary[left + 1].first = mid;
+		binary[left + 1].count = first + count - mid;
+		binary[nodeIndex].first = left;
+		binary[nodeIndex].count = 0;
+		subdivide(binary, build, left);
+		subdivide(binary, build, left + 1);
+	}
+
+	// Pull up to four descendants of a binary node into one Node4, opening the largest interior
+	// child each time
+	int collapse(const std::vector<BinaryNode>& binary, unsigned int binaryIndex)
+	{
+		unsigned int children[4];
+		int count = 0;
+		const BinaryNode& root = binary[binaryIndex];
+		if (root.count > 0)
+		{
+			children[count++] = binaryIndex;   // a tree that is a single leaf
+		}
+		else
+		{
+			children[count++] = root.first;
+			children[count++] = root.first + 1;
+			while (count < 4)
+			{
+				int best = -1;
+				float bestArea = -1.0f;
+				for (int c = 0; c < count; c++)
+				{
+					const BinaryNode& n = binary[children[c]];
+					float area = halfArea(n.min, n.max);
+					if (n.count == 0 && area > bestArea)
+					{
+						best = c;
+						bestArea = area;
+					}
+				}
+				if (best < 0)
+				{
+					break;
+				}
+				unsigned int opened = children[best];
+				children[best] = binary[opened].first;
+				children[count++] = binary[opened].first + 1;
+			}
+		}
+
+		int nodeIndex = (int)nodes.size();
+		nodes.push_back(Node4());
+		for (int c = 0; c < 4; c++)
+		{
+			Node4& node = nodes[nodeIndex];
+			if (c >= count)
+			{
+				node.minX[c] = node.minY[c] = node.minZ[c] = FLT_MAX;
+				node.maxX[c] = node.maxY[c] = node.maxZ[c] = -FLT_MAX;
+				node.child[c] = EMPTY;
+				continue;
+			}
+			const BinaryNode& n = binary[children[c]];
+			node.minX[c] = n.min.x; node.minY[c] = n.min.y; node.minZ[c] = n.min.z;
+			node.maxX[c] = n.max.x; node.maxY[c] = n.max.y; node.maxZ[c] = n.max.z;
+			node.child[c] = n.count > 0 ? makeLeaf(n.first, n.count) : 0;
+		}
+		for (int c = 0; c < count; c++)
+		{
+			const BinaryNode& n = binary[children[c]];
+			if (n.count == 0)
+			{
+				int child = collapse(binary, children[c]);
+				nodes[nodeIndex].child[c] = child;   // 'nodes' may have grown; index again
+			}
+		}
+		return nodeIndex;
+	}
+
+	// Slab test of one ray against four boxes grown by 'inflate'; returns a hit mask and each
+	// box's entry t
+	static int rayBoxes(const Node4& node, const Vec3& o, const Vec3& inv, float maxT, float tNear[4], float inflate = 0.0f)
+	{
+#ifdef MESHBVH_SSE
+		// Growing the boxes is folded into the origin: min - r - o == min - (o + r)
+		__m128 lox = _mm_set1_ps(o.x + inflate), loy = _mm_set1_ps(o.y + inflate), loz = _mm_set1_ps(o.z + inflate);
+		__m128 hox = _mm_set1_ps(o.x - inflate), hoy = _mm_set1_ps(o.y - inflate), hoz = _mm_set1_ps(o.z - inflate);
+		__m128 ix = _mm_set1_ps(inv.x), iy = _mm_set1_ps(inv.y), iz = _mm_set1_ps(inv.z);
+		__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), lox), ix);
+		__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), hox), ix);
+		__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), loy), iy);
+		__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), hoy), iy);
+		__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), loz), iz);
+		__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), hoz), iz);
+		__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+		__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(maxT)));
+		_mm_storeu_ps(tNear, enter);
+		return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+		int mask = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			float t0x = (node.minX[c] - inflate - o.x) * inv.x, t1x = (node.maxX[c] + inflate - o.x) * inv.x;
+			float t0y = (node.minY[c] - inflate - o.y) * inv.y, t1y = (node.maxY[c] + inflate - o.y) * inv.y;
+			float t0z = (node.minZ[c] - inflate - o.z) * inv.z, t1z = (node.maxZ[c] + inflate - o.z) * inv.z;
+			float enter = (std::max)((std::max)((std::min)(t0x, t1x), (std::min)(t0y, t1y)), (std::max)((std::min)(t0z, t1z), 0.0f));
+			float exit = (std::min)((std::min)((std::max)(t0x, t1x), (std::max)(t0y, t1y)), (std::min)((std::max)(t0z, t1z), maxT));
+			tNear[c] = enter;
+			mask |= (enter <= exit) << c;
+		}
+		return mask;
+#endif
+	}
+
+	// Squared distance from a point to four boxes; returns the mask of boxes within 'maxD2'
+	static int pointBoxes(const Node4& node, const Vec3& p, float maxD2, float d2[4])
+	{
+#ifdef MESHBVH_SSE
+		__m128 zero = _mm_setzero_ps();
+		__m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y), pz = _mm_set1_ps(p.z);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), px), _mm_sub_ps(px, _mm_loadu_ps(node.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), py), _mm_sub_ps(py, _mm_loadu_ps(node.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), pz), _mm_sub_ps(pz, _mm_loadu_ps(node.maxZ))), zero);
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(d2, d);
+		return _mm_movemask_ps(_mm_cmple_ps(d, _mm_set1_ps(maxD2)));
+#else
+		int mask = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			float dx = (std::max)((std::max)(node.minX[c] - p.x, p.x - node.maxX[c]), 0.0f);
+			float dy = (std::max)((std::max)(node.minY[c] - p.y, p.y - node.maxY[c]), 0.0f);
+			float dz = (std::max)((std::max)(node.minZ[c] - p.z, p.z - node.maxZ[c]), 0.0f);
+			d2[c] = dx * dx + dy * dy + dz * dz;
+			mask |= (d2[c] <= maxD2) << c;
+		}
+		return mask;
+#endif
+	}
+
+	// Sphere against a point: smallest root of |c + d t - p|^2 = r^2 in [0, maxT]
+	static bool sweepPoint(const Vec3& c, const Vec3& d, float r2, const Vec3& p, float maxT, float& t)
+	{
+		Vec3 m = c - p;
+		float a = d.Dot(d);
+		float b = 2.0f * d.Dot(m);
+		float cc = m.Dot(m) - r2;
+		return lowestRoot(a, b, cc, maxT, t);
+	}
+
+	static bool lowestRoot(float a, float b, float c, float maxT, float& root)
+	{
+		float det = b * b - 4.0f * a * c;
+		if (det < 0.0f || fabsf(a) < 1e-12f)
+		{
+			return false;
+		}
+		float s = sqrtf(det);
+		float r1 = (-b - s) / (2.0f * a);
+		float r2 = (-b + s) / (2.0f * a);
+		if (r1 > r2)
+		{
+			std::swap(r1, r2);
+		}
+		if (r1 >= 0.0f && r1 < maxT)
+		{
+			root = r1;
+			return true;
+		}
+		return false;
+	}
+
+	// Swept sphere against one triangle: face first (always earliest when it applies), then the
+	// three vertices and three edges. Updates 'hit' when contact happens before hit.t.
+	static bool sweepTriangle(const Tri& tri, const Vec3& c, const Vec3& d, float r, SweepHit& hit)
+	{
+		Vec3 n = tri.e1.Cross(tri.e2);
+		float len = n.length();
+		if (len < 1e-12f)
+		{
+			return false;
+		}
+		n = n / len;
+		float dist = (c - tri.v0).Dot(n);
+		if (dist < 0.0f)
+		{
+			n = -n;   // collide with whichever side the sphere is on
+			dist = -dist;
+		}
+		float approach = d.Dot(n);
+		if (approach >= 0.0f)
+		{
+			return false;   // moving away from (or along) the plane
+		}
+		float t0 = (dist - r) / -approach;
+		if (t0 >= hit.t)
+		{
+			return false;
+		}
+		if (t0 < 0.0f)
+		{
+			t0 = 0.0f;   // already touching the plane and moving into it
+		}
+
+		// Face contact if the touching point lies inside the triangle
+		Vec3 contact = c + d * t0 - n * (dist < r ? dist : r);
+		Vec3 v1 = tri.v0 + tri.e1, v2 = tri.v0 + tri.e2;
+		Vec3 p = contact - tri.v0;
+		float d00 = tri.e1.Dot(tri.e1), d01 = tri.e1.Dot(tri.e2), d11 = tri.e2.Dot(tri.e2);
+		float d20 = p.Dot(tri.e1), d21 = p.Dot(tri.e2);
+		float denom = d00 * d11 - d01 * d01;
+		float bv = (d11 * d20 - d01 * d21) / denom;
+		float bw = (d00 * d21 - d01 * d20) / denom;
+		if (bv >= 0.0f && bw >= 0.0f && bv + bw <= 1.0f)
+		{
+			hit.t = t0;
+			hit.normal = n;
+			hit.point = contact;
+			return true;
+		}
+
+		// Vertices and edges
+		float r2 = r * r;
+		float best = hit.t;
+		bool found = false;
+		Vec3 bestPoint;
+		const Vec3 verts[3] = { tri.v0, v1, v2 };
+		for (int i = 0; i < 3; i++)
+		{
+			float t;
+			if (sweepPoint(c, d, r2, verts[i], best, t))
+			{
+				best = t;
+				bestPoint = verts[i];
+				found = true;
+			}
+		}
+		float dd = d.Dot(d);
+		for (int i = 0; i < 3; i++)
+		{
+			const Vec3& p1 = verts[i];
+			Vec3 edge = verts[(i + 1) % 3] - p1;
+			Vec3 base = p1 - c;
+			float ee = edge.Dot(edge), ed = edge.Dot(d), eb = edge.Dot(base);
+			float a = ee * -dd + ed * ed;
+			float b = ee * (2.0f * d.Dot(base)) - 2.0f * ed * eb;
+			float cc = ee * (r2 - base.Dot(base)) + eb * eb;
+			float t;
+			if (lowestRoot(a, b, cc, best, t))
+			{
+				float f = (ed * t - eb) / ee;
+				if (f >= 0.0f && f <= 1.0f)
+				{
+					best = t;
+					bestPoint = p1 + edge * f;
+					found = true;
+				}
+			}
+		}
+		if (!found)
+		{
+			return false;
+		}
+		Vec3 centreAtHit = c + d * best;
+		Vec3 away = centreAtHit - bestPoint;
+		hit.t = best;
+		hit.normal = away.lengthSquared() > 1e-12f ? away.normalize() : n;
+		hit.point = bestPoint;
+		return true;
+	}
+
+	// Moller-Trumbore; 'slot' is the leaf-order index recorded on a closer hit
+	static bool rayTriangle(const Tri& tri, const Vec3& o, const Vec3& d, unsigned int slot, RayHit& hit)
+	{
+		Vec3 p = d.Cross(tri.e2);
+		float det = tri.e1.Dot(p);
+		if (fabsf(det) < 1e-12f)
+		{
+			return false;
+		}
+		float invDet = 1.0f / det;
+		Vec3 s = o - tri.v0;
+		float u = s.Dot(p) * invDet;
+		if (u < 0.0f || u > 1.0f)
+		{
+			return false;
+		}
+		Vec3 q = s.Cross(tri.e1);
+		float v = d.Dot(q) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+		{
+			return false;
+		}
+		float t = tri.e2.Dot(q) * invDet;
+		if (t < 0.0f || t >= hit.t)
+		{
+			return false;
+		}
+		hit.t = t;
+		hit.u = u;
+		hit.v = v;
+		hit.triangle = slot;
+		return true;
+	}
+};
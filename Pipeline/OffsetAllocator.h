@@ -0,0 +1,363 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Two-level segregated fit (TLSF) allocator over a range of offsets (Masmano et al., "TLSF: a New
+// Dynamic Memory Allocator for Real-Time Systems"). Free blocks sit in size bins, 8 per power of
+// two, with a bitmap per level, so allocate and free are O(1): a couple of bit scans, a split, and
+// on free a merge with the physical neighbours. It manages numbers only; the caller owns the
+// memory (GPUBufferHeap puts D3D12 buffers behind it).
+class OffsetAllocator
+{
+public:
+	static constexpr uint64_t GRANULE = 16;   // unit of sizes and offsets, and the minimum alignment
+	static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;   // aligned, in bytes
+		uint64_t size = 0;     // as requested
+		uint32_t node = NO_NODE;
+
+		bool valid() const
+		{
+			return node != NO_NODE;
+		}
+	};
+
+	explicit OffsetAllocator(uint64_t capacity = 0)
+	{
+		reset(capacity);
+	}
+
+	// Forgets every allocation; the whole range becomes one free block
+	void reset(uint64_t capacity)
+	{
+		nodes.clear();
+		unusedNodes.clear();
+		firstLevel = 0;
+		for (uint32_t& bits : secondLevel) bits = 0;
+		for (uint32_t& head : bins) head = NO_NODE;
+		capacityUnits = (uint32_t)(capacity / GRANULE);
+		freeUnits = 0;
+		allocations = 0;
+		if (capacityUnits > 0)
+		{
+			uint32_t n = newNode(0, capacityUnits);
+			insertFree(n);
+		}
+	}
+
+	// 'alignment' is a power of two; above GRANULE the block is padded to fit it. Invalid when no
+	// free block is large enough.
+	Allocation allocate(uint64_t size, uint64_t alignment = GRANULE)
+	{
+		Allocation a;
+		if (size == 0)
+		{
+			return a;
+		}
+		uint64_t units64 = (size + GRANULE - 1) / GRANULE;
+		if (alignment > GRANULE)
+		{
+			units64 += alignment / GRANULE - 1;
+		}
+		if (units64 > capacityUnits)
+		{
+			return a;
+		}
+		uint32_t units = (uint32_t)units64;
+
+		uint32_t n = findFree(units);
+		if (n == NO_NODE)
+		{
+			return a;
+		}
+		removeFree(n);
+		if (nodes[n].size > units)
+		{
+			// The rest of the block becomes a free block right after it
+			uint32_t rest = newNode(nodes[n].offset + units, nodes[n].size - units);
+			nodes[rest].prevPhysical = n;
+			nodes[rest].nextPhysical = nodes[n].nextPhysical;
+			if (nodes[n].nextPhysical != NO_NODE) nodes[nodes[n].nextPhysical].prevPhysical = rest;
+			nodes[n].nextPhysical = rest;
+			nodes[n].size = units;
+			insertFree(rest);
+		}
+		nodes[n].used = true;
+		allocations++;
+
+		uint64_t start = (uint64_t)nodes[n].offset * GRANULE;
+		a.offset = alignment > GRANULE ? (start + alignment - 1) & ~(alignment - 1) : start;
+		a.size = size;
+		a.node = n;
+		return a;
+	}
+
+	void free(Allocation& a)
+	{
+		if (!a.valid())
+		{
+			return;
+		}
+		uint32_t n = a.node;
+		nodes[n].used = false;
+		allocations--;
+
+		uint32_t prev = nodes[n].prevPhysical;
+		if (prev != NO_NODE && !nodes[prev].used)
+		{
+			removeFree(prev);
+			nodes[prev].size += nodes[n].size;
+			unlinkPhysical(n);
+			n = prev;
+		}
+		uint32_t next = nodes[n].nextPhysical;
+		if (next != NO_NODE && !nodes[next].used)
+		{
+			removeFree(next);
+			nodes[n].size += nodes[next].size;
+			unlinkPhysical(next);
+		}
+		insertFree(n);
+		a = Allocation();
+	}
+
+	uint64_t capacity() const
+	{
+		return (uint64_t)capacityUnits * GRANULE;
+	}
+
+	uint64_t freeBytes() const
+	{
+		return (uint64_t)freeUnits * GRANULE;
+	}
+
+	uint32_t allocationCount() const
+	{
+		return allocations;
+	}
+
+	// Largest single allocation that would succeed right now
+	uint64_t largestFreeBlock() const
+	{
+		if (firstLevel == 0)
+		{
+			return 0;
+		}
+		uint32_t fl = 31 - leadingZeros(firstLevel);
+		uint32_t sl = 31 - leadingZeros(secondLevel[fl]);
+		uint32_t largest = 0;
+		for (uint32_t n = bins[fl * SL_COUNT + sl]; n != NO_NODE; n = nodes[n].nextFree)
+		{
+			largest = nodes[n].size > largest ? nodes[n].size : largest;
+		}
+		return (uint64_t)largest * GRANULE;
+	}
+
+	// 0 when all free space is one block, towards 1 as it splinters
+	float fragmentation() const
+	{
+		return freeUnits == 0 ? 0.0f : 1.0f - (float)(largestFreeBlock() / GRANULE) / (float)freeUnits;
+	}
+
+	// Walks the physical block list: blocks tile the range, no two free blocks touch, and the free
+	// lists hold exactly the free blocks
+	bool validate() const
+	{
+		if (capacityUnits == 0)
+		{
+			return true;
+		}
+		uint32_t first = NO_NODE;
+		for (uint32_t i = 0; i < nodes.size() && first == NO_NODE; i++)
+		{
+			if (nodes[i].live && nodes[i].offset == 0) first = i;
+		}
+		uint32_t expected = 0, freeFound = 0, usedFound = 0, freeBlocks = 0;
+		bool previousFree = false;
+		for (uint32_t n = first; n != NO_NODE; n = nodes[n].nextPhysical)
+		{
+			if (nodes[n].offset != expected) return false;
+			if (!nodes[n].used && previousFree) return false;
+			previousFree = !nodes[n].used;
+			expected += nodes[n].size;
+			if (nodes[n].used) usedFound++;
+			else
+			{
+				freeFound += nodes[n].size;
+				freeBlocks++;
+			}
+		}
+		uint32_t listed = 0;
+		for (uint32_t b = 0; b < FL_COUNT * SL_COUNT; b++)
+		{
+			for (uint32_t n = bins[b]; n != NO_NODE; n = nodes[n].nextFree)
+			{
+				if (nodes[n].used) return false;
+				listed++;
+			}
+		}
+		return expected == capacityUnits && freeFound == freeUnits && usedFound == allocations && listed == freeBlocks;
+	}
+
+private:
+	static constexpr uint32_t SL_BITS = 3;
+	static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+	static constexpr uint32_t FL_COUNT = 32 - SL_BITS + 1;
+
+	struct Node
+	{
+		uint32_t offset;
+		uint32_t size;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		bool used;
+		bool live;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> unusedNodes;
+	uint32_t firstLevel = 0;
+	uint32_t secondLevel[FL_COUNT];
+	uint32_t bins[FL_COUNT * SL_COUNT];
+	uint32_t capacityUnits = 0;
+	uint32_t freeUnits = 0;
+	uint32_t allocations = 0;
+
+	static uint32_t leadingZeros(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse(&index, v);
+		return 31 - index;
+#else
+		return __builtin_clz(v);
+#endif
+	}
+
+	static uint32_t trailingZeros(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, v);
+		return index;
+#else
+		return __builtin_ctz(v);
+#endif
+	}
+
+	// Bin of a block of 'size' units: sizes below SL_COUNT get a bin each, then 8 per power of two
+	static void binOf(uint32_t size, uint32_t& fl, uint32_t& sl)
+	{
+		uint32_t log2 = 31 - leadingZeros(size);
+		if (log2 < SL_BITS)
+		{
+			fl = 0;
+			sl = size;
+		}
+		else
+		{
+			fl = log2 - SL_BITS + 1;
+			sl = (size >> (log2 - SL_BITS)) - SL_COUNT;
+		}
+	}
+
+	// A free block of at least 'size' units: rounding the request up to the next bin boundary
+	// makes any block in that bin or above fit. Failing that, the request's own bin is searched,
+	// so the last blocks of a nearly full range can still be handed out.
+	uint32_t findFree(uint32_t size) const
+	{
+		uint32_t log2 = 31 - leadingZeros(size);
+		uint64_t rounded = size;
+		if (log2 >= SL_BITS)
+		{
+			rounded += (1u << (log2 - SL_BITS)) - 1;
+		}
+		uint32_t fl, sl;
+		if (rounded <= 0xFFFFFFFFull)
+		{
+			binOf((uint32_t)rounded, fl, sl);
+			uint32_t slMap = secondLevel[fl] & (~0u << sl);
+			uint32_t flMap = firstLevel & (~0u << (fl + 1));
+			if (slMap != 0)
+			{
+				return bins[fl * SL_COUNT + trailingZeros(slMap)];
+			}
+			if (flMap != 0)
+			{
+				fl = trailingZeros(flMap);
+				return bins[fl * SL_COUNT + trailingZeros(secondLevel[fl])];
+			}
+		}
+		binOf(size, fl, sl);
+		for (uint32_t n = bins[fl * SL_COUNT + sl]; n != NO_NODE; n = nodes[n].nextFree)
+		{
+			if (nodes[n].size >= size) return n;
+		}
+		return NO_NODE;
+	}
+
+	uint32_t newNode(uint32_t offset, uint32_t size)
+	{
+		uint32_t n;
+		if (!unusedNodes.empty())
+		{
+			n = unusedNodes.back();
+			unusedNodes.pop_back();
+		}
+		else
+		{
+			n = (uint32_t)nodes.size();
+			nodes.push_back(Node());
+		}
+		nodes[n] = { offset, size, NO_NODE, NO_NODE, NO_NODE, NO_NODE, false, true };
+		return n;
+	}
+
+	// Drops a node merged into its predecessor
+	void unlinkPhysical(uint32_t n)
+	{
+		uint32_t prev = nodes[n].prevPhysical, next = nodes[n].nextPhysical;
+		if (prev != NO_NODE) nodes[prev].nextPhysical = next;
+		if (next != NO_NODE) nodes[next].prevPhysical = prev;
+		nodes[n].live = false;
+		unusedNodes.push_back(n);
+	}
+
+	void insertFree(uint32_t n)
+	{
+		uint32_t fl, sl;
+		binOf(nodes[n].size, fl, sl);
+		uint32_t& head = bins[fl * SL_COUNT + sl];
+		nodes[n].prevFree = NO_NODE;
+		nodes[n].nextFree = head;
+		if (head != NO_NODE) nodes[head].prevFree = n;
+		head = n;
+		firstLevel |= 1u << fl;
+		secondLevel[fl] |= 1u << sl;
+		freeUnits += nodes[n].size;
+	}
+
+	void removeFree(uint32_t n)
+	{
+		uint32_t fl, sl;
+		binOf(nodes[n].size, fl, sl);
+		uint32_t& head = bins[fl * SL_COUNT + sl];
+		if (nodes[n].prevFree != NO_NODE) nodes[nodes[n].prevFree].nextFree = nodes[n].nextFree;
+		else head = nodes[n].nextFree;
+		if (nodes[n].nextFree != NO_NODE) nodes[nodes[n].nextFree].prevFree = nodes[n].prevFree;
+		if (head == NO_NODE)
+		{
+			secondLevel[fl] &= ~(1u << sl);
+			if (secondLevel[fl] == 0) firstLevel &= ~(1u << fl);
+		}
+		freeUnits -= nodes[n].size;
+	}
+};
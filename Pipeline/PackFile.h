@@ -0,0 +1,622 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Single-file asset archive.
+//
+// Layout: [PackHeader][entry data, each 4 KB aligned][PackEntry * n][bucket table][name blob]
+// Entries are looked up through an open-addressed hash table stored in the file, so mounting
+// is one read of the table of contents and every lookup is a couple of probes.
+// Entries that do not compress well are stored raw; because they are page aligned they can be
+// used straight out of the memory-mapped file with no copy.
+
+static const uint32_t PACK_MAGIC = 0x4B504741; // "AGPK"
+static const uint32_t PACK_VERSION = 1;
+static const uint32_t PACK_ALIGNMENT = 4096;
+static const uint32_t PACK_EMPTY_BUCKET = 0xFFFFFFFF;
+
+enum PackEntryFlags
+{
+	PACK_ENTRY_RAW = 0,
+	PACK_ENTRY_LZ = 1
+};
+
+struct PackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t bucketCount;   // power of two
+	uint64_t tocOffset;     // start of PackEntry array
+	uint64_t namesSize;
+};
+
+struct PackEntry
+{
+	uint64_t hash;
+	uint64_t offset;        // absolute, multiple of PACK_ALIGNMENT
+	uint32_t storedSize;
+	uint32_t originalSize;
+	uint32_t flags;
+	uint32_t nameOffset;    // into the name blob, original spelling of the path
+};
+
+// Paths are normalised before hashing so "./Models\\tree.gem" and "models/tree.gem" match
+inline std::string packNormalisePath(const std::string& path)
+{
+	std::string out;
+	out.reserve(path.size());
+	size_t start = 0;
+	while (start + 1 < path.size() && path[start] == '.' && (path[start + 1] == '/' || path[start + 1] == '\\'))
+	{
+		start += 2;
+	}
+	for (size_t i = start; i < path.size(); i++)
+	{
+		char c = path[i];
+		if (c == '\\')
+		{
+			c = '/';
+		}
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = c - 'A' + 'a';
+		}
+		out.push_back(c);
+	}
+	return out;
+}
+
+// FNV-1a, 64 bit
+inline uint64_t packHashPath(const std::string& normalisedPath)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : normalisedPath)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// LZ77 byte-oriented compressor using the LZ4 block format: each sequence is a token
+// (literal length, match length), literals, and a 16 bit back offset.
+class PackCompressor
+{
+public:
+	static const int MIN_MATCH = 4;
+	static const int LAST_LITERALS = 5;     // block always ends with literals
+	static const int MATCH_SAFE_END = 12;   // no match may start this close to the end
+	static const int HASH_BITS = 16;
+	static const int MAX_OFFSET = 65535;
+
+	static size_t maxCompressedSize(size_t inputSize)
+	{
+		return inputSize + inputSize / 255 + 16;
+	}
+
+	static size_t compress(const unsigned char* src, size_t srcSize, std::vector<unsigned char>& dst)
+	{
+		dst.resize(maxCompressedSize(srcSize));
+		unsigned char* op = dst.data();
+		std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0xFFFFFFFF);
+
+		size_t anchor = 0;
+		size_t ip = 0;
+		if (srcSize > MATCH_SAFE_END)
+		{
+			size_t matchLimit = srcSize - MATCH_SAFE_END;
+			while (ip < matchLimit)
+			{
+				uint32_t sequence = read32(src + ip);
+				uint32_t h = (sequence * 2654435761u) >> (32 - HASH_BITS);
+				uint32_t candidate = table[h];
+				table[h] = (uint32_t)ip;
+				if (candidate == 0xFFFFFFFF || ip - candidate > MAX_OFFSET || read32(src + candidate) != sequence)
+				{
+					ip++;
+					continue;
+				}
+
+				// Extend the match forwards, staying clear of the trailing literals
+				size_t matchEnd = ip + MIN_MATCH;
+				size_t ref = candidate + MIN_MATCH;
+				size_t limit = srcSize - LAST_LITERALS;
+				while (matchEnd < limit && src[matchEnd] == src[ref])
+				{
+					matchEnd++;
+					ref++;
+				}
+
+				op = writeSequence(op, src + anchor, ip - anchor, (uint16_t)(ip - candidate), matchEnd - ip - MIN_MATCH);
+				ip = matchEnd;
+				anchor = ip;
+			}
+		}
+
+		// Final literal run
+		size_t literals = srcSize - anchor;
+		unsigned char* token = op++;
+		*token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+		op = writeLength(op, literals, 15);
+		memcpy(op, src + anchor, literals);
+		op += literals;
+
+		size_t written = op - dst.data();
+		dst.resize(written);
+		return written;
+	}
+
+	// Returns false on malformed input instead of reading or writing out of bounds
+	static bool decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+	{
+		const unsigned char* ip = src;
+		const unsigned char* iend = src + srcSize;
+		unsigned char* op = dst;
+		unsigned char* oend = dst + dstSize;
+
+		while (ip < iend)
+		{
+			unsigned int token = *ip++;
+			size_t literals = token >> 4;
+			if (!readLength(ip, iend, literals, 15))
+			{
+				return false;
+			}
+			if ((size_t)(iend - ip) < literals || (size_t)(oend - op) < literals)
+			{
+				return false;
+			}
+			memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+
+			if (ip >= iend)
+			{
+				break; // last sequence has no match
+			}
+			if (iend - ip < 2)
+			{
+				return false;
+			}
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > (size_t)(op - dst))
+			{
+				return false;
+			}
+			size_t matchLength = token & 15;
+			if (!readLength(ip, iend, matchLength, 15))
+			{
+				return false;
+			}
+			matchLength += MIN_MATCH;
+			if ((size_t)(oend - op) < matchLength)
+			{
+				return false;
+			}
+			// Byte copy: the match may overlap the bytes being written
+			const unsigned char* match = op - offset;
+			for (size_t i = 0; i < matchLength; i++)
+			{
+				op[i] = match[i];
+			}
+			op += matchLength;
+		}
+		return op == oend;
+	}
+
+private:
+	static uint32_t read32(const unsigned char* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(uint32_t));
+		return v;
+	}
+
+	static unsigned char* writeLength(unsigned char* op, size_t length, size_t tokenMax)
+	{
+		if (length < tokenMax)
+		{
+			return op;
+		}
+		length -= tokenMax;
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (unsigned char)length;
+		return op;
+	}
+
+	static bool readLength(const unsigned char*& ip, const unsigned char* iend, size_t& length, size_t tokenMax)
+	{
+		if (length != tokenMax)
+		{
+			return true;
+		}
+		unsigned char s;
+		do
+		{
+			if (ip >= iend)
+			{
+				return false;
+			}
+			s = *ip++;
+			length += s;
+		} while (s == 255);
+		return true;
+	}
+
+	static unsigned char* writeSequence(unsigned char* op, const unsigned char* literals, size_t literalCount, uint16_t offset, size_t matchExtra)
+	{
+		unsigned char* token = op++;
+		*token = (unsigned char)(((literalCount >= 15 ? 15 : literalCount) << 4) | (matchExtra >= 15 ? 15 : matchExtra));
+		op = writeLength(op, literalCount, 15);
+		memcpy(op, literals, literalCount);
+		op += literalCount;
+		*op++ = (unsigned char)(offset & 0xFF);
+		*op++ = (unsigned char)(offset >> 8);
+		op = writeLength(op, matchExtra, 15);
+		return op;
+	}
+};
+
+// Builds a pack file. Used by the offline PackTool, never at runtime.
+class PackWriter
+{
+public:
+	// Entries compress only if they shrink by at least this fraction; otherwise stay mappable
+	float minCompressionSaving = 0.1f;
+
+	void add(const std::string& path, const std::vector<unsigned char>& data)
+	{
+		files.push_back({ path, data });
+	}
+
+	bool write(const std::string& filename)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		PackHeader header = {};
+		header.magic = PACK_MAGIC;
+		header.version = PACK_VERSION;
+		header.entryCount = (uint32_t)files.size();
+		header.bucketCount = 1;
+		while (header.bucketCount < files.size() * 2)
+		{
+			header.bucketCount <<= 1;
+		}
+
+		std::vector<PackEntry> entries;
+		std::string names;
+		uint64_t offset = align(sizeof(PackHeader));
+		file.write(reinterpret_cast<const char*>(&header), sizeof(PackHeader));
+		pad(file, offset);
+
+		std::vector<unsigned char> compressed;
+		for (const PendingFile& f : files)
+		{
+			PackEntry entry = {};
+			entry.hash = packHashPath(packNormalisePath(f.path));
+			entry.offset = offset;
+			entry.originalSize = (uint32_t)f.data.size();
+			entry.nameOffset = (uint32_t)names.size();
+			names.append(f.path);
+			names.push_back('\0');
+
+			const unsigned char* payload = f.data.data();
+			size_t payloadSize = f.data.size();
+			entry.flags = PACK_ENTRY_RAW;
+			if (!f.data.empty())
+			{
+				size_t compressedSize = PackCompressor::compress(f.data.data(), f.data.size(), compressed);
+				if (compressedSize < f.data.size() * (1.0f - minCompressionSaving))
+				{
+					entry.flags = PACK_ENTRY_LZ;
+					payload = compressed.data();
+					payloadSize = compressedSize;
+				}
+			}
+			entry.storedSize = (uint32_t)payloadSize;
+			file.write(reinterpret_cast<const char*>(payload), payloadSize);
+			offset = align(offset + payloadSize);
+			pad(file, offset);
+			entries.push_back(entry);
+		}
+
+		// Open addressing with linear probing; the table is at most half full
+		std::vector<uint32_t> buckets(header.bucketCount, PACK_EMPTY_BUCKET);
+		for (uint32_t i = 0; i < entries.size(); i++)
+		{
+			uint32_t b = (uint32_t)entries[i].hash & (header.bucketCount - 1);
+			while (buckets[b] != PACK_EMPTY_BUCKET)
+			{
+				b = (b + 1) & (header.bucketCount - 1);
+			}
+			buckets[b] = i;
+		}
+
+		header.tocOffset = offset;
+		header.namesSize = names.size();
+		if (!entries.empty())
+		{
+			file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackEntry));
+		}
+		file.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+		file.write(names.data(), names.size());
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(PackHeader));
+		return file.good();
+	}
+
+private:
+	struct PendingFile
+	{
+		std::string path;
+		std::vector<unsigned char> data;
+	};
+	std::vector<PendingFile> files;
+
+	static uint64_t align(uint64_t value)
+	{
+		return (value + PACK_ALIGNMENT - 1) & ~(uint64_t)(PACK_ALIGNMENT - 1);
+	}
+
+	static void pad(std::ofstream& file, uint64_t target)
+	{
+		static const char zeros[PACK_ALIGNMENT] = {};
+		uint64_t current = (uint64_t)file.tellp();
+		if (target > current)
+		{
+			file.write(zeros, target - current);
+		}
+	}
+};
+
+// Read-only view of a mounted pack. The whole file is memory mapped once; raw entries are
+// returned as pointers into the mapping, compressed ones are decoded into the caller's buffer.
+class PackReader
+{
+public:
+	PackHeader header = {};
+	std::vector<PackEntry> entries;
+	std::vector<uint32_t> buckets;
+	std::string names;
+
+	PackReader() {}
+	PackReader(const PackReader&) = delete;
+	PackReader& operator=(const PackReader&) = delete;
+
+	~PackReader()
+	{
+		unmap();
+	}
+
+	// Fails on a truncated or corrupt table of contents: every offset, size and bucket index is
+	// checked against the mapped file before find() or read() can follow it
+	bool open(const std::string& filename)
+	{
+		unmap();
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.read(reinterpret_cast<char*>(&header), sizeof(PackHeader));
+		if (!file || header.magic != PACK_MAGIC || header.version != PACK_VERSION ||
+			header.bucketCount == 0 || (header.bucketCount & (header.bucketCount - 1)) != 0)
+		{
+			return false;
+		}
+		if (!map(filename))
+		{
+			unmap();
+			return false;
+		}
+		// Sizes before allocating, so a bad count can't ask for gigabytes
+		uint64_t tocSize = (uint64_t)header.entryCount * sizeof(PackEntry) + (uint64_t)header.bucketCount * sizeof(uint32_t);
+		if (header.tocOffset > mappedSize || tocSize > mappedSize - header.tocOffset ||
+			header.namesSize > mappedSize - header.tocOffset - tocSize)
+		{
+			unmap();
+			return false;
+		}
+		entries.resize(header.entryCount);
+		buckets.resize(header.bucketCount);
+		names.resize((size_t)header.namesSize);
+		file.seekg((std::streamoff)header.tocOffset);
+		if (header.entryCount > 0)
+		{
+			file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(PackEntry));
+		}
+		file.read(reinterpret_cast<char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+		if (!names.empty())
+		{
+			file.read(&names[0], names.size());
+		}
+		if (!file || !validate())
+		{
+			unmap();
+			return false;
+		}
+		return true;
+	}
+
+	const PackEntry* find(const std::string& path) const
+	{
+		if (buckets.empty())
+		{
+			return nullptr;
+		}
+		std::string normalised = packNormalisePath(path);
+		uint64_t hash = packHashPath(normalised);
+		uint32_t mask = header.bucketCount - 1;
+		// At most one lap, so a table with no empty bucket still ends
+		uint32_t b = (uint32_t)hash & mask;
+		for (uint32_t probe = 0; probe < header.bucketCount; probe++, b = (b + 1) & mask)
+		{
+			uint32_t index = buckets[b];
+			if (index == PACK_EMPTY_BUCKET)
+			{
+				return nullptr;
+			}
+			const PackEntry& entry = entries[index];
+			if (entry.hash == hash && normalised == packNormalisePath(&names[entry.nameOffset]))
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	// Zero-copy access to an uncompressed entry; nullptr if the entry is compressed
+	const unsigned char* view(const PackEntry& entry) const
+	{
+		if (entry.flags != PACK_ENTRY_RAW || mapped == nullptr)
+		{
+			return nullptr;
+		}
+		return mapped + entry.offset;
+	}
+
+	bool read(const PackEntry& entry, std::string& out) const
+	{
+		if (mapped == nullptr || entry.offset + entry.storedSize > mappedSize)
+		{
+			return false;
+		}
+		out.resize(entry.originalSize);
+		if (entry.originalSize == 0)
+		{
+			return true;
+		}
+		const unsigned char* src = mapped + entry.offset;
+		if (entry.flags == PACK_ENTRY_RAW)
+		{
+			memcpy(&out[0], src, entry.originalSize);
+			return true;
+		}
+		return PackCompressor::decompress(src, entry.storedSize, reinterpret_cast<unsigned char*>(&out[0]), entry.originalSize);
+	}
+
+	const char* entryName(const PackEntry& entry) const
+	{
+		return &names[entry.nameOffset];
+	}
+
+private:
+	const unsigned char* mapped = nullptr;
+	uint64_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	HANDLE mappingHandle = NULL;
+#endif
+
+	// Every bucket names an entry, every name ends inside the blob and every entry's data lies
+	// inside the file; raw entries are stored at their original size
+	bool validate() const
+	{
+		if (!names.empty() && names.back() != '\0')
+		{
+			return false;
+		}
+		for (uint32_t index : buckets)
+		{
+			if (index != PACK_EMPTY_BUCKET && index >= header.entryCount)
+			{
+				return false;
+			}
+		}
+		for (const PackEntry& entry : entries)
+		{
+			bool sized = entry.flags == PACK_ENTRY_LZ || (entry.flags == PACK_ENTRY_RAW && entry.storedSize == entry.originalSize);
+			if (!sized || entry.nameOffset >= names.size() || entry.offset > mappedSize || entry.storedSize > mappedSize - entry.offset)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool map(const std::string& filename)
+	{
+#ifdef _WIN32
+		fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(fileHandle, &size);
+		mappedSize = (uint64_t)size.QuadPart;
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL)
+		{
+			return false;
+		}
+		mapped = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		fstat(fd, &st);
+		mappedSize = (uint64_t)st.st_size;
+		void* p = mmap(NULL, (size_t)mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		mapped = (p == MAP_FAILED) ? nullptr : (const unsigned char*)p;
+#endif
+		return mapped != nullptr;
+	}
+
+	void unmap()
+	{
+#ifdef _WIN32
+		if (mapped)
+		{
+			UnmapViewOfFile(mapped);
+		}
+		if (mappingHandle)
+		{
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(fileHandle);
+		}
+		mappingHandle = NULL;
+		fileHandle = INVALID_HANDLE_VALUE;
+#else
+		if (mapped)
+		{
+			munmap((void*)mapped, (size_t)mappedSize);
+		}
+#endif
+		mapped = nullptr;
+		mappedSize = 0;
+	}
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+#include <vector>
+
+// Records a sorted draw list on several threads. The list is cut into contiguous chunks, each
+// recorded into a command recorder of its own as a job; submitting the recorders in chunk order
+// then draws in exactly the single-threaded order. Every chunk starts with nothing bound, so it
+// sets its own render pass state and re-binds at its first draw. Backend-neutral: Core supplies
+// one D3D12 command list per chunk, the benchmarks RecordingBackends.
+struct RecordingChunk
+{
+	unsigned int begin;
+	unsigned int end;
+};
+
+class ChunkedRecording
+{
+public:
+	std::vector<RecordingChunk> chunks;
+
+	// Up to 'maxChunks' near-equal ranges, none shorter than 'minDraws' (the re-binds at the start
+	// of a chunk and the list itself have to pay off), so short lists use fewer chunks
+	void split(unsigned int count, unsigned int maxChunks, unsigned int minDraws)
+	{
+		chunks.clear();
+		if (count == 0)
+		{
+			return;
+		}
+		unsigned int n = minDraws > 0 ? count / minDraws : count;
+		n = n < 1 ? 1 : (n > maxChunks ? maxChunks : n);
+		unsigned int begin = 0;
+		for (unsigned int k = 0; k < n; k++)
+		{
+			unsigned int end = (unsigned int)((unsigned long long)count * (k + 1) / n);
+			chunks.push_back({ begin, end });
+			begin = end;
+		}
+	}
+
+	// Calls record(chunk, begin, end) for every chunk; in parallel when given a job system
+	template<typename F>
+	void record(JobSystem* jobs, const F& record) const
+	{
+		if (!jobs || chunks.size() < 2)
+		{
+			for (unsigned int k = 0; k < chunks.size(); k++)
+			{
+				record(k, chunks[k].begin, chunks[k].end);
+			}
+			return;
+		}
+		jobs->parallelFor((unsigned int)chunks.size(), 1, [this, &record](unsigned int b, unsigned int e) {
+			for (unsigned int k = b; k < e; k++)
+			{
+				record(k, chunks[k].begin, chunks[k].end);
+			}
+		});
+	}
+};
@@ -0,0 +1,54 @@
+// Anti-Gravity particles, instanced: one cube per instance, placed and sized from the instance
+// stream and tinted by remaining life. Both stages live here; LoadShaders gets this file twice.
+
+cbuffer particleBuffer : register(b0)
+{
+    float4x4 VP;      // View * Projection Matrix
+    float time;       // Time in seconds
+    float3 cameraPos; // Camera Position
+};
+
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+
+    float4 Instance : INSTANCE; // xyz position, w scale
+    float Life : LIFE;
+};
+
+struct PS_INPUT
+{
+    float4 Pos : SV_POSITION;
+    float3 Normal : NORMAL;
+    float Life : LIFE;
+};
+
+PS_INPUT VS(VS_INPUT input)
+{
+    PS_INPUT output;
+
+    // Same floating wave as VertexShader.hlsl, in cube space
+    float4 animatedPos = input.Pos;
+    float offset = animatedPos.x * 0.5f + animatedPos.z * 0.3f;
+    animatedPos.y += sin(time * 1.5f + offset) * 0.5f;
+
+    // Particles never rotate: scale, then translate
+    float3 worldPos = animatedPos.xyz * input.Instance.w + input.Instance.xyz;
+    output.Pos = mul(float4(worldPos, 1.0f), VP);
+    output.Normal = input.Normal;
+    output.Life = input.Life;
+
+    return output;
+}
+
+float4 PS(PS_INPUT input) : SV_Target0
+{
+    // Directional light as in PixelShader.hlsl; fresh particles are warm white, old ones cyan
+    float3 lightDir = normalize(float3(0.5, 1.0, -0.5));
+    float diff = max(dot(normalize(input.Normal), lightDir), 0.0);
+    float3 colour = lerp(float3(0.2, 0.6, 1.0), float3(1.0, 0.95, 0.9), saturate(input.Life));
+    return float4(colour * (0.3f + diff), 1.0);
+}
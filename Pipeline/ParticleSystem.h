@@ -1,21 +1,44 @@
 #pragma once
 #include "Cube.h"
+#include "DynamicVertexBuffer.h"
+#include "GPUResources.h"
+#include "JobSystem.h"
+#include "PipeLineState.h"
+#include "Shader.h"
 #include <vector>
 #include <cstdlib>
 
 struct Particle {
     Vec3 pos;
+    Vec3 prevPos; // position before the last update, for render interpolation
     Vec3 velocity;
     float life;
 };
 
+// Per-instance stream for ParticleShader.hlsl (VertexLayoutCache::getParticleLayout)
+struct ParticleInstance {
+    Vec3 position;
+    float scale;
+    float life;
+};
+static_assert(sizeof(ParticleInstance) == 5 * sizeof(float), "matches the INSTANCE + LIFE layout");
+
 class ParticleSystem {
 public:
-    Cube cubeRenderer;
+    Cube cube; // geometry only; every particle is an instance of it
     std::vector<Particle> particles;
+    unsigned int particlesPerJob = 2048;
+    float particleScale = 0.05f;
 
     void init(Core* core, int count) {
-        cubeRenderer.init(core);
+        cube.initMesh(core);
+        Shader program;
+        program.LoadShaders("ParticleShader.hlsl", "ParticleShader.hlsl");
+        program.ReflectShaders(core, program.pixelShader, false);
+        program.ReflectShaders(core, program.vertexShader, true);
+        psos.createPSO(core, "Particles", program.vertexShader, program.pixelShader, VertexLayoutCache::getParticleLayout());
+        shader = GPUResources::instance().shaders.create(program);
+
         particles.clear();
         particles.reserve(count);
         for (int i = 0; i < count; ++i) {
@@ -24,20 +47,21 @@ public:
             float y = (float)(rand() % 400 - 200) / 10.0f;
             float z = (float)(rand() % 400 - 200) / 10.0f;
             p.pos = Vec3(x, y, z);
+            p.prevPos = p.pos;
             p.velocity = Vec3(((rand() % 100) - 50) / 50.0f, ((rand() % 100) - 50) / 50.0f, ((rand() % 100) - 50) / 50.0f);
             p.life = (rand() % 100) / 100.0f;
             particles.push_back(p);
         }
     }
 
-    void update(float dt) {
-        for (auto &p : particles) {
-            p.pos.y += p.velocity.y * dt;
-            if (p.pos.y > 20.0f) {
-                p.pos.y = -20.0f;
-                p.pos.x = (float)(rand() % 400 - 200) / 10.0f;
-                p.pos.z = (float)(rand() % 400 - 200) / 10.0f;
-            }
+    // Particles are independent, so with a job system the array is split into ranges
+    void update(float dt, JobSystem* jobs = nullptr) {
+        unsigned int count = (unsigned int)particles.size();
+        unsigned int seed = ++frame * 0x9E3779B9u;
+        if (jobs && count >= 2 * particlesPerJob) {
+            jobs->parallelFor(count, particlesPerJob, [this, dt, seed](unsigned int b, unsigned int e) { updateRange(b, e, dt, seed); });
+        } else {
+            updateRange(0, count, dt, seed);
         }
     }
 
@@ -45,18 +69,81 @@ public:
         for (int i = 0; i < count; ++i) {
             Particle p;
             p.pos = position;
+            p.prevPos = position;
             p.velocity = Vec3(((rand() % 200) - 100) / 50.0f, ((rand() % 200)) / 50.0f, ((rand() % 200) - 100) / 50.0f);
             p.life = 1.0f; // could implement life-based fade
             particles.push_back(p);
         }
     }
 
-    void draw(Core* core, Matrix& vp, float time, const Vec3& camPos) {
-        for (auto &p : particles) {
-            Matrix w;
-            w.translation(p.pos);
-            w.scaling(Vec3(0.05f, 0.05f, 0.05f));
-            cubeRenderer.draw(core, w, vp, time, camPos);
+    // 'alpha' blends from the previous to the current update (1 = latest state)
+    void draw(Core* core, Matrix& vp, float time, const Vec3& camPos, float alpha = 1.0f) {
+        draw(core, particles, vp, time, camPos, alpha);
+    }
+
+    // Draws a copy of the particle array, e.g. from a render snapshot taken after a tick. One
+    // linear pass writes this frame's instance stream, then a single instanced draw covers it.
+    void draw(Core* core, const std::vector<Particle>& list, Matrix& vp, float time, const Vec3& camPos, float alpha) {
+        Shader* program = GPUResources::instance().shaders.get(shader);
+        unsigned int count = (unsigned int)list.size();
+        if (count == 0 || !program) return;
+
+        ParticleInstance* out = (ParticleInstance*)instanceBuffer.map(core, count, sizeof(ParticleInstance));
+        for (unsigned int i = 0; i < count; ++i) {
+            const Particle &p = list[i];
+            ParticleInstance instance;
+            instance.position = lerp(p.prevPos, p.pos, alpha);
+            instance.scale = particleScale;
+            instance.life = p.life;
+            out[i] = instance;
+        }
+
+        core->beginRenderPass();
+        if (program->vsConstantBuffers.size() > 0) {
+            program->vsConstantBuffers[0]->update("VP", &vp);
+            program->vsConstantBuffers[0]->update("time", (void*)&time);
+            program->vsConstantBuffers[0]->update("cameraPos", (void*)&camPos);
+        }
+        program->apply(core);
+        psos.bind(core, "Particles");
+        core->commands().setVertexBuffer(1, instanceBuffer.view(count));
+        cube.mesh.draw(core, count, 0);
+    }
+
+    // Shutdown, after flushGraphicsQueue()
+    void release() {
+        instanceBuffer.release();
+        GPUResources::instance().release(shader);
+        shader = ShaderHandle();
+        psos.release();
+        cube.mesh.release();
+    }
+
+private:
+    unsigned int frame = 0;
+    DynamicVertexBuffer instanceBuffer;
+    PSOManager psos;
+    ShaderHandle shader;
+
+    // Stateless per-particle random in [0, 1): rand() is shared state and can't run on jobs
+    static float hashRandom(unsigned int x) {
+        x ^= x >> 16; x *= 0x7FEB352Du;
+        x ^= x >> 15; x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        return (x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void updateRange(unsigned int begin, unsigned int end, float dt, unsigned int seed) {
+        for (unsigned int i = begin; i < end; ++i) {
+            Particle &p = particles[i];
+            p.prevPos = p.pos;
+            p.pos.y += p.velocity.y * dt;
+            if (p.pos.y > 20.0f) {
+                p.pos.y = -20.0f;
+                p.pos.x = hashRandom(seed ^ (i * 2u)) * 40.0f - 20.0f;
+                p.pos.z = hashRandom(seed ^ (i * 2u + 1u)) * 40.0f - 20.0f;
+                p.prevPos = p.pos; // don't interpolate across the wrap
+            }
         }
     }
 };
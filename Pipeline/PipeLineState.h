@@ -1,14 +1,15 @@
 #pragma once
 
 #include "core.h"
+#include "GPUResources.h"
 #include <unordered_map>
 #include "string"
 
-// Pipeline State Manager
+// Pipeline State Manager. The states live in GPUResources::psos; this maps names to handles.
 class PSOManager
 {
 public:
-	std::unordered_map<std::string, ID3D12PipelineState*> psos;
+	std::unordered_map<std::string, PSOHandle> psos;
 
 	void createPSO(Core* core, std::string name, ID3DBlob* vs, ID3DBlob* ps, D3D12_INPUT_LAYOUT_DESC layout)
 	{
@@ -80,13 +81,27 @@ public:
 		HRESULT hr = core->device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso));
 
 		// Insert into map
-		psos.insert({ name, pso });
+		psos.insert({ name, GPUResources::instance().psos.create(pso) });
 
 	}
 
-	void bind(Core* core, std::string name)
+	// Read-only lookup, so recording threads can bind concurrently
+	void bind(Core* core, const std::string& name)
 	{
-		core->getCommandList()->SetPipelineState(psos[name]);
+		auto it = psos.find(name);
+		if (it == psos.end()) return;
+		ID3D12PipelineState** pso = GPUResources::instance().psos.get(it->second);
+		if (pso) core->commands().setPipelineState(*pso);
+	}
+
+	// Hands every state back for deferred destruction
+	void release()
+	{
+		for (auto& entry : psos)
+		{
+			GPUResources::instance().release(entry.second);
+		}
+		psos.clear();
 	}
 
 };
\ No newline at end of file
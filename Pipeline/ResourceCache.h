@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+// Owns exactly one T per key (a model file), addressed by a small index that instances store
+// instead of a copy. acquire()/release() count users; the last release destroys the resource and
+// recycles its index. Resources that were never acquired stay until clear().
+template<typename T>
+class ResourceCache
+{
+public:
+	ResourceCache() = default;
+	ResourceCache(const ResourceCache&) = delete;
+	ResourceCache& operator=(const ResourceCache&) = delete;
+
+	// -1 when nothing is cached under 'key'
+	int find(const std::string& key) const
+	{
+		auto it = index.find(key);
+		return it != index.end() ? (int)it->second : -1;
+	}
+
+	// Takes ownership; the new entry has no references
+	unsigned int add(const std::string& key, T* resource)
+	{
+		unsigned int slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			slot = (unsigned int)entries.size();
+			entries.emplace_back();
+		}
+		Entry& e = entries[slot];
+		e.resource.reset(resource);
+		e.key = key;
+		e.refs = 0;
+		index.insert({ key, slot });
+		return slot;
+	}
+
+	T* operator[](unsigned int slot) const
+	{
+		return entries[slot].resource.get();
+	}
+
+	void acquire(unsigned int slot)
+	{
+		entries[slot].refs++;
+	}
+
+	// Returns true when this was the last reference and the resource was destroyed
+	bool release(unsigned int slot)
+	{
+		Entry& e = entries[slot];
+		if (e.refs == 0 || --e.refs > 0)
+		{
+			return false;
+		}
+		index.erase(e.key);
+		e.resource.reset();
+		e.key.clear();
+		freeSlots.push_back(slot);
+		return true;
+	}
+
+	unsigned int refs(unsigned int slot) const
+	{
+		return entries[slot].refs;
+	}
+
+	// Slots, including recycled ones (null until reused)
+	unsigned int capacity() const
+	{
+		return (unsigned int)entries.size();
+	}
+
+	// Live resources
+	unsigned int size() const
+	{
+		return (unsigned int)index.size();
+	}
+
+	// Calls f(resource) for every live resource
+	template<typename F>
+	void forEach(F f) const
+	{
+		for (const Entry& e : entries)
+		{
+			if (e.resource)
+			{
+				f(*e.resource);
+			}
+		}
+	}
+
+	void clear()
+	{
+		entries.clear();
+		index.clear();
+		freeSlots.clear();
+	}
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<T> resource;
+		std::string key;
+		unsigned int refs = 0;
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, unsigned int> index;
+	std::vector<unsigned int> freeSlots;
+};
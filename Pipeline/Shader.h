@@ -1,5 +1,6 @@
 #pragma once
 #include "ConstantBufferClass.h"
+#include "VirtualFileSystem.h"
 #include <fstream>
 #include <sstream>
 
@@ -9,19 +10,18 @@ class Shader
 public:
 
 	// Vertex and pixel shader - member variables
-	ID3DBlob* vertexShader;
-	ID3DBlob* pixelShader;
+	ID3DBlob* vertexShader = nullptr;
+	ID3DBlob* pixelShader = nullptr;
 
 	std::vector<ConstantBufferClass *> vsConstantBuffers;
 	std::vector<ConstantBufferClass *> psConstantBuffers;
 
-	// Function to read in a file
+	// Function to read in a file (pack or loose)
 	string ReadFile(string filename)
 	{
-		std::ifstream file(filename);
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		return buffer.str();
+		std::string source;
+		VirtualFileSystem::instance().readFile(filename, source);
+		return source;
 	}
 
 	// pass in shaders by filename
@@ -69,20 +69,16 @@ public:
 			D3D12_SHADER_BUFFER_DESC cbDesc;
 			constantBuffer->GetDesc(&cbDesc);
 			buffer->name = cbDesc.Name;
-			unsigned int totalSize = 0;
+			buffer->layoutSize = cbDesc.Size;
 
 			for (int j = 0; j < cbDesc.Variables; j++)
 			{
 				ID3D12ShaderReflectionVariable* var = constantBuffer->GetVariableByIndex(j);
 				D3D12_SHADER_VARIABLE_DESC vDesc;
 				var->GetDesc(&vDesc);
-				ConstantBufferVariable bufferVariable;
-				bufferVariable.offset = vDesc.StartOffset;
-				bufferVariable.size = vDesc.Size;
-				buffer->constantBufferData.insert({ vDesc.Name, bufferVariable });
-				totalSize += bufferVariable.size;
+				buffer->addVariable(vDesc.Name, vDesc.StartOffset, vDesc.Size);
 			}
-			buffer->init(core, totalSize, 1024);
+			buffer->init(cbDesc.Size);
 			if (isVS)
 			{
 				vsConstantBuffers.push_back(buffer);
@@ -95,18 +91,58 @@ public:
 		reflection->Release();
 	}
 
+	// Frees the blobs and constant buffers; the GPU must be finished with them
+	void release()
+	{
+		for (ConstantBufferClass* buffer : vsConstantBuffers)
+		{
+			buffer->release();
+			delete buffer;
+		}
+		for (ConstantBufferClass* buffer : psConstantBuffers)
+		{
+			buffer->release();
+			delete buffer;
+		}
+		vsConstantBuffers.clear();
+		psConstantBuffers.clear();
+		if (vertexShader) vertexShader->Release();
+		if (pixelShader) pixelShader->Release();
+		vertexShader = nullptr;
+		pixelShader = nullptr;
+	}
+
+	// Buffers whose staged values haven't changed since their last entry this frame rebind that
+	// entry, which the recorder then skips
 	void apply(Core* core)
 	{
 		for (int i = 0; i < vsConstantBuffers.size(); i++)
 		{
-			core->getCommandList()->SetGraphicsRootConstantBufferView(0, vsConstantBuffers[i]->getGPUAddress());
-			vsConstantBuffers[i]->next();
+			core->commands().setRootConstantBuffer(0, vsConstantBuffers[i]->current(core).address);
+		}
+
+		for (int i = 0; i < psConstantBuffers.size(); i++)
+		{
+			core->commands().setRootConstantBuffer(1, psConstantBuffers[i]->current(core).address);
+		}
+	}
+
+	// apply() for one draw that may be recorded on any thread: fill(buffer, entry) writes every
+	// variable of the first vertex shader buffer's entry; the other buffers share their current()
+	// entry, so per-pass pixel constants cost one entry and one bind per recording chunk
+	template<typename Fill>
+	void applyDraw(Core* core, const Fill& fill)
+	{
+		for (int i = 0; i < vsConstantBuffers.size(); i++)
+		{
+			ConstantAllocation entry = i == 0 ? vsConstantBuffers[i]->reserve(core) : vsConstantBuffers[i]->current(core);
+			if (i == 0) fill(*vsConstantBuffers[i], entry);
+			core->commands().setRootConstantBuffer(0, entry.address);
 		}
 
 		for (int i = 0; i < psConstantBuffers.size(); i++)
 		{
-			core->getCommandList()->SetGraphicsRootConstantBufferView(1, psConstantBuffers[i]->getGPUAddress());
-			psConstantBuffers[i]->next();
+			core->commands().setRootConstantBuffer(1, psConstantBuffers[i]->current(core).address);
 		}
 	}
 };
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Offsets into a fixed-size staging buffer, handed out in ring order. Allocations since the last
+// close() form a batch tagged with the fence value that signals its copies are done; reclaim()
+// frees whole batches, oldest first, once the fence has passed them. Nothing here touches the
+// memory itself, so the same ring drives the D3D12 upload buffer and the headless benchmark.
+class StagingRing
+{
+public:
+	static constexpr size_t FAILED = ~(size_t)0;
+
+	void init(size_t _capacity)
+	{
+		capacity = _capacity;
+		head = tail = used = open = 0;
+		batches.clear();
+	}
+
+	// Offset of 'size' bytes aligned to 'alignment' (a power of two), or FAILED when there is no
+	// room until older batches are reclaimed; a request larger than the ring always fails
+	size_t allocate(size_t size, size_t alignment)
+	{
+		if (used == 0)
+		{
+			head = tail = 0;
+		}
+		size_t offset = (head + alignment - 1) & ~(alignment - 1);
+		size_t taken;
+		if (head >= tail && !(head == tail && used > 0))
+		{
+			// Free space is [head, capacity) then [0, tail)
+			if (offset + size <= capacity)
+			{
+				taken = offset + size - head;
+			}
+			else if (size <= tail)
+			{
+				offset = 0;
+				taken = capacity - head + size;   // the end of the buffer is skipped
+			}
+			else
+			{
+				return FAILED;
+			}
+		}
+		else
+		{
+			// Free space is [head, tail)
+			if (offset + size > tail)
+			{
+				return FAILED;
+			}
+			taken = offset + size - head;
+		}
+		head = offset + size;
+		used += taken;
+		open += taken;
+		return offset;
+	}
+
+	// Everything allocated since the last close is free once 'fenceValue' completes
+	void close(uint64_t fenceValue)
+	{
+		if (open == 0)
+		{
+			return;
+		}
+		batches.push_back({ head, open, fenceValue });
+		open = 0;
+	}
+
+	void reclaim(uint64_t completedValue)
+	{
+		while (!batches.empty() && batches.front().fence <= completedValue)
+		{
+			tail = batches.front().end;
+			used -= batches.front().bytes;
+			batches.pop_front();
+		}
+	}
+
+	// Fence value to wait for to free the oldest batch; 0 when nothing is in flight
+	uint64_t oldestPending() const
+	{
+		return batches.empty() ? 0 : batches.front().fence;
+	}
+
+	size_t size() const
+	{
+		return capacity;
+	}
+
+	size_t bytesUsed() const
+	{
+		return used;
+	}
+
+	// Allocated since the last close
+	size_t bytesOpen() const
+	{
+		return open;
+	}
+
+private:
+	struct Batch
+	{
+		size_t end;
+		size_t bytes;
+		uint64_t fence;
+	};
+
+	size_t capacity = 0;
+	size_t head = 0;   // next free byte
+	size_t tail = 0;   // start of the oldest live batch
+	size_t used = 0;   // bytes between tail and head, including skipped ends
+	size_t open = 0;   // bytes allocated since the last close
+	std::deque<Batch> batches;
+};
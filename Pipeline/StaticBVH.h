@@ -0,0 +1,314 @@
+#pragma once
+#include "EntityRegistry.h"
+#include <vector>
+
+// Static bounding volume hierarchy over world-space boxes, built once with a binned surface area
+// heuristic. Each primitive carries a 32-bit user value (the game stores Entity ids) that
+// queries hand back, so only nearby candidates reach the narrow phase.
+class StaticBVH
+{
+public:
+	struct Node
+	{
+		WorldBounds bounds;
+		unsigned int first;   // leaf: first primitive, interior: left child (right is first + 1)
+		unsigned int count;   // primitives in a leaf, 0 for interior nodes
+	};
+
+	std::vector<Node> nodes;
+
+	// Query statistics from the last query, for tuning
+	unsigned int nodesVisited = 0;
+
+	void build(const std::vector<WorldBounds>& bounds, const std::vector<unsigned int>& values)
+	{
+		unsigned int count = (unsigned int)bounds.size();
+		primBounds = bounds;
+		primValues = values;
+		order.resize(count);
+		centres.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			order[i] = i;
+			centres[i] = bounds[i].centre();
+		}
+		nodes.clear();
+		if (count == 0)
+		{
+			return;
+		}
+		nodes.reserve(2 * count);
+		nodes.push_back(Node());
+		nodes[0].first = 0;
+		nodes[0].count = count;
+		subdivide(0);
+
+		// Reorder payloads so leaves read contiguous memory
+		std::vector<WorldBounds> sortedBounds(count);
+		std::vector<unsigned int> sortedValues(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			sortedBounds[i] = primBounds[order[i]];
+			sortedValues[i] = primValues[order[i]];
+		}
+		primBounds.swap(sortedBounds);
+		primValues.swap(sortedValues);
+		centres.clear();
+		order.clear();
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)primValues.size();
+	}
+
+	// Refit after primitives moved without changing the topology: 'boundsOf(value, oldBounds)'
+	// returns each primitive's new box. Children always follow their parent in 'nodes', so one
+	// reverse pass rebuilds every node box. Query quality degrades if things move far.
+	template<typename BoundsOf>
+	void refit(BoundsOf boundsOf)
+	{
+		for (size_t i = 0; i < primValues.size(); i++)
+		{
+			primBounds[i] = boundsOf(primValues[i], primBounds[i]);
+		}
+		for (size_t n = nodes.size(); n-- > 0;)
+		{
+			Node& node = nodes[n];
+			node.bounds = emptyBounds();
+			if (node.count > 0)
+			{
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					grow(node.bounds, primBounds[i]);
+				}
+			}
+			else
+			{
+				grow(node.bounds, nodes[node.first].bounds);
+				grow(node.bounds, nodes[node.first + 1].bounds);
+			}
+		}
+	}
+
+	// Primitives whose box contains 'p'
+	template<typename Visitor>
+	void queryPoint(const Vec3& p, Visitor visit)
+	{
+		WorldBounds box = { p, p };
+		query(box, [&](const WorldBounds& b) { return b.contains(p); }, visit);
+	}
+
+	// Primitives whose box overlaps the sphere
+	template<typename Visitor>
+	void querySphere(const Vec3& centre, float radius, Visitor visit)
+	{
+		float r2 = radius * radius;
+		WorldBounds box = { centre - Vec3(radius, radius, radius), centre + Vec3(radius, radius, radius) };
+		query(box, [&](const WorldBounds& b) { return distanceSquared(b, centre) <= r2; }, visit);
+	}
+
+	// Primitives whose box overlaps 'box'
+	template<typename Visitor>
+	void queryAABB(const WorldBounds& box, Visitor visit)
+	{
+		query(box, [&](const WorldBounds& b) { return b.overlaps(box); }, visit);
+	}
+
+	// Squared distance from a point to a box (0 inside)
+	static float distanceSquared(const WorldBounds& b, const Vec3& p)
+	{
+		float d = 0.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			float v = p.v[a];
+			if (v < b.min.v[a]) d += SQ(b.min.v[a] - v);
+			else if (v > b.max.v[a]) d += SQ(v - b.max.v[a]);
+		}
+		return d;
+	}
+
+private:
+	static constexpr unsigned int LEAF_SIZE = 4;
+	static constexpr int BINS = 12;
+
+	std::vector<WorldBounds> primBounds;
+	std::vector<unsigned int> primValues;
+	std::vector<unsigned int> order;   // build only
+	std::vector<Vec3> centres;         // build only
+	std::vector<unsigned int> stack;   // traversal scratch, reused between queries
+
+	static WorldBounds emptyBounds()
+	{
+		WorldBounds b;
+		b.min = Vec3(1e30f, 1e30f, 1e30f);
+		b.max = Vec3(-1e30f, -1e30f, -1e30f);
+		return b;
+	}
+
+	static void grow(WorldBounds& b, const WorldBounds& other)
+	{
+		b.min = Vec3::Min(b.min, other.min);
+		b.max = Vec3::Max(b.max, other.max);
+	}
+
+	static float halfArea(const WorldBounds& b)
+	{
+		Vec3 e = b.extent();
+		if (e.x < 0.0f) return 0.0f;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	void subdivide(unsigned int nodeIndex)
+	{
+		unsigned int first = nodes[nodeIndex].first;
+		unsigned int count = nodes[nodeIndex].count;
+
+		WorldBounds nodeBounds = emptyBounds();
+		WorldBounds centreBounds = emptyBounds();
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			grow(nodeBounds, primBounds[order[i]]);
+			Vec3 c = centres[order[i]];
+			centreBounds.min = Vec3::Min(centreBounds.min, c);
+			centreBounds.max = Vec3::Max(centreBounds.max, c);
+		}
+		nodes[nodeIndex].bounds = nodeBounds;
+		if (count <= LEAF_SIZE)
+		{
+			return;
+		}
+
+		// Binned SAH: evaluate BINS-1 split planes on each axis
+		int bestAxis = -1;
+		int bestSplit = 0;
+		float bestCost = halfArea(nodeBounds) * (float)count;   // cost of keeping a leaf
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float lo = centreBounds.min.v[axis];
+			float hi = centreBounds.max.v[axis];
+			if (hi <= lo)
+			{
+				continue;
+			}
+			WorldBounds binBounds[BINS];
+			unsigned int binCount[BINS] = {};
+			for (int b = 0; b < BINS; b++)
+			{
+				binBounds[b] = emptyBounds();
+			}
+			float scale = (float)BINS / (hi - lo);
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				int b = binOf(centres[order[i]].v[axis], lo, scale);
+				binCount[b]++;
+				grow(binBounds[b], primBounds[order[i]]);
+			}
+
+			// Sweep from the right to get suffix areas, then from the left
+			float rightArea[BINS];
+			unsigned int rightCount[BINS];
+			WorldBounds acc = emptyBounds();
+			unsigned int n = 0;
+			for (int b = BINS - 1; b > 0; b--)
+			{
+				grow(acc, binBounds[b]);
+				n += binCount[b];
+				rightArea[b] = halfArea(acc);
+				rightCount[b] = n;
+			}
+			acc = emptyBounds();
+			n = 0;
+			for (int b = 0; b < BINS - 1; b++)
+			{
+				grow(acc, binBounds[b]);
+				n += binCount[b];
+				float cost = halfArea(acc) * (float)n + rightArea[b + 1] * (float)rightCount[b + 1];
+				if (n > 0 && rightCount[b + 1] > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+		if (bestAxis < 0)
+		{
+			return;
+		}
+
+		// Partition 'order' around the chosen plane
+		float lo = centreBounds.min.v[bestAxis];
+		float scale = (float)BINS / (centreBounds.max.v[bestAxis] - lo);
+		unsigned int i = first;
+		unsigned int j = first + count;
+		while (i < j)
+		{
+			if (binOf(centres[order[i]].v[bestAxis], lo, scale) < bestSplit)
+			{
+				i++;
+			}
+			else
+			{
+				std::swap(order[i], order[--j]);
+			}
+		}
+		unsigned int leftCount = i - first;
+
+		unsigned int left = (unsigned int)nodes.size();
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		nodes[left].first = first;
+		nodes[left].count = leftCount;
+		nodes[left + 1].first = i;
+		nodes[left + 1].count = count - leftCount;
+		nodes[nodeIndex].first = left;
+		nodes[nodeIndex].count = 0;
+		subdivide(left);
+		subdivide(left + 1);
+	}
+
+	static int binOf(float v, float lo, float scale)
+	{
+		int b = (int)((v - lo) * scale);
+		return b < 0 ? 0 : (b >= BINS ? BINS - 1 : b);
+	}
+
+	// Iterative traversal; 'test' is the exact primitive/node predicate, 'box' a conservative cull
+	template<typename Test, typename Visitor>
+	void query(const WorldBounds& box, Test test, Visitor visit)
+	{
+		nodesVisited = 0;
+		if (nodes.empty())
+		{
+			return;
+		}
+		stack.clear();
+		stack.push_back(0);
+		while (!stack.empty())
+		{
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			nodesVisited++;
+			if (!node.bounds.overlaps(box) || !test(node.bounds))
+			{
+				continue;
+			}
+			if (node.count > 0)
+			{
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					if (test(primBounds[i]))
+					{
+						visit(primValues[i]);
+					}
+				}
+			}
+			else
+			{
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+			}
+		}
+	}
+};
@@ -6,53 +6,119 @@
 #include "GEMLoader.h"
 #include"Shader.h"
 #include"PipeLineState.h"
+#include "MaterialTable.h"
+#include "VirtualFileSystem.h"
+#include "MeshBVH.h"
+#include "GPUResources.h"
+#include "DrawList.h"
+#include <cstddef>
     
 
+// A loaded model: GPU buffers, render state and collision data. One exists per model file
+// (owned by LevelLoader's prototype cache); instances are entities that store its index and a
+// world matrix, so a prototype is never copied.
 class StaticMesh
 {
 
 public:
+    // GPU objects live in GPUResources' pools; the prototype holds handles
     PSOManager psos;
-    std::vector<Mesh*> meshes;
-    Shader shader;
+    std::vector<MeshHandle> meshes;
+    std::vector<MaterialTable::MaterialID> materials; // one per submesh, compiled at load
+    ShaderHandle shader;
+    unsigned int psoKey = 0; // PSO field of this prototype's draw keys
 
-	// World Matrix for this mesh instance
-	Matrix worldMatrix; 
-    std::string type = "static"; // "static", "collectible", "player", etc.
-    
     struct AABB {
         Vec3 min;
         Vec3 max;
         AABB() { min = Vec3(1e9f, 1e9f, 1e9f); max = Vec3(-1e9f, -1e9f, -1e9f); }
     } localAABB;
 
-    StaticMesh() {
-        // Ensure worldMatrix is identity by default using constructor
+    // Local-space padding applied to localAABB for player collision
+    float collisionPadding = 0.5f;
+
+    // Model-space triangle BVH, shared by every instance drawn with this prototype
+    MeshBVH collisionBVH;
+
+    // VertexShader.hlsl's staticMeshBuffer as a C++ struct, written per draw in one copy
+    struct Constants {
+        Matrix W;
+        Matrix VP;
+        float time;
+        Vec3 cameraPos;
+    };
+
+    // Checked against the reflected layout at load; on a mismatch draws fall back to per-variable
+    // writes through handles resolved here
+    bool constantsMatch = false;
+    int constantHandles[4] = { -1, -1, -1, -1 };
+
+    StaticMesh() {}
+    StaticMesh(const StaticMesh&) = delete;
+    StaticMesh& operator=(const StaticMesh&) = delete;
+
+    ~StaticMesh() {
+        release();
     }
-    
-    // Check if a world point is inside this OBB (Approximated)
-    // Actually, let's just do simple Radius check or AABB check in World Space?
-    // Transforming AABB is better.
-    bool checkCollision(const Vec3& worldPoint) {
+
+    // Check if a world point is inside this OBB at an instance transform. 'triangles' refines a
+    // box hit against the mesh itself; pickups keep the generous box test.
+    bool checkCollision(const Matrix& world, const Vec3& worldPoint, bool triangles = true) {
        // Simple approach: Transform point to local space
-       Matrix inv = worldMatrix.invert();
+       Matrix inv = world.invert();
        Vec3 localP = inv.mulPoint(worldPoint);
        
        // Expand bounds slightly for player radius
-       float padding = 0.5f; 
-       return (localP.x >= localAABB.min.x - padding && localP.x <= localAABB.max.x + padding &&
-               localP.y >= localAABB.min.y - padding && localP.y <= localAABB.max.y + padding &&
-               localP.z >= localAABB.min.z - padding && localP.z <= localAABB.max.z + padding);
+       float padding = collisionPadding; 
+       if (!(localP.x >= localAABB.min.x - padding && localP.x <= localAABB.max.x + padding &&
+             localP.y >= localAABB.min.y - padding && localP.y <= localAABB.max.y + padding &&
+             localP.z >= localAABB.min.z - padding && localP.z <= localAABB.max.z + padding)) return false;
+
+       // Inside the padded box: only a hit if actual triangles are within the padding
+       return !triangles || collisionBVH.empty() || collisionBVH.overlapsSphere(localP, padding);
     }
 
 
-    void loadMeshes(Core* core, const std::string& filename)
+    // CPU half of loading: the parsed model and its collision BVH. Touches no GPU state, so
+    // level streaming runs it on a background thread.
+    struct Decoded {
+        std::vector<GEMLoader::GEMMesh> meshes;
+        MeshBVH bvh;
+        bool ok = false;
+    };
+
+    // 'ok' is false for data that is not a model or is truncated; nothing is kept then
+    static void decode(const std::string& fileData, Decoded& out)
     {
         GEMLoader::GEMModelLoader loader;
-        std::vector<GEMLoader::GEMMesh> gemmeshes;
-        loader.load(filename, gemmeshes);
+        out.ok = loader.loadFromMemory(fileData, out.meshes);
+        if (!out.ok) {
+            out.meshes.clear();
+            return;
+        }
+        out.bvh.build(out.meshes);
+    }
+
+    // False, leaving the prototype empty, when the file is missing or not a valid model
+    bool loadMeshes(Core* core, const std::string& filename)
+    {
+        std::string fileData;
+        if (!VirtualFileSystem::instance().readFile(filename, fileData)) return false;
+        Decoded decoded;
+        decode(fileData, decoded);
+        if (!decoded.ok) return false;
+        create(core, decoded);
+        return true;
+    }
+
+    // GPU half: buffers, materials and PSOs from decoded data (render thread only)
+    void create(Core* core, Decoded& decoded)
+    {
+        std::vector<GEMLoader::GEMMesh>& gemmeshes = decoded.meshes;
+        collisionBVH = std::move(decoded.bvh);
+        GPUResources& gpu = GPUResources::instance();
         for (int i = 0; i < gemmeshes.size(); i++) {
-            Mesh* mesh=new Mesh;
+            Mesh mesh;
             std::vector<STATIC_VERTEX> vertices;
             for (int j = 0; j < gemmeshes[i].verticesStatic.size(); j++) {
                 STATIC_VERTEX v;
@@ -67,48 +133,125 @@ public:
                 if (v.pos.y > localAABB.max.y) localAABB.max.y = v.pos.y;
                 if (v.pos.z > localAABB.max.z) localAABB.max.z = v.pos.z;
             }
-            mesh->init(core, vertices, gemmeshes[i].indices);
-            meshes.push_back(mesh);
-            shader.LoadShaders("VertexShader.hlsl", "PixelShader.hlsl");
-
-            // Reflect shaders to populate constant buffer offsets
-            shader.ReflectShaders(core, shader.pixelShader, false);
-            shader.ReflectShaders(core, shader.vertexShader, true);
-
-            psos.createPSO(
-                core,
-                "Triangle",
-                shader.vertexShader,
-                shader.pixelShader,
-                mesh->inputLayoutDesc
-            );
+            mesh.init(core, vertices, gemmeshes[i].indices);
+            materials.push_back(MaterialTable::instance().compile(gemmeshes[i].material));
+
+            // Every submesh shares the prototype's shader and PSO; compile them once
+            if (shader.isNull()) {
+                Shader program;
+                program.LoadShaders("VertexShader.hlsl", "PixelShader.hlsl");
+
+                // Reflect shaders to populate constant buffer offsets
+                program.ReflectShaders(core, program.pixelShader, false);
+                program.ReflectShaders(core, program.vertexShader, true);
+                resolveConstants(*program.vsConstantBuffers[0]);
+                shader = gpu.shaders.create(program);
+
+                // inputLayoutDesc points into this local Mesh, so the PSO is built before the copy
+                psos.createPSO(
+                    core,
+                    "Triangle",
+                    program.vertexShader,
+                    program.pixelShader,
+                    mesh.inputLayoutDesc
+                );
+                psoKey = psos.psos["Triangle"].index();
+            }
+            meshes.push_back(gpu.meshes.create(mesh));
         }
 
 	}
 
+    void resolveConstants(const ConstantBufferClass& cb)
+    {
+        constantsMatch = cb.layoutSize == sizeof(Constants) &&
+            cb.matches("W", offsetof(Constants, W), sizeof(Matrix)) &&
+            cb.matches("VP", offsetof(Constants, VP), sizeof(Matrix)) &&
+            cb.matches("time", offsetof(Constants, time), sizeof(float)) &&
+            cb.matches("cameraPos", offsetof(Constants, cameraPos), sizeof(Vec3));
+        constantHandles[0] = cb.variable("W");
+        constantHandles[1] = cb.variable("VP");
+        constantHandles[2] = cb.variable("time");
+        constantHandles[3] = cb.variable("cameraPos");
+    }
+
+    // Vertex/index buffers plus the collision BVH, for streaming budgets
+    size_t residentBytes() const
+    {
+        size_t bytes = collisionBVH.memoryBytes();
+        const GPUResources& gpu = GPUResources::instance();
+        for (MeshHandle h : meshes) {
+            const Mesh* mesh = gpu.meshes.get(h);
+            if (mesh) bytes += mesh->gpuBytes();
+        }
+        return bytes;
+    }
+
+    // Hands the GPU objects back to their pools, which destroy them once in-flight frames are done
+    void release()
+    {
+        GPUResources& gpu = GPUResources::instance();
+        for (MeshHandle h : meshes) gpu.release(h);
+        meshes.clear();
+        gpu.release(shader);
+        shader = ShaderHandle();
+        psos.release();
+        materials.clear();
+        collisionBVH = MeshBVH();
+    }
+
+    // Submesh buffers only: InstancedRenderer has bound the shader, PSO and instance stream
+    void drawInstances(Core* core, unsigned int firstInstance, unsigned int instanceCount)
+    {
+        GPUResources& gpu = GPUResources::instance();
+        for (MeshHandle h : meshes) {
+            Mesh* mesh = gpu.meshes.get(h);
+            if (mesh) mesh->draw(core, instanceCount, firstInstance);
+        }
+    }
+
     void draw(Core* core, Matrix& w, Matrix& vp, float time, const Vec3& camPos)
     {
-       
         core->beginRenderPass();
-
-        for (int i = 0; i < meshes.size(); i++)
+        for (unsigned int i = 0; i < meshes.size(); i++)
         {
-            
-            // Check if constant buffer variables exist before updating to avoid crashes if reflection failed or variables optimized out
-            if (shader.vsConstantBuffers.size() > 0) {
-                 shader.vsConstantBuffers[0]->update("W", &w);
-                 shader.vsConstantBuffers[0]->update("VP", &vp);
-                 shader.vsConstantBuffers[0]->update("time", (void*)&time); // Explicit cast just in case
-                 shader.vsConstantBuffers[0]->update("cameraPos", (void*)&camPos);
-            }
+            drawSubmesh(core, i, w, vp, time, camPos);
+        }
+    }
 
+    // Sort key for one submesh in a DrawList; 'depth' from DrawKey::depth
+    uint64_t drawKey(unsigned int submesh, uint32_t depth) const
+    {
+        return DrawKey::make(DrawKey::PASS_OPAQUE, psoKey, materials[submesh], meshes[submesh].index(), depth);
+    }
 
+    // One submesh at one transform; the render pass state must already be set. Safe to call from
+    // several recording threads at once (Core::beginChunk)
+    void drawSubmesh(Core* core, unsigned int submesh, Matrix& w, Matrix& vp, float time, const Vec3& camPos)
+    {
+        GPUResources& gpu = GPUResources::instance();
+        Shader* program = gpu.shaders.get(shader);
+        Mesh* mesh = gpu.meshes.get(meshes[submesh]);
+        if (!program || !mesh) return;
 
-            shader.apply(core);
+        // Entries are reserved per draw, so chunks of the draw list can record on several threads
+        program->applyDraw(core, [&](ConstantBufferClass& cb, const ConstantAllocation& entry) {
+            if (constantsMatch) {
+                Constants constants;
+                constants.W = w;
+                constants.VP = vp;
+                constants.time = time;
+                constants.cameraPos = camPos;
+                cb.write(entry, constants);
+                return;
+            }
+            cb.update(entry, constantHandles[0], &w);
+            cb.update(entry, constantHandles[1], &vp);
+            cb.update(entry, constantHandles[2], &time);
+            cb.update(entry, constantHandles[3], &camPos);
+        });
 
-            psos.bind(core, "Triangle");
-            meshes[i]->draw(core);
-          
-        }
-	}
+        psos.bind(core, "Triangle");
+        mesh->draw(core);
+    }
 };
\ No newline at end of file
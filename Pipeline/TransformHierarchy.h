@@ -0,0 +1,301 @@
+#pragma once
+#include "maths.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+// Scene transform hierarchy. Nodes hold local TRS (position, Euler rotation in degrees, scale)
+// and a parent index that is always lower than the node's own, so one forward pass sees every
+// parent before its children. Edits queue the node on a dirty list; update() walks only those
+// nodes' subtrees through child links, so its cost follows what changed rather than the node count.
+class TransformHierarchy
+{
+public:
+	static constexpr int NO_PARENT = -1;
+
+	// Local TRS
+	std::vector<Vec3> position;
+	std::vector<Vec3> rotation;   // Euler degrees, applied Z * Y * X like level.json
+	std::vector<Vec3> scale;
+	std::vector<int> parent;
+
+	std::vector<Matrix> world;
+
+	// Nodes whose world matrix changed during the last update, in ascending order
+	std::vector<unsigned int> changed;
+
+	struct Stats
+	{
+		unsigned int recomputed = 0;   // world matrices rebuilt by the last update
+		double updateMs = 0.0;
+		unsigned int levels = 0;       // depth levels when the parallel path is usable
+	} stats;
+
+	// Below this many nodes a depth level is processed on the calling thread; larger levels
+	// are split into jobs of this many nodes
+	unsigned int minNodesPerJob = 4096;
+
+	unsigned int size() const
+	{
+		return (unsigned int)parent.size();
+	}
+
+	void reserve(unsigned int count)
+	{
+		position.reserve(count);
+		rotation.reserve(count);
+		scale.reserve(count);
+		parent.reserve(count);
+		world.reserve(count);
+		dirty.reserve(count);
+		worldChanged.reserve(count);
+		depth.reserve(count);
+		firstChild.reserve(count);
+		nextSibling.reserve(count);
+		dirtyNodes.reserve(count);
+	}
+
+	void clear()
+	{
+		position.clear();
+		rotation.clear();
+		scale.clear();
+		parent.clear();
+		world.clear();
+		dirty.clear();
+		worldChanged.clear();
+		depth.clear();
+		firstChild.clear();
+		nextSibling.clear();
+		dirtyNodes.clear();
+		changed.clear();
+		levelStart.clear();
+		depthOrdered = true;
+	}
+
+	// Appends a node; 'parentIndex' must already exist. Adding nodes in non-decreasing depth
+	// (all roots, then their children, ...) keeps each depth level contiguous, which lets
+	// update() split a level across threads.
+	unsigned int add(int parentIndex, const Vec3& pos, const Vec3& rot, const Vec3& scl)
+	{
+		unsigned int index = size();
+		if (parentIndex >= (int)index)
+		{
+			parentIndex = NO_PARENT;   // would break the parent-first order
+		}
+		unsigned int d = parentIndex == NO_PARENT ? 0 : depth[parentIndex] + 1;
+		if (index > 0 && d < depth[index - 1])
+		{
+			depthOrdered = false;
+		}
+		if (depthOrdered && d >= levelStart.size())
+		{
+			levelStart.push_back(index);
+		}
+		position.push_back(pos);
+		rotation.push_back(rot);
+		scale.push_back(scl);
+		parent.push_back(parentIndex);
+		world.push_back(Matrix());
+		dirty.push_back(0);
+		worldChanged.push_back(0);
+		depth.push_back(d);
+		firstChild.push_back(NO_PARENT);
+		nextSibling.push_back(NO_PARENT);
+		if (parentIndex != NO_PARENT)
+		{
+			nextSibling[index] = firstChild[parentIndex];
+			firstChild[parentIndex] = (int)index;
+		}
+		markDirty(index);
+		return index;
+	}
+
+	void setLocal(unsigned int node, const Vec3& pos, const Vec3& rot, const Vec3& scl)
+	{
+		position[node] = pos;
+		rotation[node] = rot;
+		scale[node] = scl;
+		markDirty(node);
+	}
+
+	void translate(unsigned int node, const Vec3& delta)
+	{
+		position[node] += delta;
+		markDirty(node);
+	}
+
+	void rotate(unsigned int node, const Vec3& deltaDegrees)
+	{
+		rotation[node] += deltaDegrees;
+		markDirty(node);
+	}
+
+	bool isDirty(unsigned int node) const
+	{
+		return dirty[node] != 0;
+	}
+
+	// Recompute world matrices of dirty nodes and their descendants. Given a job system and a
+	// depth-ordered hierarchy, each depth level of the affected nodes is split across threads.
+	void update(JobSystem* jobs = nullptr)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		unsigned int count = size();
+		stats.levels = depthOrdered ? (unsigned int)levelStart.size() : 0;
+		changed.clear();
+		if (!dirtyNodes.empty())
+		{
+			collectChanged(count);
+			if (!jobs || jobs->threadCount() <= 1 || !depthOrdered)
+			{
+				updateRange(0, (unsigned int)changed.size());
+			}
+			else
+			{
+				// 'changed' is ascending, so each depth level is one contiguous run of it
+				unsigned int begin = 0;
+				while (begin < changed.size())
+				{
+					unsigned int level = depth[changed[begin]];
+					unsigned int end = level + 1 < levelStart.size() ? levelStart[level + 1] : count;
+					unsigned int runEnd = (unsigned int)(std::lower_bound(changed.begin() + begin, changed.end(), end) - changed.begin());
+					updateLevel(begin, runEnd, *jobs);
+					begin = runEnd;
+				}
+			}
+			for (unsigned int n : changed)
+			{
+				worldChanged[n] = 0;
+			}
+		}
+		stats.recomputed = (unsigned int)changed.size();
+		stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// World = T * Rz * Ry * Rx * S, written out directly instead of five 4x4 multiplies
+	static Matrix compose(const Vec3& pos, const Vec3& rotDegrees, const Vec3& scl)
+	{
+		float rx = rotDegrees.x * PI_F / 180.0f;
+		float ry = rotDegrees.y * PI_F / 180.0f;
+		float rz = rotDegrees.z * PI_F / 180.0f;
+		float sx = sinf(rx), cx = cosf(rx);
+		float sy = sinf(ry), cy = cosf(ry);
+		float sz = sinf(rz), cz = cosf(rz);
+
+		Matrix m;
+		m.m[0] = cz * cy * scl.x;  m.m[1] = (cz * sy * sx - sz * cx) * scl.y;  m.m[2] = (cz * sy * cx + sz * sx) * scl.z;  m.m[3] = pos.x;
+		m.m[4] = sz * cy * scl.x;  m.m[5] = (sz * sy * sx + cz * cx) * scl.y;  m.m[6] = (sz * sy * cx - cz * sx) * scl.z;  m.m[7] = pos.y;
+		m.m[8] = -sy * scl.x;      m.m[9] = cy * sx * scl.y;                   m.m[10] = cy * cx * scl.z;                  m.m[11] = pos.z;
+		m.m[12] = 0.0f;            m.m[13] = 0.0f;                             m.m[14] = 0.0f;                             m.m[15] = 1.0f;
+		return m;
+	}
+
+	// a * b for affine matrices (bottom row 0 0 0 1); 36 multiplies instead of 64
+	static void multiplyAffine(const Matrix& a, const Matrix& b, Matrix& out)
+	{
+		for (int r = 0; r < 3; r++)
+		{
+			float a0 = a.m[r * 4 + 0], a1 = a.m[r * 4 + 1], a2 = a.m[r * 4 + 2];
+			out.m[r * 4 + 0] = a0 * b.m[0] + a1 * b.m[4] + a2 * b.m[8];
+			out.m[r * 4 + 1] = a0 * b.m[1] + a1 * b.m[5] + a2 * b.m[9];
+			out.m[r * 4 + 2] = a0 * b.m[2] + a1 * b.m[6] + a2 * b.m[10];
+			out.m[r * 4 + 3] = a0 * b.m[3] + a1 * b.m[7] + a2 * b.m[11] + a.m[r * 4 + 3];
+		}
+		out.m[12] = 0.0f; out.m[13] = 0.0f; out.m[14] = 0.0f; out.m[15] = 1.0f;
+	}
+
+private:
+	std::vector<unsigned char> dirty;         // local TRS edited since the last update
+	std::vector<unsigned char> worldChanged;  // marks nodes already in 'changed' during update
+	std::vector<unsigned int> depth;
+	std::vector<unsigned int> levelStart;     // first node of each depth level, while depthOrdered
+	std::vector<int> firstChild;              // child links, NO_PARENT ending each list
+	std::vector<int> nextSibling;
+	std::vector<unsigned int> dirtyNodes;     // nodes with 'dirty' set, in the order they were edited
+	std::vector<unsigned int> stack;          // scratch for collectChanged
+	bool depthOrdered = true;
+
+	void markDirty(unsigned int node)
+	{
+		if (!dirty[node])
+		{
+			dirty[node] = 1;
+			dirtyNodes.push_back(node);
+		}
+	}
+
+	// Fills 'changed' with the dirty nodes and their descendants, ascending, and clears the dirty list
+	void collectChanged(unsigned int count)
+	{
+		for (unsigned int root : dirtyNodes)
+		{
+			dirty[root] = 0;
+			if (worldChanged[root])
+			{
+				continue;   // inside the subtree of a node edited earlier
+			}
+			stack.push_back(root);
+			while (!stack.empty())
+			{
+				unsigned int n = stack.back();
+				stack.pop_back();
+				worldChanged[n] = 1;
+				changed.push_back(n);
+				for (int c = firstChild[n]; c != NO_PARENT; c = nextSibling[c])
+				{
+					// A dirty child already visited brought its own subtree in
+					if (!worldChanged[c]) stack.push_back((unsigned int)c);
+				}
+			}
+		}
+		dirtyNodes.clear();
+
+		// Parents come before children in index order. Sorting pays off only for a small part of the
+		// hierarchy; past that, reading the marks back in order is cheaper.
+		if (changed.size() * 16 < count)
+		{
+			std::sort(changed.begin(), changed.end());
+		}
+		else
+		{
+			changed.clear();
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (worldChanged[i]) changed.push_back(i);
+			}
+		}
+	}
+
+	// Recomputes changed[begin, end)
+	void updateRange(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int k = begin; k < end; k++)
+		{
+			unsigned int i = changed[k];
+			int p = parent[i];
+			Matrix local = compose(position[i], rotation[i], scale[i]);
+			if (p == NO_PARENT)
+			{
+				world[i] = local;
+			}
+			else
+			{
+				multiplyAffine(world[p], local, world[i]);
+			}
+		}
+	}
+
+	void updateLevel(unsigned int begin, unsigned int end, JobSystem& jobs)
+	{
+		unsigned int count = end - begin;
+		if (count < minNodesPerJob * 2)
+		{
+			updateRange(begin, end);
+			return;
+		}
+		// Each level must finish before the next reads its parents' world matrices
+		jobs.parallelFor(count, minNodesPerJob, [this, begin](unsigned int b, unsigned int e) { updateRange(begin + b, begin + e); });
+	}
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+
+// Lock-free single-producer / single-consumer handoff of the latest value. The producer fills
+// writeBuffer() and publish()es it; the consumer acquire()s the newest published value and reads
+// it from readBuffer() for as long as it likes. Three buffers mean neither side ever waits:
+// one is being written, one being read, and the third holds the newest finished value.
+//
+// Buffers are recycled, so the producer gets back a stale value (two publishes old) and must
+// overwrite all of it; containers keep their capacity, so steady-state publishing doesn't allocate.
+template<typename T>
+class TripleBuffer
+{
+public:
+	T& writeBuffer()
+	{
+		return buffers[writeIndex];
+	}
+
+	// Producer: make the write buffer the newest value and take back the spare one
+	void publish()
+	{
+		unsigned int previous = shared.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+		writeIndex = previous & INDEX_MASK;
+		published++;
+	}
+
+	// Consumer: swap in the newest value if one was published since the last call
+	bool acquire()
+	{
+		if (!(shared.load(std::memory_order_relaxed) & FRESH))
+		{
+			return false;
+		}
+		unsigned int previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	const T& readBuffer() const
+	{
+		return buffers[readIndex];
+	}
+
+	// Producer-side count of publishes
+	unsigned long long publishCount() const
+	{
+		return published;
+	}
+
+private:
+	static constexpr unsigned int INDEX_MASK = 3;
+	static constexpr unsigned int FRESH = 4;   // shared slot holds a value the consumer hasn't taken
+
+	T buffers[3];
+	std::atomic<unsigned int> shared{ 1 };
+	unsigned int writeIndex = 0;   // producer only
+	unsigned int readIndex = 2;    // consumer only
+	unsigned long long published = 0;
+};
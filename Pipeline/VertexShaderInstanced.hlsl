@@ -0,0 +1,66 @@
+// Anti-Gravity Vertex Shader, instanced: the world matrix comes from a per-instance vertex stream
+// (slot 1) instead of the constant buffer, so one draw covers every instance of a prototype
+
+cbuffer staticMeshBuffer : register(b0)
+{
+    float4x4 W;       // Unused; kept so the layout matches VertexShader.hlsl
+    float4x4 VP;      // View * Projection Matrix
+    float time;       // Time in seconds
+    float3 cameraPos; // Camera Position
+};
+
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float2 TexCoords : TEXCOORD;
+
+    // Rows of the CPU-side (row-major) world matrix
+    float4 World0 : WORLD0;
+    float4 World1 : WORLD1;
+    float4 World2 : WORLD2;
+    float4 World3 : WORLD3;
+};
+
+struct PS_INPUT
+{
+    float4 Pos : SV_POSITION;
+    float3 WorldPos : POSITION;
+    float3 Normal : NORMAL;
+    float3 Tangent : TANGENT;
+    float3 Binormal : BINORMAL;
+    float2 TexCoords : TEXCOORD;
+};
+
+PS_INPUT VS(VS_INPUT input)
+{
+    PS_INPUT output;
+
+    // Built from rows, this is the CPU matrix itself, so it multiplies column vectors. (The
+    // constant buffer copy is read column-major, i.e. transposed, hence mul(v, W) there.)
+    float4x4 world = float4x4(input.World0, input.World1, input.World2, input.World3);
+
+    // 1. Floating effect, as in VertexShader.hlsl
+    float4 animatedPos = input.Pos;
+    float amplitude = 0.5f;
+    float frequency = 1.5f;
+    float offset = animatedPos.x * 0.5f + animatedPos.z * 0.3f;
+    animatedPos.y += sin(time * frequency + offset) * amplitude;
+
+    // 2. World Transform
+    float4 worldPos = mul(world, animatedPos);
+    output.WorldPos = worldPos.xyz;
+
+    // 3. Clip Space Transform
+    output.Pos = mul(worldPos, VP);
+
+    // 4. Normal/Tangent Transform (uniform scale assumed)
+    output.Normal = normalize(mul((float3x3)world, input.Normal));
+    output.Tangent = normalize(mul((float3x3)world, input.Tangent));
+    output.Binormal = cross(output.Normal, output.Tangent);
+
+    output.TexCoords = input.TexCoords;
+
+    return output;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "PackFile.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+
+// Single entry point for asset reads. Mounted packs are searched first (newest mount wins),
+// then the loose file in the working directory, so development builds without a pack keep working.
+// Reads may come from several threads (level streaming); mounting must not overlap them.
+class VirtualFileSystem
+{
+public:
+	// Running totals so load time can be compared between loose and packed builds
+	struct Stats
+	{
+		unsigned int packReads = 0;
+		unsigned int looseReads = 0;
+		unsigned int failedReads = 0;
+		unsigned long long bytesRead = 0;
+	} stats;
+
+	static VirtualFileSystem& instance()
+	{
+		static VirtualFileSystem vfs;
+		return vfs;
+	}
+
+	bool mount(const std::string& packFilename)
+	{
+		std::unique_ptr<PackReader> pack(new PackReader());
+		if (!pack->open(packFilename))
+		{
+			return false;
+		}
+		packs.push_back(std::move(pack));
+		return true;
+	}
+
+	void unmountAll()
+	{
+		packs.clear();
+	}
+
+	bool hasPacks() const
+	{
+		return !packs.empty();
+	}
+
+	bool exists(const std::string& filename) const
+	{
+		for (size_t i = packs.size(); i-- > 0;)
+		{
+			if (packs[i]->find(filename))
+			{
+				return true;
+			}
+		}
+		std::ifstream file(filename, std::ios::binary);
+		return file.is_open();
+	}
+
+	// Reads a whole file into 'out'; binary safe
+	bool readFile(const std::string& filename, std::string& out)
+	{
+		for (size_t i = packs.size(); i-- > 0;)
+		{
+			const PackEntry* entry = packs[i]->find(filename);
+			if (entry && packs[i]->read(*entry, out))
+			{
+				std::lock_guard<std::mutex> lock(statsMutex);
+				stats.packReads++;
+				stats.bytesRead += out.size();
+				return true;
+			}
+		}
+		return readLooseFile(filename, out);
+	}
+
+	// Bypasses mounted packs, for tools and hot reload of files being edited on disk
+	bool readLooseFile(const std::string& filename, std::string& out)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.failedReads++;
+			return false;
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		out = buffer.str();
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.looseReads++;
+		stats.bytesRead += out.size();
+		return true;
+	}
+
+private:
+	std::vector<std::unique_ptr<PackReader>> packs;
+	std::mutex statsMutex;   // packs are read-only mappings; only the counters are shared
+};
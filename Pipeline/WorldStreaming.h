@@ -0,0 +1,459 @@
+#pragma once
+#include "maths.h"
+#include "VirtualFileSystem.h"
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+
+// One square of the level on the XZ plane with the placements that live in it
+struct WorldCell
+{
+	enum State { UNLOADED, LOADING, RESIDENT };
+
+	int x = 0;
+	int z = 0;
+	std::vector<unsigned int> placements;   // indices into the level's placement list
+	std::vector<std::string> models;        // distinct model files those placements use
+	State state = UNLOADED;
+	float distance = 0.0f;                  // to the streaming centre at the last update
+};
+
+// Partition of a level into cells. Each placement is filed under the cell containing the world
+// position it is given (the game passes the root's position, so a hierarchy streams as a unit).
+class WorldCellGrid
+{
+public:
+	float cellSize = 32.0f;
+	std::vector<WorldCell> cells;
+
+	void clear()
+	{
+		cells.clear();
+		lookup.clear();
+	}
+
+	void build(const std::vector<Vec3>& positions, const std::vector<std::string>& models)
+	{
+		clear();
+		for (unsigned int i = 0; i < (unsigned int)positions.size(); i++)
+		{
+			int x = coord(positions[i].x);
+			int z = coord(positions[i].z);
+			long long k = key(x, z);
+			auto it = lookup.find(k);
+			unsigned int c;
+			if (it == lookup.end())
+			{
+				c = (unsigned int)cells.size();
+				cells.push_back(WorldCell());
+				cells[c].x = x;
+				cells[c].z = z;
+				lookup.insert({ k, c });
+			}
+			else
+			{
+				c = it->second;
+			}
+			WorldCell& cell = cells[c];
+			cell.placements.push_back(i);
+			if (std::find(cell.models.begin(), cell.models.end(), models[i]) == cell.models.end())
+			{
+				cell.models.push_back(models[i]);
+			}
+		}
+	}
+
+	int coord(float v) const
+	{
+		return (int)floorf(v / cellSize);
+	}
+
+	// Index of the cell at (x, z), or -1 when nothing was placed there
+	int find(int x, int z) const
+	{
+		auto it = lookup.find(key(x, z));
+		return it == lookup.end() ? -1 : (int)it->second;
+	}
+
+	// Horizontal distance from 'p' to the nearest point of the cell (0 inside it)
+	float distanceTo(const WorldCell& cell, const Vec3& p) const
+	{
+		float minX = cell.x * cellSize, minZ = cell.z * cellSize;
+		float dx = (std::max)((std::max)(minX - p.x, p.x - (minX + cellSize)), 0.0f);
+		float dz = (std::max)((std::max)(minZ - p.z, p.z - (minZ + cellSize)), 0.0f);
+		return sqrtf(dx * dx + dz * dz);
+	}
+
+private:
+	std::unordered_map<long long, unsigned int> lookup;
+
+	static long long key(int x, int z)
+	{
+		return ((long long)x << 32) ^ (unsigned int)z;
+	}
+};
+
+// Decides which cells to load and drop around a moving centre. Cells within loadRadius are
+// requested nearest first; they are only dropped once beyond unloadRadius, so walking back and
+// forth over a boundary doesn't thrash. New loads wait while resident memory plus the cell's
+// expected size would exceed memoryBudget, and when over budget the farthest cells outside the
+// load ring go first. The budget is soft: cells inside the load ring are never shed.
+// Models are shared between cells, so the streamer counts the resident cells using each model:
+// a cell costs, and dropping it frees, only the models no other resident cell holds.
+class CellStreamer
+{
+public:
+	float loadRadius = 48.0f;
+	float unloadRadius = 80.0f;
+	size_t memoryBudget = (size_t)256 << 20;
+	unsigned int maxLoadsInFlight = 4;
+
+	struct Stats
+	{
+		unsigned int loadsStarted = 0;
+		unsigned int unloads = 0;
+		unsigned int budgetUnloads = 0;
+		unsigned int deferredLoads = 0;   // wanted but held back (budget or in-flight limit), last update
+	} stats;
+
+	// Re-reads which cells are loading or resident after the grid was rebuilt
+	void sync(const WorldCellGrid& grid)
+	{
+		active.clear();
+		for (std::pair<const std::string, ModelUse>& m : models)
+		{
+			m.second.cells = 0;
+		}
+		for (unsigned int c = 0; c < (unsigned int)grid.cells.size(); c++)
+		{
+			if (grid.cells[c].state != WorldCell::UNLOADED)
+			{
+				active.push_back(c);
+			}
+			if (grid.cells[c].state == WorldCell::RESIDENT)
+			{
+				hold(grid.cells[c]);
+			}
+		}
+	}
+
+	// Moves cells to LOADING (listed in 'load') or UNLOADED (listed in 'unload'); the caller
+	// starts/drops their content and calls markResident() when a load completes
+	void update(WorldCellGrid& grid, const Vec3& centre, size_t residentBytes, std::vector<unsigned int>& load, std::vector<unsigned int>& unload)
+	{
+		load.clear();
+		unload.clear();
+
+		// Drop what moved out of the outer ring
+		unsigned int inFlight = 0;
+		for (size_t i = 0; i < active.size();)
+		{
+			WorldCell& cell = grid.cells[active[i]];
+			cell.distance = grid.distanceTo(cell, centre);
+			if (cell.distance > unloadRadius)
+			{
+				size_t freed = cell.state == WorldCell::RESIDENT ? exclusiveBytes(cell) : 0;
+				residentBytes = freed < residentBytes ? residentBytes - freed : 0;
+				drop(grid, i, unload);
+				stats.unloads++;
+				continue;
+			}
+			inFlight += cell.state == WorldCell::LOADING;
+			i++;
+		}
+
+		// Over budget: shed the farthest resident cells that are outside the load ring
+		while (residentBytes > memoryBudget)
+		{
+			size_t farthest = active.size();
+			for (size_t i = 0; i < active.size(); i++)
+			{
+				const WorldCell& cell = grid.cells[active[i]];
+				if (cell.state == WorldCell::RESIDENT && cell.distance > loadRadius &&
+					(farthest == active.size() || cell.distance > grid.cells[active[farthest]].distance))
+				{
+					farthest = i;
+				}
+			}
+			if (farthest == active.size())
+			{
+				break;
+			}
+			// A cell whose models are all shared frees nothing, but its drop lets a later one free them
+			size_t freed = exclusiveBytes(grid.cells[active[farthest]]);
+			drop(grid, farthest, unload);
+			stats.budgetUnloads++;
+			residentBytes = freed < residentBytes ? residentBytes - freed : 0;
+		}
+
+		// Candidates inside the load ring, nearest first
+		candidates.clear();
+		int reach = (int)ceilf(loadRadius / grid.cellSize);
+		int cx = grid.coord(centre.x), cz = grid.coord(centre.z);
+		for (int z = cz - reach; z <= cz + reach; z++)
+		{
+			for (int x = cx - reach; x <= cx + reach; x++)
+			{
+				int c = grid.find(x, z);
+				if (c < 0 || grid.cells[c].state != WorldCell::UNLOADED)
+				{
+					continue;
+				}
+				float d = grid.distanceTo(grid.cells[c], centre);
+				if (d <= loadRadius)
+				{
+					grid.cells[c].distance = d;
+					candidates.push_back((unsigned int)c);
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [&](unsigned int a, unsigned int b) { return grid.cells[a].distance < grid.cells[b].distance; });
+
+		stats.deferredLoads = 0;
+		size_t expected = residentBytes;
+		for (unsigned int c : candidates)
+		{
+			WorldCell& cell = grid.cells[c];
+			size_t estimate = addedBytes(cell);
+			// The cell under the player always loads
+			bool fits = expected + estimate <= memoryBudget || cell.distance == 0.0f;
+			if (inFlight >= maxLoadsInFlight || !fits)
+			{
+				stats.deferredLoads++;
+				continue;
+			}
+			cell.state = WorldCell::LOADING;
+			active.push_back(c);
+			load.push_back(c);
+			expected += estimate;
+			inFlight++;
+			stats.loadsStarted++;
+		}
+	}
+
+	// A LOADING cell finished; modelBytes(file) is the memory a model of the cell holds once loaded
+	template<typename ModelBytes>
+	void markResident(WorldCellGrid& grid, unsigned int c, const ModelBytes& modelBytes)
+	{
+		WorldCell& cell = grid.cells[c];
+		cell.state = WorldCell::RESIDENT;
+		for (const std::string& file : cell.models)
+		{
+			ModelUse& use = models[file];
+			if (!use.measured)
+			{
+				use.bytes = modelBytes(file);
+				use.measured = true;
+				measuredModels++;
+				totalModelBytes += use.bytes;
+			}
+		}
+		hold(cell);
+	}
+
+	// Memory that dropping 'cell' frees: its models no other resident cell uses
+	size_t exclusiveBytes(const WorldCell& cell) const
+	{
+		size_t bytes = 0;
+		for (const std::string& file : cell.models)
+		{
+			auto it = models.find(file);
+			if (it != models.end() && it->second.cells == 1)
+			{
+				bytes += it->second.bytes;
+			}
+		}
+		return bytes;
+	}
+
+	// Memory that loading 'cell' would add: its models not resident yet, at the average size
+	// for models never loaded
+	size_t addedBytes(const WorldCell& cell) const
+	{
+		size_t average = measuredModels ? (size_t)(totalModelBytes / measuredModels) : 0;
+		size_t bytes = 0;
+		for (const std::string& file : cell.models)
+		{
+			auto it = models.find(file);
+			if (it == models.end() || !it->second.measured)
+			{
+				bytes += average;
+			}
+			else if (it->second.cells == 0)
+			{
+				bytes += it->second.bytes;
+			}
+		}
+		return bytes;
+	}
+
+	unsigned int residentCount(const WorldCellGrid& grid) const
+	{
+		unsigned int count = 0;
+		for (unsigned int c : active)
+		{
+			count += grid.cells[c].state == WorldCell::RESIDENT;
+		}
+		return count;
+	}
+
+private:
+	struct ModelUse
+	{
+		unsigned int cells = 0;   // resident cells using the model
+		size_t bytes = 0;         // as measured when it was first loaded
+		bool measured = false;
+	};
+
+	std::vector<unsigned int> active;       // cells that are LOADING or RESIDENT
+	std::vector<unsigned int> candidates;
+	std::unordered_map<std::string, ModelUse> models;
+	unsigned long long measuredModels = 0;  // for the estimate of models never loaded
+	unsigned long long totalModelBytes = 0;
+
+	void hold(const WorldCell& cell)
+	{
+		for (const std::string& file : cell.models)
+		{
+			models[file].cells++;
+		}
+	}
+
+	void drop(WorldCellGrid& grid, size_t activeIndex, std::vector<unsigned int>& unload)
+	{
+		unsigned int c = active[activeIndex];
+		if (grid.cells[c].state == WorldCell::RESIDENT)
+		{
+			for (const std::string& file : grid.cells[c].models)
+			{
+				models[file].cells--;
+			}
+		}
+		grid.cells[c].state = WorldCell::UNLOADED;
+		unload.push_back(c);
+		active[activeIndex] = active.back();
+		active.pop_back();
+	}
+};
+
+// Background file reads: a thread pulls requested files through the VirtualFileSystem, runs
+// 'decode' on the bytes (parsing, BVH building: anything that needs no GPU) and queues the
+// result for the owner to collect with poll().
+template<typename Result>
+class StreamingReader
+{
+public:
+	typedef void (*DecodeFn)(const std::string& bytes, Result& out);
+
+	struct Completed
+	{
+		std::string file;
+		std::unique_ptr<Result> result;   // null when the read failed
+	};
+
+	// Running totals (written by the reader thread)
+	std::atomic<unsigned long long> bytesRead{ 0 };
+	std::atomic<unsigned int> filesRead{ 0 };
+	std::atomic<unsigned int> failedReads{ 0 };
+
+	explicit StreamingReader(DecodeFn decodeFn) : decode(decodeFn)
+	{
+		worker = std::thread([this]() { run(); });
+	}
+
+	~StreamingReader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+
+	StreamingReader(const StreamingReader&) = delete;
+	StreamingReader& operator=(const StreamingReader&) = delete;
+
+	void request(const std::string& file)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(file);
+			outstanding++;
+		}
+		wake.notify_one();
+	}
+
+	// Appends finished reads to 'out'
+	void poll(std::vector<Completed>& out)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Completed& c : done)
+		{
+			out.push_back(std::move(c));
+		}
+		done.clear();
+	}
+
+	// Requested but not yet collected
+	unsigned int pending()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return outstanding;
+	}
+
+private:
+	DecodeFn decode;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::string> requests;
+	std::vector<Completed> done;
+	unsigned int outstanding = 0;
+	bool stopping = false;
+
+	void run()
+	{
+		std::string bytes;
+		for (;;)
+		{
+			std::string file;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+				if (stopping)
+				{
+					return;
+				}
+				file = requests.front();
+				requests.pop_front();
+			}
+
+			Completed completed;
+			completed.file = file;
+			if (VirtualFileSystem::instance().readFile(file, bytes))
+			{
+				completed.result.reset(new Result());
+				decode(bytes, *completed.result);
+				bytesRead += bytes.size();
+				filesRead++;
+			}
+			else
+			{
+				failedReads++;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			done.push_back(std::move(completed));
+			outstanding--;
+		}
+	}
+};
@@ -4,6 +4,10 @@
 #include <dxgi1_6.h>       // more functionality
 #include <d3dcompiler.h>   // compiler
 #include <vector>               // vector
+#include <algorithm>
+#include "CommandRecorder.h"
+#include "StagingRing.h"
+#include "FrameLinearAllocator.h"
 #pragma comment(lib, "d3d12")         // libraries
 #pragma comment(lib, "dxgi")              // libraries
 #pragma comment(lib, "d3dcompiler.lib")    // libraries
@@ -41,6 +45,11 @@ public:
 	{
 		queue->Signal(fence, ++value);
 	}
+	void signal(ID3D12CommandQueue* queue, UINT64 _value)                             // signal a value from a shared sequence
+	{
+		value = _value;
+		queue->Signal(fence, value);
+	}
 	void wait() 
 	{
 		if (fence->GetCompletedValue() < value) 
@@ -49,6 +58,14 @@ public:
 			WaitForSingleObject(eventHandle, INFINITE);                   // CPU does nothing until this fence is hit
 		}
 	}
+	void wait(UINT64 _value)                                                           // wait for an earlier signal
+	{
+		if (fence->GetCompletedValue() < _value)
+		{
+			fence->SetEventOnCompletion(_value, eventHandle);
+			WaitForSingleObject(eventHandle, INFINITE);
+		}
+	}
 
 	~GPUFence() 
 	{
@@ -58,6 +75,410 @@ public:
 };
 
 
+// CommandRecorder over a D3D12 command list; Core points it at the frame's list
+class D3D12CommandRecorder : public CommandRecorder
+{
+public:
+	ID3D12GraphicsCommandList4* list = nullptr;
+
+protected:
+	void recordViewport(const RenderViewport& viewport) override
+	{
+		D3D12_VIEWPORT v = { viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+		list->RSSetViewports(1, &v);
+	}
+
+	void recordScissor(const RenderScissor& scissor) override
+	{
+		D3D12_RECT r = { scissor.left, scissor.top, scissor.right, scissor.bottom };
+		list->RSSetScissorRects(1, &r);
+	}
+
+	void recordRootSignature(const void* rootSignature) override
+	{
+		list->SetGraphicsRootSignature((ID3D12RootSignature*)rootSignature);
+	}
+
+	void recordPipelineState(const void* pipelineState) override
+	{
+		list->SetPipelineState((ID3D12PipelineState*)pipelineState);
+	}
+
+	void recordRootConstantBuffer(unsigned int slot, uint64_t address) override
+	{
+		list->SetGraphicsRootConstantBufferView(slot, address);
+	}
+
+	void recordTopology(PrimitiveTopology topology) override
+	{
+		list->IASetPrimitiveTopology((D3D_PRIMITIVE_TOPOLOGY)topology);
+	}
+
+	void recordVertexBuffer(unsigned int slot, const VertexBufferView& view) override
+	{
+		D3D12_VERTEX_BUFFER_VIEW v = { view.address, view.sizeInBytes, view.strideInBytes };
+		list->IASetVertexBuffers(slot, 1, &v);
+	}
+
+	void recordIndexBuffer(const IndexBufferView& view) override
+	{
+		D3D12_INDEX_BUFFER_VIEW v = { view.address, view.sizeInBytes, (DXGI_FORMAT)view.format };
+		list->IASetIndexBuffer(&v);
+	}
+
+	void recordDrawIndexed(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override
+	{
+		list->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	void recordDraw(unsigned int vertexCount, unsigned int instanceCount, unsigned int startVertex, unsigned int startInstance) override
+	{
+		list->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+	}
+};
+
+
+// Uploads staged through one persistently mapped ring and copied on the copy queue, many to a
+// command list. A batch is submitted before the graphics queue next executes, which waits for it
+// on the GPU, so the CPU only blocks when the ring is full. Destinations are created in COMMON:
+// the copy promotes them to COPY_DEST, they decay back afterwards, and first use on the graphics
+// queue promotes them to their read state, so no barriers are recorded.
+class UploadBatcher
+{
+public:
+	struct Stats
+	{
+		unsigned int uploads = 0;
+		unsigned long long bytes = 0;
+		unsigned int batches = 0;
+		unsigned int stalls = 0;   // waits for the copy queue to free ring space
+	} stats;
+
+	void init(ID3D12Device5* _device, ID3D12CommandQueue* _copyQueue, ID3D12CommandQueue* _graphicsQueue, size_t capacity)
+	{
+		device = _device;
+		copyQueue = _copyQueue;
+		graphicsQueue = _graphicsQueue;
+		fence.create(device);
+		ring.init(capacity);
+		buffer = createUploadBuffer(capacity, &mapped);
+	}
+
+	// Copies 'data' now; the GPU copy happens with the batch. 'footprint' describes a texture
+	// subresource laid out from offset 0, otherwise 'data' goes to 'dstOffset' in a buffer.
+	void upload(ID3D12Resource* dstResource, UINT64 dstOffset, const void* data, size_t size, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* footprint = NULL)
+	{
+		reclaim();
+		size_t alignment = footprint ? D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 16;
+		size_t offset = ring.allocate(size, alignment);
+		while (offset == StagingRing::FAILED && size <= ring.size())
+		{
+			// Ring full: send what is staged and wait for the oldest batch
+			submit();
+			fence.wait(ring.oldestPending());
+			stats.stalls++;
+			reclaim();
+			offset = ring.allocate(size, alignment);
+		}
+
+		ID3D12Resource* source = buffer;
+		unsigned char* target = mapped;
+		if (offset == StagingRing::FAILED)
+		{
+			// Larger than the ring: a buffer of its own, released with the batch
+			source = createUploadBuffer(size, &target);
+			offset = 0;
+			oversized.push_back({ source, fence.value + 1 });
+		}
+		memcpy(target + offset, data, size);
+
+		ID3D12GraphicsCommandList4* list = openList();
+		if (footprint != NULL)
+		{
+			D3D12_TEXTURE_COPY_LOCATION src = {};
+			src.pResource = source;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint = *footprint;
+			src.PlacedFootprint.Offset += offset;
+			D3D12_TEXTURE_COPY_LOCATION dst = {};
+			dst.pResource = dstResource;
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = 0;
+			list->CopyTextureRegion(&dst, 0, 0, 0, &src, NULL);
+		}
+		else
+		{
+			list->CopyBufferRegion(dstResource, dstOffset, source, offset, size);
+		}
+		stats.uploads++;
+		stats.bytes += size;
+
+		// Keep the copy queue busy during long loads rather than waiting for the ring to fill
+		if (ring.bytesOpen() >= ring.size() / 4)
+		{
+			submit();
+		}
+	}
+
+	// Executes the open batch, if any; work the graphics queue is given from now on waits for it
+	void submit()
+	{
+		if (open < 0)
+		{
+			return;
+		}
+		Batch& batch = batches[open];
+		batch.list->Close();
+		ID3D12CommandList* lists[] = { batch.list };
+		copyQueue->ExecuteCommandLists(1, lists);
+		fence.signal(copyQueue);
+		batch.fenceValue = fence.value;
+		ring.close(fence.value);
+		graphicsQueue->Wait(fence.fence, fence.value);
+		open = -1;
+		stats.batches++;
+	}
+
+	// Shutdown, after the queues are idle
+	void release()
+	{
+		for (Batch& batch : batches)
+		{
+			batch.list->Release();
+			batch.allocator->Release();
+		}
+		batches.clear();
+		for (const Oversized& o : oversized)
+		{
+			o.resource->Release();
+		}
+		oversized.clear();
+		if (buffer)
+		{
+			buffer->Unmap(0, NULL);
+			buffer->Release();
+		}
+		buffer = nullptr;
+		mapped = nullptr;
+	}
+
+private:
+	struct Batch
+	{
+		ID3D12CommandAllocator* allocator;
+		ID3D12GraphicsCommandList4* list;
+		UINT64 fenceValue;
+	};
+
+	struct Oversized
+	{
+		ID3D12Resource* resource;
+		UINT64 fenceValue;
+	};
+
+	ID3D12Device5* device = nullptr;
+	ID3D12CommandQueue* copyQueue = nullptr;
+	ID3D12CommandQueue* graphicsQueue = nullptr;
+	GPUFence fence;
+	StagingRing ring;
+	ID3D12Resource* buffer = nullptr;
+	unsigned char* mapped = nullptr;
+	std::vector<Batch> batches;
+	std::vector<Oversized> oversized;
+	int open = -1;
+
+	void reclaim()
+	{
+		UINT64 completed = fence.fence->GetCompletedValue();
+		ring.reclaim(completed);
+		for (size_t i = 0; i < oversized.size();)
+		{
+			if (oversized[i].fenceValue <= completed)
+			{
+				oversized[i].resource->Release();
+				oversized[i] = oversized.back();
+				oversized.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	// The open batch's list, reusing the allocator of a finished batch when there is one
+	ID3D12GraphicsCommandList4* openList()
+	{
+		if (open >= 0)
+		{
+			return batches[open].list;
+		}
+		UINT64 completed = fence.fence->GetCompletedValue();
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			if (batches[i].fenceValue <= completed)
+			{
+				open = (int)i;
+				break;
+			}
+		}
+		if (open < 0)
+		{
+			Batch batch;
+			device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&batch.allocator));
+			device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_COPY, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&batch.list));
+			batches.push_back(batch);
+			open = (int)batches.size() - 1;
+		}
+		Batch& batch = batches[open];
+		batch.fenceValue = ~(UINT64)0;   // in use until submitted
+		batch.allocator->Reset();
+		batch.list->Reset(batch.allocator, NULL);
+		return batch.list;
+	}
+
+	ID3D12Resource* createUploadBuffer(size_t size, unsigned char** data)
+	{
+		D3D12_HEAP_PROPERTIES heapProps = {};
+		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		D3D12_RESOURCE_DESC bufferDesc = {};
+		bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufferDesc.Width = size;
+		bufferDesc.Height = 1;
+		bufferDesc.DepthOrArraySize = 1;
+		bufferDesc.MipLevels = 1;
+		bufferDesc.SampleDesc.Count = 1;
+		bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ID3D12Resource* resource;
+		device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&resource));
+		resource->Map(0, NULL, (void**)data);
+		return resource;
+	}
+};
+
+
+// Where a constant buffer entry was allocated: mapped for the CPU to write, and the address the
+// draw binds
+struct ConstantAllocation
+{
+	unsigned char* data;
+	D3D12_GPU_VIRTUAL_ADDRESS address;
+};
+
+// Upload-heap memory for constant buffers, shared by every shader. Each slab of the
+// FrameLinearAllocator is a persistently mapped buffer; a frame takes as many as it needs and
+// hands them back once its fence passes, so an entry is never rewritten while the GPU may read it.
+class ConstantAllocator
+{
+public:
+	static constexpr uint64_t SLAB_SIZE = 1024 * 1024;
+
+	void init(ID3D12Device5* _device)
+	{
+		device = _device;
+		allocator.init(SLAB_SIZE);
+		overflow = createSlab(D3D12_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16, &overflowData);
+	}
+
+	// 'alignment' is a power of two; constant buffer views need 256. Safe on any thread.
+	ConstantAllocation allocate(uint64_t size, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+	{
+		FrameLinearAllocator::Allocation a = allocator.allocate(size, alignment, [&](uint32_t slab, uint64_t slabSize) {
+			slabs[slab] = createSlab(slabSize, &slabData[slab]);
+			slabAddresses[slab] = slabs[slab]->GetGPUVirtualAddress();
+		});
+		if (!a.valid())
+		{
+			// Every slab is in use: share one scratch entry rather than bind nothing
+			return { overflowData, overflow->GetGPUVirtualAddress() };
+		}
+		return { slabData[a.slab] + a.offset, slabAddresses[a.slab] + a.offset };
+	}
+
+	// The frame's allocations are reused once 'fenceValue' completes
+	void close(UINT64 fenceValue)
+	{
+		allocator.close(fenceValue);
+		frames++;
+	}
+
+	// Frames closed so far; an entry allocated during frame() is valid until the next close()
+	uint64_t frame() const
+	{
+		return frames;
+	}
+
+	void reclaim(UINT64 completedValue)
+	{
+		allocator.reclaim(completedValue);
+	}
+
+	const FrameLinearAllocator::Stats& stats() const
+	{
+		return allocator.stats;
+	}
+
+	void resetPeak()
+	{
+		allocator.resetPeak();
+	}
+
+	unsigned int slabCount() const
+	{
+		return allocator.slabTotal();
+	}
+
+	unsigned long long reservedBytes() const
+	{
+		return allocator.reservedBytes();
+	}
+
+	// Shutdown, after the graphics queue is idle
+	void release()
+	{
+		for (uint32_t s = 0; s < allocator.slabTotal(); s++)
+		{
+			slabs[s]->Unmap(0, NULL);
+			slabs[s]->Release();
+		}
+		if (overflow)
+		{
+			overflow->Unmap(0, NULL);
+			overflow->Release();
+		}
+		overflow = nullptr;
+		allocator.init(SLAB_SIZE);
+	}
+
+private:
+	ID3D12Device5* device = nullptr;
+	FrameLinearAllocator allocator;
+	uint64_t frames = 0;
+	ID3D12Resource* slabs[FrameLinearAllocator::MAX_SLABS] = {};
+	unsigned char* slabData[FrameLinearAllocator::MAX_SLABS] = {};
+	D3D12_GPU_VIRTUAL_ADDRESS slabAddresses[FrameLinearAllocator::MAX_SLABS] = {};
+	ID3D12Resource* overflow = nullptr;
+	unsigned char* overflowData = nullptr;
+
+	ID3D12Resource* createSlab(uint64_t size, unsigned char** data)
+	{
+		D3D12_HEAP_PROPERTIES heapProps = {};
+		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		D3D12_RESOURCE_DESC bufferDesc = {};
+		bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufferDesc.Width = size;
+		bufferDesc.Height = 1;
+		bufferDesc.DepthOrArraySize = 1;
+		bufferDesc.MipLevels = 1;
+		bufferDesc.SampleDesc.Count = 1;
+		bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ID3D12Resource* resource;
+		device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&resource));
+		resource->Map(0, NULL, (void**)data);
+		return resource;
+	}
+};
+
 class Core
 {
 public:
@@ -93,6 +514,32 @@ public:
 	// Root signature
 	ID3D12RootSignature* rootSignature;
 
+	// Draw commands go through here rather than straight to the command list, which never sees
+	// a state command that repeats what is bound
+	D3D12CommandRecorder recorder;
+
+	// Staging ring and copy-queue batches behind uploadResource
+	UploadBatcher uploads;
+	unsigned int queueFlushes = 0;
+
+	// Per-frame constant buffer entries for every shader
+	ConstantAllocator constants;
+
+	// Parallel recording: a command allocator and list per chunk per frame in flight, created on
+	// demand by prepareChunks, plus a recorder per chunk
+	static constexpr unsigned int MAX_RECORDING_CHUNKS = 16;
+	ID3D12CommandAllocator* chunkAllocators[2][MAX_RECORDING_CHUNKS] = {};
+	ID3D12GraphicsCommandList4* chunkLists[2][MAX_RECORDING_CHUNKS] = {};
+	D3D12CommandRecorder chunkRecorders[MAX_RECORDING_CHUNKS];
+	unsigned int chunkListCount = 0;
+
+	// Set by beginFrame for recording threads, which must not touch the swapchain
+	unsigned int recordingFrame = 0;
+	D3D12_CPU_DESCRIPTOR_HANDLE renderTargetHandle = {};
+
+	// Chunk a thread is recording, if any; commands() goes there instead of the frame's list
+	static inline thread_local CommandRecorder* threadRecorder = nullptr;
+
     // Initialize members to safe defaults
     Core()
         : adapter(nullptr), device(nullptr), graphicsQueue(nullptr), copyQueue(nullptr), computeQueue(nullptr), swapchain(nullptr), backbufferHeap(nullptr), backbuffers(nullptr), dsvHeap(nullptr), dsv(nullptr), rootSignature(nullptr)
@@ -101,6 +548,7 @@ public:
         graphicsCommandList[0] = graphicsCommandList[1] = nullptr;
         graphicsQueueFence[0].fence = nullptr;
         graphicsQueueFence[1].fence = nullptr;
+        recorder.skipRedundant = true;
         // eventHandles and other init occur when fences are created
     }
 
@@ -326,13 +774,35 @@ public:
 		serialized->Release();
 
 
+		uploads.init(device, copyQueue, graphicsQueue, 64 * 1024 * 1024);
+		constants.init(device);
+
 		factory->Release();
 	}
 
+	// Every graphics-queue signal takes the next value of one sequence. The queue executes in
+	// order, so the highest value any of its fences has reached covers all earlier submissions.
+	UINT64 graphicsFenceValue = 0;
+
+	// Value the next signal will carry, i.e. the one that covers everything recorded so far
+	UINT64 nextGraphicsFenceValue() const
+	{
+		return graphicsFenceValue + 1;
+	}
+
+	UINT64 completedGraphicsFenceValue() const
+	{
+		UINT64 a = graphicsQueueFence[0].fence->GetCompletedValue();
+		UINT64 b = graphicsQueueFence[1].fence->GetCompletedValue();
+		return a > b ? a : b;
+	}
+
 	// ensures all work is completed before mobing on
 	void flushGraphicsQueue()
 	{
-		graphicsQueueFence[0].signal(graphicsQueue);
+		uploads.submit();
+		queueFlushes++;
+		graphicsQueueFence[0].signal(graphicsQueue, ++graphicsFenceValue);
 		graphicsQueueFence[0].wait();
 	}
 
@@ -342,6 +812,8 @@ public:
 		unsigned int frameIndex = swapchain->GetCurrentBackBufferIndex();
 		graphicsCommandAllocator[frameIndex]->Reset();
 		graphicsCommandList[frameIndex]->Reset(graphicsCommandAllocator[frameIndex], NULL);
+		recorder.list = graphicsCommandList[frameIndex];
+		recorder.resetState();
 	}
 
 	// Gets current command list
@@ -351,9 +823,73 @@ public:
 		return graphicsCommandList[frameIndex];
 	}
 
+	// Records into the current command list
+	CommandRecorder& commands()
+	{
+		return threadRecorder ? *threadRecorder : recorder;
+	}
+
+	// Creates lists for the first 'count' chunks of both frames; on the main thread before recording
+	void prepareChunks(unsigned int count)
+	{
+		count = (std::min)(count, MAX_RECORDING_CHUNKS);
+		for (; chunkListCount < count; chunkListCount++)
+		{
+			for (unsigned int f = 0; f < 2; f++)
+			{
+				device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&chunkAllocators[f][chunkListCount]));
+				device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&chunkLists[f][chunkListCount]));
+			}
+			chunkRecorders[chunkListCount].skipRedundant = true;
+		}
+	}
+
+	// On a recording thread: opens chunk 'k' of this frame on the frame's targets with the render
+	// pass state set, and routes commands() on this thread to it until endChunk()
+	CommandRecorder& beginChunk(unsigned int k)
+	{
+		ID3D12GraphicsCommandList4* list = chunkLists[recordingFrame][k];
+		chunkAllocators[recordingFrame][k]->Reset();
+		list->Reset(chunkAllocators[recordingFrame][k], NULL);
+		list->OMSetRenderTargets(1, &renderTargetHandle, FALSE, &dsvHandle);
+		chunkRecorders[k].list = list;
+		chunkRecorders[k].resetState();
+		chunkRecorders[k].stats.reset();
+		threadRecorder = &chunkRecorders[k];
+		beginRenderPass();
+		return chunkRecorders[k];
+	}
+
+	void endChunk()
+	{
+		threadRecorder = nullptr;
+	}
+
+	// Ordered submit: what the frame's list holds so far, then chunks 0..count-1. The frame's list
+	// is reopened on the same targets, so later passes and finishFrame carry on as before.
+	void executeChunks(unsigned int count)
+	{
+		uploads.submit();
+		ID3D12CommandList* lists[MAX_RECORDING_CHUNKS + 1];
+		getCommandList()->Close();
+		lists[0] = getCommandList();
+		for (unsigned int k = 0; k < count; k++)
+		{
+			chunkLists[recordingFrame][k]->Close();
+			lists[k + 1] = chunkLists[recordingFrame][k];
+		}
+		graphicsQueue->ExecuteCommandLists(count + 1, lists);
+
+		// Commands already submitted, so the allocator stays as it is
+		getCommandList()->Reset(graphicsCommandAllocator[recordingFrame], NULL);
+		recorder.resetState();
+		getCommandList()->OMSetRenderTargets(1, &renderTargetHandle, FALSE, &dsvHandle);
+	}
+
 	// Close and execute the command list
 	void runCommandList()
 	{
+		uploads.submit();
 		getCommandList()->Close();
 		ID3D12CommandList* lists[] = { getCommandList() };
 		graphicsQueue->ExecuteCommandLists(1, lists);
@@ -364,10 +900,13 @@ public:
 		unsigned int frameIndex = swapchain->GetCurrentBackBufferIndex();
 
 		graphicsQueueFence[frameIndex].wait();
+		constants.reclaim(completedGraphicsFenceValue());
 
 		D3D12_CPU_DESCRIPTOR_HANDLE renderTargetViewHandle = backbufferHeap -> GetCPUDescriptorHandleForHeapStart();
 		unsigned int renderTargetViewDescriptorSize = device -> GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 		renderTargetViewHandle.ptr += frameIndex * renderTargetViewDescriptorSize;
+		recordingFrame = frameIndex;
+		renderTargetHandle = renderTargetViewHandle;
 		resetCommandList();
 		Barrier::add(backbuffers[frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET, getCommandList());
 		getCommandList()->OMSetRenderTargets(1, &renderTargetViewHandle, FALSE, &dsvHandle);
@@ -386,67 +925,42 @@ public:
 		unsigned int frameIndex = swapchain->GetCurrentBackBufferIndex();
 		Barrier::add(backbuffers[frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT, getCommandList());
 		runCommandList();
-		graphicsQueueFence[frameIndex].signal(graphicsQueue);
+		graphicsQueueFence[frameIndex].signal(graphicsQueue, ++graphicsFenceValue);
+		constants.close(graphicsFenceValue);
 		swapchain->Present(1, 0);
 	}
 
-	// Copies some data (pointer to memory), allocate memory in upload heap
-	void uploadResource(ID3D12Resource* dstResource, const void* data, unsigned int size, D3D12_RESOURCE_STATES targetState, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* texFootprint = NULL)
+	// Copies some data into a resource created in COMMON, which is promoted to the state it is
+	// first used in. Batched on the copy queue (UploadBatcher), so this returns without waiting.
+	void uploadResource(ID3D12Resource* dstResource, const void* data, unsigned int size, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* texFootprint = NULL)
 	{
-		ID3D12Resource* uploadBuffer;
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		D3D12_RESOURCE_DESC bufferDesc = {};
-		bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		bufferDesc.Width = size;
-		bufferDesc.Height = 1;
-		bufferDesc.DepthOrArraySize = 1;
-		bufferDesc.MipLevels = 1;
-		bufferDesc.SampleDesc.Count = 1;
-		bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, IID_PPV_ARGS(&uploadBuffer));
-
-		void* mappeddata = NULL;                          // Initialises data
-		uploadBuffer->Map(0, NULL, &mappeddata);
-		memcpy(mappeddata, data, size);
-		uploadBuffer->Unmap(0, NULL);
-
-		resetCommandList();
-
-		if (texFootprint != NULL)
-		{
-			D3D12_TEXTURE_COPY_LOCATION src = {};
-			src.pResource = uploadBuffer;
-			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-			src.PlacedFootprint = *texFootprint;
-			D3D12_TEXTURE_COPY_LOCATION dst = {};
-			dst.pResource = dstResource;
-			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-			dst.SubresourceIndex = 0;
-			getCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, NULL);
-		}
-		else
-		{
-			getCommandList()->CopyBufferRegion(dstResource, 0, uploadBuffer, 0, size);
-		}
-
-		// Transition buffer to final state after copying
-		Barrier::add(dstResource, D3D12_RESOURCE_STATE_COPY_DEST, targetState, getCommandList());
-
-		runCommandList();    // close and execute command lists
-
-		flushGraphicsQueue();   // wait for command to finish
-
-		uploadBuffer->Release();  //  release upload heap memory
+		uploads.upload(dstResource, 0, data, size, texFootprint);
+	}
 
+	// The same into part of a buffer, e.g. a GPUBufferHeap range
+	void uploadBuffer(ID3D12Resource* dstResource, UINT64 dstOffset, const void* data, unsigned int size)
+	{
+		uploads.upload(dstResource, dstOffset, data, size);
 	}
 
 	// Functionality to set common draw functionality
 	void beginRenderPass()
 	{
-		getCommandList()->RSSetViewports(1, &viewport);
-		getCommandList()->RSSetScissorRects(1, &scissorRect);
-		getCommandList()->SetGraphicsRootSignature(rootSignature);
+		RenderViewport v;
+		v.x = viewport.TopLeftX;
+		v.y = viewport.TopLeftY;
+		v.width = viewport.Width;
+		v.height = viewport.Height;
+		v.minDepth = viewport.MinDepth;
+		v.maxDepth = viewport.MaxDepth;
+		RenderScissor r;
+		r.left = scissorRect.left;
+		r.top = scissorRect.top;
+		r.right = scissorRect.right;
+		r.bottom = scissorRect.bottom;
+		commands().setViewport(v);
+		commands().setScissor(r);
+		commands().setRootSignature(rootSignature);
 	}
 
 
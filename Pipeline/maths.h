@@ -4,7 +4,9 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
-#include "GamesEngineeringBase.h"
+#ifdef _WIN32
+#include "GamesEngineeringBase.h"  // Windows only; the maths types build headless without it
+#endif
 using namespace std;
 
 // Use a float PI to avoid double->float implicit conversions
@@ -370,6 +372,7 @@ public:
     Vec4 v0, v1, v2;
     Triangle(Vec4 a, Vec4 b, Vec4 c) : v0(a), v1(b), v2(c) {}
     float edgeFunction(const Vec4& a, const Vec4& b, const Vec4& p) const { return ((p.x - a.x) * (b.y - a.y)) - ((b.x - a.x) * (p.y - a.y)); }
+#ifdef _WIN32
     void findBounds(Vec4& tr, Vec4& bl, GamesEngineeringBase::Window& canvas) const
     {
         tr.x = min(max(max(v0.x,v1.x), v2.x), canvas.getWidth()-1);
@@ -377,6 +380,7 @@ public:
         bl.x = max(min(min(v0.x,v1.x), v2.x), 0);
         bl.y = max(min(min(v0.y,v1.y), v2.y), 0);
     }
+#endif
     void barycentricCoordinates(const Vec4& p, float& alpha, float& beta, float& gamma) const
     {
         alpha = edgeFunction(v1, v2, p);
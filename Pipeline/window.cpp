@@ -23,6 +23,17 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			 return 0;
 		 }
 
+		// F10 arrives as a system key (menu activation); take it as an ordinary key and leave Alt
+		// combinations such as Alt+F4 to the default handling
+		case WM_SYSKEYDOWN:
+		case WM_SYSKEYUP:
+		{
+			 if (wParam != VK_F10) return DefWindowProc(hwnd, msg, wParam, lParam);
+			 Window* wnd = (Window*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+			 if (wnd) wnd->keys[VK_F10] = msg == WM_SYSKEYDOWN;
+			return 0;
+		}
+
 		case WM_KEYDOWN:
 		{
 			 Window* wnd = (Window*)GetWindowLongPtr(hwnd, GWLP_USERDATA);